@@ -0,0 +1,26 @@
+# Find the brotli decoder include file and library.
+
+find_package(PkgConfig)
+pkg_check_modules(PC_BROTLI libbrotlidec)
+
+find_path(BROTLI_INCLUDE_DIR
+    NAMES brotli/decode.h
+    HINTS ${BROTLI_INCLUDE_DIR_HINT} ${PC_BROTLI_INCLUDEDIR} ${PC_BROTLI_INCLUDE_DIRS}
+)
+
+find_library(BROTLI_LIBRARY
+    NAMES brotlidec
+    HINTS ${BROTLI_LIBRARIES_DIR_HINT} ${PC_BROTLI_LIBDIR} ${PC_BROTLI_LIBRARY_DIRS}
+)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(
+    Brotli
+    REQUIRED_VARS
+        BROTLI_INCLUDE_DIR BROTLI_LIBRARY
+)
+
+mark_as_advanced(
+    BROTLI_INCLUDE_DIR
+    BROTLI_LIBRARY
+)
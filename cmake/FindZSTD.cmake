@@ -0,0 +1,26 @@
+# Find the zstd include file and library.
+
+find_package(PkgConfig)
+pkg_check_modules(PC_ZSTD libzstd)
+
+find_path(ZSTD_INCLUDE_DIR
+    NAMES zstd.h
+    HINTS ${ZSTD_INCLUDE_DIR_HINT} ${PC_ZSTD_INCLUDEDIR} ${PC_ZSTD_INCLUDE_DIRS}
+)
+
+find_library(ZSTD_LIBRARY
+    NAMES zstd
+    HINTS ${ZSTD_LIBRARIES_DIR_HINT} ${PC_ZSTD_LIBDIR} ${PC_ZSTD_LIBRARY_DIRS}
+)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(
+    ZSTD
+    REQUIRED_VARS
+        ZSTD_INCLUDE_DIR ZSTD_LIBRARY
+)
+
+mark_as_advanced(
+    ZSTD_INCLUDE_DIR
+    ZSTD_LIBRARY
+)
@@ -5,6 +5,12 @@
 
 set ( SHELL ${ENABLE_SHELL} )
 set ( UNIT_TEST ${ENABLE_UNIT_TESTS} )
+
+if ( ENABLE_BENCHMARK_TESTS AND NOT ENABLE_UNIT_TESTS )
+    message ( FATAL_ERROR "ENABLE_BENCHMARK_TESTS requires ENABLE_UNIT_TESTS" )
+endif ( ENABLE_BENCHMARK_TESTS AND NOT ENABLE_UNIT_TESTS )
+
+set ( BENCHMARK_TEST ${ENABLE_BENCHMARK_TESTS} )
 set ( PIGLET ${ENABLE_PIGLET} )
 
 if ( NOT ENABLE_COREFILES )
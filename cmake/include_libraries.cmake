@@ -15,6 +15,8 @@ endif (ENABLE_UNIT_TESTS)
 
 # optional libraries
 find_package(LibLZMA QUIET)
+find_package(Brotli QUIET)
+find_package(ZSTD QUIET)
 find_package(Asciidoc QUIET)
 find_package(DBLATEX QUIET)
 find_package(Ruby QUIET 1.8.7)
@@ -145,6 +145,14 @@ if (DEFINED LIBLZMA_LIBRARIES)
     check_library_exists (${LIBLZMA_LIBRARIES} lzma_code "" HAVE_LZMA)
 endif()
 
+if (BROTLI_FOUND)
+    check_library_exists ("${BROTLI_LIBRARY}" BrotliDecoderDecompressStream "" HAVE_BROTLI)
+endif()
+
+if (ZSTD_FOUND)
+    check_library_exists ("${ZSTD_LIBRARY}" ZSTD_decompressStream "" HAVE_ZSTD)
+endif()
+
 if (ICONV_FOUND)
     # Not actually a sanity check at the moment...
     set (HAVE_ICONV "1")
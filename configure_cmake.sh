@@ -68,6 +68,8 @@ Optional Features:
     --enable-appid-third-party
                             enable third party appid
     --enable-unit-tests     build unit tests
+    --enable-benchmark-tests
+                            build benchmark tests (implies --enable-unit-tests)
     --enable-piglet         build piglet test harness
     --enable-ccache         enable ccache support
     --disable-static-daq    link static DAQ modules
@@ -115,6 +117,14 @@ Optional Packages:
                             libuuid include directory
     --with-uuid-libraries=DIR
                             libuuid library directory
+    --with-brotli-includes=DIR
+                            brotli include directory
+    --with-brotli-libraries=DIR
+                            brotli library directory
+    --with-zstd-includes=DIR
+                            libzstd include directory
+    --with-zstd-libraries=DIR
+                            libzstd library directory
 
 Some influential variable definitions:
     SIGNAL_SNORT_RELOAD=<int>
@@ -321,6 +331,13 @@ while [ $# -ne 0 ]; do
         --disable-unit-tests)
             append_cache_entry ENABLE_UNIT_TESTS        BOOL false
             ;;
+        --enable-benchmark-tests)
+            append_cache_entry ENABLE_UNIT_TESTS        BOOL true
+            append_cache_entry ENABLE_BENCHMARK_TESTS   BOOL true
+            ;;
+        --disable-benchmark-tests)
+            append_cache_entry ENABLE_BENCHMARK_TESTS   BOOL false
+            ;;
         --enable-piglet)
             append_cache_entry ENABLE_PIGLET            BOOL true
             ;;
@@ -427,6 +444,18 @@ while [ $# -ne 0 ]; do
         --with-uuid-libraries=*)
             append_cache_entry UUID_LIBRARIES_DIR_HINT PATH $optarg
             ;;
+        --with-brotli-includes=*)
+            append_cache_entry BROTLI_INCLUDE_DIR_HINT PATH $optarg
+            ;;
+        --with-brotli-libraries=*)
+            append_cache_entry BROTLI_LIBRARIES_DIR_HINT PATH $optarg
+            ;;
+        --with-zstd-includes=*)
+            append_cache_entry ZSTD_INCLUDE_DIR_HINT PATH $optarg
+            ;;
+        --with-zstd-libraries=*)
+            append_cache_entry ZSTD_LIBRARIES_DIR_HINT PATH $optarg
+            ;;
         SIGNAL_SNORT_RELOAD=*)
             append_cache_entry SIGNAL_SNORT_RELOAD STRING $optarg
             ;;
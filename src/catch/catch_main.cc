@@ -16,5 +16,13 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 //--------------------------------------------------------------------------
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef BENCHMARK_TEST
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#endif
+
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
@@ -29,6 +29,8 @@
 #include "main/thread.h"
 #include "utils/util.h"
 
+#include "inflate_pool.h"
+
 #ifdef UNIT_TEST
 #include "catch/snort_catch.h"
 #endif
@@ -902,24 +904,20 @@ static fd_status_t Init_Stream(fd_session_t* SessionPtr)
     {
     case FILE_COMPRESSION_TYPE_DEFLATE:
     {
-        int z_ret;
-
-        z_stream* z_s = &(StPtr->PDF_Decomp_State.Deflate.StreamDeflate);
-
-        memset( (char*)z_s, 0, sizeof(z_stream));
+        z_stream*& z_s = StPtr->PDF_Decomp_State.Deflate.StreamDeflate;
 
-        z_s->zalloc = (alloc_func)nullptr;
-        z_s->zfree = (free_func)nullptr;
-        SYNC_IN(z_s)
-
-        z_ret = inflateInit2(z_s, 47);
+        // 47 = 32 + MAX_WBITS, detect zlib or gzip header
+        InflatePool::release(z_s);
+        z_s = InflatePool::acquire(47);
 
-        if ( z_ret != Z_OK )
+        if ( !z_s )
         {
             File_Decomp_Alert(SessionPtr, FILE_DECOMP_ERR_PDF_DEFL_FAILURE);
             return File_Decomp_Error;
         }
 
+        SYNC_IN(z_s)
+
         break;
     }
     default:
@@ -945,7 +943,7 @@ static fd_status_t Decomp_Stream(fd_session_t* SessionPtr)
     case FILE_COMPRESSION_TYPE_DEFLATE:
     {
         int z_ret;
-        z_stream* z_s = &(StPtr->PDF_Decomp_State.Deflate.StreamDeflate);
+        z_stream* z_s = StPtr->PDF_Decomp_State.Deflate.StreamDeflate;
 
         SYNC_IN(z_s)
 
@@ -1002,16 +1000,10 @@ fd_status_t File_Decomp_End_PDF(fd_session_t* SessionPtr)
     {
     case FILE_COMPRESSION_TYPE_DEFLATE:
     {
-        int z_ret;
-        z_stream* z_s = &(StPtr->PDF_Decomp_State.Deflate.StreamDeflate);
+        z_stream*& z_s = StPtr->PDF_Decomp_State.Deflate.StreamDeflate;
 
-        z_ret = inflateEnd(z_s);
-
-        if ( z_ret != Z_OK )
-        {
-            File_Decomp_Alert(SessionPtr, FILE_DECOMP_ERR_PDF_DEFL_FAILURE);
-            return File_Decomp_Error;
-        }
+        InflatePool::release(z_s);
+        z_s = nullptr;
 
         break;
     }
@@ -24,6 +24,8 @@
 
 #include "file_decomp_swf.h"
 
+#include "inflate_pool.h"
+
 #include "utils/util.h"
 
 #ifdef UNIT_TEST
@@ -100,7 +102,7 @@ static fd_status_t Decomp(fd_session_t* SessionPtr)
     case FILE_COMPRESSION_TYPE_ZLIB:
     {
         int z_ret;
-        z_stream* z_s = &(SessionPtr->SWF->StreamZLIB);
+        z_stream* z_s = SessionPtr->SWF->StreamZLIB;
 
         SYNC_IN(z_s)
 
@@ -163,16 +165,8 @@ fd_status_t File_Decomp_End_SWF(fd_session_t* SessionPtr)
     {
     case FILE_COMPRESSION_TYPE_ZLIB:
     {
-        int z_ret;
-        z_stream* z_s = &(SessionPtr->SWF->StreamZLIB);
-
-        z_ret = inflateEnd(z_s);
-
-        if ( z_ret != Z_OK )
-        {
-            SessionPtr->Error_Event = FILE_DECOMP_ERR_SWF_ZLIB_FAILURE;
-            return( File_Decomp_DecompError );
-        }
+        InflatePool::release(SessionPtr->SWF->StreamZLIB);
+        SessionPtr->SWF->StreamZLIB = nullptr;
 
         break;
     }
@@ -209,28 +203,22 @@ fd_status_t File_Decomp_Init_SWF(fd_session_t* SessionPtr)
     {
     case FILE_COMPRESSION_TYPE_ZLIB:
     {
-        int z_ret;
         z_stream* z_s;
 
         SessionPtr->SWF->Header_Len =
             SWF_VER_LEN + SWF_UCL_LEN;
 
-        z_s = &(SessionPtr->SWF->StreamZLIB);
-
-        memset( (char*)z_s, 0, sizeof(z_stream));
-
-        z_s->zalloc = (alloc_func)nullptr;
-        z_s->zfree = (free_func)nullptr;
-        SYNC_IN(z_s)
-
-        z_ret = inflateInit(z_s);
+        z_s = InflatePool::acquire(MAX_WBITS);
 
-        if ( z_ret != Z_OK )
+        if ( !z_s )
         {
             SessionPtr->Error_Event = FILE_DECOMP_ERR_SWF_ZLIB_FAILURE;
             return( File_Decomp_DecompError );
         }
 
+        SessionPtr->SWF->StreamZLIB = z_s;
+        SYNC_IN(z_s)
+
         break;
     }
 #ifdef HAVE_LZMA
@@ -0,0 +1,211 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "inflate_pool.h"
+
+#include <cstring>
+
+#include "main/thread.h"
+#include "memory/memory_cap.h"
+#include "utils/util.h"
+
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
+using namespace snort;
+
+// each cached stream holds about 7K of state plus a 32K window
+static const unsigned max_cached = 16;
+
+// zlib allocations are prefixed with their size so they can be accounted
+static const size_t header_size = 16;
+
+static THREAD_LOCAL z_stream* cache[max_cached];
+static THREAD_LOCAL unsigned num_cached = 0;
+static THREAD_LOCAL PegCount pool_hits = 0;
+static THREAD_LOCAL PegCount pool_misses = 0;
+
+static voidpf pool_alloc(voidpf, uInt items, uInt size)
+{
+    size_t n = (size_t)items * size;
+    uint8_t* p = (uint8_t*)snort_alloc(n + header_size);
+    *(size_t*)p = n;
+    memory::MemoryCap::update_allocations(n);
+    return p + header_size;
+}
+
+static void pool_free(voidpf, voidpf addr)
+{
+    uint8_t* p = (uint8_t*)addr - header_size;
+    memory::MemoryCap::update_deallocations(*(size_t*)p);
+    snort_free(p);
+}
+
+static void destroy(z_stream* zs)
+{
+    inflateEnd(zs);
+    memory::MemoryCap::update_deallocations(sizeof(*zs));
+    delete zs;
+}
+
+z_stream* InflatePool::acquire(int window_bits)
+{
+    z_stream* zs;
+
+    while ( num_cached )
+    {
+        zs = cache[--num_cached];
+
+        if ( inflateReset2(zs, window_bits) == Z_OK )
+        {
+            zs->next_in = Z_NULL;
+            zs->avail_in = 0;
+            pool_hits++;
+            return zs;
+        }
+        destroy(zs);
+    }
+
+    pool_misses++;
+
+    zs = new z_stream;
+    memset(zs, 0, sizeof(*zs));
+    zs->zalloc = pool_alloc;
+    zs->zfree = pool_free;
+    zs->next_in = Z_NULL;
+    zs->avail_in = 0;
+
+    memory::MemoryCap::update_allocations(sizeof(*zs));
+
+    if ( inflateInit2(zs, window_bits) != Z_OK )
+    {
+        memory::MemoryCap::update_deallocations(sizeof(*zs));
+        delete zs;
+        return nullptr;
+    }
+    return zs;
+}
+
+void InflatePool::release(z_stream* zs)
+{
+    if ( !zs )
+        return;
+
+    if ( num_cached < max_cached and !memory::MemoryCap::over_threshold() )
+        cache[num_cached++] = zs;
+    else
+        destroy(zs);
+}
+
+void InflatePool::get_counts(PegCount& hits, PegCount& misses)
+{
+    hits += pool_hits;
+    misses += pool_misses;
+    pool_hits = pool_misses = 0;
+}
+
+void InflatePool::thread_term()
+{
+    while ( num_cached )
+        destroy(cache[--num_cached]);
+}
+
+//--------------------------------------------------------------------------
+// unit tests
+//--------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+static const char* text = "the quick brown fox jumps over the lazy dog";
+
+static unsigned deflate_text(uint8_t* out, unsigned len, int window_bits)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    REQUIRE(deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, 8,
+        Z_DEFAULT_STRATEGY) == Z_OK);
+
+    zs.next_in = (Bytef*)text;
+    zs.avail_in = strlen(text);
+    zs.next_out = out;
+    zs.avail_out = len;
+    CHECK(deflate(&zs, Z_FINISH) == Z_STREAM_END);
+    deflateEnd(&zs);
+
+    return len - zs.avail_out;
+}
+
+static void inflate_text(z_stream* zs, uint8_t* in, unsigned len)
+{
+    char out[128];
+
+    zs->next_in = in;
+    zs->avail_in = len;
+    zs->next_out = (Bytef*)out;
+    zs->avail_out = sizeof(out);
+
+    CHECK(inflate(zs, Z_SYNC_FLUSH) == Z_STREAM_END);
+    CHECK((sizeof(out) - zs->avail_out) == strlen(text));
+    CHECK(!memcmp(out, text, strlen(text)));
+}
+
+TEST_CASE("inflate pool reuse", "[inflate_pool]")
+{
+    uint8_t gzip[128], raw[128];
+    unsigned gzip_len = deflate_text(gzip, sizeof(gzip), 31);
+    unsigned raw_len = deflate_text(raw, sizeof(raw), -15);
+
+    PegCount hits = 0, misses = 0;
+    InflatePool::thread_term();
+    InflatePool::get_counts(hits, misses);
+    hits = misses = 0;
+
+    z_stream* zs = InflatePool::acquire(31);
+    REQUIRE(zs);
+    inflate_text(zs, gzip, gzip_len);
+    InflatePool::release(zs);
+
+    // reused with a different format
+    z_stream* zs2 = InflatePool::acquire(-15);
+    CHECK(zs2 == zs);
+    inflate_text(zs2, raw, raw_len);
+
+    // nothing cached so this is new
+    z_stream* zs3 = InflatePool::acquire(31);
+    REQUIRE(zs3);
+    CHECK(zs3 != zs2);
+    inflate_text(zs3, gzip, gzip_len);
+
+    InflatePool::release(zs2);
+    InflatePool::release(zs3);
+    InflatePool::release(nullptr);
+
+    InflatePool::get_counts(hits, misses);
+    CHECK(hits == 1);
+    CHECK(misses == 2);
+
+    InflatePool::thread_term();
+}
+
+#endif
+
@@ -1,5 +1,5 @@
 //--------------------------------------------------------------------------
-// Copyright (C) 2019-2020 Cisco and/or its affiliates. All rights reserved.
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
 //
 // This program is free software; you can redistribute it and/or modify it
 // under the terms of the GNU General Public License Version 2 as published
@@ -15,43 +15,37 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 //--------------------------------------------------------------------------
-// http2_huffman_state_machine.h author Maya Dagon <mdagon@cisco.com>
 
-#ifndef HTTP2_HUFFMAN_STATE_MACHINE_H
-#define HTTP2_HUFFMAN_STATE_MACHINE_H
+#ifndef INFLATE_POOL_H
+#define INFLATE_POOL_H
 
+// per thread cache of zlib inflate streams shared by all decompressors.
+// acquire() returns a stream ready for inflate() with the given window
+// bits.  release() keeps the stream so the next acquire() only needs
+// inflateReset2() instead of inflateInit2() and the internal state and
+// window are not freed and reallocated for every body or file.  all zlib
+// memory is accounted with MemoryCap.
+
+#include <zlib.h>
+
+#include "framework/counts.h"
 #include "main/snort_types.h"
 
-enum HuffmanState
+class SO_PUBLIC InflatePool
 {
-    HUFFMAN_LOOKUP_1 = 0,
-    HUFFMAN_LOOKUP_2 = 1,
-    HUFFMAN_LOOKUP_3 = 2,
-    HUFFMAN_LOOKUP_4 = 3,
-    HUFFMAN_LOOKUP_5 = 4,
-    HUFFMAN_LOOKUP_6 = 5,
-    HUFFMAN_LOOKUP_7 = 6,
-    HUFFMAN_LOOKUP_8 = 7,
-    HUFFMAN_LOOKUP_9 = 8,
-    HUFFMAN_LOOKUP_10 = 9,
-    HUFFMAN_LOOKUP_11 = 10,
-    HUFFMAN_LOOKUP_12 = 11,
-    HUFFMAN_LOOKUP_13 = 12,
-    HUFFMAN_LOOKUP_14 = 13,
-    HUFFMAN_LOOKUP_15 = 14,
-    HUFFMAN_LOOKUP_MAX = HUFFMAN_LOOKUP_15,
-    HUFFMAN_MATCH = HUFFMAN_LOOKUP_MAX + 1,
-    HUFFMAN_FAILURE = HUFFMAN_MATCH + 1
-};
+public:
+    // returns nullptr if zlib can't be initialized
+    static z_stream* acquire(int window_bits);
 
-struct HuffmanEntry
-{
-    uint8_t len;
-    char symbol;
-    HuffmanState state;
-};
+    // null is ok
+    static void release(z_stream*);
+
+    // adds and clears this thread's counts
+    static void get_counts(PegCount& hits, PegCount& misses);
 
-extern const HuffmanEntry huffman_decode[][UINT8_MAX+1];
+    // frees this thread's cached streams
+    static void thread_term();
+};
 
 #endif
 
@@ -0,0 +1,449 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "stream_decomp.h"
+
+#ifdef HAVE_BROTLI
+#include <brotli/decode.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#include <zstd_errors.h>
+#endif
+
+#include "memory/memory_cap.h"
+#include "utils/util.h"
+
+#ifdef UNIT_TEST
+#include <cstring>
+
+#include "catch/snort_catch.h"
+#endif
+
+using namespace snort;
+
+//--------------------------------------------------------------------------
+// brotli
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_BROTLI
+
+class BrotliDecomp : public StreamDecomp
+{
+public:
+    BrotliDecomp(uint32_t cap) : memcap(cap)
+    { state = BrotliDecoderCreateInstance(alloc, dealloc, this); }
+
+    ~BrotliDecomp() override
+    {
+        if ( state )
+            BrotliDecoderDestroyInstance(state);
+    }
+
+    bool is_valid() const
+    { return state != nullptr; }
+
+    Status decompress(const uint8_t*&, uint32_t&, uint8_t*&, uint32_t&) override;
+
+private:
+    // allocations are prefixed with their size so they can be accounted
+    static const size_t header_size = 16;
+
+    static void* alloc(void*, size_t);
+    static void dealloc(void*, void*);
+
+    BrotliDecoderState* state;
+    size_t memcap;
+    size_t used = 0;
+    bool over_cap = false;
+    bool done = false;
+};
+
+void* BrotliDecomp::alloc(void* opaque, size_t n)
+{
+    BrotliDecomp* bd = (BrotliDecomp*)opaque;
+
+    if ( bd->used + n > bd->memcap )
+    {
+        bd->over_cap = true;
+        return nullptr;
+    }
+
+    uint8_t* p = (uint8_t*)snort_alloc(n + header_size);
+    *(size_t*)p = n;
+
+    bd->used += n;
+    memory::MemoryCap::update_allocations(n);
+
+    return p + header_size;
+}
+
+void BrotliDecomp::dealloc(void* opaque, void* addr)
+{
+    if ( !addr )
+        return;
+
+    BrotliDecomp* bd = (BrotliDecomp*)opaque;
+    uint8_t* p = (uint8_t*)addr - header_size;
+    size_t n = *(size_t*)p;
+
+    bd->used -= n;
+    memory::MemoryCap::update_deallocations(n);
+
+    snort_free(p);
+}
+
+StreamDecomp::Status BrotliDecomp::decompress(
+    const uint8_t*& next_in, uint32_t& avail_in, uint8_t*& next_out, uint32_t& avail_out)
+{
+    if ( done )
+        return SD_END;
+
+    size_t in_len = avail_in;
+    size_t out_len = avail_out;
+
+    BrotliDecoderResult ret = BrotliDecoderDecompressStream(
+        state, &in_len, &next_in, &out_len, &next_out, nullptr);
+
+    avail_in = in_len;
+    avail_out = out_len;
+
+    switch ( ret )
+    {
+    case BROTLI_DECODER_RESULT_SUCCESS:
+        done = true;
+        return SD_END;
+
+    case BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT:
+    case BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT:
+        return SD_OK;
+
+    default:
+        break;
+    }
+    return over_cap ? SD_MEMCAP : SD_ERROR;
+}
+
+#endif
+
+//--------------------------------------------------------------------------
+// zstd
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_ZSTD
+
+class ZstdDecomp : public StreamDecomp
+{
+public:
+    ZstdDecomp(uint32_t memcap);
+    ~ZstdDecomp() override;
+
+    bool is_valid() const
+    { return stream != nullptr; }
+
+    Status decompress(const uint8_t*&, uint32_t&, uint8_t*&, uint32_t&) override;
+
+private:
+    void update_memory();
+
+    ZSTD_DStream* stream;
+    size_t used = 0;
+    bool done = false;
+};
+
+ZstdDecomp::ZstdDecomp(uint32_t memcap)
+{
+    stream = ZSTD_createDStream();
+
+    if ( !stream )
+        return;
+
+    // the window is most of the memory so it is limited to the largest
+    // power of 2 within memcap; larger frames fail with windowTooLarge
+    int window_log = 10;
+
+    while ( window_log < 30 and (2u << window_log) <= memcap )
+        window_log++;
+
+    ZSTD_DCtx_setParameter(stream, ZSTD_d_windowLogMax, window_log);
+    update_memory();
+}
+
+ZstdDecomp::~ZstdDecomp()
+{
+    if ( !stream )
+        return;
+
+    memory::MemoryCap::update_deallocations(used);
+    ZSTD_freeDStream(stream);
+}
+
+void ZstdDecomp::update_memory()
+{
+    size_t now = ZSTD_sizeof_DStream(stream);
+
+    if ( now > used )
+        memory::MemoryCap::update_allocations(now - used);
+
+    else if ( now < used )
+        memory::MemoryCap::update_deallocations(used - now);
+
+    used = now;
+}
+
+StreamDecomp::Status ZstdDecomp::decompress(
+    const uint8_t*& next_in, uint32_t& avail_in, uint8_t*& next_out, uint32_t& avail_out)
+{
+    if ( done )
+        return SD_END;
+
+    ZSTD_inBuffer in = { next_in, avail_in, 0 };
+    ZSTD_outBuffer out = { next_out, avail_out, 0 };
+    size_t ret;
+
+    // a body may be several concatenated frames
+    do
+        ret = ZSTD_decompressStream(stream, &out, &in);
+    while ( ret == 0 and in.pos < in.size and out.pos < out.size );
+
+    next_in += in.pos;
+    avail_in -= in.pos;
+    next_out += out.pos;
+    avail_out -= out.pos;
+
+    update_memory();
+
+    if ( ZSTD_isError(ret) )
+    {
+        if ( ZSTD_getErrorCode(ret) == ZSTD_error_frameParameter_windowTooLarge )
+            return SD_MEMCAP;
+
+        return SD_ERROR;
+    }
+
+    if ( ret == 0 and !avail_in )
+    {
+        done = true;
+        return SD_END;
+    }
+    return SD_OK;
+}
+
+#endif
+
+//--------------------------------------------------------------------------
+// api
+//--------------------------------------------------------------------------
+
+bool StreamDecomp::is_supported(Type type)
+{
+    switch ( type )
+    {
+#ifdef HAVE_BROTLI
+    case SD_BROTLI:
+        return true;
+#endif
+#ifdef HAVE_ZSTD
+    case SD_ZSTD:
+        return true;
+#endif
+    default:
+        break;
+    }
+    return false;
+}
+
+StreamDecomp* StreamDecomp::create(Type type, uint32_t memcap)
+{
+    switch ( type )
+    {
+#ifdef HAVE_BROTLI
+    case SD_BROTLI:
+    {
+        BrotliDecomp* bd = new BrotliDecomp(memcap);
+
+        if ( bd->is_valid() )
+            return bd;
+
+        delete bd;
+        break;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    case SD_ZSTD:
+    {
+        ZstdDecomp* zd = new ZstdDecomp(memcap);
+
+        if ( zd->is_valid() )
+            return zd;
+
+        delete zd;
+        break;
+    }
+#endif
+    default:
+        UNUSED(memcap);
+        break;
+    }
+    return nullptr;
+}
+
+//--------------------------------------------------------------------------
+// unit tests
+//--------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+static const char* text = "the quick brown fox jumps over the lazy dog";
+
+static StreamDecomp::Status decode(
+    StreamDecomp* sd, const uint8_t* in, unsigned len, uint8_t* out, uint32_t& out_len)
+{
+    StreamDecomp::Status ret = StreamDecomp::SD_OK;
+    uint32_t avail_out = out_len;
+
+    // one byte at a time to exercise the incremental state
+    for ( unsigned i = 0; i < len and ret == StreamDecomp::SD_OK; ++i )
+    {
+        const uint8_t* next_in = in + i;
+        uint32_t avail_in = 1;
+        ret = sd->decompress(next_in, avail_in, out, avail_out);
+
+        if ( ret == StreamDecomp::SD_OK )
+            CHECK(avail_in == 0);
+    }
+    out_len -= avail_out;
+    return ret;
+}
+
+#ifdef HAVE_BROTLI
+static const uint8_t br_text[] =
+{
+    0x1b, 0x2a, 0x00, 0x88, 0x9c, 0x09, 0x36, 0x4e, 0xa8, 0x77, 0x37, 0xbc,
+    0x24, 0x33, 0xa3, 0x4b, 0x90, 0x33, 0xbc, 0x42, 0x7b, 0x4b, 0x90, 0xb2,
+    0x39, 0x98, 0xc8, 0x81, 0x43, 0x5b, 0xa0, 0xf7, 0xde, 0xa7, 0x15, 0x0e,
+    0xe9, 0x0b, 0x47, 0x89, 0xea, 0x0c, 0x1b, 0xe0, 0x56, 0x35, 0x06
+};
+
+// 64K of "abcd" which needs a 64K ring buffer
+static const uint8_t br_64k[] =
+{
+    0x1b, 0xff, 0xff, 0xf8, 0xa5, 0xc3, 0xc4, 0xc6, 0xc8, 0xc4, 0x69, 0x01,
+    0x80, 0xed, 0x3d, 0x00, 0x36
+};
+
+TEST_CASE("brotli decode", "[stream_decomp]")
+{
+    REQUIRE(StreamDecomp::is_supported(StreamDecomp::SD_BROTLI));
+
+    StreamDecomp* sd = StreamDecomp::create(StreamDecomp::SD_BROTLI, 1 << 20);
+    REQUIRE(sd);
+
+    uint8_t out[64];
+    uint32_t out_len = sizeof(out);
+
+    CHECK(decode(sd, br_text, sizeof(br_text), out, out_len) == StreamDecomp::SD_END);
+    CHECK(out_len == strlen(text));
+    CHECK(!memcmp(out, text, strlen(text)));
+
+    const uint8_t* next_in = br_text;
+    uint32_t avail_in = sizeof(br_text);
+    uint8_t* next_out = out;
+    uint32_t avail_out = sizeof(out);
+
+    // nothing more is decoded after the end
+    CHECK(sd->decompress(next_in, avail_in, next_out, avail_out) == StreamDecomp::SD_END);
+    CHECK(avail_in == sizeof(br_text));
+
+    delete sd;
+}
+
+TEST_CASE("brotli memcap", "[stream_decomp]")
+{
+    uint8_t* out = new uint8_t[1 << 16];
+    uint32_t out_len = 1 << 16;
+
+    StreamDecomp* sd = StreamDecomp::create(StreamDecomp::SD_BROTLI, 1 << 15);
+    REQUIRE(sd);
+    CHECK(decode(sd, br_64k, sizeof(br_64k), out, out_len) == StreamDecomp::SD_MEMCAP);
+    delete sd;
+
+    out_len = 1 << 16;
+    sd = StreamDecomp::create(StreamDecomp::SD_BROTLI, 1 << 18);
+    REQUIRE(sd);
+    CHECK(decode(sd, br_64k, sizeof(br_64k), out, out_len) == StreamDecomp::SD_END);
+    CHECK(out_len == 1 << 16);
+    CHECK(!memcmp(out + 4096, "abcd", 4));
+    delete sd;
+
+    delete[] out;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+// frame with a 1K window and one raw block
+static const uint8_t zstd_text[] =
+{
+    0x28, 0xb5, 0x2f, 0xfd, 0x00, 0x00, 0x59, 0x01, 0x00,
+    't', 'h', 'e', ' ', 'q', 'u', 'i', 'c', 'k', ' ', 'b', 'r', 'o', 'w', 'n', ' ',
+    'f', 'o', 'x', ' ', 'j', 'u', 'm', 'p', 's', ' ', 'o', 'v', 'e', 'r', ' ',
+    't', 'h', 'e', ' ', 'l', 'a', 'z', 'y', ' ', 'd', 'o', 'g'
+};
+
+// frame header asking for a 256M window
+static const uint8_t zstd_big[] =
+{
+    0x28, 0xb5, 0x2f, 0xfd, 0x00, 0x90, 0x01, 0x00, 0x00
+};
+
+TEST_CASE("zstd decode", "[stream_decomp]")
+{
+    REQUIRE(StreamDecomp::is_supported(StreamDecomp::SD_ZSTD));
+
+    StreamDecomp* sd = StreamDecomp::create(StreamDecomp::SD_ZSTD, 1 << 20);
+    REQUIRE(sd);
+
+    uint8_t out[64];
+    uint32_t out_len = sizeof(out);
+
+    CHECK(decode(sd, zstd_text, sizeof(zstd_text), out, out_len) == StreamDecomp::SD_END);
+    CHECK(out_len == strlen(text));
+    CHECK(!memcmp(out, text, strlen(text)));
+    delete sd;
+}
+
+TEST_CASE("zstd memcap", "[stream_decomp]")
+{
+    StreamDecomp* sd = StreamDecomp::create(StreamDecomp::SD_ZSTD, 1 << 20);
+    REQUIRE(sd);
+
+    uint8_t out[64];
+    uint32_t out_len = sizeof(out);
+
+    CHECK(decode(sd, zstd_big, sizeof(zstd_big), out, out_len) == StreamDecomp::SD_MEMCAP);
+    delete sd;
+}
+#endif
+
+#endif
+
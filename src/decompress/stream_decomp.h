@@ -0,0 +1,57 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef STREAM_DECOMP_H
+#define STREAM_DECOMP_H
+
+// incremental brotli and zstd decoders for content encodings.  each
+// decoder is limited to memcap bytes so a stream that asks for a larger
+// window fails with SD_MEMCAP instead of growing the flow.  the decoders
+// are only available if snort was built with the libraries.
+
+#include <cstdint>
+
+#include "main/snort_types.h"
+
+class SO_PUBLIC StreamDecomp
+{
+public:
+    enum Type { SD_BROTLI, SD_ZSTD };
+    enum Status { SD_OK, SD_END, SD_ERROR, SD_MEMCAP };
+
+    static bool is_supported(Type);
+
+    // returns nullptr if the type is not supported or the decoder can't
+    // be created within memcap
+    static StreamDecomp* create(Type, uint32_t memcap);
+
+    virtual ~StreamDecomp() = default;
+
+    // decodes as much input as fits in the output and advances both.
+    // SD_OK means more input is needed or the output is full.  SD_END is
+    // returned once the stream is complete and any remaining input is
+    // left unconsumed.
+    virtual Status decompress(const uint8_t*& next_in, uint32_t& avail_in,
+        uint8_t*& next_out, uint32_t& avail_out) = 0;
+
+protected:
+    StreamDecomp() = default;
+};
+
+#endif
+
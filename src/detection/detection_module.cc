@@ -64,6 +64,9 @@ static const Parameter detection_params[] =
       "apply rule_state against all policies" },
 
 #ifdef HAVE_HYPERSCAN
+    { "hyperscan_cache", Parameter::PT_STRING, nullptr, nullptr,
+      "directory for saving and loading compiled hyperscan databases" },
+
     { "hyperscan_literals", Parameter::PT_BOOL, nullptr, "false",
       "use hyperscan for content literal searches instead of boyer-moore" },
 #endif
@@ -132,6 +135,9 @@ bool DetectionModule::set(const char*, Value& v, SnortConfig* sc)
         sc->global_rule_state = v.get_bool();
 
 #ifdef HAVE_HYPERSCAN
+    else if ( v.is("hyperscan_cache") )
+        sc->hyperscan_cache = v.get_string();
+
     else if ( v.is("hyperscan_literals") )
         sc->hyperscan_literals = v.get_bool();
 #endif
@@ -25,6 +25,8 @@
 #ifndef FP_CONFIG_H
 #define FP_CONFIG_H
 
+#include <atomic>
+
 namespace snort
 {
     struct MpseApi;
@@ -122,6 +124,12 @@ public:
     bool get_search_opt() const
     { return search_opt; }
 
+    void set_stream_search(bool flag)
+    { stream_search = flag; }
+
+    bool get_stream_search() const
+    { return stream_search; }
+
     bool set_search_method(const char*);
     const char* get_search_method();
 
@@ -152,6 +160,7 @@ private:
     bool debug_print_fast_pattern = false;
     bool debug = false;
     bool search_opt = false;
+    bool stream_search = false;
 
     unsigned max_queue_events = 5;
     unsigned bleedover_port_limit = 1024;
@@ -160,7 +169,7 @@ private:
     unsigned queue_limit = 0;
 
     int portlists_flags = 0;
-    int num_patterns_truncated = 0;  // due to max_pattern_len
+    std::atomic<int> num_patterns_truncated { 0 };  // due to max_pattern_len
 };
 
 #endif
@@ -34,6 +34,13 @@
 
 #include "fp_create.h"
 
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "framework/mpse.h"
 #include "framework/mpse_batch.h"
 #include "hash/ghash.h"
@@ -42,6 +49,7 @@
 #include "log/messages.h"
 #include "main/snort.h"
 #include "main/snort_config.h"
+#include "main/thread.h"
 #include "main/thread_config.h"
 #include "managers/mpse_manager.h"
 #include "parser/parse_rule.h"
@@ -54,18 +62,29 @@
 #include "detection_options.h"
 #include "detect_trace.h"
 #include "fp_config.h"
+#include "fp_stream.h"
 #include "fp_utils.h"
 #include "pattern_match_data.h"
 #include "pcrm.h"
 #include "service_map.h"
 #include "treenodes.h"
 
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#include "main/policy.h"
+#endif
+
 using namespace snort;
 using namespace std;
 
-static unsigned mpse_count = 0;
-static unsigned offload_mpse_count = 0;
-static const char* s_group = "";
+static std::atomic<unsigned> mpse_count(0);
+static std::atomic<unsigned> offload_mpse_count(0);
+static THREAD_LOCAL const char* s_group = "";
+
+// port and service groups are built by this many threads; the otns are
+// shared by all groups so updates to them are serialized with s_otn_mutex
+static unsigned s_build_threads = 1;
+static std::mutex s_otn_mutex;
 
 static void fpDeletePMX(void* data);
 
@@ -182,6 +201,13 @@ static int otn_create_tree(OptTreeNode* otn, void** existing_tree, Mpse::MpseTyp
         need_leaf = true;
     }
 
+    // other group builds may be setting the fast pattern only option
+    const OptFpList* fp_only;
+    {
+        std::lock_guard<std::mutex> lock(s_otn_mutex);
+        fp_only = (mpse_type == Mpse::MPSE_TYPE_NORMAL) ? otn->normal_fp_only : otn->offload_fp_only;
+    }
+
     int i = 0;
     child = root->children[i];
     OptFpList* opt_fp = otn->opt_func;
@@ -201,7 +227,7 @@ static int otn_create_tree(OptTreeNode* otn, void** existing_tree, Mpse::MpseTyp
 
         /* Don't add contents that are only for use in the
          * fast pattern matcher */
-        if ( is_fast_pattern_only(otn, opt_fp, mpse_type) )
+        if ( opt_fp == fp_only )
         {
             opt_fp = opt_fp->next;
             continue;
@@ -552,8 +578,10 @@ static void fpAddAlternatePatterns(
     fpFinishPortGroupRule(mpse, otn, pmd, fp, false);
 }
 
+// stream is set for groups that may search reassembled tcp pdus
 static int fpAddPortGroupRule(
-    SnortConfig* sc, PortGroup* pg, OptTreeNode* otn, FastPatternConfig* fp, bool srvc)
+    SnortConfig* sc, PortGroup* pg, OptTreeNode* otn, FastPatternConfig* fp, bool srvc,
+    bool stream)
 {
     const MpseApi* search_api = nullptr;
     const MpseApi* offload_search_api = nullptr;
@@ -625,6 +653,9 @@ static int fpAddPortGroupRule(
                 mpse_count++;
                 if ( fp->get_search_opt() )
                     pg->mpsegrp[main_pmd->pm_type]->normal_mpse->set_opt(1);
+
+                if ( stream and fp->get_stream_search() and main_pmd->pm_type == PM_TYPE_PKT )
+                    pg->mpsegrp[main_pmd->pm_type]->normal_mpse->set_stream_mode();
             }
 
             if (add_to_offload)
@@ -667,11 +698,15 @@ static int fpAddPortGroupRule(
                 if (fpFinishPortGroupRule(
                     pg->mpsegrp[main_pmd->pm_type]->normal_mpse, otn, main_pmd, fp, true) == 0)
                 {
-                    if (main_pmd->pattern_size > otn->longestPatternLen)
-                        otn->longestPatternLen = main_pmd->pattern_size;
+                    {
+                        std::lock_guard<std::mutex> lock(s_otn_mutex);
 
-                    if ( make_fast_pattern_only(ofp, main_pmd) )
-                        otn->normal_fp_only = ofp;
+                        if (main_pmd->pattern_size > otn->longestPatternLen)
+                            otn->longestPatternLen = main_pmd->pattern_size;
+
+                        if ( make_fast_pattern_only(ofp, main_pmd) )
+                            otn->normal_fp_only = ofp;
+                    }
 
                     // Add Alternative patterns
                     for (auto p : pmv)
@@ -690,11 +725,15 @@ static int fpAddPortGroupRule(
                 if (fpFinishPortGroupRule(
                     pg->mpsegrp[main_pmd->pm_type]->offload_mpse, otn, ol_pmd, fp, true) == 0)
                 {
-                    if (ol_pmd->pattern_size > otn->longestPatternLen)
-                        otn->longestPatternLen = ol_pmd->pattern_size;
+                    {
+                        std::lock_guard<std::mutex> lock(s_otn_mutex);
+
+                        if (ol_pmd->pattern_size > otn->longestPatternLen)
+                            otn->longestPatternLen = ol_pmd->pattern_size;
 
-                    if ( make_fast_pattern_only(ofp_ol, ol_pmd) )
-                        otn->offload_fp_only = ofp_ol;
+                        if ( make_fast_pattern_only(ofp_ol, ol_pmd) )
+                            otn->offload_fp_only = ofp_ol;
+                    }
 
                     // Add Alternative patterns
                     for (auto p : pmv_ol)
@@ -1003,8 +1042,93 @@ static void fpDeletePMX(void* pv)
  *  content and uricontent based on the rules in the PortObjects
  *  hash table.
  */
-static void fpCreatePortObject2PortGroup(SnortConfig* sc, PortObject2* po, PortObject2* poaa)
+//--------------------------------------------------------------------------
+// group build threads
+//--------------------------------------------------------------------------
+
+// groups are independent of each other so each job builds one group from
+// its rules, including the patterns, mpse instances, and the nfp tree.
+// jobs are claimed in order by s_build_threads workers.
+template <typename Job>
+static void build_groups(SnortConfig* sc, vector<Job>& jobs, void (*build)(SnortConfig*, Job&))
+{
+    std::atomic<unsigned> next(0);
+
+    auto work = [&]()
+    {
+        unsigned i;
+
+        while ( (i = next++) < jobs.size() )
+            build(sc, jobs[i]);
+    };
+
+    unsigned max = s_build_threads < jobs.size() ? s_build_threads : jobs.size();
+
+    if ( max <= 1 )
+    {
+        work();
+        return;
+    }
+
+    vector<std::thread> workers;
+
+    for ( unsigned i = 0; i < max; ++i )
+        workers.emplace_back(work);
+
+    for ( auto& w : workers )
+        w.join();
+}
+
+// rule hash walks use a cursor in the hash so the rule indexes are copied
+// before the groups are built.  the any-any rules are copied once and
+// shared by all groups that include them.
+struct PortGroupJob
+{
+    PortObject2* po;
+    vector<int> rules;
+    const vector<int>* any_rules;
+    bool tcp;
+};
+
+static vector<PortGroupJob> s_port_jobs;
+static std::map<const PortObject2*, vector<int>> s_any_rules;
+
+static void get_port_object_rules(PortObject2* po, vector<int>& rules)
+{
+    for (GHashNode* node = po->rule_hash->find_first();
+         node;
+         node = po->rule_hash->find_next())
+    {
+        int* prindex = (int*)node->data;
+
+        /* be safe - no rule index, ignore it */
+        if (prindex != nullptr)
+            rules.emplace_back(*prindex);
+    }
+}
+
+static void fpAddPortObjectRules(
+    SnortConfig* sc, PortGroup* pg, const vector<int>& rules, FastPatternConfig* fp, bool tcp)
 {
+    for ( int rindex : rules )
+    {
+        unsigned sid, gid;
+
+        /* look up gid:sid */
+        parser_get_rule_ids(rindex, gid, sid);
+
+        /* look up otn */
+        OptTreeNode* otn = OtnLookup(sc->otn_map, gid, sid);
+        assert(otn);
+
+        if ( is_network_protocol(otn->snort_protocol_id) )
+            fpAddPortGroupRule(sc, pg, otn, fp, false, tcp);
+    }
+}
+
+static void fpCreatePortObject2PortGroup(SnortConfig* sc, PortGroupJob& job)
+{
+    PortObject2* po = job.po;
     assert( po );
 
     po->group = nullptr;
@@ -1035,38 +1159,17 @@ static void fpCreatePortObject2PortGroup(SnortConfig* sc, PortObject2* po, PortO
      * (src/dst or any-any ports)
      *
      */
-    PortObject2* pox = po;
-    while ( pox )
-    {
-        for (GHashNode* node = pox->rule_hash->find_first();
-             node;
-             node = pox->rule_hash->find_next())
-        {
-            unsigned sid, gid;
-            int* prindex = (int*)node->data;
-
-            /* be safe - no rule index, ignore it */
-            if (prindex == nullptr)
-                continue;
-
-            /* look up gid:sid */
-            parser_get_rule_ids(*prindex, gid, sid);
+    fpAddPortObjectRules(sc, pg, job.rules, fp, job.tcp);
 
-            /* look up otn */
-            OptTreeNode* otn = OtnLookup(sc->otn_map, gid, sid);
-            assert(otn);
+    if (fp->get_debug_print_rule_group_build_details())
+        fpPortGroupPrintRuleCount(pg, "ports");
 
-            if ( is_network_protocol(otn->snort_protocol_id) )
-                fpAddPortGroupRule(sc, pg, otn, fp, false);
-        }
+    if ( job.any_rules )
+    {
+        fpAddPortObjectRules(sc, pg, *job.any_rules, fp, job.tcp);
 
         if (fp->get_debug_print_rule_group_build_details())
-            fpPortGroupPrintRuleCount(pg, pox == po ? "ports" : "any");
-
-        if (pox == poaa)
-            break;
-
-        pox = poaa;
+            fpPortGroupPrintRuleCount(pg, "any");
     }
 
     // This might happen if there was ip proto only rules...Don't return failure
@@ -1074,13 +1177,50 @@ static void fpCreatePortObject2PortGroup(SnortConfig* sc, PortObject2* po, PortO
         return;
 
     po->group = pg;
-    return;
+}
+
+// the group is built now if single threaded to keep the build details in
+// order, otherwise by build_port_groups()
+static void queue_port_group(
+    SnortConfig* sc, PortObject2* po, PortObject2* poaa, bool tcp = false)
+{
+    PortGroupJob job { po, { }, nullptr, tcp };
+
+    if ( po->rule_hash )
+    {
+        get_port_object_rules(po, job.rules);
+
+        if ( poaa and poaa != po )
+        {
+            auto it = s_any_rules.find(poaa);
+
+            if ( it == s_any_rules.end() )
+            {
+                it = s_any_rules.emplace(poaa, vector<int>()).first;
+                get_port_object_rules(poaa, it->second);
+            }
+            job.any_rules = &it->second;
+        }
+    }
+
+    if ( s_build_threads > 1 )
+        s_port_jobs.emplace_back(std::move(job));
+    else
+        fpCreatePortObject2PortGroup(sc, job);
+}
+
+static void build_port_groups(SnortConfig* sc)
+{
+    build_groups(sc, s_port_jobs, fpCreatePortObject2PortGroup);
+    s_port_jobs.clear();
+    s_any_rules.clear();
 }
 
 /*
  *  Create the port groups for this port table
  */
-static void fpCreatePortTablePortGroups(SnortConfig* sc, PortTable* p, PortObject2* poaa)
+static void fpCreatePortTablePortGroups(
+    SnortConfig* sc, PortTable* p, PortObject2* poaa, bool tcp = false)
 {
     int cnt = 1;
     FastPatternConfig* fp = sc->fast_pattern_config;
@@ -1103,7 +1243,7 @@ static void fpCreatePortTablePortGroups(SnortConfig* sc, PortTable* p, PortObjec
         if ( !po->port_cnt )
             continue;
 
-        fpCreatePortObject2PortGroup(sc, po, poaa);
+        queue_port_group(sc, po, poaa, tcp);
     }
 }
 
@@ -1121,6 +1261,10 @@ static int fpCreatePortGroups(SnortConfig* sc, RulePortTables* p)
     FastPatternConfig* fp = sc->fast_pattern_config;
     bool log_rule_group_details = fp->get_debug_print_rule_group_build_details();
 
+    // the any groups are built from copies which must be kept until the
+    // src and dst groups that include them are done
+    vector<std::pair<PortObject*, PortObject2*>> any_groups;
+
     /* IP */
     PortObject2* po2 = PortObject2Dup(*p->ip.any);
     PortObject2* add_any_any = fp->get_split_any_any() ? nullptr : po2;
@@ -1138,10 +1282,8 @@ static int fpCreatePortGroups(SnortConfig* sc, RulePortTables* p)
     if ( log_rule_group_details )
         LogMessage("\nIP-ANY ");
 
-    fpCreatePortObject2PortGroup(sc, po2, nullptr);
-    p->ip.any->group = po2->group;
-    po2->group = nullptr;
-    PortObject2Free(po2);
+    queue_port_group(sc, po2, nullptr);
+    any_groups.push_back({ p->ip.any, po2 });
 
     /* ICMP */
     po2 = PortObject2Dup(*p->icmp.any);
@@ -1160,10 +1302,8 @@ static int fpCreatePortGroups(SnortConfig* sc, RulePortTables* p)
     if ( log_rule_group_details )
         LogMessage("\nICMP-ANY ");
 
-    fpCreatePortObject2PortGroup(sc, po2, nullptr);
-    p->icmp.any->group = po2->group;
-    po2->group = nullptr;
-    PortObject2Free(po2);
+    queue_port_group(sc, po2, nullptr);
+    any_groups.push_back({ p->icmp.any, po2 });
 
     po2 = PortObject2Dup(*p->tcp.any);
     add_any_any = fp->get_split_any_any() ? nullptr : po2;
@@ -1171,20 +1311,18 @@ static int fpCreatePortGroups(SnortConfig* sc, RulePortTables* p)
     if ( log_rule_group_details )
         LogMessage("\nTCP-SRC ");
 
-    fpCreatePortTablePortGroups(sc, p->tcp.src, add_any_any);
+    fpCreatePortTablePortGroups(sc, p->tcp.src, add_any_any, true);
 
     if ( log_rule_group_details )
         LogMessage("\nTCP-DST ");
 
-    fpCreatePortTablePortGroups(sc, p->tcp.dst, add_any_any);
+    fpCreatePortTablePortGroups(sc, p->tcp.dst, add_any_any, true);
 
     if ( log_rule_group_details )
         LogMessage("\nTCP-ANY ");
 
-    fpCreatePortObject2PortGroup(sc, po2, nullptr);
-    p->tcp.any->group = po2->group;
-    po2->group = nullptr;
-    PortObject2Free(po2);
+    queue_port_group(sc, po2, nullptr, true);
+    any_groups.push_back({ p->tcp.any, po2 });
 
     /* UDP */
     po2 = PortObject2Dup(*p->udp.any);
@@ -1203,10 +1341,8 @@ static int fpCreatePortGroups(SnortConfig* sc, RulePortTables* p)
     if ( log_rule_group_details )
         LogMessage("\nUDP-ANY ");
 
-    fpCreatePortObject2PortGroup(sc, po2, nullptr);
-    p->udp.any->group = po2->group;
-    po2->group = nullptr;
-    PortObject2Free(po2);
+    queue_port_group(sc, po2, nullptr);
+    any_groups.push_back({ p->udp.any, po2 });
 
     /* SVC */
     po2 = PortObject2Dup(*p->svc_any);
@@ -1214,28 +1350,42 @@ static int fpCreatePortGroups(SnortConfig* sc, RulePortTables* p)
     if ( log_rule_group_details )
         LogMessage("\nSVC-ANY ");
 
-    fpCreatePortObject2PortGroup(sc, po2, nullptr);
-    p->svc_any->group = po2->group;
-    po2->group = nullptr;
-    PortObject2Free(po2);
+    queue_port_group(sc, po2, nullptr);
+    any_groups.push_back({ p->svc_any, po2 });
+
+    build_port_groups(sc);
 
+    for ( auto& any : any_groups )
+    {
+        any.first->group = any.second->group;
+        any.second->group = nullptr;
+        PortObject2Free(any.second);
+    }
     return 0;
 }
 
+struct ServiceGroupJob
+{
+    const char* srvc;
+    SF_LIST* list;
+    PortGroup* pg;
+};
+
 /*
 * Build a Port Group for this service based on the list of otns. The final
-* port_group pointer is stored using the service name as the key.
+* port_group pointer is stored in the job and added to the service table
+* using the service name as the key when all groups are built.
 *
-* p   - hash table mapping services to port_groups
 * srvc- service name, key used to store the port_group
 *       ...could use a service id instead (bytes, fixed length,etc...)
 * list- list of otns for this service
 */
-static void fpBuildServicePortGroupByServiceOtnList(
-    SnortConfig* sc, GHash* p, const char* srvc, SF_LIST* list, FastPatternConfig* fp)
+static void fpBuildServicePortGroupByServiceOtnList(SnortConfig* sc, ServiceGroupJob& job)
 {
+    FastPatternConfig* fp = sc->fast_pattern_config;
     PortGroup* pg = PortGroup::alloc();
-    s_group = srvc;
+    s_group = job.srvc;
+    job.pg = nullptr;
 
     /*
      * add each rule to the service group pattern matchers,
@@ -1243,18 +1393,17 @@ static void fpBuildServicePortGroupByServiceOtnList(
      */
     SF_LNODE* cursor;
 
-    for (OptTreeNode* otn = (OptTreeNode*)sflist_first(list, &cursor);
+    for (OptTreeNode* otn = (OptTreeNode*)sflist_first(job.list, &cursor);
          otn;
          otn = (OptTreeNode*)sflist_next(&cursor) )
     {
-        fpAddPortGroupRule(sc, pg, otn, fp, true);
+        fpAddPortGroupRule(sc, pg, otn, fp, true, true);
     }
 
     if (fpFinishPortGroup(sc, pg, fp) != 0)
         return;
 
-    /* Add the port_group using it's service name */
-    p->insert(srvc, pg);
+    job.pg = pg;
 }
 
 /*
@@ -1271,25 +1420,35 @@ static void fpBuildServicePortGroupByServiceOtnList(
  *
  */
 static void fpBuildServicePortGroups(
-    SnortConfig* sc, GHash* spg, PortGroupVector& sopg, GHash* srm, FastPatternConfig* fp)
+    SnortConfig* sc, GHash* spg, PortGroupVector& sopg, GHash* srm)
 {
+    vector<ServiceGroupJob> jobs;
+
     for (GHashNode* n = srm->find_first(); n; n = srm->find_next())
     {
         SF_LIST* list = (SF_LIST*)n->data;
         const char* srvc = (const char*)n->key;
 
         assert(list and srvc);
+        jobs.push_back({ srvc, list, nullptr });
+    }
+
+    build_groups(sc, jobs, fpBuildServicePortGroupByServiceOtnList);
 
-        fpBuildServicePortGroupByServiceOtnList(sc, spg, srvc, list, fp);
+    for ( auto& job : jobs )
+    {
+        /* Add the port_group using it's service name */
+        if ( job.pg )
+            spg->insert(job.srvc, job.pg);
 
         /* Add this PortGroup to the protocol-ordinal -> port_group table */
-        PortGroup* pg = (PortGroup*)spg->find(srvc);
+        PortGroup* pg = (PortGroup*)spg->find(job.srvc);
         if ( !pg )
         {
-            ParseError("*** failed to create and find a port group for '%s'",srvc);
+            ParseError("*** failed to create and find a port group for '%s'", job.srvc);
             continue;
         }
-        SnortProtocolId snort_protocol_id = sc->proto_ref->find(srvc);
+        SnortProtocolId snort_protocol_id = sc->proto_ref->find(job.srvc);
         assert(snort_protocol_id != UNKNOWN_PROTOCOL_ID);
         assert((unsigned)snort_protocol_id < sopg.size());
 
@@ -1302,16 +1461,14 @@ static void fpBuildServicePortGroups(
  */
 static void fpCreateServiceMapPortGroups(SnortConfig* sc)
 {
-    FastPatternConfig* fp = sc->fast_pattern_config;
-
     sc->spgmmTable = ServicePortGroupMapNew();
     sc->sopgTable = new sopg_table_t(sc->proto_ref->get_count());
 
     fpBuildServicePortGroups(sc, sc->spgmmTable->to_srv,
-        sc->sopgTable->to_srv, sc->srmmTable->to_srv, fp);
+        sc->sopgTable->to_srv, sc->srmmTable->to_srv);
 
     fpBuildServicePortGroups(sc, sc->spgmmTable->to_cli,
-        sc->sopgTable->to_cli, sc->srmmTable->to_cli, fp);
+        sc->sopgTable->to_cli, sc->srmmTable->to_cli);
 }
 
 /*
@@ -1533,11 +1690,8 @@ static void fpCreateServicePortGroups(SnortConfig* sc)
     sc->srmmTable = nullptr;
 }
 
-static unsigned can_build_mt(FastPatternConfig* fp)
+static bool parallel_search_engines(FastPatternConfig* fp)
 {
-    if ( Snort::is_reloading() )
-        return false;
-
     const MpseApi* search_api = fp->get_search_api();
     assert(search_api);
 
@@ -1552,6 +1706,26 @@ static unsigned can_build_mt(FastPatternConfig* fp)
     return true;
 }
 
+static unsigned can_build_mt(FastPatternConfig* fp)
+{
+    if ( Snort::is_reloading() )
+        return false;
+
+    return parallel_search_engines(fp);
+}
+
+// like compiles, reload group builds don't compete with the packet
+// threads.  the debug output is per group so those builds are kept in
+// order.
+static unsigned get_build_threads(SnortConfig* sc, FastPatternConfig* fp)
+{
+    if ( !can_build_mt(fp) or fp->get_debug_mode() or fp->get_debug_print_fast_patterns() or
+        fp->get_debug_print_rule_group_build_details() )
+        return 1;
+
+    return sc->num_slots;
+}
+
 /*
 *  Port list version
 *
@@ -1579,9 +1753,22 @@ int fpCreateFastPacketDetection(SnortConfig* sc)
 
     mpse_count = 0;
     offload_mpse_count = 0;
+    s_build_threads = get_build_threads(sc, fp);
 
     MpseManager::start_search_engine(fp->get_search_api());
 
+    if ( fp->get_stream_search() )
+    {
+        if ( fp->get_search_api()->flags & MPSE_STREAM )
+            FpStreamData::init();
+        else
+        {
+            ParseWarning(WARN_CONF, "search_engine.stream_search ignored; %s can't search streams",
+                fp->get_search_api()->base.name);
+            fp->set_stream_search(false);
+        }
+    }
+
     /* Use PortObjects to create PortGroups */
     if ( log_rule_group_details )
         LogMessage("Creating Port Groups....\n");
@@ -1665,6 +1852,8 @@ void fpDeleteFastPacketDetection(SnortConfig* sc)
 
 static void print_nfp_info(const char* group, OptTreeNode* otn)
 {
+    std::lock_guard<std::mutex> lock(s_otn_mutex);
+
     if ( otn->warned_fp() )
         return;
 
@@ -1707,3 +1896,252 @@ static void print_fp_info(
         pm_type_strings[pmd->pm_type], pattern_length,
         txt.c_str(), hex.c_str(), opts.c_str());
 }
+
+#ifdef UNIT_TEST
+#ifdef HAVE_HYPERSCAN
+// parallel builds need a search engine that can build groups in parallel.
+// the same rules are built serially and in parallel and each group is
+// summarized by its rules, pattern counts, and nfp tree.  hash iteration
+// order differs between configs so groups, rules, and tree branches are
+// sorted before they are compared.
+
+static const unsigned num_test_rules = 240;
+
+static string get_test_rules()
+{
+    static const char* srvcs[] = { "dns", "ftp", "http", "smtp" };
+    string rules;
+
+    for ( unsigned i = 0; i < num_test_rules; ++i )
+    {
+        string sid = to_string(i + 1);
+        string port = to_string(1000 + i % 16);
+        string n = to_string(i);
+        const char* proto = (i % 3) ? "tcp" : "udp";
+
+        switch ( i % 8 )
+        {
+        case 0:
+            rules += "alert " + string(proto) + " any any -> any " + port +
+                " ( content:\"fp_only_" + n + "\"; sid:" + sid + "; )\n";
+            break;
+        case 1:
+            rules += "alert " + string(proto) + " any " + port + " -> any any" +
+                " ( content:\"first_" + n + "\"; content:\"next\", distance 0; sid:" + sid + "; )\n";
+            break;
+        case 2:
+            rules += "alert " + string(proto) + " any any -> any " + port +
+                " ( content:!\"negated_" + n + "\"; sid:" + sid + "; )\n";
+            break;
+        case 3:
+            rules += "alert " + string(proto) + " any any -> any " + port +
+                " ( dsize:>" + n + "; sid:" + sid + "; )\n";
+            break;
+        case 4:
+            rules += "alert tcp any any -> any any ( service:" + string(srvcs[i % 4]) +
+                "; content:\"service_" + n + "\"; sid:" + sid + "; )\n";
+            break;
+        case 5:
+            rules += "alert tcp any any -> any any ( service:" + string(srvcs[i % 4]) +
+                "; dsize:<" + n + "; sid:" + sid + "; )\n";
+            break;
+        case 6:
+            rules += "alert ip any any -> any any ( content:\"any_any_" + n +
+                "\", nocase; sid:" + sid + "; )\n";
+            break;
+        default:
+            rules += "alert " + string(proto) + " any " + port + " -> any " + port +
+                " ( content:\"short\"; content:\"longer_" + n + "\"; sid:" + sid + "; )\n";
+            break;
+        }
+    }
+    return rules;
+}
+
+static string get_test_tree(const detection_option_tree_node_t* node)
+{
+    string s;
+
+    if ( node->option_type == RULE_OPTION_TYPE_LEAF_NODE )
+    {
+        const OptTreeNode* otn = (const OptTreeNode*)node->option_data;
+        s = to_string(otn->sigInfo.gid) + ":" + to_string(otn->sigInfo.sid);
+    }
+    else
+    {
+        const IpsOption* opt = (const IpsOption*)node->option_data;
+        s = string(opt->get_name()) + "/" + to_string(opt->hash());
+    }
+
+    vector<string> children;
+
+    for ( int i = 0; i < node->num_children; ++i )
+        children.emplace_back(get_test_tree(node->children[i]));
+
+    sort(children.begin(), children.end());
+
+    for ( const auto& c : children )
+        s += " (" + c + ")";
+
+    return s;
+}
+
+static string get_test_group(const string& key, const vector<unsigned>& sids, const PortGroup* pg)
+{
+    string s = key + " rules";
+
+    for ( auto sid : sids )
+        s += " " + to_string(sid);
+
+    if ( !pg )
+        return s + " no group";
+
+    s += " count " + to_string(pg->rule_count) + " nfp " + to_string(pg->nfp_rule_count);
+
+    for ( int i = PM_TYPE_PKT; i < PM_TYPE_MAX; ++i )
+    {
+        if ( pg->mpsegrp[i] and pg->mpsegrp[i]->normal_mpse )
+        {
+            s += string(" ") + pm_type_strings[i] + " " +
+                to_string(pg->mpsegrp[i]->normal_mpse->get_pattern_count());
+        }
+    }
+
+    if ( pg->nfp_tree )
+    {
+        const detection_option_tree_root_t* root = (detection_option_tree_root_t*)pg->nfp_tree;
+        vector<string> children;
+
+        for ( int i = 0; i < root->num_children; ++i )
+            children.emplace_back(get_test_tree(root->children[i]));
+
+        sort(children.begin(), children.end());
+
+        for ( const auto& c : children )
+            s += " tree (" + c + ")";
+    }
+    return s;
+}
+
+static void get_test_port_groups(const char* name, PortTable* pt, vector<string>& groups)
+{
+    for ( GHashNode* node = pt->pt_mpo_hash->find_first(); node;
+        node = pt->pt_mpo_hash->find_next() )
+    {
+        PortObject2* po = (PortObject2*)node->data;
+
+        if ( !po or !po->rule_hash )
+            continue;
+
+        vector<int> rules;
+        vector<unsigned> sids;
+        get_port_object_rules(po, rules);
+
+        for ( int r : rules )
+        {
+            unsigned gid, sid;
+            parser_get_rule_ids(r, gid, sid);
+            sids.emplace_back(sid);
+        }
+        sort(sids.begin(), sids.end());
+        groups.emplace_back(get_test_group(name, sids, po->group));
+    }
+}
+
+static void get_test_any_group(const char* name, PortObject* po, vector<string>& groups)
+{
+    vector<unsigned> sids;
+    SF_LNODE* cursor;
+
+    for ( int* r = (int*)sflist_first(po->rule_list, &cursor); r; r = (int*)sflist_next(&cursor) )
+    {
+        unsigned gid, sid;
+        parser_get_rule_ids(*r, gid, sid);
+        sids.emplace_back(sid);
+    }
+    sort(sids.begin(), sids.end());
+    groups.emplace_back(get_test_group(name, sids, po->group));
+}
+
+static void get_test_service_groups(const char* dir, GHash* spg, vector<string>& groups)
+{
+    for ( GHashNode* node = spg->find_first(); node; node = spg->find_next() )
+    {
+        const PortGroup* pg = (PortGroup*)node->data;
+        string key = string(dir) + " " + (const char*)node->key;
+        groups.emplace_back(get_test_group(key, { }, pg));
+    }
+}
+
+static void get_test_otns(SnortConfig* sc, vector<string>& otns)
+{
+    for ( unsigned sid = 1; sid <= num_test_rules; ++sid )
+    {
+        const OptTreeNode* otn = OtnLookup(sc->otn_map, 1, sid);
+        REQUIRE(otn);
+
+        int fp_only = -1, idx = 0;
+
+        for ( const OptFpList* ofp = otn->opt_func; ofp; ofp = ofp->next, ++idx )
+        {
+            if ( ofp == otn->normal_fp_only )
+                fp_only = idx;
+        }
+        otns.emplace_back(to_string(sid) + " fp_only " + to_string(fp_only) +
+            " longest " + to_string(otn->longestPatternLen));
+    }
+}
+
+static vector<string> build_test_groups(unsigned threads)
+{
+    parser_init();
+    SnortConfig* sc = ParseSnortConf(SnortConfig::get_conf(), "", false);
+    set_default_policy(sc);
+
+    sc->policy_map->get_ips_policy(0)->rules = get_test_rules();
+    REQUIRE(sc->fast_pattern_config->set_search_method("hyperscan"));
+    sc->num_slots = threads;
+    sc->setup();
+
+    CHECK(s_build_threads == threads);
+
+    vector<string> groups;
+    const struct { const char* name; PortProto& pp; } protos[] =
+    {
+        { "ip", sc->port_tables->ip }, { "icmp", sc->port_tables->icmp },
+        { "tcp", sc->port_tables->tcp }, { "udp", sc->port_tables->udp }
+    };
+
+    for ( const auto& p : protos )
+    {
+        get_test_port_groups((string(p.name) + " src").c_str(), p.pp.src, groups);
+        get_test_port_groups((string(p.name) + " dst").c_str(), p.pp.dst, groups);
+        get_test_any_group((string(p.name) + " any").c_str(), p.pp.any, groups);
+    }
+    get_test_any_group("svc any", sc->port_tables->svc_any, groups);
+
+    get_test_service_groups("to srv", sc->spgmmTable->to_srv, groups);
+    get_test_service_groups("to cli", sc->spgmmTable->to_cli, groups);
+    get_test_otns(sc, groups);
+
+    sort(groups.begin(), groups.end());
+
+    parser_term(sc);
+    delete sc;
+    set_default_policy(SnortConfig::get_conf());
+
+    return groups;
+}
+
+TEST_CASE("parallel group builds", "[fp_create]")
+{
+    auto serial = build_test_groups(1);
+    auto parallel = build_test_groups(4);
+
+    CHECK(serial.size() > num_test_rules);
+    CHECK(serial == parallel);
+
+    s_build_threads = 1;
+}
+#endif
+#endif
@@ -74,6 +74,7 @@
 #include "detection_options.h"
 #include "fp_config.h"
 #include "fp_create.h"
+#include "fp_stream.h"
 #include "ips_context.h"
 #include "pattern_match_data.h"
 #include "pcrm.h"
@@ -854,6 +855,33 @@ static inline int batch_search(
     return 0;
 }
 
+// reassembled pdus are searched immediately with stream mode mpses so the
+// stream state is current for the next pdu.  returns false to batch it.
+static inline bool stream_search(MpseGroup* so, Packet* p, unsigned len, PegCount& cnt)
+{
+    if ( !(p->packet_flags & PKT_REBUILT_STREAM) or !p->flow )
+        return false;
+
+    if ( !p->context->conf->fast_pattern_config->get_stream_search() )
+        return false;
+
+    MpseStash* stash = p->context->stash;
+    FpStreamData* fsd = FpStreamData::get(p->flow);
+    {
+        Profile mpse_profile(mpsePerfStats);
+
+        if ( fsd->search(so->get_normal_mpse(), p, p->data, len, rule_tree_queue, p->context) < 0 )
+            return false;
+    }
+    cnt++;
+    dump_buffer(p->data, len, p);
+    {
+        Profile rule_profile(rulePerfStats);
+        stash->process(p->context);
+    }
+    return true;
+}
+
 static inline void search_buffer(
     Inspector* gadget, InspectionBuffer& buf, InspectionBuffer::Type ibt,
     Packet* p, PortGroup* pg, PmType pmt, PegCount& cnt)
@@ -891,7 +919,9 @@ static int fp_search(PortGroup* port_group, Packet* p, bool srvc)
                     "%" PRIu64 " fp %s[%u]\n", p->context->packet_number,
                     pm_type_strings[PM_TYPE_PKT], pattern_match_size);
 
-                batch_search(so, p, p->data, pattern_match_size, pc.pkt_searches);
+                if ( !stream_search(so, p, pattern_match_size, pc.pkt_searches) )
+                    batch_search(so, p, p->data, pattern_match_size, pc.pkt_searches);
+
                 p->is_cooked() ?  pc.cooked_searches++ : pc.raw_searches++;
             }
         }
@@ -0,0 +1,296 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fp_stream.h"
+
+#include <cassert>
+
+#include "detection/ips_context.h"
+#include "flow/flow.h"
+#include "framework/mpse.h"
+#include "main/snort_config.h"
+#include "protocols/packet.h"
+#include "utils/stats.h"
+
+#include "fp_config.h"
+
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
+using namespace snort;
+
+unsigned FpStreamData::data_id = 0;
+
+FpStreamData::FpStreamData() : FlowData(data_id)
+{ }
+
+FpStreamData::~FpStreamData()
+{
+    for ( auto& s : scans )
+    {
+        update_deallocations(s.stream->size_of());
+        delete s.stream;
+    }
+}
+
+void FpStreamData::init()
+{
+    if ( !data_id )
+        data_id = FlowData::create_flow_data_id();
+}
+
+FpStreamData* FpStreamData::get(Flow* flow)
+{
+    assert(data_id);
+    FpStreamData* fsd = (FpStreamData*)flow->get_flow_data(data_id);
+
+    if ( !fsd )
+    {
+        fsd = new FpStreamData;
+        flow->set_flow_data(fsd);
+    }
+    return fsd;
+}
+
+void FpStreamData::set_pdu_seq(const Packet* pdu, uint32_t seq)
+{
+    if ( !data_id or !pdu->flow or
+        !pdu->context->conf->fast_pattern_config->get_stream_search() )
+        return;
+
+    FpStreamData* fsd = get(pdu->flow);
+    bool to_server = pdu->is_from_client();
+
+    fsd->pdu_seq[to_server] = seq;
+    fsd->have_seq[to_server] = true;
+}
+
+void FpStreamData::clear_pdu_seq(const Packet* pdu)
+{
+    if ( !data_id or !pdu->flow )
+        return;
+
+    if ( FpStreamData* fsd = (FpStreamData*)pdu->flow->get_flow_data(data_id) )
+        fsd->have_seq[pdu->is_from_client()] = false;
+}
+
+FpStreamData::Scan* FpStreamData::find(const Mpse* mpse, bool to_server)
+{
+    for ( auto& s : scans )
+    {
+        if ( s.mpse == mpse and s.to_server == to_server )
+            return &s;
+    }
+    return nullptr;
+}
+
+// a stream that can't be reset was opened by a deleted mpse that happened
+// to live at this address so we need a new one
+bool FpStreamData::restart(Mpse* mpse, Scan& s)
+{
+    if ( mpse->reset_stream(s.stream) )
+        return true;
+
+    update_deallocations(s.stream->size_of());
+    delete s.stream;
+
+    s.stream = mpse->open_stream();
+
+    if ( !s.stream )
+    {
+        scans.erase(scans.begin() + (&s - scans.data()));
+        return false;
+    }
+
+    update_allocations(s.stream->size_of());
+    return true;
+}
+
+int FpStreamData::search(
+    Mpse* mpse, const Packet* p, const uint8_t* buf, unsigned len, MpseMatch mf, void* context)
+{
+    bool to_server = p->is_from_client();
+
+    if ( !have_seq[to_server] )
+        return -1;
+
+    uint32_t seq = pdu_seq[to_server];
+    Scan* s = find(mpse, to_server);
+
+    if ( !s )
+    {
+        MpseStream* ms = mpse->open_stream();
+
+        if ( !ms )
+            return -1;
+
+        update_allocations(ms->size_of());
+        scans.push_back({ mpse, ms, seq, to_server });
+        s = &scans.back();
+    }
+    else if ( s->next_seq != seq )
+    {
+        if ( !restart(mpse, *s) )
+            return -1;
+
+        pc.stream_resets++;
+    }
+    else
+        pc.stream_searches++;
+
+    int found = mpse->search_stream(s->stream, buf, len, mf, context);
+
+    if ( found < 0 )
+    {
+        if ( !restart(mpse, *s) )
+            return -1;
+
+        found = mpse->search_stream(s->stream, buf, len, mf, context);
+    }
+
+    s->next_seq = seq + len;
+    return found;
+}
+
+
+//--------------------------------------------------------------------------
+// unit tests
+//--------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+// finds "ab" even if it spans buffers of the same stream
+class TestStream : public MpseStream
+{
+public:
+    size_t size_of() const override
+    { return sizeof(*this); }
+
+    uint8_t last = 0;
+};
+
+class TestMpse : public Mpse
+{
+public:
+    TestMpse() : Mpse("test") { }
+
+    int add_pattern(const uint8_t*, unsigned, const PatternDescriptor&, void*) override
+    { return 0; }
+
+    int prep_patterns(SnortConfig*) override
+    { return 0; }
+
+    MpseStream* open_stream() override
+    { return new TestStream; }
+
+    bool reset_stream(MpseStream* ms) override
+    {
+        ((TestStream*)ms)->last = 0;
+        return true;
+    }
+
+protected:
+    int _search(const uint8_t*, int, MpseMatch, void*, int*) override
+    { return 0; }
+
+    int _search_stream(MpseStream* ms, const uint8_t* buf, int n, MpseMatch, void*) override
+    {
+        TestStream* ts = (TestStream*)ms;
+        int found = 0;
+
+        for ( int i = 0; i < n; ++i )
+        {
+            if ( ts->last == 'a' and buf[i] == 'b' )
+                ++found;
+            ts->last = buf[i];
+        }
+        return found;
+    }
+};
+
+// flush pdus the way the reassembler does: the pdu has no tcp header and
+// its sequence number is set before it is searched
+static int flush(FpStreamData* fsd, Mpse& mpse, Packet& pdu, uint32_t seq, const char* data)
+{
+    FpStreamData::set_pdu_seq(&pdu, seq);
+    return fsd->search(&mpse, &pdu, (const uint8_t*)data, strlen(data), nullptr, nullptr);
+}
+
+TEST_CASE("stream search of reassembled pdus", "[fp_stream]")
+{
+    FpStreamData::init();
+
+    SnortConfig sc;
+    FastPatternConfig fp;
+    sc.fast_pattern_config = &fp;
+
+    IpsContext context(1);
+    context.conf = &sc;
+
+    Flow flow;
+    Packet& pdu = *context.packet;
+
+    pdu.flow = &flow;
+    pdu.packet_flags = PKT_FROM_CLIENT | PKT_REBUILT_STREAM;
+    pdu.ptrs.tcph = nullptr;
+
+    TestMpse mpse;
+
+    SECTION("off")
+    {
+        FpStreamData::set_pdu_seq(&pdu, 1000);
+        CHECK(!flow.flow_data);
+    }
+    SECTION("on")
+    {
+        fp.set_stream_search(true);
+        FpStreamData::set_pdu_seq(&pdu, 1000);
+
+        REQUIRE(flow.flow_data);
+        FpStreamData* fsd = FpStreamData::get(&flow);
+
+        PegCount searches = pc.stream_searches;
+        PegCount resets = pc.stream_resets;
+
+        CHECK(flush(fsd, mpse, pdu, 1000, "xxa") == 0);
+        CHECK(flush(fsd, mpse, pdu, 1003, "bxa") == 1);
+        CHECK(pc.stream_searches == searches + 1);
+
+        // the other direction has its own stream
+        pdu.packet_flags = PKT_FROM_SERVER | PKT_REBUILT_STREAM;
+        CHECK(flush(fsd, mpse, pdu, 5000, "bb") == 0);
+        pdu.packet_flags = PKT_FROM_CLIENT | PKT_REBUILT_STREAM;
+
+        // a gap restarts the stream
+        CHECK(flush(fsd, mpse, pdu, 2000, "bab") == 1);
+        CHECK(pc.stream_resets == resets + 1);
+
+        // zero byte flushes are not part of the stream
+        FpStreamData::clear_pdu_seq(&pdu);
+        CHECK(fsd->search(&mpse, &pdu, (const uint8_t*)"b", 1, nullptr, nullptr) == -1);
+    }
+    flow.free_flow_data();
+    sc.fast_pattern_config = nullptr;
+}
+
+#endif
@@ -0,0 +1,89 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef FP_STREAM_H
+#define FP_STREAM_H
+
+// FpStreamData holds the stream mode search state of a TCP flow so that
+// packet fast pattern searches of reassembled PDUs pick up where the last
+// PDU in the same direction left off instead of starting over.  There is
+// one stream per search engine and direction.  A stream is restarted when
+// the next PDU does not begin at the sequence number following the bytes
+// searched last (a gap, a detect limit truncation, or a splitter that
+// rewrites the payload).  PDUs have no TCP header so the reassembler
+// records the sequence number of each PDU here before it is inspected.
+
+#include <vector>
+
+#include "flow/flow_data.h"
+#include "search_engines/search_common.h"
+
+namespace snort
+{
+class Flow;
+class Mpse;
+class MpseStream;
+struct Packet;
+}
+
+class FpStreamData : public snort::FlowData
+{
+public:
+    FpStreamData();
+    ~FpStreamData() override;
+
+    static void init();
+    static FpStreamData* get(snort::Flow*);
+
+    // called by the reassembler for each pdu; does nothing unless stream
+    // searches are enabled.  pdus without stream data are cleared so they
+    // are searched normally.
+    static void set_pdu_seq(const snort::Packet*, uint32_t seq);
+    static void clear_pdu_seq(const snort::Packet*);
+
+    size_t size_of() override
+    { return sizeof(*this); }
+
+    // returns -1 if the mpse can't search streams or the pdu has no
+    // sequence number, otherwise the number of matches found in buf
+    int search(snort::Mpse*, const snort::Packet*, const uint8_t* buf, unsigned len,
+        MpseMatch, void* context);
+
+private:
+    struct Scan
+    {
+        const snort::Mpse* mpse;
+        snort::MpseStream* stream;
+        uint32_t next_seq;
+        bool to_server;
+    };
+
+    Scan* find(const snort::Mpse*, bool to_server);
+    bool restart(snort::Mpse*, Scan&);
+
+    std::vector<Scan> scans;
+
+    // sequence number of the current pdu, indexed by to_server
+    uint32_t pdu_seq[2] = { };
+    bool have_seq[2] = { };
+
+    static unsigned data_id;
+};
+
+#endif
+
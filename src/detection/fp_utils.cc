@@ -391,6 +391,7 @@ static void compile_mpse(SnortConfig* sc, unsigned id, unsigned* count)
 
 void queue_mpse(Mpse* m)
 {
+    std::lock_guard<std::mutex> lock(s_mutex);
     s_tbd.push_back(m);
 }
 
@@ -30,9 +30,13 @@
 
 #include "file_capture.h"
 
-#include <sys/stat.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
+#include <atomic>
 #include <cassert>
+#include <cerrno>
 
 #include "log/messages.h"
 #include "utils/stats.h"
@@ -52,17 +56,24 @@ int64_t FileCapture::capture_block_size = 0;
 
 std::mutex FileCapture::capture_mutex;
 std::condition_variable FileCapture::capture_cv;
-std::thread* FileCapture::file_storer = nullptr;
+std::vector<std::thread*> FileCapture::file_storers;
 std::queue<FileCapture*> FileCapture::files_waiting;
 bool FileCapture::running = true;
 
+// time files waited for a writer, picked up by the packet threads' pegs
+static std::atomic<uint64_t> queue_usecs { 0 };
+
+// blocks written per writev() call
+static const int max_iov = 64;
+
 FileCaptureState FileCapture::error_capture(FileCaptureState state)
 {
     file_counts.file_reserve_failures++;
     return state;
 }
 
-// Only one writer thread supported
+// Any number of writer threads can serve the queue; O_EXCL keeps them
+// from storing the same file at once.
 void FileCapture::writer_thread()
 {
     while (true)
@@ -81,9 +92,16 @@ void FileCapture::writer_thread()
         files_waiting.pop();
         lk.unlock();
 
+        auto waited = std::chrono::steady_clock::now() - file->queued_time;
+        queue_usecs += std::chrono::duration_cast<std::chrono::microseconds>(waited).count();
+
         file->store_file();
         delete file;
     }
+
+    // released blocks are cached by this thread
+    if (file_mempool)
+        file_mempool->thread_term();
 }
 
 FileCapture::FileCapture(int64_t min_size, int64_t max_size)
@@ -131,11 +149,19 @@ FileCapture::~FileCapture()
         delete file_info;
 }
 
-void FileCapture::init(int64_t memcap, int64_t block_size)
+void FileCapture::init(int64_t memcap, int64_t block_size, unsigned writers)
 {
     capture_block_size = block_size;
     init_mempool(memcap, capture_block_size);
-    file_storer = new std::thread(writer_thread);
+
+    for (unsigned i = 0; i < writers; ++i)
+        file_storers.emplace_back(new std::thread(writer_thread));
+}
+
+void FileCapture::thread_term()
+{
+    if (file_mempool)
+        file_mempool->thread_term();
 }
 
 /*
@@ -148,14 +174,14 @@ void FileCapture::exit()
         std::lock_guard<std::mutex> lk(capture_mutex);
         running = false;
     }
-    capture_cv.notify_one();
+    capture_cv.notify_all();
 
-    if (file_storer)
+    for (auto* t : file_storers)
     {
-        file_storer->join();
-        delete file_storer;
-        file_storer = nullptr;
+        t->join();
+        delete t;
     }
+    file_storers.clear();
 }
 
 /*
@@ -431,41 +457,42 @@ FileCaptureBlock* FileCapture::get_file_data(uint8_t** buff, int* size)
 }
 
 /*
- * writing file data to the disk.
+ * writing file data blocks to the disk with one system call.
  *
- * In the case of interrupt errors, the write is retried, but only for a
- * finite number of times.
+ * Short writes are continued. In the case of interrupt errors, the write
+ * is retried, but only for a finite number of times.
  */
-void FileCapture::write_file_data(uint8_t* buf, size_t buf_len, FILE* fh)
+void FileCapture::write_file_data(int fd, struct iovec* iov, int count)
 {
     int max_retries = 3;
-    size_t bytes_written = 0;
-    int err;
-
-    /* Nothing to write or nothing to write to */
-    if ((buf == nullptr) || (fh == nullptr))
-        return;
 
-    /* writing several times */
-    do
+    while (count > 0)
     {
-        size_t bytes_left = buf_len - bytes_written;
-
-        bytes_written += fwrite(buf + bytes_written, 1, bytes_left, fh);
+        ssize_t n = writev(fd, iov, count);
 
-        err = ferror(fh);
-        if (err && (err != EINTR) && (err != EAGAIN))
+        if (n <= 0)
         {
-            break;
+            int err = (n < 0) ? errno : EAGAIN;
+
+            if (((err == EINTR) || (err == EAGAIN)) && (--max_retries > 0))
+                continue;
+
+            ErrorMessage("File inspect: disk writing error - %s!\n", get_error(err));
+            return;
         }
 
-        max_retries--;
-    }
-    while ((max_retries > 0) && (bytes_written < buf_len));
+        while ((count > 0) && ((size_t)n >= iov->iov_len))
+        {
+            n -= iov->iov_len;
+            ++iov;
+            --count;
+        }
 
-    if (bytes_written < buf_len)
-    {
-        ErrorMessage("File inspect: disk writing error - %s!\n", get_error(err));
+        if (count > 0)
+        {
+            iov->iov_base = (uint8_t*)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
     }
 }
 
@@ -477,20 +504,16 @@ void FileCapture::store_file()
 
     std::string& file_full_name = file_info->get_file_name();
 
-    /*Check whether the file exists*/
-    struct stat buffer;
-    if (stat (file_full_name.c_str(), &buffer) == 0)
-    {
-        return;
-    }
-
-    FILE* fh = fopen(file_full_name.c_str(), "w");
-    if (!fh )
+    /*Skip files that exist or are being stored by another writer*/
+    int fd = open(file_full_name.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+    if (fd < 0)
     {
         return;
     }
 
     // Check the file buffer
+    struct iovec iov[max_iov];
+    int count = 0;
     uint8_t* buff = nullptr;
     int size = 0;
     void* file_mem;
@@ -500,16 +523,23 @@ void FileCapture::store_file()
         file_mem = get_file_data(&buff, &size);
         // Get file from file buffer
         if (!buff || !size )
+            break;
+
+        iov[count].iov_base = buff;
+        iov[count].iov_len = size;
+
+        if (++count == max_iov)
         {
-            fclose(fh);
-            return;
+            write_file_data(fd, iov, count);
+            count = 0;
         }
-
-        write_file_data(buff, size, fh);
     }
     while (file_mem);
 
-    fclose(fh);
+    if (count)
+        write_file_data(fd, iov, count);
+
+    close(fd);
 }
 
 // Queue files to be stored to disk
@@ -529,9 +559,19 @@ void FileCapture::store_file_async()
     get_instance_file(file_full_name, file_name.c_str());
     file_info->set_file_name(file_full_name.c_str(), file_full_name.size());
 
-    std::lock_guard<std::mutex> lk(capture_mutex);
-    files_waiting.push(this);
+    queued_time = std::chrono::steady_clock::now();
+    size_t depth;
+    {
+        std::lock_guard<std::mutex> lk(capture_mutex);
+        files_waiting.push(this);
+        depth = files_waiting.size();
+    }
     capture_cv.notify_one();
+
+    if (file_counts.capture_queue_max < depth)
+        file_counts.capture_queue_max = depth;
+
+    file_counts.capture_queue_usecs += queue_usecs.exchange(0, std::memory_order_relaxed);
 }
 
 /*Log file capture mempool usage*/
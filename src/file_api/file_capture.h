@@ -31,14 +31,17 @@
 // 3) Then file data can be read through file_capture_read()
 // 4) Finally, file data must be released from mempool file_capture_release()
 
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <vector>
 
 #include "file_api.h"
 
 class FileMemPool;
+struct iovec;
 
 namespace snort
 {
@@ -57,7 +60,10 @@ public:
     ~FileCapture();
 
     // this must be called during snort init
-    static void init(int64_t memcap, int64_t block_size);
+    static void init(int64_t memcap, int64_t block_size, unsigned writers = 1);
+
+    // return cached capture blocks; call before a packet thread exits
+    static void thread_term();
 
     // Capture file data to local buffer
     // This is the main function call to enable file capture
@@ -104,13 +110,13 @@ private:
     inline FileCaptureBlock* create_file_buffer();
     inline FileCaptureState save_to_file_buffer(const uint8_t* file_data, int data_size,
         int64_t max_size);
-    void write_file_data(uint8_t* buf, size_t buf_len, FILE* fh);
+    void write_file_data(int fd, struct iovec*, int count);
 
     static FileMemPool* file_mempool;
     static int64_t capture_block_size;
     static std::mutex capture_mutex;
     static std::condition_variable capture_cv;
-    static std::thread* file_storer;
+    static std::vector<std::thread*> file_storers;
     static std::queue<FileCapture*> files_waiting;
     static bool running;
 
@@ -124,6 +130,7 @@ private:
     snort::FileInfo* file_info = nullptr;
     int64_t capture_min_size;
     int64_t capture_max_size;
+    std::chrono::steady_clock::time_point queued_time;
 };
 }
 
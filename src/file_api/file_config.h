@@ -36,8 +36,10 @@
 #define DEFAULT_FILE_CAPTURE_MAX_SIZE       1048576     // 1 MiB
 #define DEFAULT_FILE_CAPTURE_MIN_SIZE       0           // 0
 #define DEFAULT_FILE_CAPTURE_BLOCK_SIZE     32768       // 32 KiB
+#define DEFAULT_FILE_CAPTURE_WRITERS        1
 #define DEFAULT_MAX_FILES_CACHED            65536
 #define DEFAULT_MAX_FILES_PER_FLOW          128
+#define DEFAULT_SIGNATURE_QUEUE_DEPTH       1024
 
 #define FILE_ID_NAME "file_id"
 #define FILE_ID_HELP "configure file identification"
@@ -65,9 +67,12 @@ public:
     int64_t capture_max_size = DEFAULT_FILE_CAPTURE_MAX_SIZE;
     int64_t capture_min_size = DEFAULT_FILE_CAPTURE_MIN_SIZE;
     int64_t capture_block_size = DEFAULT_FILE_CAPTURE_BLOCK_SIZE;
+    unsigned capture_writers = DEFAULT_FILE_CAPTURE_WRITERS;
     int64_t file_depth =  0;
     int64_t max_files_cached = DEFAULT_MAX_FILES_CACHED;
     uint64_t max_files_per_flow = DEFAULT_MAX_FILES_PER_FLOW;
+    unsigned signature_workers = 0;
+    unsigned signature_queue_depth = DEFAULT_SIGNATURE_QUEUE_DEPTH;
 
     int64_t show_data_depth = DEFAULT_FILE_SHOW_DATA_DEPTH;
     bool trace_type = false;
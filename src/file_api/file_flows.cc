@@ -76,10 +76,15 @@ void FileFlows::handle_retransmit(Packet* p)
     if ((file == nullptr) or (file->verdict != FILE_VERDICT_PENDING))
         return;
 
-    FileVerdict verdict = file_policy->signature_lookup(p, file);
+    bool hashing = file->is_signature_pending();
+    FileVerdict verdict = hashing ? FILE_VERDICT_PENDING : file_policy->signature_lookup(p, file);
     FileCache* file_cache = FileService::get_file_cache();
     if (file_cache)
         file_cache->apply_verdict(p, file, verdict, false, file_policy);
+
+    // the lookup timeout starts when the signature is ready to look up
+    if (hashing and file->verdict == FILE_VERDICT_PENDING)
+        timerclear(&file->pending_expire_time);
     file->log_file_event(flow, file_policy);
 }
 
@@ -0,0 +1,294 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "file_hasher.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "helpers/ring.h"
+#include "main/thread.h"
+#include "main/thread_config.h"
+#include "utils/util.h"
+
+#include "file_stats.h"
+
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
+using namespace snort;
+
+typedef Ring<HashItem> HashQueue;
+
+// one queue per packet thread
+static std::vector<HashQueue*> queues;
+static std::vector<std::thread*> workers;
+static std::atomic<bool> running { false };
+static unsigned max_queued = 0;
+
+bool FileHasher::active = false;
+
+void FileHasher::init(unsigned num_workers, unsigned queue_depth)
+{
+    assert(num_workers and !active);
+
+    unsigned num_queues = ThreadConfig::get_instance_max();
+
+    if ( num_workers > num_queues )
+        num_workers = num_queues;
+
+    // a ring of n slots holds n - 2 items
+    for ( unsigned i = 0; i < num_queues; ++i )
+        queues.emplace_back(new HashQueue(queue_depth + 2));
+
+    max_queued = queue_depth;
+
+    running = true;
+
+    for ( unsigned i = 0; i < num_workers; ++i )
+        workers.emplace_back(new std::thread(worker, i, num_workers));
+
+    active = true;
+}
+
+void FileHasher::exit()
+{
+    if ( !active )
+        return;
+
+    // packet threads are gone so the queues are drained before the
+    // workers exit
+    running = false;
+
+    for ( auto* t : workers )
+    {
+        t->join();
+        delete t;
+    }
+    workers.clear();
+
+    for ( auto* q : queues )
+        delete q;
+    queues.clear();
+
+    active = false;
+}
+
+FileHashJob::~FileHashJob()
+{
+    for ( auto& hi : backlog )
+        snort_free(hi.data);
+}
+
+FileHashJob* FileHasher::create()
+{
+    // a new file waits behind everything already queued so past half full
+    // it is faster to hash it inline than to wait on the retry queue
+    if ( queues[get_instance_id()]->count() >= (int)max_queued / 2 )
+        return nullptr;
+
+    file_counts.signatures_offloaded++;
+    return new FileHashJob;
+}
+
+void FileHasher::hash(FileHashJob* job, const HashItem& hi)
+{
+    if ( hi.data )
+    {
+        SHA256_Update(&job->ctx, hi.data, hi.size);
+        snort_free(hi.data);
+    }
+    if ( hi.last )
+    {
+        SHA256_Final(job->sha256, &job->ctx);
+        job->finished.store(true, std::memory_order_release);
+    }
+}
+
+bool FileHasher::enqueue(FileHashJob* job, const HashItem& hi)
+{
+    // counted first since the worker may be done with it before put returns
+    job->hold();
+    job->queued.fetch_add(1, std::memory_order_relaxed);
+
+    if ( queues[get_instance_id()]->put(hi) )
+        return true;
+
+    job->queued.fetch_sub(1, std::memory_order_relaxed);
+    job->refs.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+}
+
+void FileHasher::resume(FileHashJob* job)
+{
+    auto it = job->backlog.begin();
+
+    while ( it != job->backlog.end() and enqueue(job, *it) )
+        ++it;
+
+    job->backlog.erase(job->backlog.begin(), it);
+
+    // rather than wait for room in the queue, the packet thread finishes the
+    // file itself once the worker is done with the segments already queued
+    if ( job->backlog.empty() or job->queued.load(std::memory_order_acquire) )
+        return;
+
+    for ( auto& hi : job->backlog )
+        hash(job, hi);
+
+    job->backlog.clear();
+    job->local = true;
+}
+
+void FileHasher::update(FileHashJob* job, const uint8_t* data, int size, bool last)
+{
+    HashItem hi = { job, nullptr, 0, last };
+
+    // the context belongs to the packet thread now so there is nothing to copy
+    if ( job->local )
+    {
+        if ( size > 0 )
+            SHA256_Update(&job->ctx, data, size);
+        hash(job, hi);
+        return;
+    }
+
+    if ( size > 0 )
+    {
+        hi.data = (uint8_t*)snort_alloc(size);
+        memcpy(hi.data, data, size);
+        hi.size = size;
+    }
+
+    // keep the order if earlier segments are still waiting for room
+    if ( job->backlog.empty() and enqueue(job, hi) )
+        return;
+
+    file_counts.signature_queue_full++;
+    job->backlog.emplace_back(hi);
+    resume(job);
+}
+
+void FileHasher::worker(unsigned id, unsigned num_workers)
+{
+    unsigned idle = 0;
+
+    while ( true )
+    {
+        // check before draining so nothing queued before exit is missed
+        bool stop = !running.load(std::memory_order_acquire);
+        bool busy = false;
+
+        for ( unsigned i = id; i < queues.size(); i += num_workers )
+        {
+            HashQueue* q = queues[i];
+
+            while ( HashItem* hi = q->read() )
+            {
+                FileHashJob* job = hi->job;
+
+                hash(job, *hi);
+                q->pop();
+                job->queued.fetch_sub(1, std::memory_order_release);
+                job->release();
+                busy = true;
+            }
+        }
+
+        if ( busy )
+            idle = 0;
+
+        else if ( stop )
+            break;
+
+        else if ( ++idle < 64 )
+            std::this_thread::yield();
+
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+#ifdef UNIT_TEST
+static void hash_file(FileHashJob* job, const std::vector<uint8_t>& data, unsigned seg_size)
+{
+    for ( size_t off = 0; off < data.size(); off += seg_size )
+    {
+        size_t n = std::min((size_t)seg_size, data.size() - off);
+        FileHasher::update(job, data.data() + off, n, off + n == data.size());
+    }
+
+    // like the retried packet
+    while ( !job->done() )
+    {
+        FileHasher::resume(job);
+        std::this_thread::yield();
+    }
+}
+
+TEST_CASE("offloaded signature", "[file_hasher]")
+{
+    std::vector<uint8_t> data(1 << 20);
+
+    for ( size_t i = 0; i < data.size(); ++i )
+        data[i] = (uint8_t)(i * 7 + (i >> 9));
+
+    uint8_t expected[SHA256_HASH_SIZE];
+    SHA256(data.data(), data.size(), expected);
+
+    // a short queue overflows into the job backlog and the packet thread
+    // may take over the rest of the file
+    for ( unsigned depth : { 2, 64 } )
+    {
+        FileHasher::init(2, depth);
+
+        for ( unsigned seg_size : { 100, 1460, 65535 } )
+        {
+            FileHashJob* job = FileHasher::create();
+            REQUIRE(job);
+
+            hash_file(job, data, seg_size);
+            CHECK(!memcmp(job->get_sha256(), expected, sizeof(expected)));
+            job->release();
+        }
+        FileHasher::exit();
+    }
+}
+
+TEST_CASE("busy queue", "[file_hasher]")
+{
+    // new files are hashed inline once the queue is half full
+    FileHasher::init(1, 1);
+    CHECK(!FileHasher::create());
+    FileHasher::exit();
+
+    FileHasher::init(1, 2);
+    FileHashJob* job = FileHasher::create();
+    CHECK(job);
+    job->release();
+    FileHasher::exit();
+}
+#endif
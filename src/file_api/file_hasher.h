@@ -0,0 +1,116 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef FILE_HASHER_H
+#define FILE_HASHER_H
+
+// computes file signatures off the packet threads.  each packet thread
+// has its own queue of file segments and each queue is served by exactly
+// one worker so the segments of a file are hashed in the order given.
+// segments are copied since the packet data is gone by the time the
+// worker gets to them.  the packet thread never waits on a full queue:
+// segments that don't fit are held by the job and the packet thread
+// finishes the file itself once the worker is done with it.
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <openssl/sha.h>
+
+#include "hash/hashes.h"
+
+class FileHashJob;
+
+struct HashItem
+{
+    FileHashJob* job;
+    uint8_t* data;
+    unsigned size;
+    bool last;
+};
+
+class FileHashJob
+{
+public:
+    FileHashJob()
+    { SHA256_Init(&ctx); }
+
+    ~FileHashJob();
+
+    void hold()
+    { refs.fetch_add(1, std::memory_order_relaxed); }
+
+    void release()
+    {
+        if ( refs.fetch_sub(1, std::memory_order_acq_rel) == 1 )
+            delete this;
+    }
+
+    bool done() const
+    { return finished.load(std::memory_order_acquire); }
+
+    const uint8_t* get_sha256() const
+    { return sha256; }
+
+private:
+    friend class FileHasher;
+
+    SHA256_CTX ctx;
+    uint8_t sha256[SHA256_HASH_SIZE];
+
+    // segments that didn't fit in the queue; packet thread only
+    std::vector<HashItem> backlog;
+
+    std::atomic<unsigned> refs { 1 };
+    std::atomic<unsigned> queued { 0 };
+    std::atomic<bool> finished { false };
+
+    // set when the packet thread took over the hashing
+    bool local = false;
+};
+
+class FileHasher
+{
+public:
+    static void init(unsigned workers, unsigned queue_depth);
+    static void exit();
+
+    static bool is_active()
+    { return active; }
+
+    // returns nullptr if this thread's queue is too busy to take another
+    // file, which is then hashed inline.  the job is released by the
+    // caller when done with it.
+    static FileHashJob* create();
+
+    // called on the packet thread that created the job
+    static void update(FileHashJob*, const uint8_t* data, int size, bool last);
+
+    // queues or hashes the backlog of a job that isn't done yet
+    static void resume(FileHashJob*);
+
+private:
+    static void hash(FileHashJob*, const HashItem&);
+    static bool enqueue(FileHashJob*, const HashItem&);
+    static void worker(unsigned id, unsigned num_workers);
+    static bool active;
+};
+
+#endif
+
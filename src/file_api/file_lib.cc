@@ -38,6 +38,7 @@
 #include "framework/data_bus.h"
 #include "main/snort_config.h"
 #include "managers/inspector_manager.h"
+#include "packet_io/sfdaq.h"
 #include "packet_tracer/packet_tracer.h"
 #include "protocols/packet.h"
 #include "utils/util.h"
@@ -48,10 +49,17 @@
 #include "file_config.h"
 #include "file_cache.h"
 #include "file_flows.h"
+#include "file_hasher.h"
 #include "file_service.h"
 #include "file_segment.h"
 #include "file_stats.h"
 
+#ifdef UNIT_TEST
+#include <thread>
+
+#include "catch/snort_catch.h"
+#endif
+
 using namespace snort;
 
 // Convert UTF16-LE file name to UTF-8.
@@ -93,14 +101,29 @@ FileInfo::~FileInfo ()
 {
     if (sha256)
         delete[] sha256;
+    if (sig_job)
+        sig_job->release();
 }
 
 void FileInfo::copy(const FileInfo& other)
 {
-    if (other.sha256)
+    if (sig_job)
+    {
+        sig_job->release();
+        sig_job = nullptr;
+    }
+
+    // the job belongs to the packet thread that created it so only a
+    // finished signature is copied
+    const uint8_t* sig = other.sha256;
+
+    if (!sig and other.sig_job and other.sig_job->done())
+        sig = other.sig_job->get_sha256();
+
+    if (sig)
     {
         sha256 = new uint8_t[SHA256_HASH_SIZE];
-        memcpy( (char*)sha256, (const char*)other.sha256, SHA256_HASH_SIZE);
+        memcpy(sha256, sig, SHA256_HASH_SIZE);
     }
 
     file_size = other.file_size;
@@ -114,6 +137,10 @@ void FileInfo::copy(const FileInfo& other)
     file_signature_enabled = other.file_signature_enabled;
     file_capture_enabled = other.file_capture_enabled;
     file_state = other.file_state;
+
+    if (!sha256 and file_state.sig_state == FILE_SIG_DONE)
+        file_state.sig_state = FILE_SIG_PROCESSING;
+
     pending_expire_time = other.pending_expire_time;
     // only one copy of file capture
     file_capture = nullptr;
@@ -191,6 +218,28 @@ uint8_t* FileInfo::get_file_sig_sha256() const
     return (sha256);
 }
 
+bool FileInfo::is_signature_pending()
+{
+    if (!sig_job)
+        return false;
+
+    if (!sig_job->done())
+        FileHasher::resume(sig_job);
+
+    if (!sig_job->done())
+        return true;
+
+    if (!sha256)
+    {
+        sha256 = new uint8_t[SHA256_HASH_SIZE];
+        memcpy(sha256, sig_job->get_sha256(), SHA256_HASH_SIZE);
+    }
+
+    sig_job->release();
+    sig_job = nullptr;
+    return false;
+}
+
 std::string FileInfo::sha_to_string(const uint8_t* sha256)
 {
     uint8_t conv[] = "0123456789ABCDEF";
@@ -476,7 +525,7 @@ bool FileContext::process(Packet* p, const uint8_t* file_data, int data_size,
     if (is_file_signature_enabled())
     {
         if (!sha256)
-            process_file_signature_sha256(file_data, data_size, position);
+            process_file_signature_sha256(file_data, data_size, position, p);
 
         file_stats->data_processed[get_file_type()][get_file_direction()]
             += data_size;
@@ -492,6 +541,15 @@ bool FileContext::process(Packet* p, const uint8_t* file_data, int data_size,
             process_file_capture(file_data, data_size, position);
         }
 
+        // wait for the signature worker via the retry queue; the lookup is
+        // done by FileFlows::handle_retransmit()
+        if (file_state.sig_state == FILE_SIG_DONE and is_signature_pending())
+        {
+            FileCache* file_cache = FileService::get_file_cache();
+            if (file_cache)
+                file_cache->apply_verdict(p, this, FILE_VERDICT_PENDING, false, policy);
+        }
+
         finish_signature_lookup(p, ( file_state.sig_state != FILE_SIG_FLUSH ), policy);
 
         if (file_state.sig_state == FILE_SIG_DEPTH_FAIL)
@@ -563,7 +621,7 @@ void FileContext::process_file_type(const uint8_t* file_data, int data_size, Fil
 }
 
 void FileContext::process_file_signature_sha256(const uint8_t* file_data, int data_size,
-    FilePosition position)
+    FilePosition position, const Packet* p)
 {
     if ((int64_t)processed_bytes + data_size > config->file_signature_depth)
     {
@@ -571,6 +629,9 @@ void FileContext::process_file_signature_sha256(const uint8_t* file_data, int da
         return;
     }
 
+    if (offload_file_signature(file_data, data_size, position, p))
+        return;
+
     switch (position)
     {
     case SNORT_FILE_START:
@@ -630,6 +691,58 @@ void FileContext::process_file_signature_sha256(const uint8_t* file_data, int da
     }
 }
 
+// The result is only picked up by a retried packet so files are hashed
+// inline unless the packet can be retried (inline with forwarding).  Files
+// that start while partial signatures are wanted (FILE_SIG_FLUSH) are also
+// hashed inline.
+static bool can_offload_signature(FileSigState sig_state, bool forwarding)
+{
+    return FileHasher::is_active() and sig_state != FILE_SIG_FLUSH and forwarding;
+}
+
+// Returns true if the data was given to a signature worker.  Files that
+// start when the worker queue is busy are hashed inline.
+bool FileContext::offload_file_signature(const uint8_t* file_data, int data_size,
+    FilePosition position, const Packet* p)
+{
+    switch (position)
+    {
+    case SNORT_FILE_START:
+    case SNORT_FILE_FULL:
+        if (sig_job)
+        {
+            sig_job->release();
+            sig_job = nullptr;
+        }
+        if (!can_offload_signature(file_state.sig_state,
+            p and SFDAQ::forwarding_packet(p->pkth)))
+            return false;
+        sig_job = FileHasher::create();
+        if (!sig_job)
+            return false;
+        break;
+
+    case SNORT_FILE_MIDDLE:
+    case SNORT_FILE_END:
+        if (!sig_job)
+            return false;
+        if (file_state.sig_state == FILE_SIG_DONE)
+            return true;
+        break;
+
+    default:
+        return false;
+    }
+
+    bool last = (position == SNORT_FILE_END) or (position == SNORT_FILE_FULL);
+    FileHasher::update(sig_job, file_data, data_size, last);
+
+    if (last)
+        file_state.sig_state = FILE_SIG_DONE;
+
+    return true;
+}
+
 FileCaptureState FileContext::process_file_capture(const uint8_t* file_data,
     int data_size, FilePosition position)
 {
@@ -829,3 +942,82 @@ bool file_IDs_from_group(const void *conf, const char *group,
     return get_ids_from_group(conf, group, ids, count);
 }
  **/
+
+#ifdef UNIT_TEST
+class TestFileInfo : public FileInfo
+{
+public:
+    FileHashJob* get_job() const
+    { return sig_job; }
+
+    void set_job(FileHashJob* job)
+    { sig_job = job; }
+
+    void set_sig_state(FileSigState state)
+    { file_state.sig_state = state; }
+};
+
+TEST_CASE("offload decision", "[file_lib]")
+{
+    CHECK(!can_offload_signature(FILE_SIG_PROCESSING, true));
+
+    FileHasher::init(1, 8);
+
+    CHECK(can_offload_signature(FILE_SIG_PROCESSING, true));
+    CHECK(!can_offload_signature(FILE_SIG_PROCESSING, false));
+    CHECK(!can_offload_signature(FILE_SIG_FLUSH, true));
+
+    FileHasher::exit();
+}
+
+TEST_CASE("copy with signature job", "[file_lib]")
+{
+    FileHasher::init(1, 8);
+
+    const uint8_t data[] = "file data";
+    uint8_t expected[SHA256_HASH_SIZE];
+    SHA256(data, sizeof(data), expected);
+
+    TestFileInfo orig;
+    orig.set_sig_state(FILE_SIG_DONE);
+
+    SECTION("finished")
+    {
+        FileHashJob* job = FileHasher::create();
+        REQUIRE(job);
+        orig.set_job(job);
+        FileHasher::update(job, data, sizeof(data), true);
+
+        while ( !job->done() )
+            std::this_thread::yield();
+
+        TestFileInfo copy(orig);
+        CHECK(!copy.get_job());
+        REQUIRE(copy.get_file_sig_sha256());
+        CHECK(!memcmp(copy.get_file_sig_sha256(), expected, sizeof(expected)));
+        CHECK(copy.get_file_state().sig_state == FILE_SIG_DONE);
+        CHECK(!copy.is_signature_pending());
+
+        CHECK(orig.get_job() == job);
+        CHECK(!orig.is_signature_pending());
+        CHECK(!memcmp(orig.get_file_sig_sha256(), expected, sizeof(expected)));
+    }
+    SECTION("running")
+    {
+        // nothing queued yet so the job can't finish
+        FileHashJob* job = FileHasher::create();
+        REQUIRE(job);
+        orig.set_job(job);
+
+        TestFileInfo copy(orig);
+        CHECK(!copy.get_job());
+        CHECK(!copy.get_file_sig_sha256());
+        CHECK(copy.get_file_state().sig_state == FILE_SIG_PROCESSING);
+        CHECK(!copy.is_signature_pending());
+
+        CHECK(orig.get_job() == job);
+        CHECK(orig.is_signature_pending());
+    }
+    FileHasher::exit();
+}
+#endif
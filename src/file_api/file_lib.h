@@ -34,6 +34,7 @@
 #define SNORT_FILE_TYPE_CONTINUE         0
 
 class FileConfig;
+class FileHashJob;
 class FileSegments;
 
 namespace snort
@@ -60,6 +61,8 @@ public:
     void set_file_direction(FileDirection dir);
     FileDirection get_file_direction() const;
     uint8_t* get_file_sig_sha256() const;
+    // true while a signature worker is computing sha256
+    bool is_signature_pending();
     std::string sha_to_string(const uint8_t* sha256);
     void set_file_id(uint64_t index);
     uint64_t get_file_id() const;
@@ -90,6 +93,7 @@ protected:
     FileDirection direction = FILE_DOWNLOAD;
     uint32_t file_type_id = SNORT_FILE_TYPE_CONTINUE;
     uint8_t* sha256 = nullptr;
+    FileHashJob* sig_job = nullptr;
     uint64_t file_id = 0;
     FileCapture* file_capture = nullptr;
     bool file_type_enabled = false;
@@ -118,7 +122,8 @@ public:
     bool process(Packet*, const uint8_t* file_data, int data_size, uint64_t offset, FilePolicyBase*,
         FilePosition position=SNORT_FILE_POSITION_UNKNOWN);
     void process_file_type(const uint8_t* file_data, int data_size, FilePosition);
-    void process_file_signature_sha256(const uint8_t* file_data, int data_size, FilePosition);
+    void process_file_signature_sha256(const uint8_t* file_data, int data_size, FilePosition,
+        const Packet* = nullptr);
     void update_file_size(int data_size, FilePosition position);
     void stop_file_capture();
     FileCaptureState process_file_capture(const uint8_t* file_data, int data_size, FilePosition);
@@ -148,6 +153,8 @@ private:
     bool cacheable = true;
 
     inline void finalize_file_type();
+    bool offload_file_signature(const uint8_t* file_data, int data_size, FilePosition,
+        const Packet*);
     inline void finish_signature_lookup(Packet*, bool, FilePolicyBase*);
 };
 }
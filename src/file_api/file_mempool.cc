@@ -31,9 +31,20 @@
 
 #include "file_mempool.h"
 
+#include <algorithm>
+
 #include "log/messages.h"
+#include "main/thread.h"
 #include "utils/util.h"
 
+#ifdef UNIT_TEST
+#include <condition_variable>
+#include <set>
+#include <thread>
+
+#include "catch/snort_catch.h"
+#endif
+
 using namespace snort;
 
 /*This magic is used for double free detection*/
@@ -41,6 +52,20 @@ using namespace snort;
 #define FREE_MAGIC    0x2525252525252525
 typedef uint64_t MagicType;
 
+#define MAGAZINE_SIZE 32
+
+// the magazine lock is only contended when another thread steals from it
+struct FileMemPool::Magazine
+{
+    FileMemPool* pool;
+    std::mutex mutex;
+    unsigned count = 0;
+    void* objs[MAGAZINE_SIZE];
+};
+
+// only one pool is cached per thread; others go straight to the lists
+static THREAD_LOCAL FileMemPool::Magazine* magazine = nullptr;
+
 
 void FileMemPool::free_pools()
 {
@@ -121,55 +146,155 @@ FileMemPool::~FileMemPool()
  * Returns: a pointer to the FileMemPool object on success, nullptr on failure
  */
 
+FileMemPool::Magazine* FileMemPool::get_magazine()
+{
+    if (!magazine)
+    {
+        magazine = new Magazine;
+        magazine->pool = this;
+
+        std::lock_guard<std::mutex> lock(mags_mutex);
+        mags.emplace_back(magazine);
+    }
+    return (magazine->pool == this) ? magazine : nullptr;
+}
+
+// must be called with the pool locked
+void FileMemPool::flush(Magazine* mag, CircularBuffer* cb, unsigned keep)
+{
+    while (mag->count > keep)
+    {
+        cbuffer_write(cb, mag->objs[--mag->count]);
+        cached--;
+    }
+}
+
+void FileMemPool::thread_term()
+{
+    Magazine* mag = get_magazine();
+
+    if (!mag)
+        return;
+
+    {
+        std::lock_guard<std::mutex> mags_lock(mags_mutex);
+        mags.erase(std::remove(mags.begin(), mags.end(), mag), mags.end());
+
+        std::lock_guard<std::mutex> mag_lock(mag->mutex);
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        flush(mag, free_list, 0);
+    }
+
+    delete mag;
+    magazine = nullptr;
+}
+
+// take an object cached by another thread
+void* FileMemPool::steal(const Magazine* own)
+{
+    std::lock_guard<std::mutex> mags_lock(mags_mutex);
+
+    for (auto mag : mags)
+    {
+        if (mag == own)
+            continue;
+
+        std::lock_guard<std::mutex> mag_lock(mag->mutex);
+
+        if (mag->count)
+        {
+            cached--;
+            return mag->objs[--mag->count];
+        }
+    }
+    return nullptr;
+}
+
 void* FileMemPool::m_alloc()
 {
     void* b = nullptr;
+    Magazine* mag = get_magazine();
 
-    std::lock_guard<std::mutex> lock(pool_mutex);
-
-    if (cbuffer_read(free_list, &b))
     {
-        if (cbuffer_read(released_list, &b))
+        std::unique_lock<std::mutex> mag_lock;
+
+        if (mag)
         {
-            return nullptr;
+            mag_lock = std::unique_lock<std::mutex>(mag->mutex);
+
+            if (mag->count)
+            {
+                cached--;
+                return mag->objs[--mag->count];
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(pool_mutex);
+
+        if (!cbuffer_read(free_list, &b) or !cbuffer_read(released_list, &b))
+        {
+            // refill half the magazine while we have the lock
+            if (mag)
+            {
+                void* obj;
+
+                while (mag->count < MAGAZINE_SIZE / 2 and
+                    (!cbuffer_read(free_list, &obj) or !cbuffer_read(released_list, &obj)))
+                {
+                    mag->objs[mag->count++] = obj;
+                    cached++;
+                }
+            }
+            return b;
         }
     }
 
-    return b;
+    // the lists are empty but other threads may still cache free objects
+    return steal(mag);
 }
 
 /*
  * Free a new object from the buffer
- * We use circular buffer to synchronize one reader and one writer
+ * Freed objects go to this thread's magazine; when it is full, half of
+ * it is returned to the given list.
  */
 int FileMemPool::remove(CircularBuffer* cb, void* obj)
 {
     if (obj == nullptr)
         return FILE_MEM_FAIL;
 
-    if (cbuffer_write(cb, obj))
+    if (*(MagicType*)obj == FREE_MAGIC)
     {
         return FILE_MEM_FAIL;
     }
 
-    if (*(MagicType*)obj == FREE_MAGIC)
+    *(MagicType*)obj = FREE_MAGIC;
+
+    Magazine* mag = get_magazine();
+
+    if (!mag)
     {
-        return FILE_MEM_FAIL;
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        return cbuffer_write(cb, obj) ? FILE_MEM_FAIL : FILE_MEM_SUCCESS;
     }
 
-    *(MagicType*)obj = FREE_MAGIC;
+    std::lock_guard<std::mutex> mag_lock(mag->mutex);
+
+    if (mag->count == MAGAZINE_SIZE)
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        flush(mag, cb, MAGAZINE_SIZE / 2);
+    }
+
+    mag->objs[mag->count++] = obj;
+    cached++;
 
     return FILE_MEM_SUCCESS;
 }
 
 int FileMemPool::m_free(void* obj)
 {
-    std::lock_guard<std::mutex> lock(pool_mutex);
-
-    int ret = remove(free_list, obj);
-
-
-    return ret;
+    return remove(free_list, obj);
 }
 
 /*
@@ -181,19 +306,14 @@ int FileMemPool::m_free(void* obj)
 
 int FileMemPool::m_release(void* obj)
 {
-    std::lock_guard<std::mutex> lock(pool_mutex);
-
     /*A writer that might from different thread*/
-    int ret = remove(released_list, obj);
-
-
-    return ret;
+    return remove(released_list, obj);
 }
 
 /* Returns number of elements allocated in current buffer*/
 uint64_t FileMemPool::allocated()
 {
-    uint64_t total_freed = released() + freed();
+    uint64_t total_freed = released() + freed() + cached;
     return (total - total_freed);
 }
 
@@ -209,3 +329,167 @@ uint64_t FileMemPool::released()
     return (cbuffer_used(released_list));
 }
 
+#ifdef UNIT_TEST
+// blocks are written like capture blocks, which clears the free magic
+static void* alloc_block(FileMemPool& pool)
+{
+    void* obj = pool.m_alloc();
+
+    if (obj)
+        memset(obj, 0, sizeof(MagicType));
+
+    return obj;
+}
+
+TEST_CASE("mempool alloc and free", "[file_mempool]")
+{
+    FileMemPool pool(8, 64);
+    std::set<void*> objs;
+
+    for (unsigned i = 0; i < 8; ++i)
+        objs.insert(alloc_block(pool));
+
+    CHECK(objs.size() == 8);
+    CHECK(objs.count(nullptr) == 0);
+    CHECK(alloc_block(pool) == nullptr);
+    CHECK(pool.allocated() == 8);
+
+    void* obj = *objs.begin();
+    CHECK(pool.m_free(obj) == FILE_MEM_SUCCESS);
+    CHECK(pool.m_free(obj) == FILE_MEM_FAIL);
+    CHECK(pool.allocated() == 7);
+
+    CHECK(alloc_block(pool) == obj);
+    CHECK(alloc_block(pool) == nullptr);
+
+    for (auto p : objs)
+        CHECK(pool.m_release(p) == FILE_MEM_SUCCESS);
+
+    pool.thread_term();
+    CHECK(pool.allocated() == 0);
+    CHECK(pool.freed() + pool.released() == 8);
+}
+
+// objects cached by one thread are available to the others
+TEST_CASE("mempool magazines", "[file_mempool]")
+{
+    const unsigned num_threads = 4;
+    const unsigned per_thread = 4;
+    FileMemPool pool(num_threads * per_thread, 64);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    unsigned parked = 0;
+    bool done = false;
+
+    auto cache = [&]()
+    {
+        void* objs[per_thread];
+
+        for (auto& obj : objs)
+            obj = alloc_block(pool);
+
+        for (auto obj : objs)
+            pool.m_free(obj);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        parked++;
+        cv.notify_all();
+        cv.wait(lock, [&]() { return done; });
+        lock.unlock();
+
+        pool.thread_term();
+    };
+
+    std::vector<std::thread> threads;
+
+    for (unsigned i = 0; i < num_threads; ++i)
+        threads.emplace_back(cache);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return parked == num_threads; });
+    }
+
+    // every object is sitting in a magazine of a live thread
+    CHECK(pool.allocated() == 0);
+
+    std::set<void*> objs;
+
+    for (unsigned i = 0; i < num_threads * per_thread; ++i)
+        objs.insert(alloc_block(pool));
+
+    CHECK(objs.size() == num_threads * per_thread);
+    CHECK(objs.count(nullptr) == 0);
+    CHECK(alloc_block(pool) == nullptr);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    cv.notify_all();
+
+    for (auto& t : threads)
+        t.join();
+
+    for (auto obj : objs)
+        pool.m_free(obj);
+
+    pool.thread_term();
+    CHECK(pool.allocated() == 0);
+}
+
+TEST_CASE("mempool churn", "[file_mempool]")
+{
+    const unsigned num_threads = 4;
+    const unsigned num_objs = 2 * MAGAZINE_SIZE;
+    FileMemPool pool(num_objs, 64);
+    std::atomic<unsigned> failed { 0 };
+
+    // each thread can hold a quarter of the pool so allocation never fails
+    auto churn = [&](unsigned seed)
+    {
+        std::vector<void*> held;
+
+        for (unsigned i = 0; i < 20000; ++i)
+        {
+            seed = seed * 1103515245 + 12345;
+
+            if (held.size() < num_objs / num_threads and (seed & 0x100))
+            {
+                void* obj = alloc_block(pool);
+
+                if (obj)
+                    held.emplace_back(obj);
+                else
+                    failed++;
+            }
+            else if (!held.empty())
+            {
+                if (seed & 0x200)
+                    pool.m_free(held.back());
+                else
+                    pool.m_release(held.back());
+
+                held.pop_back();
+            }
+        }
+        for (auto obj : held)
+            pool.m_free(obj);
+
+        pool.thread_term();
+    };
+
+    std::vector<std::thread> threads;
+
+    for (unsigned i = 0; i < num_threads; ++i)
+        threads.emplace_back(churn, i + 1);
+
+    for (auto& t : threads)
+        t.join();
+
+    CHECK(failed == 0);
+    CHECK(pool.allocated() == 0);
+    CHECK(pool.freed() + pool.released() == num_objs);
+}
+#endif
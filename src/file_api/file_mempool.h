@@ -28,7 +28,9 @@
 //  One more bonus: Double free detection is also added into this library
 //  This is a thread safe version of memory pool for one writer and one reader thread
 
+#include <atomic>
 #include <mutex>
+#include <vector>
 
 #include "circular_buffer.h"
 
@@ -67,10 +69,22 @@ public:
     // Returns total number of elements in current buffer
     uint64_t total_objects() { return total; }
 
-private:
+    // Objects are allocated from and freed to a per thread magazine first.
+    // The pool lock is only taken to move half a magazine to or from the
+    // shared lists.  When the lists are empty, an allocation takes an object
+    // from another thread's magazine so the pool is only exhausted when all
+    // objects are in use.  This must be called before a thread using the
+    // pool exits to return its cached objects.
+    void thread_term();
+
+    struct Magazine;
 
+private:
     void free_pools();
     int remove(CircularBuffer* cb, void* obj);
+    Magazine* get_magazine();
+    void flush(Magazine*, CircularBuffer*, unsigned keep);
+    void* steal(const Magazine*);
 
     void** datapool = nullptr; /* memory buffer */
     uint64_t total = 0;
@@ -78,6 +92,11 @@ private:
     CircularBuffer* released_list = nullptr;
     size_t obj_size = 0;
     std::mutex pool_mutex;
+    std::atomic<uint64_t> cached { 0 };
+
+    // lock order is mags_mutex, then a magazine, then pool_mutex
+    std::mutex mags_mutex;
+    std::vector<Magazine*> mags;
 };
 
 #endif
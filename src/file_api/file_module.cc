@@ -150,12 +150,21 @@ static const Parameter file_id_params[] =
     { "capture_block_size", Parameter::PT_INT, "8:max53", "32768",
       "file capture block size in bytes" },
 
+    { "capture_writers", Parameter::PT_INT, "1:32", "1",
+      "number of threads storing captured files" },
+
     { "max_files_cached", Parameter::PT_INT, "8:max53", "65536",
       "maximal number of files cached in memory" },
 
     { "max_files_per_flow", Parameter::PT_INT, "1:max53", "128",
       "maximal number of files able to be concurrently processed per flow" },
 
+    { "signature_workers", Parameter::PT_INT, "0:32", "0",
+      "number of threads computing file signatures for the packet threads (0 computes inline)" },
+
+    { "signature_queue_depth", Parameter::PT_INT, "16:65535", "1024",
+      "maximal number of file segments queued for signature workers per packet thread" },
+
     { "enable_type", Parameter::PT_BOOL, nullptr, "true",
       "enable type ID" },
 
@@ -217,6 +226,10 @@ static const PegInfo file_pegs[] =
     { CountType::SUM, "cache_failures", "number of file cache add failures" },
     { CountType::SUM, "files_not_processed", "number of files not processed due to per-flow limit" },
     { CountType::MAX, "max_concurrent_files", "maximum files processed concurrently on a flow" },
+    { CountType::SUM, "signatures_offloaded", "number of file signatures computed by signature workers" },
+    { CountType::SUM, "signature_queue_full", "number of file segments that found the signature queue full" },
+    { CountType::MAX, "capture_queue_max", "maximum number of captured files queued for writers" },
+    { CountType::SUM, "capture_queue_usecs", "total microseconds captured files waited for a writer" },
     { CountType::END, nullptr, nullptr }
 };
 
@@ -285,12 +298,21 @@ bool FileIdModule::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("capture_block_size") )
         fc->capture_block_size = v.get_int64();
 
+    else if ( v.is("capture_writers") )
+        fc->capture_writers = v.get_uint32();
+
     else if ( v.is("max_files_cached") )
         fc->max_files_cached = v.get_int64();
 
     else if ( v.is("max_files_per_flow") )
         fc->max_files_per_flow = v.get_uint64();
 
+    else if ( v.is("signature_workers") )
+        fc->signature_workers = v.get_uint32();
+
+    else if ( v.is("signature_queue_depth") )
+        fc->signature_queue_depth = v.get_uint32();
+
     else if ( v.is("enable_type") )
     {
         fp.set_file_type(v.get_bool());
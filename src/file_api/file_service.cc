@@ -37,6 +37,7 @@
 #include "file_cache.h"
 #include "file_capture.h"
 #include "file_flows.h"
+#include "file_hasher.h"
 #include "file_stats.h"
 
 using namespace snort;
@@ -53,6 +54,9 @@ DecodeConfig FileService::decode_conf;
 static int64_t max_files_cached = 0;
 static int64_t capture_memcap = 0;
 static int64_t capture_block_size = 0;
+static unsigned capture_writers = 0;
+static unsigned signature_workers = 0;
+static unsigned signature_queue_depth = 0;
 
 void FileService::init()
 {
@@ -80,9 +84,17 @@ void FileService::post_init(const SnortConfig* sc)
 
     if (file_capture_enabled)
     {
-        FileCapture::init(conf->capture_memcap, conf->capture_block_size);
+        FileCapture::init(conf->capture_memcap, conf->capture_block_size, conf->capture_writers);
         capture_memcap = conf->capture_memcap;
         capture_block_size = conf->capture_block_size;
+        capture_writers = conf->capture_writers;
+    }
+
+    if (file_signature_enabled and conf->signature_workers)
+    {
+        FileHasher::init(conf->signature_workers, conf->signature_queue_depth);
+        signature_workers = conf->signature_workers;
+        signature_queue_depth = conf->signature_queue_depth;
     }
 }
 
@@ -102,6 +114,16 @@ void FileService::verify_reload(const SnortConfig* sc)
             ReloadError("Changing file_id.capture_memcap requires a restart.\n");
         if (capture_block_size != conf->capture_block_size)
             ReloadError("Changing file_id.capture_block_size requires a restart.\n");
+        if (capture_writers != conf->capture_writers)
+            ReloadError("Changing file_id.capture_writers requires a restart.\n");
+    }
+
+    if (file_signature_enabled)
+    {
+        if (signature_workers != conf->signature_workers)
+            ReloadError("Changing file_id.signature_workers requires a restart.\n");
+        else if (signature_workers and signature_queue_depth != conf->signature_queue_depth)
+            ReloadError("Changing file_id.signature_queue_depth requires a restart.\n");
     }
 }
 
@@ -112,13 +134,17 @@ void FileService::close()
 
     MimeSession::exit();
     FileCapture::exit();
+    FileHasher::exit();
 }
 
 void FileService::thread_init()
 { file_stats_init(); }
 
 void FileService::thread_term()
-{ file_stats_term(); }
+{
+    FileCapture::thread_term();
+    file_stats_term();
+}
 
 void FileService::enable_file_type()
 {
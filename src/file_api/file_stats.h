@@ -37,6 +37,10 @@ struct FileCounts
     PegCount cache_add_fails;
     PegCount files_over_flow_limit_not_processed;
     PegCount max_concurrent_files_per_flow;
+    PegCount signatures_offloaded;
+    PegCount signature_queue_full;
+    PegCount capture_queue_max;
+    PegCount capture_queue_usecs;
     PegCount files_buffered_total;
     PegCount files_released_total;
     PegCount files_freed_total;
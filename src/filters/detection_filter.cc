@@ -28,12 +28,16 @@
 #include "main/thread.h"
 #include "utils/util.h"
 
+#include "shared_counts.h"
 #include "sfthd.h"
 
 using namespace snort;
 
 static THREAD_LOCAL XHash* detection_filter_hash = nullptr;
 
+// replaces detection_filter_hash in all threads if detection_filter_shared is set
+static SharedCounts* detection_filter_shared = nullptr;
+
 DetectionFilterConfig* DetectionFilterConfigNew()
 {
     DetectionFilterConfig* df =
@@ -58,6 +62,12 @@ int detection_filter_test(void* pv, const SfIp* sip, const SfIp* dip, long curti
     if (pv == nullptr)
         return 0;
 
+    if ( detection_filter_shared )
+    {
+        return sfthd_test_shared(detection_filter_shared, (THD_NODE*)pv,
+            sip, dip, curtime, get_ips_policy()->policy_id);
+    }
+
     return sfthd_test_rule(detection_filter_hash, (THD_NODE*)pv,
         sip, dip, curtime, get_ips_policy()->policy_id);
 }
@@ -78,7 +88,7 @@ THD_NODE* detection_filter_create(DetectionFilterConfig* df_config, THDX_STRUCT*
 
 void detection_filter_init(DetectionFilterConfig* df_config)
 {
-    if ( !df_config->enabled )
+    if ( !df_config->enabled or df_config->shared )
         return;
 
     if ( !detection_filter_hash )
@@ -94,3 +104,18 @@ void detection_filter_term()
     detection_filter_hash = nullptr;
 }
 
+void detection_filter_shared_init(DetectionFilterConfig* df_config)
+{
+    if ( !df_config->enabled or !df_config->shared )
+        return;
+
+    if ( !detection_filter_shared )
+        detection_filter_shared = new SharedCounts(df_config->memcap);
+}
+
+void detection_filter_shared_term()
+{
+    delete detection_filter_shared;
+    detection_filter_shared = nullptr;
+}
+
@@ -39,6 +39,7 @@ struct DetectionFilterConfig
     unsigned memcap;
     int count;
     int enabled;
+    bool shared;
 };
 
 DetectionFilterConfig* DetectionFilterConfigNew();
@@ -47,6 +48,10 @@ void DetectionFilterConfigFree(DetectionFilterConfig*);
 void detection_filter_init(DetectionFilterConfig*);
 void detection_filter_term();
 
+// called once before and after the packet threads run
+void detection_filter_shared_init(DetectionFilterConfig*);
+void detection_filter_shared_term();
+
 int detection_filter_test(void*, const snort::SfIp* sip, const snort::SfIp* dip, long curtime);
 struct THD_NODE* detection_filter_create(DetectionFilterConfig*, struct THDX_STRUCT*);
 
@@ -66,6 +66,17 @@ void RateFilter_Cleanup()
     SFRF_Delete();
 }
 
+void RateFilter_SharedInit(RateFilterConfig* config)
+{
+    if ( config and config->shared )
+        SFRF_SharedNew(config->memcap);
+}
+
+void RateFilter_SharedTerm()
+{
+    SFRF_SharedDelete();
+}
+
 /*
  * Create and Add a Thresholding Event Object
  */
@@ -36,6 +36,10 @@ RateFilterConfig* RateFilter_ConfigNew();
 void RateFilter_ConfigFree(RateFilterConfig*);
 void RateFilter_Cleanup();
 
+// called once before and after the packet threads run
+void RateFilter_SharedInit(RateFilterConfig*);
+void RateFilter_SharedTerm();
+
 int RateFilter_Create(snort::SnortConfig* sc, RateFilterConfig*, tSFRFConfigNode*);
 int RateFilter_Test(const OptTreeNode*, snort::Packet*);
 
@@ -37,6 +37,8 @@
 #include "utils/sflsq.h"
 #include "utils/util.h"
 
+#include "shared_counts.h"
+
 using namespace snort;
 
 // Number of hash rows for gid 1 (rules)
@@ -102,6 +104,9 @@ typedef struct
 
 static THREAD_LOCAL XHash* rf_hash = nullptr;
 
+// replaces rf_hash in all threads if rate_filter_shared is set
+static SharedCounts* rf_shared = nullptr;
+
 // private methods ...
 static int _checkThreshold(
     tSFRFConfigNode*,
@@ -121,6 +126,13 @@ static tSFRFTrackingNode* _getSFRFTrackingNode(
     time_t curTime
     );
 
+static int SFRF_TestShared(
+    tSFRFConfigNode*,
+    const SfIp*,
+    time_t curTime,
+    SFRF_COUNT_OPERATION
+    );
+
 static void _updateDependentThresholds(
     RateFilterConfig* config,
     unsigned gid,
@@ -170,6 +182,18 @@ void SFRF_Flush()
         rf_hash->clear_hash();
 }
 
+void SFRF_SharedNew(unsigned memcap)
+{
+    if ( !rf_shared )
+        rf_shared = new SharedCounts(memcap);
+}
+
+void SFRF_SharedDelete()
+{
+    delete rf_shared;
+    rf_shared = nullptr;
+}
+
 static void SFRF_ConfigNodeFree(void* item)
 {
     tSFRFConfigNode* node = (tSFRFConfigNode*)item;
@@ -358,6 +382,9 @@ static int SFRF_TestObject(
     tSFRFTrackingNode* dynNode;
     int retValue = -1;
 
+    if ( rf_shared )
+        return SFRF_TestShared(cfgNode, ip, curTime, op);
+
     dynNode = _getSFRFTrackingNode(ip, cfgNode->tid, curTime);
 
     if ( dynNode == nullptr )
@@ -802,3 +829,102 @@ static tSFRFTrackingNode* _getSFRFTrackingNode(const SfIp* ip, unsigned tid, tim
 
     return dynNode;
 }
+
+//--------------------------------------------------------------------------
+// shared counts
+//--------------------------------------------------------------------------
+
+// this follows _checkSamplingPeriod() and _checkThreshold() with the node
+// state kept in a SharedCount.  the count and over rate are for all
+// threads so once any thread starts the new action the others see the
+// same count and start it on their next event.
+static inline bool _overRate(const SharedCount* sc)
+{
+#ifdef SFRF_OVER_RATE
+    return sc->is_over();
+#else
+    UNUSED(sc);
+    return false;
+#endif
+}
+
+static int _checkSharedThreshold(
+    tSFRFConfigNode* cfgNode,
+    SharedCount* sc,
+    unsigned count,
+    time_t curTime)
+{
+    if ( sc->is_on() )
+    {
+        if ( !cfgNode->timeout or (uint32_t)curTime - sc->on_time() < cfgNode->timeout )
+            return cfgNode->newAction;
+
+        if ( count > cfgNode->count or _overRate(sc) )
+        {
+            sc->set_on(curTime);
+            return cfgNode->newAction;
+        }
+        sc->set_off();
+    }
+
+    if ( count <= cfgNode->count and !_overRate(sc) )
+        return -1;
+
+    sc->set_on(curTime);
+    sc->set_over();
+
+    return Actions::MAX + cfgNode->newAction;
+}
+
+static int SFRF_TestShared(
+    tSFRFConfigNode* cfgNode,
+    const SfIp* ip,
+    time_t curTime,
+    SFRF_COUNT_OPERATION op
+    )
+{
+    tSFRFTrackingNodeKey key;
+
+    key.ip = *(ip);
+    key.tid = cfgNode->tid;
+    key.policyId = get_ips_policy()->policy_id;
+    key.padding = 0;
+
+    uint64_t tag;
+    SharedCount* sc = rf_shared->get(&key, sizeof(key), tag);
+
+    if ( !sc )
+    {
+        rate_filter_stats.xhash_nomem_peg++;
+        return -1;
+    }
+
+    unsigned n = (op == SFRF_COUNT_INCREMENT) ? 1 : 0;
+    unsigned count = sc->add(curTime, cfgNode->seconds, cfgNode->count, n);
+
+    // another key took the slot so count may not be ours
+    if ( !sc->holds(tag) )
+    {
+        rate_filter_stats.xhash_nomem_peg++;
+        return -1;
+    }
+
+    if ( op == SFRF_COUNT_DECREMENT and !cfgNode->seconds and count )
+    {
+        sc->sub();
+        --count;
+    }
+    else if ( op == SFRF_COUNT_RESET )
+    {
+        sc->reset();
+        count = 0;
+    }
+
+    int retValue = _checkSharedThreshold(cfgNode, sc, count, curTime);
+
+    // see SFRF_TestObject()
+    if ( !cfgNode->seconds and count > cfgNode->count and cfgNode->newAction == Actions::DROP )
+        sc->sub();
+
+    return retValue;
+}
@@ -143,6 +143,7 @@ struct RateFilterConfig
 
     unsigned memcap;
     unsigned noRevertCount;
+    bool shared;
     int count;
     int internal_event_mask;
 };
@@ -188,4 +189,8 @@ inline bool is_internal_event_enabled(RateFilterConfig* config, uint32_t sid)
 
 int SFRF_Alloc(unsigned int memcap);
 
+// one table for all threads instead of SFRF_Alloc() in each
+void SFRF_SharedNew(unsigned memcap);
+void SFRF_SharedDelete();
+
 #endif
@@ -1004,6 +1004,27 @@ TEST_CASE("sfrf default memcap", "[sfrf]")
     Term();
 }
 
+// counts shared by all threads give the same results with one thread
+TEST_CASE("sfrf shared", "[sfrf]")
+{
+    SnortConfig sc;
+    Init(&sc, MEM_DEFAULT);
+    SFRF_SharedNew(rfc->memcap);
+
+    SECTION("setup")
+    {
+        for ( unsigned i = 0; i < NUM_NODES; ++i )
+            CHECK(SetupCheck(i) == 1);
+    }
+    SECTION("event")
+    {
+        for ( unsigned i = 0; i < NUM_EVENTS; ++i )
+            CHECK(EventCheck(i) == 1);
+    }
+    SFRF_SharedDelete();
+    Term();
+}
+
 TEST_CASE("sfrf minimum memcap", "[sfrf]")
 {
     SnortConfig sc;
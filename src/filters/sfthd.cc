@@ -44,6 +44,8 @@
 #include "utils/sflsq.h"
 #include "utils/util.h"
 
+#include "shared_counts.h"
+
 using namespace snort;
 
 //  Debug Printing
@@ -634,6 +636,50 @@ int sfthd_test_rule(XHash* rule_hash, THD_NODE* sfthd_node,
     return (status < -1) ? 1 : status;
 }
 
+int sfthd_test_shared(SharedCounts* counts, THD_NODE* sfthd_node,
+    const SfIp* sip, const SfIp* dip, long curtime, PolicyId policy_id)
+{
+    if ((counts == nullptr) || (sfthd_node == nullptr))
+        return 0;
+
+    if ( sfthd_node->count == THD_NO_THRESHOLD )
+        return 0;
+
+    // only detection_filter uses shared counts
+    assert(sfthd_node->type == THD_TYPE_DETECT);
+
+    THD_IP_NODE_KEY key;
+    key.policyId = policy_id;
+    key.ip = (sfthd_node->tracking == THD_TRK_SRC) ? *sip : *dip;
+    key.thd_id = sfthd_node->thd_id;
+    key.padding = 0;
+
+    uint64_t tag;
+    SharedCount* sc = counts->get(&key, sizeof(key), tag);
+
+    if ( !sc )
+    {
+        event_filter_stats.xhash_nomem_peg_local++;
+        return 1;
+    }
+
+    // this is the detect test in sfthd_test_non_suppress() where prev is
+    // only checked against count
+    unsigned count = sc->add(curtime, sfthd_node->seconds, sfthd_node->count);
+
+    // another key took the slot so count may not be ours
+    if ( !sc->holds(tag) )
+    {
+        event_filter_stats.xhash_nomem_peg_local++;
+        return 1;
+    }
+
+    if ( count > (unsigned)sfthd_node->count or sc->is_over() )
+        return 0;
+
+    return 1;
+}
+
 static inline int sfthd_test_suppress(
     THD_NODE* sfthd_node,
     const SfIp* ip)
@@ -35,6 +35,7 @@ class XHash;
 struct SnortConfig;
 }
 
+class SharedCounts;
 typedef struct sf_list SF_LIST;
 
 /*!
@@ -230,6 +231,10 @@ void sfthd_objs_free(ThresholdObjects*);
 int sfthd_test_rule(snort::XHash* rule_hash, THD_NODE* sfthd_node,
     const snort::SfIp* sip, const snort::SfIp* dip, long curtime, PolicyId policy_id);
 
+// same as sfthd_test_rule() with counts shared by all threads
+int sfthd_test_shared(SharedCounts*, THD_NODE* sfthd_node,
+    const snort::SfIp* sip, const snort::SfIp* dip, long curtime, PolicyId policy_id);
+
 THD_NODE* sfthd_create_rule_threshold(
     int id,
     int tracking,
@@ -28,6 +28,7 @@
 #include "parser/parse_ip.h"
 #include "sfip/sf_ip.h"
 
+#include "shared_counts.h"
 #include "sfthd.h"
 
 using namespace snort;
@@ -93,6 +94,7 @@ typedef struct
 static THD_STRUCT* pThd = nullptr;
 static ThresholdObjects* pThdObjs = nullptr;
 static XHash* dThd = nullptr;
+static SharedCounts* dShared = nullptr;
 
 //---------------------------------------------------------------
 
@@ -811,6 +813,10 @@ static void Term()
     }
 
     delete dThd;
+    dThd = nullptr;
+
+    delete dShared;
+    dShared = nullptr;
 }
 
 static int SetupCheck(int i)
@@ -842,7 +848,12 @@ static int EventTest(EventData* p, THD_NODE* rule)
     sip.set(p->sip);
     dip.set(p->dip);
 
-    if ( rule )
+    if ( rule and dShared )
+    {
+        status = sfthd_test_shared(
+            dShared, rule, &sip, &dip, curtime, get_ips_policy()->policy_id);
+    }
+    else if ( rule )
     {
         status = sfthd_test_rule(dThd, rule, &sip, &dip, curtime, get_ips_policy()->policy_id);
     }
@@ -967,3 +978,21 @@ TEST_CASE("sfthd detect", "[sfthd]")
     Term();
 }
 
+TEST_CASE("sfthd detect shared", "[sfthd]")
+{
+    SnortConfig sc;
+    InitDetect(&sc);
+    dShared = new SharedCounts(MEM_DEFAULT);
+
+    SECTION("rules")
+    {
+        for ( unsigned i = 0; i < NUM_RULS; ++i )
+            CHECK(RuleCheck(i) == 1);
+    }
+    SECTION("packets")
+    {
+        for ( unsigned i = 0; i < NUM_PKTS; ++i )
+            CHECK(PacketCheck(i) == 1);
+    }
+    Term();
+}
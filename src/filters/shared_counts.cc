@@ -0,0 +1,196 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "shared_counts.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+// a busy count may change between the load and the swap so give up
+// instead of retrying without bound
+static const unsigned max_tries = 4;
+
+static inline uint64_t mix(uint64_t h)
+{
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+static uint64_t hash_key(const void* key, size_t len, uint64_t seed)
+{
+    const uint8_t* p = (const uint8_t*)key;
+    uint64_t h = mix(seed ^ len);
+
+    while ( len )
+    {
+        uint64_t w = 0;
+        size_t n = std::min(len, sizeof(w));
+        memcpy(&w, p, n);
+        h = mix(h ^ w);
+        p += n;
+        len -= n;
+    }
+    return h;
+}
+
+static inline uint32_t start_of(uint64_t period)
+{ return period >> 32; }
+
+static inline uint32_t count_of(uint64_t period)
+{ return (uint32_t)period; }
+
+static inline uint64_t make_period(uint32_t start, uint32_t count)
+{ return ((uint64_t)start << 32) | count; }
+
+//--------------------------------------------------------------------------
+// count
+//--------------------------------------------------------------------------
+
+unsigned SharedCount::add(time_t now, unsigned seconds, unsigned limit, unsigned n)
+{
+    uint32_t t = (uint32_t)now;
+    uint64_t p = period.load(std::memory_order_relaxed);
+
+    // an unused slot starts a period on the first event
+    if ( !p or (seconds and t - start_of(p) >= seconds) )
+    {
+        if ( period.compare_exchange_strong(p, make_period(t, n), std::memory_order_relaxed) )
+        {
+            uint32_t prev = last.exchange(t, std::memory_order_relaxed);
+            bool was_over = seconds and t - prev <= seconds and count_of(p) > limit;
+            over.store(was_over, std::memory_order_relaxed);
+            return n;
+        }
+        // another thread started the period and p is now current
+    }
+    last.store(t, std::memory_order_relaxed);
+    p = period.fetch_add(n, std::memory_order_relaxed);
+
+    if ( !seconds )
+        over.store(count_of(p) > limit, std::memory_order_relaxed);
+
+    return count_of(p) + n;
+}
+
+// this and the fence in SharedCounts::get() order the add before the
+// check here against the key swap before clear() there.  if the key still
+// matches then any clear() comes after the add, which is then lost with
+// the rest of the old count instead of landing in the new one.
+bool SharedCount::holds(uint64_t tag) const
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return key.load(std::memory_order_relaxed) == tag;
+}
+
+void SharedCount::sub()
+{
+    uint64_t p = period.load(std::memory_order_relaxed);
+
+    for ( unsigned i = 0; i < max_tries and count_of(p); ++i )
+    {
+        if ( period.compare_exchange_weak(p, p - 1, std::memory_order_relaxed) )
+            return;
+    }
+}
+
+void SharedCount::reset()
+{
+    uint64_t p = period.load(std::memory_order_relaxed);
+    period.compare_exchange_strong(p, make_period(start_of(p), 0), std::memory_order_relaxed);
+}
+
+void SharedCount::clear()
+{
+    period.store(0, std::memory_order_relaxed);
+    action.store(0, std::memory_order_relaxed);
+    last.store(0, std::memory_order_relaxed);
+    over.store(0, std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------------------
+// table
+//--------------------------------------------------------------------------
+
+const unsigned SharedCounts::max_probes;
+
+SharedCounts::SharedCounts(size_t memcap)
+{
+    size = std::max(memcap / sizeof(SharedCount), (size_t)max_probes);
+    slots = new SharedCount[size]();
+
+    std::random_device rd;
+    seed = ((uint64_t)rd() << 32) | rd();
+}
+
+SharedCounts::~SharedCounts()
+{ delete[] slots; }
+
+SharedCount* SharedCounts::get(const void* key, size_t len, uint64_t& tag)
+{
+    tag = hash_key(key, len, seed);
+
+    // zero marks an empty slot
+    if ( !tag )
+        tag = 1;
+
+    unsigned idx = ((uint64_t)(uint32_t)tag * size) >> 32;
+    SharedCount* lru = nullptr;
+
+    for ( unsigned i = 0; i < max_probes; ++i )
+    {
+        SharedCount* sc = slots + idx;
+        uint64_t k = sc->key.load(std::memory_order_relaxed);
+
+        // k is updated with the current key if the swap fails
+        if ( !k and sc->key.compare_exchange_strong(k, tag, std::memory_order_relaxed) )
+            return sc;
+
+        if ( k == tag )
+            return sc;
+
+        if ( !lru or sc->last.load(std::memory_order_relaxed) <
+            lru->last.load(std::memory_order_relaxed) )
+            lru = sc;
+
+        if ( ++idx == size )
+            idx = 0;
+    }
+
+    uint64_t k = lru->key.load(std::memory_order_relaxed);
+
+    if ( k != tag )
+    {
+        if ( !lru->key.compare_exchange_strong(k, tag, std::memory_order_relaxed) )
+            return nullptr;
+
+        // see SharedCount::holds()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        lru->clear();
+    }
+    return lru;
+}
+
@@ -0,0 +1,116 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef SHARED_COUNTS_H
+#define SHARED_COUNTS_H
+
+// Fixed size table of event counts shared by all packet threads so that
+// rate_filter and detection_filter limits apply to the whole process
+// instead of to each thread.  Nothing here blocks or retries without
+// bound: a key is found or added within max_probes slots and each update
+// is one atomic add or compare and swap.  Threads racing on the same key
+// at a period boundary may start the period with a count or two from the
+// last one, which is no worse than the per thread hash losing a node to
+// ANR.
+//
+// A slot may be taken for another key between get() and add().  Callers
+// must check holds() after add() and drop the event like a failed get()
+// if it fails.  The count returned while the slot is held is for the
+// caller's key; an add that lost the slot may be left in the new key's
+// count, so the new key can start at most one event per racing thread
+// high.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+class SharedCount
+{
+public:
+    // adds n to the count for the current period and returns the new count.
+    // a new period is started when seconds have passed since the current
+    // one started and 0 seconds means the period never ends.
+    unsigned add(time_t now, unsigned seconds, unsigned limit, unsigned n = 1);
+
+    // true if this slot is still used for the key get() found it for.
+    // call after add() so the returned count is known to be for that key.
+    bool holds(uint64_t tag) const;
+
+    // decrements the count unless it is already zero
+    void sub();
+    void reset();
+
+    // with seconds this is set when a new period starts if the last one
+    // ended over limit within the last seconds.  without seconds this is
+    // set by each add if the count was over limit.
+    bool is_over() const
+    { return over.load(std::memory_order_relaxed); }
+
+    void set_over()
+    { over.store(1, std::memory_order_relaxed); }
+
+    // rate_filter keeps the time its new action started here
+    bool is_on() const
+    { return action.load(std::memory_order_relaxed) >> 32; }
+
+    uint32_t on_time() const
+    { return (uint32_t)action.load(std::memory_order_relaxed); }
+
+    void set_on(time_t now)
+    { action.store(((uint64_t)1 << 32) | (uint32_t)now, std::memory_order_relaxed); }
+
+    void set_off()
+    { action.store(0, std::memory_order_relaxed); }
+
+private:
+    friend class SharedCounts;
+    void clear();
+
+    std::atomic<uint64_t> key;
+    std::atomic<uint64_t> period;   // start << 32 | count
+    std::atomic<uint64_t> action;   // on << 32 | start
+    std::atomic<uint32_t> last;     // time of the last event
+    std::atomic<uint32_t> over;
+};
+
+class SharedCounts
+{
+public:
+    static const unsigned max_probes = 8;
+
+    // memcap is for all threads
+    SharedCounts(size_t memcap);
+    ~SharedCounts();
+
+    // finds or adds the count for key and sets tag for holds().  if the
+    // probed slots are all in use the least recently updated one is taken.
+    // returns nullptr only if another thread takes that slot first.
+    SharedCount* get(const void* key, size_t len, uint64_t& tag);
+
+    unsigned get_size() const
+    { return size; }
+
+private:
+    SharedCount* slots;
+    unsigned size;
+    uint64_t seed;
+};
+
+#endif
+
@@ -0,0 +1,293 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "catch/snort_catch.h"
+
+#include "shared_counts.h"
+
+//---------------------------------------------------------------
+
+static SharedCount* get(SharedCounts& counts, unsigned key)
+{
+    uint64_t tag;
+    return counts.get(&key, sizeof(key), tag);
+}
+
+TEST_CASE("shared count periods", "[shared_counts]")
+{
+    SharedCounts counts(1024);
+    SharedCount* sc = get(counts, 1);
+    REQUIRE(sc);
+
+    // count 3 in 10 seconds
+    CHECK(sc->add(100, 10, 3) == 1);
+    CHECK(sc->add(101, 10, 3) == 2);
+    CHECK(sc->add(102, 10, 3) == 3);
+    CHECK(sc->add(109, 10, 3) == 4);
+    CHECK(!sc->is_over());
+
+    // the last period ended over
+    CHECK(sc->add(110, 10, 3) == 1);
+    CHECK(sc->is_over());
+
+    CHECK(sc->add(120, 10, 3) == 1);
+    CHECK(!sc->is_over());
+
+    // no events in the last period
+    sc->add(130, 10, 3);
+    sc->add(130, 10, 3);
+    sc->add(130, 10, 3);
+    sc->add(130, 10, 3);
+    CHECK(sc->add(141, 10, 3) == 1);
+    CHECK(!sc->is_over());
+
+    sc->reset();
+    CHECK(sc->add(142, 10, 3) == 1);
+}
+
+TEST_CASE("shared count totals", "[shared_counts]")
+{
+    SharedCounts counts(1024);
+    SharedCount* sc = get(counts, 2);
+    REQUIRE(sc);
+
+    CHECK(sc->add(100, 0, 1) == 1);
+    CHECK(!sc->is_over());
+    CHECK(sc->add(200, 0, 1) == 2);
+    CHECK(!sc->is_over());
+    CHECK(sc->add(300, 0, 1) == 3);
+    CHECK(sc->is_over());
+
+    sc->sub();
+    sc->sub();
+    sc->sub();
+    sc->sub();
+    CHECK(sc->add(400, 0, 1, 0) == 0);
+    CHECK(!sc->is_over());
+
+    CHECK(!sc->is_on());
+    sc->set_on(500);
+    CHECK(sc->is_on());
+    CHECK(sc->on_time() == 500);
+    sc->set_off();
+    CHECK(!sc->is_on());
+}
+
+TEST_CASE("shared counts table", "[shared_counts]")
+{
+    // the minimum is one probe window
+    SharedCounts counts(0);
+    REQUIRE(counts.get_size() == SharedCounts::max_probes);
+
+    SharedCount* keys[SharedCounts::max_probes];
+
+    for ( unsigned i = 0; i < SharedCounts::max_probes; ++i )
+    {
+        keys[i] = get(counts, i);
+        REQUIRE(keys[i]);
+        keys[i]->add(100 + i, 10, 1);
+    }
+
+    for ( unsigned i = 0; i < SharedCounts::max_probes; ++i )
+    {
+        CHECK(get(counts, i) == keys[i]);
+
+        for ( unsigned j = 0; j < i; ++j )
+            CHECK(keys[i] != keys[j]);
+    }
+
+    // the least recently updated slot is cleared for the new key
+    SharedCount* sc = get(counts, SharedCounts::max_probes);
+    CHECK(sc == keys[0]);
+    CHECK(sc->add(200, 10, 1) == 1);
+
+    CHECK(get(counts, 0) == keys[1]);
+}
+
+TEST_CASE("shared count threads", "[shared_counts]")
+{
+    const unsigned num_threads = 8;
+    const unsigned num_adds = 100000;
+
+    SharedCounts counts(1 << 16);
+    std::vector<std::thread> threads;
+
+    for ( unsigned i = 0; i < num_threads; ++i )
+    {
+        threads.emplace_back([&counts, i]()
+        {
+            for ( unsigned n = 0; n < num_adds; ++n )
+            {
+                get(counts, 0)->add(100, 0, 0);
+                get(counts, i + 1)->add(100, 0, 0);
+            }
+        });
+    }
+    for ( auto& t : threads )
+        t.join();
+
+    CHECK(get(counts, 0)->add(100, 0, 0, 0) == num_threads * num_adds);
+
+    for ( unsigned i = 1; i <= num_threads; ++i )
+        CHECK(get(counts, i)->add(100, 0, 0, 0) == num_adds);
+}
+
+// more keys than slots so they are taken from each other between get and
+// add.  thread i adds 1 << (8 * i) so each byte of a count is how many
+// adds one thread made to it.  a held count only has adds from other
+// threads that lost that slot, so those bytes are bounded by the number
+// of adds each thread had to drop.
+TEST_CASE("shared count steals", "[shared_counts]")
+{
+    const unsigned num_threads = 4;
+    const unsigned num_keys = 4;
+    const unsigned num_adds = 200;  // each byte stays under 256
+
+    for ( unsigned round = 0; round < 50; ++round )
+    {
+        SharedCounts counts(0);
+        std::vector<std::thread> threads;
+        unsigned dropped[num_threads] = { };
+        unsigned most[num_threads][num_threads] = { };
+
+        for ( unsigned i = 0; i < num_threads; ++i )
+        {
+            threads.emplace_back([&counts, &dropped, &most, i]()
+            {
+                for ( unsigned n = 0; n < num_adds; ++n )
+                {
+                    unsigned key = i * num_keys + n % num_keys;
+                    uint64_t tag;
+                    SharedCount* sc = counts.get(&key, sizeof(key), tag);
+
+                    if ( !sc )
+                    {
+                        ++dropped[i];
+                        continue;
+                    }
+                    std::this_thread::yield();
+                    unsigned count = sc->add(100, 0, ~0u, 1u << (8 * i));
+
+                    if ( !sc->holds(tag) )
+                    {
+                        ++dropped[i];
+                        continue;
+                    }
+                    for ( unsigned j = 0; j < num_threads; ++j )
+                        most[i][j] = std::max(most[i][j], (count >> (8 * j)) & 0xff);
+                }
+            });
+        }
+        for ( auto& t : threads )
+            t.join();
+
+        for ( unsigned i = 0; i < num_threads; ++i )
+        {
+            for ( unsigned j = 0; j < num_threads; ++j )
+            {
+                if ( i != j )
+                    CHECK(most[i][j] <= dropped[j]);
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------
+
+#ifdef BENCHMARK_TEST
+
+// each thread updates either one key for all threads, like a rate_filter
+// tracked by rule, or its own keys, like one tracked by source with each
+// source on one thread.  without contention the total rate goes up with
+// the number of threads.  the threads wait to start together so they run
+// in parallel instead of one after another.
+static double million_updates_per_second(
+    SharedCounts& counts, unsigned num_threads, bool one_key)
+{
+    const unsigned num_updates = 1000000;
+    std::vector<std::thread> threads;
+    std::atomic<unsigned> ready(0);
+    std::atomic<bool> go(false);
+
+    for ( unsigned i = 0; i < num_threads; ++i )
+    {
+        threads.emplace_back([&counts, &ready, &go, i, one_key]()
+        {
+            ++ready;
+
+            while ( !go )
+                std::this_thread::yield();
+
+            for ( unsigned n = 0; n < num_updates; ++n )
+            {
+                unsigned key = one_key ? 0 : (i << 10) | (n & 1023);
+                uint64_t tag;
+                SharedCount* sc = counts.get(&key, sizeof(key), tag);
+
+                if ( sc )
+                {
+                    sc->add(n >> 16, 1, 100);
+                    sc->holds(tag);
+                }
+            }
+        });
+    }
+    while ( ready < num_threads )
+        std::this_thread::yield();
+
+    auto start = std::chrono::steady_clock::now();
+    go = true;
+
+    for ( auto& t : threads )
+        t.join();
+
+    std::chrono::duration<double, std::micro> us = std::chrono::steady_clock::now() - start;
+    return (double)num_threads * num_updates / us.count();
+}
+
+// more threads than cores only measures time slicing so stop at the
+// number of cores
+TEST_CASE("shared count contention", "[shared_counts]")
+{
+    SharedCounts counts(4 << 20);
+    unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+
+    WARN(cores << " cores");
+
+    for ( unsigned num_threads = 1; num_threads <= cores; num_threads *= 2 )
+    {
+        double one = million_updates_per_second(counts, num_threads, true);
+        double own = million_updates_per_second(counts, num_threads, false);
+
+        WARN(num_threads << " threads: " << one << "M updates/sec of one key, " <<
+            own << "M updates/sec of own keys");
+    }
+}
+
+#endif
+
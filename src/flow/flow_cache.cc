@@ -25,8 +25,6 @@
 #include "flow/flow_cache.h"
 
 #include "detection/detection_engine.h"
-#include "hash/hash_defs.h"
-#include "hash/zhash.h"
 #include "helpers/flag_context.h"
 #include "ips_options/ips_flowbits.h"
 #include "memory/memory_cap.h"
@@ -37,6 +35,7 @@
 
 #include "flow.h"
 #include "flow_key.h"
+#include "flow_table.h"
 #include "flow_uni_list.h"
 #include "ha.h"
 #include "session.h"
@@ -55,7 +54,7 @@ static const unsigned ALL_FLOWS = 3;
 
 FlowCache::FlowCache(const FlowCacheConfig& cfg) : config(cfg)
 {
-    hash_table = new ZHash(config.max_flows, sizeof(FlowKey));
+    hash_table = FlowTable::create(config.table_type, config.max_flows, sizeof(FlowKey));
     uni_flows = new FlowUniList;
     uni_ip_flows = new FlowUniList;
     flags = 0x0;
@@ -92,7 +91,7 @@ unsigned FlowCache::get_count()
 
 Flow* FlowCache::find(const FlowKey* key)
 {
-    Flow* flow = (Flow*)hash_table->get_user_data(key);
+    Flow* flow = (Flow*)hash_table->find(key);
 
     if ( flow )
     {
@@ -105,6 +104,23 @@ Flow* FlowCache::find(const FlowKey* key)
     return flow;
 }
 
+unsigned FlowCache::get_hash(const FlowKey* key)
+{ return hash_table->get_hash(key); }
+
+// each pass only reads lines requested by the previous pass so the misses
+// for all the keys are in flight together instead of one after another
+void FlowCache::prefetch(const unsigned* hashes, unsigned num_hashes) const
+{
+    for ( unsigned i = 0; i < num_hashes; ++i )
+        hash_table->prefetch_bucket(hashes[i]);
+
+    for ( unsigned i = 0; i < num_hashes; ++i )
+        hash_table->prefetch_node(hashes[i]);
+
+    for ( unsigned i = 0; i < num_hashes; ++i )
+        hash_table->prefetch_data(hashes[i]);
+}
+
 // always prepend
 void FlowCache::link_uni(Flow* flow)
 {
@@ -133,7 +149,7 @@ Flow* FlowCache::allocate(const FlowKey* key)
         {
             Flow* new_flow = new Flow();
             push(new_flow);
-            memory::MemoryCap::update_allocations(sizeof(HashNode) + sizeof(FlowKey));
+            memory::MemoryCap::update_allocations(hash_table->get_node_size());
         }
         else if ( !prune_stale(timestamp, nullptr) )
         {
@@ -168,7 +184,7 @@ void FlowCache::remove(Flow* flow)
     // FIXIT-M This check is added for offload case where both Flow::reset
     // and Flow::retire try remove the flow from hash. Flow::reset should
     // just mark the flow as pending instead of trying to remove it.
-    if ( !hash_table->release_node(flow->key) )
+    if ( hash_table->release(flow->key) )
         memory::MemoryCap::update_deallocations(config.proto[to_utype(flow->key->pkt_type)].cap_weight);
 }
 
@@ -346,7 +362,7 @@ bool FlowCache::prune_one(PruneReason reason, bool do_cleanup)
     if ( hash_table->get_num_nodes() <= 1 )
         return false;
 
-    // ZHash returns in LRU order, which is updated per packet via find --> move_to_front call
+    // FlowTable returns in LRU order, which is updated per packet via find --> move_to_front call
     auto flow = static_cast<Flow*>(hash_table->lru_first());
     assert(flow);
 
@@ -430,7 +446,7 @@ unsigned FlowCache::delete_active_flows(unsigned mode, unsigned num_to_delete, u
         //The flow should not be removed from the hash before reset
         hash_table->remove();
         delete flow;
-        memory::MemoryCap::update_deallocations(sizeof(HashNode) + sizeof(FlowKey));
+        memory::MemoryCap::update_deallocations(hash_table->get_node_size());
         --flows_allocated;
         ++deleted;
         --num_to_delete;
@@ -457,7 +473,7 @@ unsigned FlowCache::delete_flows(unsigned num_to_delete)
 
             delete flow;
             delete_stats.update(FlowDeleteState::FREELIST);
-            memory::MemoryCap::update_deallocations(sizeof(HashNode) + sizeof(FlowKey));
+            memory::MemoryCap::update_deallocations(hash_table->get_node_size());
 
             --flows_allocated;
             ++deleted;
@@ -492,7 +508,7 @@ unsigned FlowCache::purge()
     while ( Flow* flow = (Flow*)hash_table->pop() )
     {
         delete flow;
-        memory::MemoryCap::update_deallocations(sizeof(HashNode) + sizeof(FlowKey));
+        memory::MemoryCap::update_deallocations(hash_table->get_node_size());
         --flows_allocated;
     }
 
@@ -23,7 +23,7 @@
 #define FLOW_CACHE_H
 
 // there is a FlowCache instance for each protocol.
-// Flows are stored in a ZHash instance by FlowKey.
+// Flows are stored in a FlowTable instance by FlowKey.
 
 #include <ctime>
 #include <type_traits>
@@ -39,6 +39,7 @@ class Flow;
 struct FlowKey;
 }
 
+class FlowTable;
 class FlowUniList;
 
 class FlowCache
@@ -51,6 +52,8 @@ public:
     FlowCache& operator=(const FlowCache&) = delete;
 
     snort::Flow* find(const snort::FlowKey*);
+    unsigned get_hash(const snort::FlowKey*);
+    void prefetch(const unsigned* hashes, unsigned num_hashes) const;
     snort::Flow* allocate(const snort::FlowKey*);
 
     bool release(snort::Flow*, PruneReason = PruneReason::NONE, bool do_cleanup = true);
@@ -111,7 +114,7 @@ private:
     FlowCacheConfig config;
     uint32_t flags;
 
-    class ZHash* hash_table;
+    FlowTable* hash_table;
     unsigned flows_allocated = 0;
     FlowUniList* uni_flows;
     FlowUniList* uni_ip_flows;
@@ -24,6 +24,12 @@
 #include "framework/decode_data.h"
 
 // configured by the stream module
+enum class FlowTableType : uint8_t
+{
+    ZHASH,
+    FLAT
+};
+
 struct FlowTypeConfig
 {
     unsigned nominal_timeout = 0;
@@ -34,6 +40,8 @@ struct FlowCacheConfig
 {
     unsigned max_flows = 0;
     unsigned pruning_timeout = 0;
+    FlowTableType table_type = FlowTableType::ZHASH;
+    bool prefetch = false;
     FlowTypeConfig proto[to_utype(PktType::MAX)];
 };
 
@@ -20,7 +20,8 @@
 #include "config.h"
 #endif
 
-#include <daq_common.h>
+#include <daq.h>
+#include <daq_dlt.h>
 
 #include "flow_control.h"
 
@@ -39,6 +40,7 @@
 
 #include "expect_cache.h"
 #include "flow_cache.h"
+#include "flow_prefetch.h"
 #include "ha.h"
 #include "session.h"
 
@@ -78,6 +80,7 @@ void FlowControl::clear_counts()
 {
     cache->reset_stats();
     num_flows = 0;
+    num_prefetches = 0;
 }
 
 //-------------------------------------------------------------------------
@@ -373,6 +376,47 @@ static bool want_flow(PktType type, Packet* p)
     return false;
 }
 
+// warm the flows of a DAQ batch before any of it is decoded
+void FlowControl::prefetch_flows(const DAQ_Msg_h* msgs, unsigned num_msgs, int dlt)
+{
+    if ( dlt != DLT_EN10MB or !cache->get_flow_cache_config().prefetch )
+        return;
+
+    const SnortConfig* sc = SnortConfig::get_conf();
+    const unsigned max_hashes = 64;
+    unsigned hashes[max_hashes];
+    unsigned num_hashes = 0;
+
+    for ( unsigned i = 0; i < num_msgs; ++i )
+    {
+        DAQ_Msg_h msg = msgs[i];
+
+        if ( daq_msg_get_type(msg) != DAQ_MSG_TYPE_PACKET )
+            continue;
+
+        FlowKey key;
+
+        if ( !init_prefetch_key(sc, *daq_msg_get_pkthdr(msg), daq_msg_get_data(msg),
+            daq_msg_get_data_len(msg), key) )
+            continue;
+
+        hashes[num_hashes++] = cache->get_hash(&key);
+
+        if ( num_hashes == max_hashes )
+        {
+            cache->prefetch(hashes, num_hashes);
+            num_prefetches += num_hashes;
+            num_hashes = 0;
+        }
+    }
+
+    if ( num_hashes )
+    {
+        cache->prefetch(hashes, num_hashes);
+        num_prefetches += num_hashes;
+    }
+}
+
 bool FlowControl::process(PktType type, Packet* p, bool* new_flow)
 {
     if ( !get_proto_session[to_utype(type)] )
@@ -25,6 +25,8 @@
 // this is where all the flow caches are managed and where all flows are
 // processed.  flows are pruned as needed to process new flows.
 
+#include <daq_common.h>
+
 #include <cstdint>
 #include <vector>
 
@@ -59,6 +61,7 @@ public:
     unsigned get_flows_allocated() const;
 
     bool process(PktType, snort::Packet*, bool* new_flow = nullptr);
+    void prefetch_flows(const DAQ_Msg_h*, unsigned num_msgs, int dlt);
     snort::Flow* find_flow(const snort::FlowKey*);
     snort::Flow* new_flow(const snort::FlowKey*);
     void release_flow(const snort::FlowKey*);
@@ -87,6 +90,9 @@ public:
     PegCount get_flows()
     { return num_flows; }
 
+    PegCount get_prefetches()
+    { return num_prefetches; }
+
     PegCount get_total_prunes() const;
     PegCount get_prunes(PruneReason) const;
     PegCount get_total_deletes() const;
@@ -102,6 +108,7 @@ private:
 private:
     snort::InspectSsnFunc get_proto_session[to_utype(PktType::MAX)] = {};
     PegCount num_flows = 0;
+    PegCount num_prefetches = 0;
     FlowCache* cache = nullptr;
     snort::Flow* mem = nullptr;
     class ExpectCache* exp_cache = nullptr;
@@ -0,0 +1,234 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "flow_prefetch.h"
+
+#include "flow/flow_key.h"
+#include "protocols/eth.h"
+#include "protocols/icmp4.h"
+#include "protocols/ipv4.h"
+#include "protocols/ipv6.h"
+#include "protocols/packet.h"
+#include "protocols/tcp.h"
+#include "protocols/udp.h"
+#include "protocols/vlan.h"
+#include "sfip/sf_ip.h"
+
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#include "main/snort_config.h"
+#endif
+
+using namespace snort;
+
+// the icmp type is the first byte of both icmp4 and icmp6 headers
+static bool get_ports(
+    IpProtocol proto, const uint8_t* pkt, uint32_t len, PktType& type,
+    uint16_t& sp, uint16_t& dp)
+{
+    switch ( proto )
+    {
+    case IpProtocol::TCP:
+        if ( len < tcp::TCP_MIN_HEADER_LEN )
+            return false;
+        type = PktType::TCP;
+        sp = ((const tcp::TCPHdr*)pkt)->src_port();
+        dp = ((const tcp::TCPHdr*)pkt)->dst_port();
+        return true;
+
+    case IpProtocol::UDP:
+        if ( len < udp::UDP_HEADER_LEN )
+            return false;
+        type = PktType::UDP;
+        sp = ((const udp::UDPHdr*)pkt)->src_port();
+        dp = ((const udp::UDPHdr*)pkt)->dst_port();
+        return true;
+
+    case IpProtocol::ICMPV4:
+    case IpProtocol::ICMPV6:
+        if ( len < 1 )
+            return false;
+        type = PktType::ICMP;
+        sp = pkt[0];
+        dp = 0;
+        return true;
+
+    // tunnels are keyed on the inner packet
+    case IpProtocol::IPIP:
+    case IpProtocol::IPV6:
+    case IpProtocol::GRE:
+    case IpProtocol::ESP:
+        return false;
+
+    default:
+        type = PktType::IP;
+        sp = dp = 0;
+        return true;
+    }
+}
+
+bool init_prefetch_key(
+    const SnortConfig* sc, const DAQ_PktHdr_t& pkth, const uint8_t* pkt, uint32_t len,
+    FlowKey& key)
+{
+    if ( len < eth::ETH_HEADER_LEN )
+        return false;
+
+    ProtocolId ether_type = ((const eth::EtherHdr*)pkt)->ethertype();
+    uint16_t vlan_id = 0;
+
+    pkt += eth::ETH_HEADER_LEN;
+    len -= eth::ETH_HEADER_LEN;
+
+    // the decoder keys on the innermost tag
+    while ( ether_type == ProtocolId::ETHERTYPE_8021Q or
+        ether_type == ProtocolId::ETHERTYPE_8021AD or
+        ether_type == ProtocolId::ETHERTYPE_QINQ_NS1 or
+        ether_type == ProtocolId::ETHERTYPE_QINQ_NS2 )
+    {
+        if ( len < sizeof(vlan::VlanTagHdr) )
+            return false;
+
+        const vlan::VlanTagHdr* vh = (const vlan::VlanTagHdr*)pkt;
+        vlan_id = vh->vid();
+        ether_type = (ProtocolId)vh->proto();
+
+        pkt += sizeof(vlan::VlanTagHdr);
+        len -= sizeof(vlan::VlanTagHdr);
+    }
+
+    SfIp src, dst;
+    IpProtocol proto;
+
+    if ( ether_type == ProtocolId::ETHERTYPE_IPV4 )
+    {
+        if ( len < ip::IP4_HEADER_LEN )
+            return false;
+
+        const ip::IP4Hdr* ip4h = (const ip::IP4Hdr*)pkt;
+        unsigned hlen = ip4h->hlen();
+
+        if ( ip4h->ver() != 4 or hlen < ip::IP4_HEADER_LEN or hlen > len or
+            ip4h->mf() or ip4h->off() )
+            return false;
+
+        src.set(&ip4h->ip_src, AF_INET);
+        dst.set(&ip4h->ip_dst, AF_INET);
+        proto = ip4h->proto();
+
+        pkt += hlen;
+        len -= hlen;
+    }
+    else if ( ether_type == ProtocolId::ETHERTYPE_IPV6 )
+    {
+        if ( len < ip::IP6_HEADER_LEN )
+            return false;
+
+        const ip::IP6Hdr* ip6h = (const ip::IP6Hdr*)pkt;
+
+        if ( ip6h->ver() != 6 )
+            return false;
+
+        src.set(ip6h->get_src(), AF_INET6);
+        dst.set(ip6h->get_dst(), AF_INET6);
+        proto = ip6h->next();
+
+        // extension headers, including fragments, are left to the codecs
+        if ( proto != IpProtocol::TCP and proto != IpProtocol::UDP and
+            proto != IpProtocol::ICMPV6 )
+            return false;
+
+        pkt += ip::IP6_HEADER_LEN;
+        len -= ip::IP6_HEADER_LEN;
+    }
+    else
+        return false;
+
+    PktType type;
+    uint16_t sp, dp;
+
+    if ( !get_ports(proto, pkt, len, type, sp, dp) )
+        return false;
+
+    key.init(sc, type, proto, &src, sp, &dst, dp, vlan_id, 0, pkth);
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+static const uint8_t tcp4_frame[] =
+{
+    // ethernet with one vlan tag (vid 10)
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0x81, 0x00,
+    0x00, 0x0A, 0x08, 0x00,
+
+    // ip4 10.1.1.1 -> 10.2.2.2 tcp
+    0x45, 0x00, 0x00, 0x28, 0x00, 0x01, 0x40, 0x00, 0x40, 0x06, 0x00, 0x00,
+    10, 1, 1, 1, 10, 2, 2, 2,
+
+    // tcp 1234 -> 80
+    0x04, 0xD2, 0x00, 0x50, 0, 0, 0, 1, 0, 0, 0, 0, 0x50, 0x02, 0xFF, 0xFF,
+    0, 0, 0, 0
+};
+
+TEST_CASE("prefetch key matches decoded key", "[flow_prefetch]")
+{
+    SnortConfig sc;
+    DAQ_PktHdr_t pkth = { };
+    pkth.ingress_group = pkth.egress_group = DAQ_PKTHDR_UNKNOWN;
+
+    FlowKey key;
+    REQUIRE(init_prefetch_key(&sc, pkth, tcp4_frame, sizeof(tcp4_frame), key));
+
+    SfIp src, dst;
+    src.pton(AF_INET, "10.1.1.1");
+    dst.pton(AF_INET, "10.2.2.2");
+
+    FlowKey expected;
+    expected.init(&sc, PktType::TCP, IpProtocol::TCP, &src, 1234, &dst, 80, 10, 0, pkth);
+
+    CHECK(FlowKey::is_equal(&key, &expected, 0));
+}
+
+TEST_CASE("prefetch key skips fragments and truncation", "[flow_prefetch]")
+{
+    SnortConfig sc;
+    DAQ_PktHdr_t pkth = { };
+    FlowKey key;
+
+    uint8_t frame[sizeof(tcp4_frame)];
+    memcpy(frame, tcp4_frame, sizeof(frame));
+
+    // more fragments
+    frame[24] = 0x20;
+    CHECK(!init_prefetch_key(&sc, pkth, frame, sizeof(frame), key));
+
+    CHECK(!init_prefetch_key(&sc, pkth, tcp4_frame, 30, key));
+    CHECK(!init_prefetch_key(&sc, pkth, tcp4_frame, 10, key));
+}
+
+#endif
+
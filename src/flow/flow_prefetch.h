@@ -0,0 +1,43 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef FLOW_PREFETCH_H
+#define FLOW_PREFETCH_H
+
+// builds the flow key of a raw ethernet frame without running the codecs
+// so the flow can be prefetched while the rest of the DAQ batch is still
+// waiting to be decoded.  only the common case is handled: optional vlan
+// tags then ip4 / ip6 then tcp, udp, icmp, or another ip protocol.
+// fragments, ip6 extension headers, mpls, and anything else return false
+// and are simply looked up cold.  a key that differs from the decoded one
+// only costs a wasted prefetch.
+
+#include <daq_common.h>
+
+namespace snort
+{
+struct FlowKey;
+struct SnortConfig;
+}
+
+bool init_prefetch_key(
+    const snort::SnortConfig*, const DAQ_PktHdr_t&, const uint8_t* pkt, uint32_t len,
+    snort::FlowKey&);
+
+#endif
+
@@ -0,0 +1,138 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef FLOW_TABLE_H
+#define FLOW_TABLE_H
+
+// FlowTable is the storage used by FlowCache.  it hides the selected
+// backend (ZHash or FlatZHash) behind the zhash contract:
+//
+// push / pop - add / remove an unused flow to / from the free list
+// get - find or insert the flow for a key, making it the MRU
+// find - find the flow for a key, making it the MRU
+// release - return the flow for a key to the free list
+// remove - drop the flow at the LRU cursor from the table and free list
+// lru_* - walk from the LRU end toward the MRU end
+// prefetch_* - warm the bucket, node, and flow for a key hash ahead of find
+
+#include <cstddef>
+
+#include "hash/flat_zhash.h"
+#include "hash/hash_defs.h"
+#include "hash/zhash.h"
+
+#include "flow_config.h"
+
+class FlowTable
+{
+public:
+    virtual ~FlowTable() = default;
+
+    virtual void* push(void*) = 0;
+    virtual void* pop() = 0;
+
+    virtual void* get(const void* key) = 0;
+    virtual void* find(const void* key) = 0;
+    virtual bool release(const void* key) = 0;
+    virtual void* remove() = 0;
+
+    virtual void* lru_first() = 0;
+    virtual void* lru_next() = 0;
+    virtual void* lru_current() = 0;
+    virtual void lru_touch() = 0;
+
+    virtual unsigned get_hash(const void* key) = 0;
+    virtual void prefetch_bucket(unsigned hash) const = 0;
+    virtual void prefetch_node(unsigned hash) const = 0;
+    virtual void prefetch_data(unsigned hash) const = 0;
+
+    virtual unsigned get_num_nodes() = 0;
+    virtual size_t get_node_size() const = 0;
+
+    static FlowTable* create(FlowTableType, unsigned max_flows, unsigned key_size);
+};
+
+template<typename Table>
+class FlowTableImpl : public FlowTable
+{
+public:
+    FlowTableImpl(unsigned rows, unsigned key_size) : table(rows, key_size)
+    { }
+
+    void* push(void* p) override
+    { return table.push(p); }
+
+    void* pop() override
+    { return table.pop(); }
+
+    void* get(const void* key) override
+    { return table.get(key); }
+
+    void* find(const void* key) override
+    { return table.get_user_data(key); }
+
+    bool release(const void* key) override
+    { return table.release_node(key) == HASH_OK; }
+
+    void* remove() override
+    { return table.remove(); }
+
+    void* lru_first() override
+    { return table.lru_first(); }
+
+    void* lru_next() override
+    { return table.lru_next(); }
+
+    void* lru_current() override
+    { return table.lru_current(); }
+
+    void lru_touch() override
+    { table.lru_touch(); }
+
+    unsigned get_hash(const void* key) override
+    { return table.get_hash(key); }
+
+    void prefetch_bucket(unsigned hash) const override
+    { table.prefetch_bucket(hash); }
+
+    void prefetch_node(unsigned hash) const override
+    { table.prefetch_node(hash); }
+
+    void prefetch_data(unsigned hash) const override
+    { table.prefetch_data(hash); }
+
+    unsigned get_num_nodes() override
+    { return table.get_num_nodes(); }
+
+    size_t get_node_size() const override
+    { return table.get_node_size(); }
+
+private:
+    Table table;
+};
+
+inline FlowTable* FlowTable::create(FlowTableType type, unsigned max_flows, unsigned key_size)
+{
+    if ( type == FlowTableType::FLAT )
+        return new FlowTableImpl<FlatZHash>(max_flows, key_size);
+
+    return new FlowTableImpl<ZHash>(max_flows, key_size);
+}
+
+#endif
+
@@ -92,6 +92,8 @@ bool ExpectCache::check(Packet*, Flow*) { return true; }
 bool ExpectCache::is_expected(Packet*) { return true; }
 Flow* HighAvailabilityManager::import(Packet&, FlowKey&) { return nullptr; }
 bool HighAvailabilityManager::in_standby(Flow*) { return true; }
+bool init_prefetch_key(const SnortConfig*, const DAQ_PktHdr_t&, const uint8_t*, uint32_t, FlowKey&)
+{ return false; }
 SfIpRet SfIp::set(void const*, int) { return SFIP_SUCCESS; }
 namespace memory
 {
@@ -259,6 +261,89 @@ TEST(flow_prune, prune_all_blocked_flows)
     delete cache;
 }
 
+// Same as blocked_flow_prune_flows using the open addressing flow table
+TEST(flow_prune, flat_table_blocked_flow_prune_flows)
+{
+    FlowCacheConfig fcg;
+    fcg.max_flows = 2;
+    fcg.table_type = FlowTableType::FLAT;
+    FlowCache *cache = new FlowCache(fcg);
+
+    int first_port = 1;
+    int second_port = 2;
+
+    FlowKey flow_key;
+    memset(&flow_key, 0, sizeof(FlowKey));
+    flow_key.pkt_type = PktType::TCP;
+
+    flow_key.port_l = first_port;
+    cache->allocate(&flow_key);
+
+    flow_key.port_l = second_port;
+    Flow* flow = cache->allocate(&flow_key);
+
+    CHECK(cache->get_count() == fcg.max_flows);
+
+    flow->block();
+
+    flow_key.port_l = first_port;
+    CHECK(cache->find(&flow_key) != nullptr);
+
+    CHECK(cache->delete_flows(1) == 1);
+
+    flow_key.port_l = second_port;
+    CHECK(cache->find(&flow_key) != nullptr);
+
+    flow_key.port_l = first_port;
+    CHECK(cache->find(&flow_key) == nullptr);
+
+    cache->purge();
+    CHECK(cache->get_flows_allocated() == 0);
+    delete cache;
+}
+
+// prefetching is only a hint; lookups must behave the same for present and
+// absent keys with either flow table
+TEST(flow_prune, prefetch_flows)
+{
+    for ( auto type : { FlowTableType::ZHASH, FlowTableType::FLAT } )
+    {
+        FlowCacheConfig fcg;
+        fcg.max_flows = 4;
+        fcg.table_type = type;
+        FlowCache *cache = new FlowCache(fcg);
+
+        FlowKey flow_key;
+        memset(&flow_key, 0, sizeof(FlowKey));
+        flow_key.pkt_type = PktType::TCP;
+
+        unsigned hashes[8];
+
+        for ( unsigned i = 0; i < 8; ++i )
+        {
+            flow_key.port_l = i;
+
+            if ( i < fcg.max_flows )
+                cache->allocate(&flow_key);
+
+            hashes[i] = cache->get_hash(&flow_key);
+        }
+
+        cache->prefetch(hashes, 8);
+
+        for ( unsigned i = 0; i < 8; ++i )
+        {
+            flow_key.port_l = i;
+            Flow* flow = cache->find(&flow_key);
+            CHECK((flow != nullptr) == (i < fcg.max_flows));
+        }
+
+        cache->purge();
+        CHECK(cache->get_flows_allocated() == 0);
+        delete cache;
+    }
+}
+
 int main(int argc, char** argv)
 {
     return CommandLineTestRunner::RunAllTests(argc, argv);
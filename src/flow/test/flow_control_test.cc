@@ -74,6 +74,8 @@ DetectionEngine::~DetectionEngine() = default;
 ExpectCache::~ExpectCache() = default;
 unsigned FlowCache::purge() { return 1; }
 Flow* FlowCache::find(const FlowKey*) { return nullptr; }
+unsigned FlowCache::get_hash(const FlowKey*) { return 0; }
+void FlowCache::prefetch(const unsigned*, unsigned) const { }
 Flow* FlowCache::allocate(const FlowKey*) { return nullptr; }
 void FlowCache::push(Flow*) { }
 bool FlowCache::prune_one(PruneReason, bool) { return true; }
@@ -97,6 +99,8 @@ ExpectCache::ExpectCache(uint32_t) { }
 bool ExpectCache::check(Packet*, Flow*) { return true; }
 bool ExpectCache::is_expected(Packet*) { return true; }
 Flow* HighAvailabilityManager::import(Packet&, FlowKey&) { return nullptr; }
+bool init_prefetch_key(const SnortConfig*, const DAQ_PktHdr_t&, const uint8_t*, uint32_t, FlowKey&)
+{ return false; }
 
 namespace memory
 {
@@ -38,6 +38,7 @@ struct Packet;
 #define OUTPUT_TYPE_FLAG__NONE  0x0
 #define OUTPUT_TYPE_FLAG__ALERT 0x1
 #define OUTPUT_TYPE_FLAG__LOG   0x2
+#define OUTPUT_TYPE_FLAG__XTRA  0x4  // logs inspector extra data
 
 //-------------------------------------------------------------------------
 // api for class
@@ -66,6 +66,17 @@ int Mpse::search_all(
     return _search(T, n, match, context, current_state);
 }
 
+int Mpse::search_stream(
+    MpseStream* ms, const unsigned char* T, int n, MpseMatch match, void* context)
+{
+    int found = _search_stream(ms, T, n, match, context);
+
+    if ( found >= 0 )
+        pmqs.matched_bytes += n;
+
+    return found;
+}
+
 void Mpse::search(MpseBatch& batch, MpseType mpse_type)
 {
     _search(batch, mpse_type);
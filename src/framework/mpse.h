@@ -36,7 +36,7 @@
 namespace snort
 {
 // this is the current version of the api
-#define SEAPI_VERSION ((BASE_API_VERSION << 16) | 0)
+#define SEAPI_VERSION ((BASE_API_VERSION << 16) | 1)
 
 struct SnortConfig;
 class Mpse;
@@ -44,6 +44,15 @@ struct MpseApi;
 struct MpseBatch;
 struct ProfileStats;
 
+// per flow scan state of a stream mode mpse; it is owned by the caller
+// and may outlive the mpse that opened it (eg across a reload)
+class SO_PUBLIC MpseStream
+{
+public:
+    virtual ~MpseStream() = default;
+    virtual size_t size_of() const = 0;
+};
+
 class SO_PUBLIC Mpse
 {
 public:
@@ -89,6 +98,17 @@ public:
 
     void search(MpseBatch&, MpseType);
 
+    // stream mode continues a search across successive buffers of a
+    // flow so that patterns spanning a buffer boundary are found.  set
+    // it before prep_patterns.  search_stream returns -1 if the stream
+    // was not opened by this mpse, otherwise the number of matches with
+    // indices relative to T as for search.
+    virtual void set_stream_mode() { }
+    virtual MpseStream* open_stream() { return nullptr; }
+    virtual bool reset_stream(MpseStream*) { return false; }
+
+    int search_stream(MpseStream*, const uint8_t* T, int n, MpseMatch, void* context);
+
     virtual MpseRespType receive_responses(MpseBatch&, MpseType)
     { return MPSE_RESP_COMPLETE_SUCCESS; }
 
@@ -112,6 +132,9 @@ protected:
 
     virtual void _search(MpseBatch&, MpseType);
 
+    virtual int _search_stream(MpseStream*, const uint8_t*, int, MpseMatch, void*)
+    { return -1; }
+
 private:
     std::string method;
     int verbose;
@@ -130,6 +153,7 @@ typedef Mpse::MpseRespType (* MpsePollFunc)(MpseBatch*&, Mpse::MpseType);
 #define MPSE_REGEX  0x02  // supports regex patterns
 #define MPSE_ASYNC  0x04  // does asynchronous (lookaside) searches
 #define MPSE_MTBLD  0x08  // support multithreaded / parallel compilation
+#define MPSE_STREAM 0x10  // supports stream mode searches
 
 struct MpseApi
 {
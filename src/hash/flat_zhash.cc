@@ -0,0 +1,562 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// flat_zhash provides the zhash contract on top of an open addressing table.
+// each slot has a control byte:
+//
+//     0x00-0x7F  in use, low 7 bits of the node hash
+//     0x80       empty
+//
+// slots are probed a group (cache line) at a time using triangular steps
+// over the groups so every group is visited.  instead of tombstones, each
+// group counts the keys that probed past it because it was full.  a lookup
+// stops at the first group with no overflow, so removing a key just empties
+// its slot and decrements the counts along its probe sequence; the table
+// never needs to be rebuilt.  counts saturate and then stay put, which only
+// makes lookups through that group probe further.  the table is sized so it
+// is at most 7/8 full with nrows keys and insertion stops there.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "flat_zhash.h"
+
+#include <cassert>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "flow/flow_key.h"
+#include "utils/util.h"
+
+#include "hash_defs.h"
+#include "hash_key_operations.h"
+
+#ifdef BENCHMARK_TEST
+#include <algorithm>
+#include <random>
+
+#include "catch/snort_catch.h"
+#include "zhash.h"
+#endif
+
+using namespace snort;
+
+static const uint32_t NIL = UINT32_MAX;
+
+static const uint8_t CTRL_EMPTY = 0x80;
+static const uint16_t MAX_OVERFLOW = UINT16_MAX;
+
+static const unsigned cache_line_size = 64;
+
+static inline uint8_t hash_tag(uint32_t hash)
+{ return hash & 0x7F; }
+
+static inline uint32_t hash_group(uint32_t hash)
+{ return hash >> 7; }
+
+static inline unsigned max_load(unsigned capacity)
+{ return capacity - capacity / 8; }
+
+//-------------------------------------------------------------------------
+// public stuff
+//-------------------------------------------------------------------------
+
+FlatZHash::FlatZHash(int rows, int key_len) : keysize(key_len)
+{
+    static_assert(sizeof(Group) == cache_line_size, "group must fill a cache line");
+
+    if ( rows < 0 )
+        rows = -rows;
+
+    hashkey_ops = new FlowHashKeyOps(rows);
+
+    // keep keys aligned for hash functions that read whole words
+    node_size = sizeof(Node) + keysize;
+    node_size = (node_size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+    head = tail = cursor = fhead = uhead = NIL;
+
+    num_groups = 1;
+    while ( max_load(num_groups * group_slots) < (unsigned)rows )
+        num_groups <<= 1;
+
+    capacity = num_groups * group_slots;
+
+    size_t size = (size_t)num_groups * sizeof(Group);
+    table_mem = (uint8_t*)snort_alloc(size + cache_line_size - 1);
+
+    uintptr_t base = ((uintptr_t)table_mem + cache_line_size - 1) & ~(uintptr_t)(cache_line_size - 1);
+    groups = (Group*)base;
+
+    memset(groups, 0, size);
+    for ( unsigned gi = 0; gi < num_groups; ++gi )
+        memset(groups[gi].ctrl, CTRL_EMPTY, sizeof(groups[gi].ctrl));
+}
+
+FlatZHash::~FlatZHash()
+{
+    for ( auto* chunk : chunks )
+        snort_free(chunk);
+
+    snort_free(table_mem);
+    delete hashkey_ops;
+}
+
+size_t FlatZHash::get_mem_used() const
+{
+    return chunks.size() * ((size_t)node_size << chunk_bits) +
+        (size_t)num_groups * sizeof(Group);
+}
+
+void* FlatZHash::push(void* p)
+{
+    uint32_t index = new_node();
+    Node* node = get_node(index);
+
+    node->data = p;
+    node->next = fhead;
+    fhead = index;
+
+    return get_key(node);
+}
+
+void* FlatZHash::pop()
+{
+    if ( fhead == NIL )
+        return nullptr;
+
+    uint32_t index = fhead;
+    Node* node = get_node(index);
+    fhead = node->next;
+
+    void* pv = node->data;
+    node->data = nullptr;
+    node->next = uhead;
+    uhead = index;
+
+    return pv;
+}
+
+void* FlatZHash::get(const void* key)
+{
+    assert(key);
+
+    uint32_t hash = hashkey_ops->do_hash((const unsigned char*)key, keysize);
+    uint32_t slot = find_slot(key, hash);
+
+    if ( slot != NIL )
+    {
+        uint32_t index = get_index(slot);
+        lru_move_to_front(index);
+        return get_node(index)->data;
+    }
+
+    if ( fhead == NIL or num_nodes >= max_load(capacity) )
+        return nullptr;
+
+    uint32_t index = fhead;
+    Node* node = get_node(index);
+    fhead = node->next;
+
+    memcpy(get_key(node), key, keysize);
+    node->hash = hash;
+    set_slot(insert_slot(hash), index, hash);
+    lru_insert(index);
+    num_nodes++;
+
+    return node->data;
+}
+
+void* FlatZHash::remove()
+{
+    assert(cursor != NIL);
+
+    uint32_t index = cursor;
+    Node* node = get_node(index);
+    void* pv = node->data;
+
+    clear_slot(node->slot);
+    lru_remove(index);
+    num_nodes--;
+
+    node->data = nullptr;
+    node->next = uhead;
+    uhead = index;
+
+    return pv;
+}
+
+void* FlatZHash::get_user_data(const void* key)
+{
+    assert(key);
+
+    uint32_t hash = hashkey_ops->do_hash((const unsigned char*)key, keysize);
+    uint32_t slot = find_slot(key, hash);
+
+    if ( slot == NIL )
+        return nullptr;
+
+    uint32_t index = get_index(slot);
+    lru_move_to_front(index);
+    return get_node(index)->data;
+}
+
+int FlatZHash::release_node(const void* key)
+{
+    assert(key);
+
+    uint32_t hash = hashkey_ops->do_hash((const unsigned char*)key, keysize);
+    uint32_t slot = find_slot(key, hash);
+
+    if ( slot == NIL )
+        return HASH_NOT_FOUND;
+
+    uint32_t index = get_index(slot);
+    Node* node = get_node(index);
+
+    clear_slot(slot);
+    lru_remove(index);
+    num_nodes--;
+
+    node->next = fhead;
+    fhead = index;
+
+    return HASH_OK;
+}
+
+uint32_t FlatZHash::get_hash(const void* key)
+{ return hashkey_ops->do_hash((const unsigned char*)key, keysize); }
+
+const FlatZHash::Group* FlatZHash::get_group(uint32_t hash) const
+{ return groups + (hash_group(hash) & (num_groups - 1)); }
+
+// only the home group is considered; keys displaced further along the
+// probe sequence just miss the lookahead
+const FlatZHash::Node* FlatZHash::first_match(uint32_t hash) const
+{
+    const Group* g = get_group(hash);
+    uint32_t match = match_byte(g, hash_tag(hash));
+
+    if ( !match )
+        return nullptr;
+
+    return get_node(g->index[__builtin_ctz(match)]);
+}
+
+void FlatZHash::prefetch_bucket(uint32_t hash) const
+{ __builtin_prefetch(get_group(hash)); }
+
+void FlatZHash::prefetch_node(uint32_t hash) const
+{
+    if ( const Node* node = first_match(hash) )
+        __builtin_prefetch(node);
+}
+
+void FlatZHash::prefetch_data(uint32_t hash) const
+{
+    const Node* node = first_match(hash);
+
+    if ( node and node->hash == hash )
+        __builtin_prefetch(node->data);
+}
+
+void* FlatZHash::lru_first()
+{
+    cursor = tail;
+    return ( cursor != NIL ) ? get_node(cursor)->data : nullptr;
+}
+
+void* FlatZHash::lru_next()
+{
+    if ( cursor != NIL )
+        cursor = get_node(cursor)->prev;
+
+    return ( cursor != NIL ) ? get_node(cursor)->data : nullptr;
+}
+
+void* FlatZHash::lru_current()
+{
+    return ( cursor != NIL ) ? get_node(cursor)->data : nullptr;
+}
+
+void FlatZHash::lru_touch()
+{
+    assert(cursor != NIL);
+    lru_move_to_front(cursor);
+}
+
+//-------------------------------------------------------------------------
+// private stuff
+//-------------------------------------------------------------------------
+
+uint32_t FlatZHash::match_byte(const Group* g, uint8_t b)
+{
+#ifdef __SSE2__
+    __m128i v = _mm_load_si128((const __m128i*)g->ctrl);
+    uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8((char)b)));
+#else
+    uint32_t mask = 0;
+    for ( unsigned i = 0; i < group_slots; ++i )
+        if ( g->ctrl[i] == b )
+            mask |= 1u << i;
+#endif
+    return mask & ((1u << group_slots) - 1);
+}
+
+// returns the slot holding key or NIL
+uint32_t FlatZHash::find_slot(const void* key, uint32_t hash) const
+{
+    const unsigned groups_mask = num_groups - 1;
+    const uint8_t tag = hash_tag(hash);
+    unsigned gi = hash_group(hash) & groups_mask;
+
+    for ( unsigned step = 1; ; ++step )
+    {
+        const Group* g = groups + gi;
+        uint32_t match = match_byte(g, tag);
+
+        while ( match )
+        {
+            unsigned i = __builtin_ctz(match);
+            Node* node = get_node(g->index[i]);
+
+            if ( node->hash == hash and
+                hashkey_ops->key_compare(get_key(node), key, keysize) )
+                return gi * group_slots + i;
+
+            match &= match - 1;
+        }
+
+        // no key went past this group
+        if ( !g->overflow )
+            return NIL;
+
+        gi = (gi + step) & groups_mask;
+    }
+}
+
+// returns the first empty slot on the probe sequence, counting the overflow
+// of each full group passed; the load limit guarantees there is one
+uint32_t FlatZHash::insert_slot(uint32_t hash)
+{
+    const unsigned groups_mask = num_groups - 1;
+    unsigned gi = hash_group(hash) & groups_mask;
+
+    for ( unsigned step = 1; ; ++step )
+    {
+        Group* g = groups + gi;
+        uint32_t avail = match_byte(g, CTRL_EMPTY);
+
+        if ( avail )
+            return gi * group_slots + __builtin_ctz(avail);
+
+        if ( g->overflow < MAX_OVERFLOW )
+            g->overflow++;
+
+        gi = (gi + step) & groups_mask;
+    }
+}
+
+void FlatZHash::set_slot(uint32_t slot, uint32_t index, uint32_t hash)
+{
+    Group* g = groups + slot / group_slots;
+    unsigned i = slot % group_slots;
+
+    g->ctrl[i] = hash_tag(hash);
+    g->index[i] = index;
+    get_node(index)->slot = slot;
+}
+
+// undo the overflow counted by insert_slot for the groups before this one
+void FlatZHash::clear_slot(uint32_t slot)
+{
+    const unsigned groups_mask = num_groups - 1;
+    const unsigned last = slot / group_slots;
+    unsigned gi = hash_group(get_node(get_index(slot))->hash) & groups_mask;
+
+    for ( unsigned step = 1; gi != last; ++step )
+    {
+        Group* g = groups + gi;
+
+        if ( g->overflow < MAX_OVERFLOW )
+            g->overflow--;
+
+        gi = (gi + step) & groups_mask;
+    }
+
+    *get_ctrl(slot) = CTRL_EMPTY;
+}
+
+uint32_t FlatZHash::new_node()
+{
+    if ( uhead != NIL )
+    {
+        uint32_t index = uhead;
+        uhead = get_node(index)->next;
+        return index;
+    }
+
+    if ( !(num_allocated & chunk_mask) )
+        chunks.emplace_back((uint8_t*)snort_calloc((size_t)node_size << chunk_bits));
+
+    return num_allocated++;
+}
+
+void FlatZHash::lru_insert(uint32_t index)
+{
+    Node* node = get_node(index);
+    node->prev = NIL;
+    node->next = head;
+
+    if ( head != NIL )
+        get_node(head)->prev = index;
+    else
+        tail = index;
+
+    head = index;
+}
+
+void FlatZHash::lru_remove(uint32_t index)
+{
+    Node* node = get_node(index);
+
+    if ( cursor == index )
+        cursor = node->prev;
+
+    if ( head == index )
+        head = node->next;
+
+    if ( node->prev != NIL )
+        get_node(node->prev)->next = node->next;
+
+    if ( node->next != NIL )
+        get_node(node->next)->prev = node->prev;
+
+    if ( tail == index )
+        tail = node->prev;
+}
+
+void FlatZHash::lru_move_to_front(uint32_t index)
+{
+    if ( cursor == index )
+        cursor = get_node(index)->prev;
+
+    if ( index != head )
+    {
+        lru_remove(index);
+        lru_insert(index);
+    }
+}
+
+//-------------------------------------------------------------------------
+// benchmarks
+//-------------------------------------------------------------------------
+
+#ifdef BENCHMARK_TEST
+
+// enough flows that neither table fits in L2
+static const unsigned bench_flows = 1 << 20;
+static const unsigned bench_lookups = 1 << 16;
+
+static void make_flow_keys(std::vector<FlowKey>& keys)
+{
+    keys.resize(bench_flows);
+
+    for ( unsigned i = 0; i < bench_flows; ++i )
+    {
+        FlowKey& key = keys[i];
+        memset(&key, 0, sizeof(key));
+        key.ip_l[2] = key.ip_h[2] = htonl(0xFFFF);
+        key.ip_l[3] = htonl(0x0A000000 | (i >> 4));
+        key.ip_h[3] = htonl(0xC0A80001);
+        key.port_l = 1024 + (i & 0xF) * 4000;
+        key.port_h = 443;
+        key.ip_protocol = 6;
+        key.pkt_type = PktType::TCP;
+        key.version = 4;
+    }
+}
+
+template<typename Table>
+static void fill_table(Table& table, std::vector<unsigned>& data, std::vector<FlowKey>& keys)
+{
+    for ( unsigned i = 0; i < bench_flows; ++i )
+        table.push(&data[i]);
+
+    for ( unsigned i = 0; i < bench_flows; ++i )
+        table.get(&keys[i]);
+}
+
+template<typename Table>
+static unsigned find_flows(Table& table, std::vector<FlowKey>& keys, std::vector<unsigned>& order)
+{
+    unsigned found = 0;
+
+    for ( auto i : order )
+        found += table.get_user_data(&keys[i]) ? 1 : 0;
+
+    return found;
+}
+
+TEST_CASE("flow table lookups", "[flat_zhash]")
+{
+    std::vector<FlowKey> keys;
+    make_flow_keys(keys);
+
+    std::vector<unsigned> order(bench_lookups);
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<unsigned> dist(0, bench_flows - 1);
+    std::generate(order.begin(), order.end(), [&]() { return dist(gen); });
+
+    std::vector<unsigned> zdata(bench_flows), fdata(bench_flows);
+
+    ZHash zh(bench_flows, sizeof(FlowKey));
+    FlatZHash fh(bench_flows, sizeof(FlowKey));
+
+    fill_table(zh, zdata, keys);
+    fill_table(fh, fdata, keys);
+
+    REQUIRE(zh.get_num_nodes() == bench_flows);
+    REQUIRE(fh.get_num_nodes() == bench_flows);
+
+    BENCHMARK("zhash random lookups")
+    {
+        return find_flows(zh, keys, order);
+    };
+
+    BENCHMARK("flat_zhash random lookups")
+    {
+        return find_flows(fh, keys, order);
+    };
+
+    // zhash also has a row pointer per flow
+    size_t zhash_mem = zh.get_mem_used() + hash_nearest_power_of_2(bench_flows) * sizeof(HashNode*);
+    size_t flat_mem = fh.get_mem_used();
+
+    WARN("bytes per flow: zhash " << zhash_mem / bench_flows <<
+        ", flat_zhash " << flat_mem / bench_flows);
+
+    CHECK(flat_mem < zhash_mem);
+}
+
+#endif
+
@@ -0,0 +1,157 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef FLAT_ZHASH_H
+#define FLAT_ZHASH_H
+
+// FlatZHash is an open addressing alternative to ZHash with the same
+// push / pop / get / remove / lru_* contract.  The table is an array of
+// cache line sized groups, each holding 12 one byte control tags and the
+// 12 matching node indices, so a probe costs one line and a node is only
+// touched when its tag matches (tags are compared with SSE2 when
+// available).  Nodes (key + user data) live in stable chunks so the key
+// pointer returned by push() never moves, and the LRU list is threaded
+// through 32 bit node indices instead of pointers.  Like ZHash, the table
+// is sized for nrows up front and never grows; get() fails if the table
+// is full.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace snort
+{
+class HashKeyOperations;
+}
+
+class FlatZHash
+{
+public:
+    FlatZHash(int nrows, int keysize);
+    ~FlatZHash();
+
+    FlatZHash(const FlatZHash&) = delete;
+    FlatZHash& operator=(const FlatZHash&) = delete;
+
+    void* push(void* p);
+    void* pop();
+
+    void* get(const void* key);
+    void* remove();
+
+    void* lru_first();
+    void* lru_next();
+    void* lru_current();
+    void lru_touch();
+
+    void* get_user_data(const void* key);
+    int release_node(const void* key);
+
+    // lookahead for a batch of keys; each stage only reads lines pulled
+    // in by the previous one so a pass over several keys overlaps misses
+    uint32_t get_hash(const void* key);
+    void prefetch_bucket(uint32_t hash) const;
+    void prefetch_node(uint32_t hash) const;
+    void prefetch_data(uint32_t hash) const;
+
+    unsigned get_num_nodes() const
+    { return num_nodes; }
+
+    // bytes charged per node, including its share of the table
+    size_t get_node_size() const
+    { return node_size + sizeof(Group) / group_slots; }
+
+    size_t get_mem_used() const;
+
+    unsigned get_capacity() const
+    { return capacity; }
+
+private:
+    static const unsigned group_slots = 12;
+
+    struct Group
+    {
+        uint8_t ctrl[group_slots];  // tags, compared 16 bytes at a time
+        uint16_t overflow;          // keys that probed past this group
+        uint16_t unused;
+        uint32_t index[group_slots];
+    };
+
+    struct Node
+    {
+        void* data;
+        uint32_t hash;
+        uint32_t slot;
+        uint32_t prev;  // lru toward mru or free list
+        uint32_t next;  // lru toward lru
+    };
+
+    Node* get_node(uint32_t index) const
+    {
+        return (Node*)(chunks[index >> chunk_bits] +
+            (size_t)(index & chunk_mask) * node_size);
+    }
+
+    uint8_t* get_key(Node* node) const
+    { return (uint8_t*)node + sizeof(Node); }
+
+    uint8_t* get_ctrl(uint32_t slot) const
+    { return groups[slot / group_slots].ctrl + slot % group_slots; }
+
+    uint32_t get_index(uint32_t slot) const
+    { return groups[slot / group_slots].index[slot % group_slots]; }
+
+    const Group* get_group(uint32_t hash) const;
+    const Node* first_match(uint32_t hash) const;
+
+    static uint32_t match_byte(const Group*, uint8_t);
+
+    uint32_t find_slot(const void* key, uint32_t hash) const;
+    uint32_t insert_slot(uint32_t hash);
+    void set_slot(uint32_t slot, uint32_t index, uint32_t hash);
+    void clear_slot(uint32_t slot);
+
+    uint32_t new_node();
+    void lru_insert(uint32_t);
+    void lru_remove(uint32_t);
+    void lru_move_to_front(uint32_t);
+
+    static const unsigned chunk_bits = 10;
+    static const unsigned chunk_mask = (1 << chunk_bits) - 1;
+
+    snort::HashKeyOperations* hashkey_ops;
+    std::vector<uint8_t*> chunks;
+    uint8_t* table_mem = nullptr;
+    Group* groups = nullptr;
+
+    unsigned keysize;
+    unsigned node_size;
+    unsigned num_groups = 0;
+    unsigned capacity = 0;
+    unsigned num_nodes = 0;
+    unsigned num_allocated = 0;
+
+    uint32_t head;      // mru
+    uint32_t tail;      // lru
+    uint32_t cursor;
+    uint32_t fhead;     // nodes holding user data, not in table
+    uint32_t uhead;     // nodes without user data
+};
+
+#endif
+
@@ -23,9 +23,18 @@
 
 // LruCacheShared -- Implements a thread-safe unordered map where the
 // least-recently-used (LRU) entries are removed once a fixed size is hit.
+//
+// The cache may be split into shards, each with its own lock, LRU list,
+// and map, to reduce contention among packet threads.  Keys are assigned to
+// shards by hash.  The size limit applies to the cache as a whole; when it
+// is exceeded, entries are pruned from the tail of each shard in turn
+// starting with the one just added to, so LRU order is approximate with
+// more than one shard.  With a single shard (the default) the cache behaves
+// exactly as a single locked LRU.
 
 #include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <list>
 #include <memory>
 #include <mutex>
@@ -61,8 +70,10 @@ public:
     LruCacheShared(const LruCacheShared& arg) = delete;
     LruCacheShared& operator=(const LruCacheShared& arg) = delete;
 
-    LruCacheShared(const size_t initial_size) :
-        max_size(initial_size), current_size(0) { }
+    // num_shards is rounded up to a power of 2
+    LruCacheShared(const size_t initial_size, unsigned num_shards = 1) :
+        max_size(initial_size), current_size(0)
+    { init_shards(num_shards); }
 
     virtual ~LruCacheShared() = default;
 
@@ -83,25 +94,30 @@ public:
     bool find_else_insert(const Key& key, std::shared_ptr<Value>& data, bool replace = false);
 
     // Return all data from the LruCache in order (most recently used to least)
+    // shard by shard
     std::vector<std::pair<Key, Data> > get_all_data();
 
     //  Get current number of elements in the LruCache.
     size_t size()
-    {
-        std::lock_guard<std::mutex> cache_lock(cache_mutex);
-        return list.size();
-    }
+    { return num_entries; }
 
     virtual size_t mem_size()
-    {
-        std::lock_guard<std::mutex> cache_lock(cache_mutex);
-        return list.size() * mem_chunk;
-    }
+    { return num_entries * mem_chunk; }
 
     size_t get_max_size()
+    { return max_size; }
+
+    unsigned get_num_shards() const
+    { return shard_mask + 1; }
+
+    // Only allowed while the cache is empty and not shared, i.e. at startup.
+    bool set_num_shards(unsigned num_shards)
     {
-        std::lock_guard<std::mutex> cache_lock(cache_mutex);
-        return max_size;
+        if ( num_entries )
+            return false;
+
+        init_shards(num_shards);
+        return true;
     }
 
     //  Modify the maximum number of entries allowed in the cache. If the size is reduced,
@@ -120,14 +136,43 @@ public:
     const PegInfo* get_pegs() const
     { return lru_cache_shared_peg_names; }
 
+    // call with the cache locked.  with one shard these are the live
+    // counts.  otherwise each shard's counts are moved into the sum so
+    // that zeroing the sum (as Module::sum_stats does) doesn't count them
+    // again on the next call.
     PegCount* get_counts()
-    { return (PegCount*)&stats; }
+    {
+        if ( !shard_mask )
+            return (PegCount*)&shards[0].stats;
+
+        const unsigned num_pegs = sizeof(stats) / sizeof(PegCount);
+        PegCount* sum = (PegCount*)&stats;
+
+        for ( unsigned s = 0; s <= shard_mask; ++s )
+        {
+            PegCount* pc = (PegCount*)&shards[s].stats;
 
+            for ( unsigned i = 0; i < num_pegs; ++i )
+            {
+                sum[i] += pc[i];
+                pc[i] = 0;
+            }
+        }
+        return sum;
+    }
+
+    // locks all shards
     void lock()
-    { cache_mutex.lock(); }
+    {
+        for ( unsigned s = 0; s <= shard_mask; ++s )
+            shards[s].mutex.lock();
+    }
 
     void unlock()
-    { cache_mutex.unlock(); }
+    {
+        for ( unsigned s = shard_mask + 1; s > 0; --s )
+            shards[s - 1].mutex.unlock();
+    }
 
 protected:
     using LruList = std::list<std::pair<Key, Data>>;
@@ -136,19 +181,51 @@ protected:
     using LruMapIter = typename LruMap::iterator;
 
     static constexpr size_t mem_chunk = sizeof(Data) + sizeof(Value);
+    static constexpr unsigned max_shards = 256;
+
+    struct Shard
+    {
+        std::mutex mutex;
+        LruList list;  //  Contains key/data pairs. Maintains LRU order with
+                       //  least recently used at the end.
+        LruMap map;    //  Maps key to list iterator for fast lookup.
+        LruCacheSharedStats stats;
+    };
 
-    size_t max_size;   // Once max_size elements are in the cache, start to
-                       // remove the least-recently-used elements.
+    std::atomic<size_t> max_size;  // Once max_size elements are in the cache, start to
+                                   // remove the least-recently-used elements.
 
     std::atomic<size_t> current_size;// Number of entries currently in the cache.
+    std::atomic<size_t> num_entries { 0 };
 
-    std::mutex cache_mutex;
-    LruList list;  //  Contains key/data pairs. Maintains LRU order with
-                   //  least recently used at the end.
-    LruMap map;    //  Maps key to list iterator for fast lookup.
+    std::unique_ptr<Shard[]> shards;
+    unsigned shard_mask;
 
+    // Aggregated by get_counts().
     struct LruCacheSharedStats stats;
 
+    unsigned get_shard_index(const Key& key) const
+    {
+        // Fibonacci hashing; take the high bits so the shard doesn't
+        // correlate with the bucket chosen by the shard map
+        uint64_t h = (uint64_t)Hash()(key) * 0x9E3779B97F4A7C15ull;
+        return (unsigned)(h >> 32) & shard_mask;
+    }
+
+    Shard& get_shard(unsigned idx)
+    { return shards[idx & shard_mask]; }
+
+    void init_shards(unsigned num_shards)
+    {
+        unsigned n = 1;
+
+        while ( n < num_shards and n < max_shards )
+            n <<= 1;
+
+        shards.reset(new Shard[n]);
+        shard_mask = n - 1;
+    }
+
     // The reason for these functions is to allow derived classes to do their
     // size book keeping differently (e.g. host_cache). This effectively
     // decouples the current_size variable from the actual size in memory,
@@ -166,20 +243,41 @@ protected:
         current_size--;
     }
 
-    // Caller must lock and unlock. Don't use this during snort reload for which
-    // we need gradual pruning and size reduction via reload resource tuner.
-    void prune(Purgatory& data)
+    // Caller must lock and unlock the shard and hold the returned data
+    // until after unlocking.  Removes the tail entry of the shard.
+    Data evict(Shard& s)
+    {
+        LruListIter list_iter = --s.list.end();
+        Data data = list_iter->second; // increase reference count
+        decrease_size(data.get());
+        s.map.erase(list_iter->first);
+        s.list.erase(list_iter);
+        --num_entries;
+        return data;
+    }
+
+    // Caller must not hold any shard lock. Don't use this during snort reload
+    // for which we need gradual pruning and size reduction via reload resource
+    // tuner.  Entries are taken from each shard in turn starting with start.
+    void prune(Purgatory& data, unsigned start = 0)
     {
-        LruListIter list_iter;
         assert(data.empty());
-        while (current_size > max_size && !list.empty())
+        unsigned empty = 0;
+
+        for ( unsigned i = start; current_size > max_size and empty <= shard_mask; ++i )
         {
-            list_iter = --list.end();
-            data.emplace_back(list_iter->second); // increase reference count
-            decrease_size(list_iter->second.get());
-            map.erase(list_iter->first);
-            list.erase(list_iter);
-            ++stats.alloc_prunes;
+            Shard& s = get_shard(i);
+            std::lock_guard<std::mutex> cache_lock(s.mutex);
+
+            if ( s.list.empty() )
+            {
+                ++empty;
+                continue;
+            }
+            empty = 0;
+            Data d = evict(s);
+            data.emplace_back(d);
+            ++s.stats.alloc_prunes;
         }
     }
 };
@@ -192,11 +290,9 @@ bool LruCacheShared<Key, Value, Hash, Eq, Purgatory>::set_max_size(size_t newsiz
 
     // Like with remove(), we need local temporary references to data being
     // deleted, to avoid race condition. This data needs to self-destruct
-    // after the cache_lock does.
+    // after the shard locks are released by prune.
     Purgatory data;
 
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
-
     //  Remove the oldest entries if we have to reduce cache size.
     max_size = newsize;
 
@@ -209,18 +305,19 @@ template<typename Key, typename Value, typename Hash, typename Eq, typename Purg
 std::shared_ptr<Value> LruCacheShared<Key, Value, Hash, Eq, Purgatory>::find(const Key& key)
 {
     LruMapIter map_iter;
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
+    Shard& s = get_shard(get_shard_index(key));
+    std::lock_guard<std::mutex> cache_lock(s.mutex);
 
-    map_iter = map.find(key);
-    if (map_iter == map.end())
+    map_iter = s.map.find(key);
+    if (map_iter == s.map.end())
     {
-        stats.find_misses++;
+        s.stats.find_misses++;
         return nullptr;
     }
 
     //  Move entry to front of LruList
-    list.splice(list.begin(), list, map_iter->second);
-    stats.find_hits++;
+    s.list.splice(s.list.begin(), s.list, map_iter->second);
+    s.stats.find_hits++;
     return map_iter->second->second;
 }
 
@@ -238,36 +335,41 @@ find_else_create(const Key& key, bool* new_data)
 
     // As with remove and operator[], we need a temporary list of references
     // to delay the destruction of the items being removed by prune().
-    // This is one instance where we cannot get by with directly locking and
-    // unlocking the cache_mutex, because the cache must be locked when we
-    // return the data pointer (below), or else, some other thread might
-    // delete it before we got a chance to return it.
+    // The returned data holds its own reference so it remains valid after
+    // the shard is unlocked for pruning.
     Purgatory tmp_data;
+    Data data;
 
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
+    unsigned idx = get_shard_index(key);
+    Shard& s = get_shard(idx);
 
-    map_iter = map.find(key);
-    if (map_iter != map.end())
     {
-        stats.find_hits++;
-        list.splice(list.begin(), list, map_iter->second); // update LRU
-        return map_iter->second->second;
-    }
+        std::lock_guard<std::mutex> cache_lock(s.mutex);
 
-    stats.find_misses++;
-    stats.adds++;
-    if ( new_data )
-        *new_data = true;
-    Data data = Data(new Value);
+        map_iter = s.map.find(key);
+        if (map_iter != s.map.end())
+        {
+            s.stats.find_hits++;
+            s.list.splice(s.list.begin(), s.list, map_iter->second); // update LRU
+            return map_iter->second->second;
+        }
+
+        s.stats.find_misses++;
+        s.stats.adds++;
+        if ( new_data )
+            *new_data = true;
+        data = Data(new Value);
 
-    //  Add key/data pair to front of list.
-    list.emplace_front(std::make_pair(key, data));
-    increase_size(data.get());
+        //  Add key/data pair to front of list.
+        s.list.emplace_front(std::make_pair(key, data));
+        increase_size(data.get());
+        ++num_entries;
 
-    //  Add list iterator for the new entry to map.
-    map[key] = list.begin();
+        //  Add list iterator for the new entry to map.
+        s.map[key] = s.list.begin();
+    }
 
-    prune(tmp_data);
+    prune(tmp_data, idx);
 
     return data;
 }
@@ -279,36 +381,45 @@ find_else_insert(const Key& key, std::shared_ptr<Value>& data, bool replace)
     LruMapIter map_iter;
 
     Purgatory tmp_data;
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
+    Data old_data;
+
+    unsigned idx = get_shard_index(key);
+    Shard& s = get_shard(idx);
 
-    map_iter = map.find(key);
-    if (map_iter != map.end())
     {
-        stats.find_hits++;
-        if (replace)
+        std::lock_guard<std::mutex> cache_lock(s.mutex);
+
+        map_iter = s.map.find(key);
+        if (map_iter != s.map.end())
         {
-            // Explicitly calling the reset so its more clear that destructor could be called for the object
-            decrease_size(map_iter->second->second.get());
-            map_iter->second->second.reset();
-            map_iter->second->second = data;
-            increase_size(map_iter->second->second.get());
-            stats.replaced++;
+            s.stats.find_hits++;
+            if (replace)
+            {
+                // Hold the old data until the shard is unlocked so its
+                // destructor can call back into the cache
+                decrease_size(map_iter->second->second.get());
+                old_data = map_iter->second->second;
+                map_iter->second->second = data;
+                increase_size(map_iter->second->second.get());
+                s.stats.replaced++;
+            }
+            s.list.splice(s.list.begin(), s.list, map_iter->second); // update LRU
+            return true;
         }
-        list.splice(list.begin(), list, map_iter->second); // update LRU
-        return true;
-    }
 
-    stats.find_misses++;
-    stats.adds++;
+        s.stats.find_misses++;
+        s.stats.adds++;
 
-    //  Add key/data pair to front of list.
-    list.emplace_front(std::make_pair(key, data));
-    increase_size(data.get());
+        //  Add key/data pair to front of list.
+        s.list.emplace_front(std::make_pair(key, data));
+        increase_size(data.get());
+        ++num_entries;
 
-    //  Add list iterator for the new entry to map.
-    map[key] = list.begin();
+        //  Add list iterator for the new entry to map.
+        s.map[key] = s.list.begin();
+    }
 
-    prune(tmp_data);
+    prune(tmp_data, idx);
 
     return false;
 }
@@ -318,11 +429,16 @@ std::vector< std::pair<Key, std::shared_ptr<Value>> >
 LruCacheShared<Key, Value, Hash, Eq, Purgatory>::get_all_data()
 {
     std::vector<std::pair<Key, Data> > vec;
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
 
-    for (auto& entry : list )
+    for ( unsigned i = 0; i <= shard_mask; ++i )
     {
-        vec.emplace_back(entry);
+        Shard& s = shards[i];
+        std::lock_guard<std::mutex> cache_lock(s.mutex);
+
+        for (auto& entry : s.list )
+        {
+            vec.emplace_back(entry);
+        }
     }
 
     return vec;
@@ -346,10 +462,11 @@ bool LruCacheShared<Key, Value, Hash, Eq, Purgatory>::remove(const Key& key)
     // data and cache_lock!
     Data data;
 
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
+    Shard& s = get_shard(get_shard_index(key));
+    std::lock_guard<std::mutex> cache_lock(s.mutex);
 
-    map_iter = map.find(key);
-    if (map_iter == map.end())
+    map_iter = s.map.find(key);
+    if (map_iter == s.map.end())
     {
         return false;   //  Key is not in LruCache.
     }
@@ -357,9 +474,10 @@ bool LruCacheShared<Key, Value, Hash, Eq, Purgatory>::remove(const Key& key)
     data = map_iter->second->second;
 
     decrease_size(data.get());
-    list.erase(map_iter->second);
-    map.erase(map_iter);
-    stats.removes++;
+    s.list.erase(map_iter->second);
+    s.map.erase(map_iter);
+    --num_entries;
+    s.stats.removes++;
 
     assert( data.use_count() > 0 );
 
@@ -375,10 +493,11 @@ bool LruCacheShared<Key, Value, Hash, Eq, Purgatory>::remove(const Key& key,
 {
     LruMapIter map_iter;
 
-    std::lock_guard<std::mutex> cache_lock(cache_mutex);
+    Shard& s = get_shard(get_shard_index(key));
+    std::lock_guard<std::mutex> cache_lock(s.mutex);
 
-    map_iter = map.find(key);
-    if (map_iter == map.end())
+    map_iter = s.map.find(key);
+    if (map_iter == s.map.end())
     {
         return false;   //  Key is not in LruCache.
     }
@@ -386,9 +505,10 @@ bool LruCacheShared<Key, Value, Hash, Eq, Purgatory>::remove(const Key& key,
     data = map_iter->second->second;
 
     decrease_size(data.get());
-    list.erase(map_iter->second);
-    map.erase(map_iter);
-    stats.removes++;
+    s.list.erase(map_iter->second);
+    s.map.erase(map_iter);
+    --num_entries;
+    s.stats.removes++;
 
     assert( data.use_count() > 0 );
 
@@ -0,0 +1,251 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// unit tests for the FlatZHash class
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string>
+
+#include "../flat_zhash.h"
+#include "../hash_defs.h"
+#include "../hash_key_operations.h"
+
+#include "flow/flow_key.h"
+#include "main/snort_config.h"
+#include "utils/util.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+using namespace snort;
+
+namespace snort
+{
+unsigned FlowHashKeyOps::do_hash(const unsigned char* k, int len)
+{
+    unsigned hash = seed;
+    while ( len )
+    {
+        hash *= scale;
+        hash += *k++;
+        len--;
+    }
+    return hash ^ hardener;
+}
+
+bool FlowHashKeyOps::key_compare(const void* k1, const void* k2, size_t len)
+{
+    if ( memcmp(k1, k2, len ) == 0 )
+        return true;
+    else
+        return false;
+}
+}
+
+// Stubs whose sole purpose is to make the test code link
+static SnortConfig my_config;
+THREAD_LOCAL SnortConfig *snort_conf = &my_config;
+
+// run_flags is used indirectly from HashFnc class by calling SnortConfig::static_hash()
+SnortConfig::SnortConfig(const SnortConfig* const)
+{ snort_conf->run_flags = 0;}
+
+SnortConfig::~SnortConfig() = default;
+
+const SnortConfig* SnortConfig::get_conf()
+{ return snort_conf; }
+
+const unsigned FLAT_ROWS = 100;
+const unsigned FLAT_KEY_SIZE = 100;
+const unsigned MAX_FLAT_NODES = 100;
+char key_buf[FLAT_KEY_SIZE];
+
+FlatZHash* fh = nullptr;
+
+static void set_key(unsigned i)
+{
+    std::string key = "foo" + std::to_string(i);
+    memset(key_buf, '\0', FLAT_KEY_SIZE);
+    memcpy(key_buf, key.c_str(), key.size());
+}
+
+TEST_GROUP(flat_zhash)
+{
+    void setup() override
+    {
+        fh = new FlatZHash(FLAT_ROWS, FLAT_KEY_SIZE);
+        CHECK(fh);
+
+        for (unsigned i = 0; i < MAX_FLAT_NODES; i++ )
+        {
+            unsigned* data = (unsigned*)snort_calloc(sizeof(unsigned));
+            fh->push(data);
+        }
+    }
+
+    void teardown() override
+    {
+        while ( fh->lru_first() )
+            snort_free(fh->remove());
+
+        while ( void* data = fh->pop() )
+            snort_free(data);
+
+        delete fh;
+    }
+};
+
+TEST(flat_zhash, lru_order_test)
+{
+    for (unsigned i = 0; i < MAX_FLAT_NODES; i++ )
+    {
+        set_key(i + 1);
+        unsigned* data = (unsigned*)fh->get(key_buf);
+        CHECK(data);
+        CHECK(*data == 0);
+        *data = i + 1;
+    }
+
+    CHECK(fh->get_num_nodes() == MAX_FLAT_NODES);
+
+    // table is full; no free nodes left for a new key
+    set_key(MAX_FLAT_NODES + 1);
+    CHECK(fh->get(key_buf) == nullptr);
+
+    unsigned nodes_walked = 0;
+    unsigned* data = (unsigned*)fh->lru_first();
+    while ( data )
+    {
+        CHECK(*data == ++nodes_walked);
+        data = (unsigned*)fh->lru_next();
+    }
+
+    CHECK(nodes_walked == MAX_FLAT_NODES);
+
+    // lookup moves the node to the mru end
+    set_key(1);
+    data = (unsigned*)fh->get_user_data(key_buf);
+    CHECK(*data == 1);
+    data = (unsigned*)fh->lru_first();
+    CHECK(*data == 2);
+
+    // touch moves the cursor node to the mru end and the cursor forward
+    fh->lru_touch();
+    data = (unsigned*)fh->lru_current();
+    CHECK(*data == 3);
+    data = (unsigned*)fh->lru_first();
+    CHECK(*data == 3);
+
+    data = (unsigned*)fh->remove();
+    CHECK(*data == 3);
+    snort_free(data);
+    data = (unsigned*)fh->lru_current();
+    CHECK(*data == 4);
+    CHECK(fh->get_num_nodes() == MAX_FLAT_NODES - 1);
+}
+
+TEST(flat_zhash, release_reuse_test)
+{
+    unsigned capacity = fh->get_capacity();
+
+    // churn far more keys than slots through a full table so freed
+    // slots must be reused
+    for (unsigned i = 0; i < 50 * MAX_FLAT_NODES; i++ )
+    {
+        if ( i >= MAX_FLAT_NODES )
+        {
+            set_key(i - MAX_FLAT_NODES);
+            CHECK(fh->release_node(key_buf) == HASH_OK);
+            CHECK(fh->release_node(key_buf) == HASH_NOT_FOUND);
+        }
+
+        set_key(i);
+        unsigned* data = (unsigned*)fh->get(key_buf);
+        CHECK(data);
+        *data = i;
+    }
+
+    CHECK(fh->get_num_nodes() == MAX_FLAT_NODES);
+
+    for (unsigned i = 49 * MAX_FLAT_NODES; i < 50 * MAX_FLAT_NODES; i++ )
+    {
+        set_key(i);
+        unsigned* data = (unsigned*)fh->get_user_data(key_buf);
+        CHECK(data);
+        CHECK(*data == i);
+    }
+
+    set_key(0);
+    CHECK(fh->get_user_data(key_buf) == nullptr);
+    CHECK(fh->get_capacity() == capacity);
+}
+
+TEST(flat_zhash, no_grow_test)
+{
+    unsigned capacity = fh->get_capacity();
+
+    // more nodes than the table was sized for
+    for (unsigned i = 0; i < 3 * MAX_FLAT_NODES; i++ )
+    {
+        unsigned* data = (unsigned*)snort_calloc(sizeof(unsigned));
+        fh->push(data);
+    }
+
+    // inserts stop at the load limit instead of growing the table
+    unsigned inserted = 0;
+
+    for (unsigned i = 0; i < 4 * MAX_FLAT_NODES; i++ )
+    {
+        set_key(i);
+        unsigned* data = (unsigned*)fh->get(key_buf);
+
+        if ( !data )
+            break;
+
+        *data = i;
+        inserted++;
+    }
+
+    CHECK(inserted >= FLAT_ROWS);
+    CHECK(inserted < 4 * MAX_FLAT_NODES);
+    CHECK(fh->get_num_nodes() == inserted);
+    CHECK(fh->get_capacity() == capacity);
+
+    for (unsigned i = 0; i < inserted; i++ )
+    {
+        set_key(i);
+        unsigned* data = (unsigned*)fh->get_user_data(key_buf);
+        CHECK(data);
+        CHECK(*data == i);
+    }
+
+    // a removed key frees its slot for the next one
+    set_key(0);
+    CHECK(fh->release_node(key_buf) == HASH_OK);
+    set_key(inserted);
+    CHECK(fh->get(key_buf));
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
@@ -0,0 +1,146 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// lru_cache_shared_mt_test.cc
+// multithreaded tests and benchmarks for sharded LruCacheShared
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef BENCHMARK_TEST
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#endif
+
+#include "catch/catch.hpp"
+
+#include "hash/lru_cache_shared.h"
+
+// entries are shared by threads so the value must synchronize itself
+struct Host
+{
+    std::atomic<uint64_t> hits { 0 };
+};
+
+using Cache = LruCacheShared<uint32_t, Host, std::hash<uint32_t>>;
+
+// the key space is larger than the cache so there is steady pruning like
+// the host cache sees with more hosts than fit in the memcap
+static const unsigned cache_size = 1 << 14;
+static const unsigned key_space = 1 << 15;
+
+// mostly lookups with an occasional remove like host tracking
+static void run_ops(Cache* cache, unsigned seed, unsigned num_ops)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<uint32_t> dist(0, key_space - 1);
+
+    for ( unsigned i = 0; i < num_ops; ++i )
+    {
+        uint32_t key = dist(gen);
+
+        if ( (i & 0x3F) == 0x3F )
+            cache->remove(key);
+        else
+            cache->find_else_create(key, nullptr)->hits++;
+    }
+}
+
+static void run_threads(Cache& cache, unsigned num_threads, unsigned total_ops)
+{
+    std::vector<std::thread> threads;
+
+    for ( unsigned t = 0; t < num_threads; ++t )
+        threads.emplace_back(run_ops, &cache, t + 1, total_ops / num_threads);
+
+    for ( auto& t : threads )
+        t.join();
+}
+
+TEST_CASE("concurrent updates", "[lru_cache_shared]")
+{
+    for ( unsigned shards : { 1, 16 } )
+    {
+        Cache cache(cache_size, shards);
+        run_threads(cache, 8, 1 << 18);
+
+        CHECK(cache.size() <= cache_size);
+        CHECK(cache.get_all_data().size() == cache.size());
+
+        PegCount* stats = cache.get_counts();
+        CHECK(stats[0] == cache.size() + stats[1] + stats[5]);  // adds
+    }
+}
+
+// like Module::sum_stats, zero the sum after reading it; only new counts
+// are summed again
+TEST_CASE("sharded counts", "[lru_cache_shared]")
+{
+    Cache cache(cache_size, 16);
+
+    for ( uint32_t key = 0; key < 64; ++key )
+        cache.find_else_create(key, nullptr);
+
+    cache.lock();
+    PegCount* stats = cache.get_counts();
+    CHECK(stats[0] == 64);  // adds
+
+    stats = cache.get_counts();
+    CHECK(stats[0] == 64);
+    stats[0] = 0;
+    cache.unlock();
+
+    cache.find_else_create(64, nullptr);
+
+    cache.lock();
+    stats = cache.get_counts();
+    CHECK(stats[0] == 1);
+    cache.unlock();
+}
+
+#ifdef BENCHMARK_TEST
+// the total work is the same for every thread count so the time for a
+// sharded cache should drop as threads are added while a single lock
+// stays flat or gets worse
+TEST_CASE("thread scaling", "[lru_cache_shared]")
+{
+    const unsigned total_ops = 1 << 20;
+
+    for ( unsigned shards : { 1, 16, 64 } )
+    {
+        Cache cache(cache_size, shards);
+        run_threads(cache, 1, total_ops);  // warm up
+
+        for ( unsigned threads : { 1, 2, 4, 8, 16 } )
+        {
+            std::string name = std::to_string(shards) + " shards, " +
+                std::to_string(threads) + " threads";
+
+            BENCHMARK(name.c_str())
+            {
+                run_threads(cache, threads, total_ops);
+            };
+        }
+    }
+}
+#endif
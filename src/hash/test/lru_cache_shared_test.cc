@@ -195,6 +195,49 @@ TEST(lru_cache_shared, stats_test)
     CHECK(!strcmp(pegs[5].name, "removes"));
 }
 
+//  Test a sharded cache.
+TEST(lru_cache_shared, shards)
+{
+    LruCacheShared<int, std::string, std::hash<int> > lru_cache(10, 3);
+    CHECK(lru_cache.get_num_shards() == 4);
+
+    for (int i = 0; i < 100; i++)
+        *lru_cache[i] = std::to_string(i);
+
+    //  The limit is global and the newest entry is never pruned.
+    CHECK(lru_cache.size() == 10);
+    CHECK(lru_cache.find(99) != nullptr);
+    CHECK(*lru_cache.find(99) == "99");
+
+    auto vec = lru_cache.get_all_data();
+    CHECK(vec.size() == 10);
+
+    for (auto& e : vec)
+        CHECK(*e.second == std::to_string(e.first));
+
+    CHECK(lru_cache.remove(99) == true);
+    CHECK(lru_cache.size() == 9);
+
+    CHECK(lru_cache.set_max_size(2) == true);
+    CHECK(lru_cache.size() == 2);
+
+    PegCount* stats = lru_cache.get_counts();
+    CHECK(stats[0] == 100);  //  adds
+    CHECK(stats[1] == 97);   //  alloc prunes
+    CHECK(stats[2] == 2);    //  find hits
+    CHECK(stats[5] == 1);    //  removes
+
+    //  Shards can only be changed while empty.
+    CHECK(lru_cache.set_num_shards(1) == false);
+
+    for (auto& e : vec)
+        lru_cache.remove(e.first);
+
+    CHECK(lru_cache.size() == 0);
+    CHECK(lru_cache.set_num_shards(1) == true);
+    CHECK(lru_cache.get_num_shards() == 1);
+}
+
 int main(int argc, char** argv)
 {
     return CommandLineTestRunner::RunAllTests(argc, argv);
@@ -412,6 +412,28 @@ HashNode* XHash::find_node_row(const void* key, int& rindex)
     return nullptr;
 }
 
+unsigned XHash::get_hash(const void* key)
+{ return hashkey_ops->do_hash((const unsigned char*)key, keysize); }
+
+void XHash::prefetch_bucket(unsigned hash) const
+{ __builtin_prefetch(table + (hash & (nrows - 1))); }
+
+// only the head of the row is considered
+void XHash::prefetch_node(unsigned hash) const
+{
+    if ( HashNode* hnode = table[hash & (nrows - 1)] )
+    {
+        __builtin_prefetch(hnode);
+        __builtin_prefetch(hnode->key);
+    }
+}
+
+void XHash::prefetch_data(unsigned hash) const
+{
+    if ( HashNode* hnode = table[hash & (nrows - 1)] )
+        __builtin_prefetch(hnode->data);
+}
+
 void XHash::save_free_node(HashNode* hnode)
 {
     if ( fhead )
@@ -67,6 +67,12 @@ public:
     void clear_hash();
     bool full() const { return !fhead; }
 
+    // lookahead for a batch of keys, see FlatZHash
+    unsigned get_hash(const void* key);
+    void prefetch_bucket(unsigned hash) const;
+    void prefetch_node(unsigned hash) const;
+    void prefetch_data(unsigned hash) const;
+
     // set max hash nodes, 0 == no limit
     void set_max_nodes(int max)
     { max_nodes = max; }
@@ -127,3 +127,7 @@ void ZHash::lru_touch()
     assert(node);
     lru_cache->touch(node);
 }
+
+size_t ZHash::get_node_size() const
+{ return sizeof(HashNode) + keysize; }
+
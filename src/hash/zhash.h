@@ -42,6 +42,8 @@ public:
     void* lru_next();
     void* lru_current();
     void lru_touch();
+
+    size_t get_node_size() const;
 };
 
 #endif
@@ -0,0 +1,298 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "hyper_db_cache.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+#include "hash/hashes.h"
+
+using namespace snort;
+
+// compiles run on the main thread and, for the mpse, the fast pattern
+// compiler threads
+static std::atomic<PegCount> s_hits { 0 };
+static std::atomic<PegCount> s_misses { 0 };
+static std::atomic<PegCount> s_errors { 0 };
+static std::atomic<PegCount> s_shares { 0 };
+static std::atomic<unsigned> s_tmp_id { 0 };
+
+// databases in use by any config, keyed like the files, so that unchanged
+// pattern groups are shared by the old and new configs during reload
+struct SharedDb
+{
+    hs_database_t* db;
+    unsigned refs;
+};
+
+static std::mutex s_share_mutex;
+static std::unordered_map<std::string, SharedDb> s_shared;
+static std::unordered_map<const hs_database_t*, std::string> s_shared_keys;
+
+static void add_key(std::string& key, const void* p, size_t n)
+{ key.append((const char*)p, n); }
+
+static void add_key(std::string& key, unsigned u)
+{ add_key(key, &u, sizeof(u)); }
+
+static std::string get_key(
+    const char* const* exprs, const unsigned* flags,
+    const unsigned* ids, unsigned count, unsigned mode)
+{
+    std::string key = hs_version();
+    add_key(key, mode);
+    add_key(key, count);
+
+    hs_platform_info_t plat = { };
+
+    if ( hs_populate_platform(&plat) == HS_SUCCESS )
+    {
+        add_key(key, plat.tune);
+        add_key(key, &plat.cpu_features, sizeof(plat.cpu_features));
+    }
+
+    for ( unsigned i = 0; i < count; ++i )
+    {
+        unsigned len = strlen(exprs[i]);
+        add_key(key, len);
+        add_key(key, exprs[i], len);
+        add_key(key, flags[i]);
+        add_key(key, ids ? ids[i] : 0);
+    }
+
+    uint8_t digest[SHA256_HASH_SIZE];
+    sha256((const uint8_t*)key.data(), key.size(), digest);
+
+    std::string hex_key;
+
+    for ( auto b : digest )
+    {
+        char hex[3];
+        snprintf(hex, sizeof(hex), "%02x", b);
+        hex_key += hex;
+    }
+    return hex_key;
+}
+
+static std::string get_path(const char* dir, const std::string& key)
+{
+    std::string path = dir;
+    path += '/';
+    path += key;
+    path += ".hsdb";
+    return path;
+}
+
+static bool load(const std::string& path, hs_database_t** db)
+{
+    std::ifstream ifs(path, std::ios::binary);
+
+    if ( !ifs )
+        return false;
+
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    std::string buf = ss.str();
+
+    if ( buf.empty() or hs_deserialize_database(buf.data(), buf.size(), db) != HS_SUCCESS )
+    {
+        // stale or damaged, overwritten by the recompile
+        ++s_errors;
+        *db = nullptr;
+        return false;
+    }
+    return true;
+}
+
+// write a private file and rename it into place so concurrent loaders
+// and writers never see a partial database
+static void store(const std::string& path, const hs_database_t* db)
+{
+    char* bytes = nullptr;
+    size_t len = 0;
+
+    if ( hs_serialize_database(db, &bytes, &len) != HS_SUCCESS )
+    {
+        ++s_errors;
+        return;
+    }
+
+    std::string tmp = path + "." + std::to_string(getpid()) + "." + std::to_string(++s_tmp_id);
+    bool ok;
+    {
+        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+        ok = ofs.write(bytes, len).good();
+    }
+    free(bytes);
+
+    if ( !ok or rename(tmp.c_str(), path.c_str()) )
+    {
+        unlink(tmp.c_str());
+        ++s_errors;
+    }
+}
+
+static hs_error_t compile_key(
+    const char* dir, const std::string& key, const char* const* exprs, const unsigned* flags,
+    const unsigned* ids, unsigned count, unsigned mode,
+    hs_database_t** db, hs_compile_error_t** error)
+{
+    if ( !dir or !*dir )
+        return hs_compile_multi(exprs, flags, ids, count, mode, nullptr, db, error);
+
+    std::string path = get_path(dir, key);
+
+    if ( load(path, db) )
+    {
+        ++s_hits;
+        return HS_SUCCESS;
+    }
+
+    ++s_misses;
+    hs_error_t err = hs_compile_multi(exprs, flags, ids, count, mode, nullptr, db, error);
+
+    if ( err == HS_SUCCESS and *db )
+        store(path, *db);
+
+    return err;
+}
+
+hs_error_t HyperDbCache::compile_multi(
+    const char* dir, const char* const* exprs, const unsigned* flags,
+    const unsigned* ids, unsigned count, unsigned mode,
+    hs_database_t** db, hs_compile_error_t** error)
+{
+    if ( !dir or !*dir )
+        return hs_compile_multi(exprs, flags, ids, count, mode, nullptr, db, error);
+
+    std::string key = get_key(exprs, flags, ids, count, mode);
+    return compile_key(dir, key, exprs, flags, ids, count, mode, db, error);
+}
+
+hs_error_t HyperDbCache::acquire_multi(
+    const char* dir, const char* const* exprs, const unsigned* flags,
+    const unsigned* ids, unsigned count, unsigned mode,
+    hs_database_t** db, hs_compile_error_t** error)
+{
+    std::string key = get_key(exprs, flags, ids, count, mode);
+    {
+        std::lock_guard<std::mutex> lock(s_share_mutex);
+        auto it = s_shared.find(key);
+
+        if ( it != s_shared.end() )
+        {
+            ++it->second.refs;
+            *db = it->second.db;
+            ++s_shares;
+            return HS_SUCCESS;
+        }
+    }
+
+    // compile without the lock; if another thread built the same database
+    // meanwhile, use that one instead
+    hs_error_t err = compile_key(dir, key, exprs, flags, ids, count, mode, db, error);
+
+    if ( err != HS_SUCCESS or !*db )
+        return err;
+
+    std::lock_guard<std::mutex> lock(s_share_mutex);
+    auto it = s_shared.find(key);
+
+    if ( it != s_shared.end() )
+    {
+        hs_free_database(*db);
+        ++it->second.refs;
+        *db = it->second.db;
+        ++s_shares;
+        return HS_SUCCESS;
+    }
+
+    s_shared[key] = { *db, 1 };
+    s_shared_keys[*db] = key;
+    return HS_SUCCESS;
+}
+
+void HyperDbCache::release(hs_database_t* db)
+{
+    if ( !db )
+        return;
+
+    std::lock_guard<std::mutex> lock(s_share_mutex);
+    auto kit = s_shared_keys.find(db);
+
+    if ( kit != s_shared_keys.end() )
+    {
+        auto it = s_shared.find(kit->second);
+        assert(it != s_shared.end());
+
+        if ( --it->second.refs )
+            return;
+
+        s_shared.erase(it);
+        s_shared_keys.erase(kit);
+    }
+    hs_free_database(db);
+}
+
+hs_error_t HyperDbCache::compile(
+    const char* dir, const char* expr, unsigned flags, unsigned mode,
+    hs_database_t** db, hs_compile_error_t** error)
+{
+    if ( !dir or !*dir )
+        return hs_compile(expr, flags, mode, nullptr, db, error);
+
+    // hs_compile is hs_compile_multi of one expression with id 0
+    const unsigned id = 0;
+    return compile_multi(dir, &expr, &flags, &id, 1, mode, db, error);
+}
+
+PegCount HyperDbCache::get_hits()
+{ return s_hits; }
+
+PegCount HyperDbCache::get_misses()
+{ return s_misses; }
+
+PegCount HyperDbCache::get_errors()
+{ return s_errors; }
+
+PegCount HyperDbCache::get_shares()
+{ return s_shares; }
+
+void HyperDbCache::reset_stats()
+{
+    s_hits = 0;
+    s_misses = 0;
+    s_errors = 0;
+    s_shares = 0;
+}
+
@@ -0,0 +1,69 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef HYPER_DB_CACHE_H
+#define HYPER_DB_CACHE_H
+
+// on disk cache of compiled hyperscan databases.  compile() and
+// compile_multi() take the same arguments as hs_compile() and
+// hs_compile_multi() plus a cache directory.  the database is stored
+// serialized under a file named by the sha256 of the expressions, flags,
+// ids, mode, hyperscan version, and host platform so an unchanged pattern
+// set is loaded instead of compiled on the next start or reload.  a null
+// or empty directory just compiles.  cache read and write failures are
+// counted and fall back to compiling; they are never fatal.
+//
+// acquire_multi() is compile_multi() for databases that are only read after
+// they are built.  identical databases are shared in memory, with or without
+// a directory, and must be returned with release() instead of freed.
+
+#include <hs_compile.h>
+
+#include "framework/counts.h"
+#include "main/snort_types.h"
+
+namespace snort
+{
+class SO_PUBLIC HyperDbCache
+{
+public:
+    static hs_error_t compile(
+        const char* dir, const char* expr, unsigned flags, unsigned mode,
+        hs_database_t**, hs_compile_error_t**);
+
+    static hs_error_t compile_multi(
+        const char* dir, const char* const* exprs, const unsigned* flags,
+        const unsigned* ids, unsigned count, unsigned mode,
+        hs_database_t**, hs_compile_error_t**);
+
+    static hs_error_t acquire_multi(
+        const char* dir, const char* const* exprs, const unsigned* flags,
+        const unsigned* ids, unsigned count, unsigned mode,
+        hs_database_t**, hs_compile_error_t**);
+
+    static void release(hs_database_t*);
+
+    static PegCount get_hits();
+    static PegCount get_misses();
+    static PegCount get_errors();
+    static PegCount get_shares();
+    static void reset_stats();
+};
+}
+#endif
+
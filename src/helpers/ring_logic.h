@@ -21,6 +21,9 @@
 #define RING_LOGIC_H
 
 // Logic for simple ring implementation
+// safe for one reader thread and one writer thread
+
+#include <atomic>
 
 class RingLogic
 {
@@ -45,8 +48,8 @@ private:
 
 private:
     int sz;
-    volatile int rx;
-    volatile int wx;
+    std::atomic<int> rx;
+    std::atomic<int> wx;
 };
 
 inline RingLogic::RingLogic(int size)
@@ -58,37 +61,37 @@ inline RingLogic::RingLogic(int size)
 
 inline int RingLogic::read()
 {
-    int nx = next(rx);
-    return ( nx == wx ) ? -1 : nx;
+    int nx = next(rx.load(std::memory_order_relaxed));
+    return ( nx == wx.load(std::memory_order_acquire) ) ? -1 : nx;
 }
 
 inline int RingLogic::write()
 {
-    int nx = next(wx);
-    return ( nx == rx ) ? -1 : wx;
+    int ix = wx.load(std::memory_order_relaxed);
+    return ( next(ix) == rx.load(std::memory_order_acquire) ) ? -1 : ix;
 }
 
 inline bool RingLogic::push()
 {
-    int nx = next(wx);
-    if ( nx == rx )
+    int nx = next(wx.load(std::memory_order_relaxed));
+    if ( nx == rx.load(std::memory_order_acquire) )
         return false;
-    wx = nx;
+    wx.store(nx, std::memory_order_release);
     return true;
 }
 
 inline bool RingLogic::pop()
 {
-    int nx = next(rx);
-    if ( nx == wx )
+    int nx = next(rx.load(std::memory_order_relaxed));
+    if ( nx == wx.load(std::memory_order_acquire) )
         return false;
-    rx = nx;
+    rx.store(nx, std::memory_order_release);
     return true;
 }
 
 inline int RingLogic::count()
 {
-    int c = wx - rx - 1;
+    int c = wx.load(std::memory_order_acquire) - rx.load(std::memory_order_acquire) - 1;
     if ( c < 0 )
         c += sz;
     return c;
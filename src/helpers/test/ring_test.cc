@@ -0,0 +1,124 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// ring_test.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <thread>
+
+#include "catch/catch.hpp"
+
+#include "../ring.h"
+
+TEST_CASE("ring capacity", "[ring]")
+{
+    // a ring of n slots holds n - 2 items
+    Ring<int> ring(5);
+
+    CHECK(ring.empty());
+    CHECK(ring.get(-1) == -1);
+
+    for ( int i = 0; i < 3; ++i )
+        CHECK(ring.put(i));
+
+    CHECK(!ring.put(3));
+    CHECK(ring.count() == 3);
+
+    // wrap around several times
+    for ( int i = 3; i < 20; ++i )
+    {
+        CHECK(ring.get(-1) == i - 3);
+        CHECK(ring.put(i));
+        CHECK(ring.count() == 3);
+    }
+
+    for ( int i = 17; i < 20; ++i )
+        CHECK(ring.get(-1) == i);
+
+    CHECK(ring.empty());
+    CHECK(!ring.pop());
+}
+
+TEST_CASE("ring read and write in place", "[ring]")
+{
+    Ring<int> ring(4);
+
+    int* w = ring.write();
+    REQUIRE(w);
+    *w = 7;
+
+    // not visible until pushed
+    CHECK(!ring.read());
+    CHECK(ring.push());
+
+    int* r = ring.read();
+    REQUIRE(r);
+    CHECK(*r == 7);
+    CHECK(ring.pop());
+    CHECK(!ring.read());
+}
+
+// the reader must see every item in order with the data written before
+// the push
+TEST_CASE("ring one reader one writer", "[ring]")
+{
+    struct Item
+    {
+        unsigned seq;
+        unsigned check;
+    };
+
+    const unsigned num_items = 1000000;
+    Ring<Item> ring(64);
+    unsigned errors = 0;
+
+    std::thread reader([&]()
+    {
+        unsigned expected = 0;
+
+        while ( expected < num_items )
+        {
+            Item* it = ring.read();
+
+            if ( !it )
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            if ( it->seq != expected or it->check != ~expected )
+                errors++;
+
+            ring.pop();
+            expected++;
+        }
+    });
+
+    for ( unsigned i = 0; i < num_items; )
+    {
+        if ( ring.put({ i, ~i }) )
+            ++i;
+        else
+            std::this_thread::yield();
+    }
+
+    reader.join();
+    CHECK(errors == 0);
+    CHECK(ring.empty());
+}
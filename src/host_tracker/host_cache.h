@@ -65,22 +65,19 @@ class LruCacheSharedMemcap : public LruCacheShared<Key, Value, Hash, Eq, Purgato
 {
 public:
     using LruBase = LruCacheShared<Key, Value, Hash, Eq, Purgatory>;
-    using LruBase::cache_mutex;
     using LruBase::current_size;
-    using LruBase::list;
-    using LruBase::map;
     using LruBase::max_size;
     using LruBase::mem_chunk;
-    using LruBase::stats;
     using Data = typename LruBase::Data;
-    using LruListIter = typename LruBase::LruListIter;
+    using Shard = typename LruBase::Shard;
     using ValueType = typename LruBase::ValueType;
 
     LruCacheSharedMemcap() = delete;
     LruCacheSharedMemcap(const LruCacheSharedMemcap& arg) = delete;
     LruCacheSharedMemcap& operator=(const LruCacheSharedMemcap& arg) = delete;
 
-    LruCacheSharedMemcap(const size_t sz) : LruCacheShared<Key, Value, Hash, Eq, Purgatory>(sz),
+    LruCacheSharedMemcap(const size_t sz, unsigned num_shards = 1) :
+        LruCacheShared<Key, Value, Hash, Eq, Purgatory>(sz, num_shards),
         valid_id(invalid_id+1) {}
 
     size_t mem_size() override
@@ -92,10 +89,8 @@ public:
     {
         if ( snort::SnortConfig::log_verbose() )
         {
-            std::lock_guard<std::mutex> cache_lock(cache_mutex);
-
             snort::LogLabel("host_cache");
-            snort::LogMessage("    memcap: %zu bytes\n", max_size);
+            snort::LogMessage("    memcap: %zu bytes\n", max_size.load());
         }
 
     }
@@ -107,13 +102,13 @@ public:
         if ( current_size > new_size )
             return true;
 
-        std::lock_guard<std::mutex> cache_lock(cache_mutex);
         max_size = new_size;
         return false;
     }
 
     // Prune a few entries at each call and set the max_size to the current watermark.
-    // Return true when the desired memcap is reached.
+    // Return true when the desired memcap is reached.  Entries are taken from each
+    // shard in turn.
     bool reload_prune(size_t new_size, unsigned max_prune)
     {
         std::unique_lock<std::mutex> reload_lock(reload_mutex, std::try_to_lock);
@@ -128,26 +123,29 @@ public:
             // Get a local temporary reference of data being deleted (as if a trash can).
             // To avoid race condition, data needs to self-destruct after the cache_lock does.
             Data data;
-            std::lock_guard<std::mutex> cache_lock(cache_mutex);
 
-            if ( !list.empty() )
+            // take the tail of the next shard that isn't empty
+            for ( unsigned i = 0; i < LruBase::get_num_shards(); ++i )
             {
+                Shard& s = LruBase::get_shard(prune_shard++);
+                std::lock_guard<std::mutex> cache_lock(s.mutex);
+
+                if ( s.list.empty() )
+                    continue;
+
                 // A data race when reload changes max_size while other threads read this may
                 // delay pruning by one round. Yet, we are avoiding mutex for better performance.
-                max_size = current_size;
+                max_size = current_size.load();
                 if ( max_size > new_size )
                 {
-                    LruListIter list_iter = --list.end();
-                    data = list_iter->second; // increase reference count
-                    decrease_size();
+                    data = LruBase::evict(s);
                     max_size -= mem_chunk; // in sync with current_size
-                    map.erase(list_iter->first);
-                    list.erase(list_iter);
-                    ++stats.reload_prunes;
+                    ++s.stats.reload_prunes;
                 }
+                break;
             }
 
-            if ( max_size <= new_size or list.empty() )
+            if ( max_size <= new_size or !LruBase::size() )
             {
                 max_size = new_size;
                 return true;
@@ -203,10 +201,9 @@ private:
         {
             // Same idea as in LruCacheShared::remove(), use shared pointers
             // to hold the pruned data until after the cache is unlocked.
-            // Do not change the order of data and cache_lock, as the data must
-            // self destruct after cache_lock.
+            // prune() locks each shard as needed and the data must self
+            // destruct after that.
             Purgatory data;
-            std::lock_guard<std::mutex> cache_lock(cache_mutex);
             LruBase::prune(data);
         }
     }
@@ -225,6 +222,7 @@ private:
     }
 
     std::atomic<size_t> valid_id;
+    unsigned prune_shard = 0;  // only changed with reload_mutex held
 
     std::mutex reload_mutex;
     friend class TEST_host_cache_module_misc_Test; // for unit test
@@ -264,7 +262,8 @@ typedef LruCacheSharedMemcap<snort::SfIp, snort::HostTracker, HashIp, IpEqualTo,
 class HostCacheIp : public HostCacheIpSpec
 {
 public:
-    HostCacheIp(const size_t initial_size) : HostCacheIpSpec(initial_size) { }
+    HostCacheIp(const size_t initial_size, unsigned num_shards = 1) :
+        HostCacheIpSpec(initial_size, num_shards) { }
 
     bool remove(const KeyType& key)
     {
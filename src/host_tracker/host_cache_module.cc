@@ -30,12 +30,19 @@
 
 #include "log/messages.h"
 #include "main.h"
+#include "main/thread.h"
 #include "managers/module_manager.h"
 #include "utils/util.h"
 
 using namespace snort;
 using namespace std;
 
+// shards can only be set at startup
+static unsigned startup_shards = 0;
+
+// get_counts() is called under the cache lock while summing
+static THREAD_LOCAL bool summing_stats = false;
+
 //-------------------------------------------------------------------------
 // commands
 //-------------------------------------------------------------------------
@@ -349,6 +356,10 @@ static const Parameter host_cache_params[] =
     { "memcap", Parameter::PT_INT, "512:maxSZ", "8388608",
       "maximum host cache size in bytes" },
 
+    { "shards", Parameter::PT_INT, "1:256", "1",
+      "number of independently locked partitions; more reduce contention among packet "
+      "threads but make LRU order approximate (rounded up to a power of 2, requires restart)" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -362,6 +373,8 @@ bool HostCacheModule::set(const char*, Value& v, SnortConfig*)
     }
     else if ( v.is("memcap") )
         memcap = v.get_size();
+    else if ( v.is("shards") )
+        shards = v.get_uint16();
     else
         return false;
 
@@ -378,6 +391,17 @@ bool HostCacheModule::end(const char* fqn, int, SnortConfig* sc)
             host_cache.set_max_size(memcap);
     }
 
+    if ( shards and !strcmp(fqn, HOST_CACHE_NAME) )
+    {
+        if ( !Snort::is_reloading() )
+        {
+            host_cache.set_num_shards(shards);
+            startup_shards = shards;
+        }
+        else if ( shards != startup_shards )
+            ReloadError("Changing host_cache.shards requires a restart.\n");
+    }
+
     return true;
 }
 
@@ -480,11 +504,22 @@ const PegInfo* HostCacheModule::get_pegs() const
 { return host_cache.get_pegs(); }
 
 PegCount* HostCacheModule::get_counts() const
-{ return (PegCount*)host_cache.get_counts(); }
+{
+    // sum_stats already holds the cache lock
+    if ( summing_stats )
+        return (PegCount*)host_cache.get_counts();
+
+    host_cache.lock();
+    PegCount* pc = (PegCount*)host_cache.get_counts();
+    host_cache.unlock();
+    return pc;
+}
 
 void HostCacheModule::sum_stats(bool accumulate_now_stats)
 {
     host_cache.lock();
+    summing_stats = true;
     Module::sum_stats(accumulate_now_stats);
+    summing_stats = false;
     host_cache.unlock();
 }
@@ -72,6 +72,7 @@ public:
 private:
     const char* dump_file = nullptr;
     size_t memcap = 0;
+    unsigned shards = 0;
 };
 
 #endif
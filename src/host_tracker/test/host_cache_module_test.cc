@@ -68,6 +68,7 @@ void LogMessage(const char* format,...)
     va_end(args);
     logged_message[LOG_MAX] = '\0';
 }
+void ReloadError(const char*, ...) { }
 time_t packet_time() { return 0; }
 bool Snort::is_reloading() { return false; }
 void SnortConfig::register_reload_resource_tuner(ReloadResourceTuner* rrt) { delete rrt; }
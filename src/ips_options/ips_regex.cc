@@ -34,6 +34,7 @@
 #include "framework/ips_option.h"
 #include "framework/module.h"
 #include "hash/hash_key_operations.h"
+#include "helpers/hyper_db_cache.h"
 #include "helpers/hyper_scratch_allocator.h"
 #include "log/messages.h"
 #include "main/snort_config.h"
@@ -378,7 +379,7 @@ bool RegexModule::set(const char*, Value& v, SnortConfig*)
     return true;
 }
 
-bool RegexModule::end(const char*, int, SnortConfig*)
+bool RegexModule::end(const char*, int, SnortConfig* sc)
 {
     if ( hs_valid_platform() != HS_SUCCESS )
     {
@@ -391,8 +392,8 @@ bool RegexModule::end(const char*, int, SnortConfig*)
 
     hs_compile_error_t* err = nullptr;
 
-    if ( hs_compile(config.re.c_str(), config.pmd.mpse_flags, HS_MODE_BLOCK,
-        nullptr, &config.db, &err) or !config.db )
+    if ( HyperDbCache::compile(sc->hyperscan_cache.c_str(), config.re.c_str(),
+        config.pmd.mpse_flags, HS_MODE_BLOCK, &config.db, &err) or !config.db )
     {
         // gracefully fall back to pcre upon upgrade failure
         if ( !config.pcre_upgrade )
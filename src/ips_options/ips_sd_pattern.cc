@@ -33,6 +33,7 @@
 #include "framework/ips_option.h"
 #include "framework/module.h"
 #include "hash/hash_key_operations.h"
+#include "helpers/hyper_db_cache.h"
 #include "helpers/hyper_scratch_allocator.h"
 #include "log/messages.h"
 #include "log/obfuscator.h"
@@ -369,7 +370,7 @@ bool SdPatternModule::set(const char*, Value& v, SnortConfig*)
     return true;
 }
 
-bool SdPatternModule::end(const char*, int, SnortConfig*)
+bool SdPatternModule::end(const char*, int, SnortConfig* sc)
 {
     if ( hs_valid_platform() != HS_SUCCESS )
     {
@@ -379,8 +380,8 @@ bool SdPatternModule::end(const char*, int, SnortConfig*)
 
     hs_compile_error_t* err = nullptr;
 
-    if ( hs_compile(config.pii.c_str(), HS_FLAG_DOTALL|HS_FLAG_SOM_LEFTMOST, HS_MODE_BLOCK,
-        nullptr, &config.db, &err)
+    if ( HyperDbCache::compile(sc->hyperscan_cache.c_str(), config.pii.c_str(),
+        HS_FLAG_DOTALL|HS_FLAG_SOM_LEFTMOST, HS_MODE_BLOCK, &config.db, &err)
         or !config.db )
     {
         ParseError("can't compile regex '%s'", config.pii.c_str());
@@ -138,7 +138,7 @@ static IpsOption* get_option(Module* mod, const char* pat)
     vs.set(get_param(mod, "~re"));
 
     mod->set(ips_regex->name, vs, nullptr);
-    mod->end(ips_regex->name, 0, nullptr);
+    mod->end(ips_regex->name, 0, snort_conf);
 
     OptTreeNode otn;
     otn.sticky_buf = 0;
@@ -199,7 +199,7 @@ TEST_GROUP(ips_regex_module)
     }
     void teardown() override
     {
-        CHECK(mod->end(ips_regex->name, 0, nullptr) == end);
+        CHECK(mod->end(ips_regex->name, 0, snort_conf) == end);
         LONGS_EQUAL(expect, s_parse_errors);
         ips_regex->mod_dtor(mod);
     }
@@ -23,6 +23,7 @@
 
 #include "messages.h"
 
+#include <atomic>
 #include <cassert>
 #include <cstdarg>
 #include <string.h>
@@ -37,8 +38,9 @@ using namespace snort;
 
 static int already_fatal = 0;
 
-static unsigned parse_errors = 0;
-static unsigned parse_warnings = 0;
+// rule groups and search engines may be built in parallel
+static std::atomic<unsigned> parse_errors(0);
+static std::atomic<unsigned> parse_warnings(0);
 static unsigned reload_errors = 0;
 
 static std::string reload_errors_description;
@@ -51,16 +53,12 @@ void reset_parse_errors()
 
 unsigned get_parse_errors()
 {
-    unsigned tmp = parse_errors;
-    parse_errors = 0;
-    return tmp;
+    return parse_errors.exchange(0);
 }
 
 unsigned get_parse_warnings()
 {
-    unsigned tmp = parse_warnings;
-    parse_warnings = 0;
-    return tmp;
+    return parse_warnings.exchange(0);
 }
 
 void reset_reload_errors()
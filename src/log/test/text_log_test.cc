@@ -0,0 +1,262 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// text_log_test.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "../log.h"
+#include "../text_log.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+using namespace snort;
+
+namespace snort
+{
+char* snort_strdup(const char* s)
+{
+    char* d = new char[strlen(s) + 1];
+    strcpy(d, s);
+    return d;
+}
+}
+
+// unbuffered so writes can be seen before the log is closed
+FILE* OpenAlertFile(const char* name)
+{
+    FILE* f = fopen(name, "a");
+
+    if ( f )
+        setvbuf(f, nullptr, _IONBF, 0);
+
+    return f;
+}
+
+int RollAlertFile(const char*)
+{ return 0; }
+
+static const char* log_name = "text_log_test.txt";
+
+static std::string read_log()
+{
+    std::string s;
+    FILE* f = fopen(log_name, "r");
+
+    if ( f )
+    {
+        char buf[1024];
+        size_t n;
+
+        while ( (n = fread(buf, 1, sizeof(buf), f)) > 0 )
+            s.append(buf, n);
+
+        fclose(f);
+    }
+    return s;
+}
+
+// each record is one line of len bytes
+static void write_records(TextLog* txt, unsigned num, unsigned len)
+{
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        TextLog_Print(txt, "%06u ", i);
+
+        for ( unsigned j = 7; j < len - 1; ++j )
+            TextLog_Putc(txt, 'a' + (j % 26));
+
+        TextLog_NewLine(txt);
+        TextLog_Flush(txt);
+    }
+}
+
+static unsigned check_records(const std::string& s, unsigned len)
+{
+    unsigned num = 0;
+    size_t pos = 0;
+
+    while ( pos < s.size() )
+    {
+        size_t end = s.find('\n', pos);
+        CHECK(end != std::string::npos);
+        CHECK_EQUAL(len - 1, end - pos);
+
+        for ( unsigned j = 7; j < len - 1; ++j )
+            CHECK_EQUAL('a' + (j % 26), s[pos + j]);
+
+        pos = end + 1;
+        ++num;
+    }
+    return num;
+}
+
+TEST_GROUP(text_log)
+{
+    void setup() override
+    {
+        unlink(log_name);
+        memset(&text_log_counts, 0, sizeof(text_log_counts));
+    }
+
+    void teardown() override
+    {
+        unlink(log_name);
+    }
+};
+
+TEST(text_log, direct)
+{
+    TextLog* txt = TextLog_Init(log_name, 0, 0);
+    write_records(txt, 100, 80);
+    TextLog_Term(txt);
+
+    CHECK_EQUAL(100, check_records(read_log(), 80));
+    CHECK_EQUAL(0, text_log_counts.queued_buffers);
+}
+
+TEST(text_log, queued)
+{
+    TextLog* txt = TextLog_Init(log_name, 0, 0, 1024);
+    write_records(txt, 100, 80);
+    TextLog_Term(txt);
+
+    CHECK_EQUAL(100, check_records(read_log(), 80));
+    CHECK_EQUAL(100, text_log_counts.queued_buffers);
+    CHECK_EQUAL(0, text_log_counts.dropped_buffers);
+}
+
+TEST(text_log, queued_in_order)
+{
+    TextLog* txt = TextLog_Init(log_name, 0, 0, 1024);
+    write_records(txt, 500, 40);
+    TextLog_Term(txt);
+
+    std::string s = read_log();
+    CHECK_EQUAL(500, check_records(s, 40));
+
+    for ( unsigned i = 0; i < 500; ++i )
+        CHECK_EQUAL(i, (unsigned)std::stoul(s.substr(i * 40, 6)));
+}
+
+TEST(text_log, drops_whole_records)
+{
+    TextLog* txt = TextLog_Init(log_name, 0, 0, 1);
+    write_records(txt, 2000, 3000);
+    TextLog_Term(txt);
+
+    unsigned num = check_records(read_log(), 3000);
+    CHECK_EQUAL(text_log_counts.queued_buffers, num);
+    CHECK_EQUAL(2000, text_log_counts.queued_buffers + text_log_counts.dropped_buffers);
+}
+
+TEST(text_log, drops_rest_of_record)
+{
+    TextLog* txt = TextLog_Init(log_name, 0, 0, 1);
+
+    // fill the queue with no chance for the writer to drain it
+    TextLog_Puts(txt, "first\n");
+    TextLog_Flush(txt);
+
+    while ( !text_log_counts.dropped_buffers )
+    {
+        TextLog_Puts(txt, "dropped\n");
+        TextLog_Flush(txt);
+    }
+
+    std::string part(5000, 'x');
+    TextLog_Puts(txt, part.c_str());
+    TextLog_NewLine(txt);
+    TextLog_Flush(txt);
+    TextLog_Term(txt);
+
+    // the end of the long record is never written without its start
+    std::string s = read_log();
+    CHECK(s.compare(0, 6, "first\n") == 0);
+
+    size_t pos = s.find('x');
+    CHECK(pos == std::string::npos or s.compare(pos, 4095, part, 0, 4095) == 0);
+}
+
+TEST(text_log, two_logs)
+{
+    const char* other = "text_log_test_2.txt";
+    unlink(other);
+
+    TextLog* a = TextLog_Init(log_name, 0, 0, 16);
+    TextLog* b = TextLog_Init(other, 0, 0, 16);
+
+    TextLog_Puts(a, "a\n");
+    TextLog_Puts(b, "b\n");
+    TextLog_Flush(a);
+    TextLog_Flush(b);
+
+    TextLog_Term(a);
+    STRCMP_EQUAL("a\n", read_log().c_str());
+
+    // writer is restarted for new logs
+    TextLog* c = TextLog_Init(log_name, 0, 0, 16);
+    TextLog_Puts(c, "c\n");
+    TextLog_Term(c);
+    TextLog_Term(b);
+
+    STRCMP_EQUAL("a\nc\n", read_log().c_str());
+    unlink(other);
+}
+
+TEST(text_log, written_before_term)
+{
+    TextLog* txt = TextLog_Init(log_name, 0, 0, 16);
+    std::string expected;
+
+    // let the writer go idle before each buffer so it must be woken
+    for ( unsigned i = 0; i < 20; ++i )
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+        std::string line = std::to_string(i) + "\n";
+        TextLog_Puts(txt, line.c_str());
+        TextLog_Flush(txt);
+        expected += line;
+
+        auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+        while ( read_log() != expected and std::chrono::steady_clock::now() < until )
+            std::this_thread::yield();
+
+        STRCMP_EQUAL(expected.c_str(), read_log().c_str());
+    }
+    TextLog_Term(txt);
+    STRCMP_EQUAL(expected.c_str(), read_log().c_str());
+}
+
+int main(int argc, char* argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
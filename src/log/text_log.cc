@@ -34,8 +34,16 @@
 #include <sys/stat.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
 #include <cstdarg>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
 
+#include "helpers/ring.h"
 #include "utils/util.h"
 
 #include "log.h"
@@ -46,6 +54,25 @@ using namespace snort;
 #define MIN_BUF  (4* K_BYTES)
 #define STDLOG_FILENO 3
 
+/* a full buffer waiting for the writer thread */
+struct LogBlock
+{
+    char* data;
+    unsigned int len;
+};
+
+/* the packet thread writes full and reads free; the writer thread
+   does the opposite so both rings are single producer and consumer */
+struct LogQueue
+{
+    LogQueue(unsigned n) : full(n + 3), free(n + 3) { }
+
+    Ring<LogBlock> full;
+    Ring<char*> free;
+    bool closing = false;
+    bool closed = false;
+};
+
 struct TextLog
 {
 /* private:
@@ -56,12 +83,18 @@ struct TextLog
     size_t maxFile;
     time_t last;
 
+/* queue attributes: */
+    LogQueue* queue;
+    bool dropping;
+
 /* buffer attributes: */
     unsigned int pos;
     unsigned int maxBuf;
-    char buf[1];
+    char* buf;
 };
 
+THREAD_LOCAL TextLogCounts snort::text_log_counts;
+
 /*-------------------------------------------------------------------
  * TextLog_Open/Close: open/close associated log file
  *-------------------------------------------------------------------
@@ -97,6 +130,277 @@ static size_t TextLog_Size(FILE* file)
     return err ? 0 : sbuf.st_size;
 }
 
+/*-------------------------------------------------------------------
+ * TextLog_Roll: start writing to new file
+ * but don't roll over stdout or any sooner
+ * than resolution of filename discriminator
+ *-------------------------------------------------------------------
+ */
+static void TextLog_Roll(TextLog* const txt)
+{
+    if ( txt->file == stdout )
+        return;
+    if ( txt->last >= time(nullptr) )
+        return;
+
+    TextLog_Close(txt->file);
+    RollAlertFile(txt->name);
+    txt->file = TextLog_Open(txt->name);
+
+    txt->last = time(nullptr);
+    txt->size = 0;
+}
+
+/*-------------------------------------------------------------------
+ * TextLog_Output: write a buffer to file
+ *-------------------------------------------------------------------
+ */
+static bool TextLog_Output(TextLog* const txt, const char* buf, unsigned len)
+{
+    if ( txt->maxFile and txt->size + len > txt->maxFile )
+        TextLog_Roll(txt);
+
+    if ( fwrite(buf, len, 1, txt->file) != 1 )
+        return false;
+
+    txt->size += len;
+    return true;
+}
+
+/*-------------------------------------------------------------------
+ * LogWriter: thread that writes queued buffers for all TextLogs
+ * created with a queue.  the thread runs while there are any such
+ * TextLogs and sleeps until notified when they are all drained.
+ * packet threads only take the lock to wake a sleeping writer and
+ * the writer doesn't hold it while writing.
+ *-------------------------------------------------------------------
+ */
+class LogWriter
+{
+public:
+    static void add(TextLog*);
+    static void remove(TextLog*);
+    static void notify();
+
+private:
+    static void run(unsigned id);
+    static void drain(TextLog*);
+
+    static std::mutex lock;
+    static std::condition_variable ready;
+    static std::condition_variable closed;
+    static std::list<TextLog*> logs;
+    static std::thread* writer;
+    static unsigned generation;
+    static unsigned closing;
+
+    static std::atomic<bool> pending;
+    static std::atomic<bool> waiting;
+};
+
+std::mutex LogWriter::lock;
+std::condition_variable LogWriter::ready;
+std::condition_variable LogWriter::closed;
+std::list<TextLog*> LogWriter::logs;
+std::thread* LogWriter::writer = nullptr;
+unsigned LogWriter::generation = 0;
+unsigned LogWriter::closing = 0;
+
+std::atomic<bool> LogWriter::pending(false);
+std::atomic<bool> LogWriter::waiting(false);
+
+void LogWriter::add(TextLog* txt)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    logs.emplace_back(txt);
+
+    if ( !writer )
+        writer = new std::thread(run, ++generation);
+}
+
+void LogWriter::remove(TextLog* txt)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    txt->queue->closing = true;
+    ++closing;
+    ready.notify_one();
+    closed.wait(guard, [txt]{ return txt->queue->closed; });
+
+    std::thread* done = nullptr;
+
+    if ( logs.empty() )
+    {
+        // the current writer exits and a later add() starts a new one
+        done = writer;
+        writer = nullptr;
+        ++generation;
+        ready.notify_one();
+    }
+    guard.unlock();
+
+    if ( done )
+    {
+        done->join();
+        delete done;
+    }
+}
+
+// the writer sets waiting before it checks pending and the packet thread
+// sets pending before it checks waiting so at least one of them sees the
+// other.  if the writer is about to wait it still holds the lock so the
+// notify below can't happen until it does.
+void LogWriter::notify()
+{
+    pending = true;
+
+    if ( waiting )
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        ready.notify_one();
+    }
+}
+
+void LogWriter::drain(TextLog* txt)
+{
+    LogQueue* q = txt->queue;
+
+    while ( LogBlock* b = q->full.read() )
+    {
+        TextLog_Output(txt, b->data, b->len);
+
+        char* data = b->data;
+        q->full.pop();
+        q->free.put(data);
+    }
+}
+
+void LogWriter::run(unsigned id)
+{
+    std::vector<TextLog*> active;
+    std::vector<TextLog*> done;
+    std::unique_lock<std::mutex> guard(lock);
+
+    while ( id == generation )
+    {
+        pending = false;
+        active.assign(logs.begin(), logs.end());
+        done.clear();
+
+        // closing is set after the last buffer was queued so these
+        // are finished once drained below
+        for ( auto txt : active )
+        {
+            if ( txt->queue->closing )
+                done.emplace_back(txt);
+        }
+
+        // a TextLog stays in logs until it is closed here so
+        // it can't be removed while unlocked
+        guard.unlock();
+
+        for ( auto txt : active )
+            drain(txt);
+
+        guard.lock();
+
+        for ( auto txt : done )
+        {
+            txt->queue->closed = true;
+            logs.remove(txt);
+            --closing;
+        }
+
+        if ( !done.empty() )
+            closed.notify_all();
+
+        waiting = true;
+        ready.wait(guard, [id]{ return pending or closing or id != generation; });
+        waiting = false;
+    }
+}
+
+/*-------------------------------------------------------------------
+ * TextLog_Enqueue: pass the buffer to the writer thread
+ * if there is a free buffer to take its place, else drop it
+ *-------------------------------------------------------------------
+ */
+static bool TextLog_Enqueue(TextLog* const txt)
+{
+    LogQueue* q = txt->queue;
+    char** spare = q->free.read();
+
+    if ( !spare )
+    {
+        text_log_counts.dropped_buffers++;
+        text_log_counts.dropped_bytes += txt->pos;
+        TextLog_Reset(txt);
+        return false;
+    }
+
+    LogBlock* b = q->full.write();
+    assert(b);
+
+    b->data = txt->buf;
+    b->len = txt->pos;
+    q->full.push();
+
+    txt->buf = *spare;
+    q->free.pop();
+
+    text_log_counts.queued_buffers++;
+    TextLog_Reset(txt);
+    LogWriter::notify();
+
+    return true;
+}
+
+/*-------------------------------------------------------------------
+ * TextLog_Dequeue: queue the last buffer and free all buffers
+ * once the writer thread is done with this TextLog
+ *-------------------------------------------------------------------
+ */
+static void TextLog_Dequeue(TextLog* const txt)
+{
+    LogQueue* q = txt->queue;
+
+    // the full ring has room for every buffer so this can't fail
+    if ( txt->pos and !txt->dropping )
+    {
+        LogBlock* b = q->full.write();
+        b->data = txt->buf;
+        b->len = txt->pos;
+        q->full.push();
+    }
+    else
+        snort_free(txt->buf);
+
+    txt->buf = nullptr;
+    LogWriter::remove(txt);
+
+    while ( char* data = q->free.get(nullptr) )
+        snort_free(data);
+
+    delete q;
+    txt->queue = nullptr;
+}
+
+/*-------------------------------------------------------------------
+ * TextLog_Spill: make room in a full buffer
+ * if part of a record is dropped, the rest is dropped too
+ *-------------------------------------------------------------------
+ */
+static void TextLog_Spill(TextLog* const txt)
+{
+    if ( !txt->queue )
+        TextLog_Flush(txt);
+
+    else if ( txt->dropping )
+        TextLog_Reset(txt);
+
+    else if ( !TextLog_Enqueue(txt) )
+        txt->dropping = true;
+}
+
 namespace snort
 {
 int TextLog_Avail(TextLog* const txt)
@@ -115,14 +419,14 @@ void TextLog_Reset(TextLog* const txt)
  *-------------------------------------------------------------------
  */
 TextLog* TextLog_Init(
-    const char* name, unsigned int maxBuf, size_t maxFile)
+    const char* name, unsigned int maxBuf, size_t maxFile, unsigned queue)
 {
     TextLog* txt;
 
     if ( maxBuf < MIN_BUF )
         maxBuf = MIN_BUF;
 
-    txt = (TextLog*)snort_alloc(sizeof(TextLog)+maxBuf);
+    txt = (TextLog*)snort_alloc(sizeof(TextLog) + (queue ? 0 : maxBuf));
 
     txt->name = name ? snort_strdup(name) : nullptr;
     txt->file = TextLog_Open(txt->name);
@@ -130,7 +434,24 @@ TextLog* TextLog_Init(
     txt->last = time(nullptr);
     txt->maxFile = maxFile;
 
+    txt->queue = nullptr;
+    txt->dropping = false;
+
     txt->maxBuf = maxBuf;
+
+    if ( queue )
+    {
+        txt->queue = new LogQueue(queue);
+        txt->buf = (char*)snort_alloc(maxBuf);
+
+        for ( unsigned i = 0; i < queue; ++i )
+            txt->queue->free.put((char*)snort_alloc(maxBuf));
+
+        LogWriter::add(txt);
+    }
+    else
+        txt->buf = (char*)(txt + 1);
+
     TextLog_Reset(txt);
 
     return txt;
@@ -145,7 +466,11 @@ void TextLog_Term(TextLog* const txt)
     if ( !txt )
         return;
 
-    TextLog_Flush(txt);
+    if ( txt->queue )
+        TextLog_Dequeue(txt);
+    else
+        TextLog_Flush(txt);
+
     TextLog_Close(txt->file);
 
     if ( txt->name )
@@ -153,50 +478,32 @@ void TextLog_Term(TextLog* const txt)
     snort_free(txt);
 }
 
-/*-------------------------------------------------------------------
- * TextLog_Flush: start writing to new file
- * but don't roll over stdout or any sooner
- * than resolution of filename discriminator
- *-------------------------------------------------------------------
- */
-static void TextLog_Roll(TextLog* const txt)
-{
-    if ( txt->file == stdout )
-        return;
-    if ( txt->last >= time(nullptr) )
-        return;
-
-    TextLog_Close(txt->file);
-    RollAlertFile(txt->name);
-    txt->file = TextLog_Open(txt->name);
-
-    txt->last = time(nullptr);
-    txt->size = 0;
-}
-
 /*-------------------------------------------------------------------
  * TextLog_Flush: write buffered stream to file
+ * or queue it for the writer thread
  *-------------------------------------------------------------------
  */
 bool TextLog_Flush(TextLog* const txt)
 {
-    int ok;
+    if ( txt->queue and txt->dropping )
+    {
+        /* the rest of a dropped record */
+        txt->dropping = false;
+        TextLog_Reset(txt);
+        return false;
+    }
 
     if ( !txt->pos )
         return false;
 
-    if ( txt->maxFile and txt->size + txt->pos > txt->maxFile )
-        TextLog_Roll(txt);
+    if ( txt->queue )
+        return TextLog_Enqueue(txt);
 
-    ok = fwrite(txt->buf, txt->pos, 1, txt->file);
+    if ( !TextLog_Output(txt, txt->buf, txt->pos) )
+        return false;
 
-    if ( ok == 1 )
-    {
-        txt->size += txt->pos;
-        TextLog_Reset(txt);
-        return true;
-    }
-    return false;
+    TextLog_Reset(txt);
+    return true;
 }
 
 /*-------------------------------------------------------------------
@@ -207,7 +514,7 @@ bool TextLog_Putc(TextLog* const txt, char c)
 {
     if ( TextLog_Avail(txt) < 1 )
     {
-        TextLog_Flush(txt);
+        TextLog_Spill(txt);
     }
     txt->buf[txt->pos++] = c;
     txt->buf[txt->pos] = '\0';
@@ -237,7 +544,7 @@ bool TextLog_Write(TextLog* const txt, const char* str, int len)
         len -= l;
 
         if ( n >= avail )
-            TextLog_Flush(txt);
+            TextLog_Spill(txt);
     }
     while ( len > 0 );
 
@@ -260,7 +567,7 @@ bool TextLog_Print(TextLog* const txt, const char* fmt, ...)
 
     if ( len >= avail )
     {
-        TextLog_Flush(txt);
+        TextLog_Spill(txt);
         avail = TextLog_Avail(txt);
 
         va_start(ap, fmt);
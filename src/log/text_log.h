@@ -32,11 +32,21 @@
  * that, the file is closed, renamed, and reopened.  The current
  * file always has the same name.  Old files are renamed to that
  * name plus a timestamp.
+ *
+ * If a queue depth is given, flushed buffers are written by a
+ * separate writer thread instead of the calling thread.  Formatting
+ * into the buffer is still done by the calling thread.  Up to
+ * that many buffers may be waiting; if none are free the buffer
+ * and the rest of the current record are dropped so the caller
+ * never blocks.  Such a TextLog must only be used by the thread
+ * that created it.
  */
 
 #include <cstring>
 
+#include "framework/counts.h"
 #include "main/snort_types.h"
+#include "main/thread.h"
 
 #define K_BYTES (1024)
 #define M_BYTES (K_BYTES*K_BYTES)
@@ -48,8 +58,17 @@ struct TextLog;
 
 namespace snort
 {
+struct TextLogCounts
+{
+    PegCount queued_buffers;
+    PegCount dropped_buffers;
+    PegCount dropped_bytes;
+};
+
+extern THREAD_LOCAL TextLogCounts text_log_counts;
+
 SO_PUBLIC TextLog* TextLog_Init(
-    const char* name, unsigned int maxBuf = 0, size_t maxFile = 0);
+    const char* name, unsigned int maxBuf = 0, size_t maxFile = 0, unsigned queue = 0);
 SO_PUBLIC void TextLog_Term(TextLog*);
 
 SO_PUBLIC bool TextLog_Putc(TextLog* const, char);
@@ -39,6 +39,7 @@
 #include "log/log.h"
 #include "log/log_text.h"
 #include "log/text_log.h"
+#include "main/snort_config.h"
 #include "packet_io/active.h"
 #include "packet_io/sfdaq.h"
 #include "protocols/cisco_meta_data.h"
@@ -615,7 +616,7 @@ CsvLogger::CsvLogger(CsvModule* m)
 
 void CsvLogger::open()
 {
-    csv_log = TextLog_Init(file.c_str(), LOG_BUFFER, limit);
+    csv_log = TextLog_Init(file.c_str(), LOG_BUFFER, limit, SnortConfig::get_conf()->log_queue);
 }
 
 void CsvLogger::close()
@@ -206,7 +206,7 @@ FastLogger::FastLogger(FastModule* m)
 void FastLogger::open()
 {
     unsigned sz = packet ? FULL_BUF : FAST_BUF;
-    fast_log = TextLog_Init(file.c_str(), sz, limit);
+    fast_log = TextLog_Init(file.c_str(), sz, limit, SnortConfig::get_conf()->log_queue);
 }
 
 void FastLogger::close()
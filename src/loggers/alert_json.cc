@@ -40,6 +40,7 @@
 #include "log/log.h"
 #include "log/log_text.h"
 #include "log/text_log.h"
+#include "main/snort_config.h"
 #include "packet_io/active.h"
 #include "packet_io/sfdaq.h"
 #include "protocols/cisco_meta_data.h"
@@ -49,6 +50,13 @@
 #include "protocols/udp.h"
 #include "protocols/vlan.h"
 #include "utils/stats.h"
+#include "utils/util.h"
+
+#if defined(UNIT_TEST) || defined(BENCHMARK_TEST)
+#include <random>
+
+#include "catch/snort_catch.h"
+#endif
 
 using namespace snort;
 using namespace std;
@@ -60,30 +68,293 @@ static THREAD_LOCAL TextLog* json_log;
 #define S_NAME "alert_json"
 #define F_NAME S_NAME ".txt"
 
+//-------------------------------------------------------------------------
+// output buffer
+//-------------------------------------------------------------------------
+
+// fields are formatted directly into this buffer, which is written to the
+// TextLog once per record or whenever it fills.  numbers, addresses, and
+// timestamps are formatted with tables instead of printf.
+
+static const char dec_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+static const uint64_t pow10[] =
+{
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+    100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+    10000000000000ull, 100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+    100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+};
+
+static inline unsigned num_digits(uint64_t v)
+{
+    // log10 from log2; 1233 / 4096 ~= log10(2)
+    v |= 1;
+    unsigned t = ((64 - __builtin_clzll(v)) * 1233) >> 12;
+    return t + (v >= pow10[t]);
+}
+
+// each entry is the decimal octet followed by a dot, and its length
+struct OctetTable
+{
+    OctetTable()
+    {
+        for ( unsigned i = 0; i < 256; ++i )
+            len[i] = snprintf(str[i], sizeof(str[i]), "%u.", i) - 1;
+    }
+
+    char str[256][5];
+    uint8_t len[256];
+};
+
+static const OctetTable octets;
+
+class JsonOutput
+{
+public:
+    void reset()
+    { pos = 0; }
+
+    void flush()
+    {
+        if ( pos )
+            TextLog_Write(json_log, buf, pos);
+        pos = 0;
+    }
+
+    void put(char c)
+    {
+        reserve(1);
+        buf[pos++] = c;
+    }
+
+    void put(const char* s, unsigned len)
+    {
+        while ( len > sizeof(buf) - pos )
+        {
+            unsigned n = sizeof(buf) - pos;
+            memcpy(buf + pos, s, n);
+            pos += n;
+            s += n;
+            len -= n;
+            flush();
+        }
+        memcpy(buf + pos, s, len);
+        pos += len;
+    }
+
+    void puts(const char* s)
+    { put(s, strlen(s)); }
+
+    // same escapes as TextLog_Quote()
+    void quote(const char* s);
+
+    void put_uint(uint64_t);
+    void put_hex(unsigned);
+    void put_mac(const uint8_t*);
+    void put_ip(const SfIp*);
+    void put_timestamp(const Packet*);
+
+    const char* data() const
+    { return buf; }
+
+    unsigned size() const
+    { return pos; }
+
+private:
+    void reserve(unsigned n)
+    {
+        if ( pos + n > sizeof(buf) )
+            flush();
+    }
+
+    char buf[LOG_BUFFER];
+    unsigned pos = 0;
+
+    // the formatted time of the last second seen
+    time_t ts_sec = 0;
+    const SnortConfig* ts_conf = nullptr;
+    char ts[TIMEBUF_SIZE];
+    unsigned ts_len = 0;
+};
+
+static THREAD_LOCAL JsonOutput* json_out;
+
+void JsonOutput::quote(const char* s)
+{
+    put('"');
+
+    while ( *s )
+    {
+        unsigned n = strcspn(s, "\"\\");
+        put(s, n);
+        s += n;
+
+        if ( *s )
+        {
+            put('\\');
+            put(*s++);
+        }
+    }
+    put('"');
+}
+
+void JsonOutput::put_uint(uint64_t v)
+{
+    reserve(20);
+    unsigned n = num_digits(v);
+    char* p = buf + pos + n;
+
+    while ( v >= 100 )
+    {
+        unsigned i = (v % 100) * 2;
+        v /= 100;
+        *--p = dec_pairs[i + 1];
+        *--p = dec_pairs[i];
+    }
+
+    if ( v >= 10 )
+    {
+        *--p = dec_pairs[v * 2 + 1];
+        *--p = dec_pairs[v * 2];
+    }
+    else
+        *--p = '0' + v;
+
+    pos += n;
+}
+
+// %X
+void JsonOutput::put_hex(unsigned v)
+{
+    reserve(8);
+    unsigned n = (32 - __builtin_clz(v | 1) + 3) / 4;
+    char* p = buf + pos + n;
+
+    for ( unsigned i = 0; i < n; ++i, v >>= 4 )
+        *--p = hex_digits[v & 0xF];
+
+    pos += n;
+}
+
+// %02X:%02X:%02X:%02X:%02X:%02X
+void JsonOutput::put_mac(const uint8_t* mac)
+{
+    // the last colon is dropped
+    reserve(18);
+    char* p = buf + pos;
+
+    for ( unsigned i = 0; i < 6; ++i )
+    {
+        *p++ = hex_digits[mac[i] >> 4];
+        *p++ = hex_digits[mac[i] & 0xF];
+        *p++ = ':';
+    }
+    pos += 17;
+}
+
+// same as SfIp::ntop()
+void JsonOutput::put_ip(const SfIp* ip)
+{
+    if ( !ip->is_ip4() )
+    {
+        SfIpString str;
+        puts(ip->ntop(str));
+        return;
+    }
+
+    // each octet is copied with a trailing dot; the last dot is dropped
+    reserve(16);
+    const uint8_t* b = (const uint8_t*)ip->get_ip4_ptr();
+
+    for ( unsigned i = 0; i < 4; ++i )
+    {
+        memcpy(buf + pos, octets.str[b[i]], 4);
+        pos += octets.len[b[i]] + 1;
+    }
+    --pos;
+}
+
+// same as LogTimeStamp(); only the microseconds change within a second
+void JsonOutput::put_timestamp(const Packet* p)
+{
+    const struct timeval* tv = (const struct timeval*)&p->pkth->ts;
+    const SnortConfig* sc = SnortConfig::get_conf();
+
+    if ( tv->tv_sec != ts_sec or sc != ts_conf or !ts_len )
+    {
+        ts_print(tv, ts);
+        ts_len = strlen(ts);
+        ts_sec = tv->tv_sec;
+        ts_conf = sc;
+
+        // all formats but the bare seconds end in .%06u
+        if ( ts_len < 7 or ts[ts_len - 7] != '.' )
+        {
+            ts_len = 0;
+            puts(ts);
+            return;
+        }
+    }
+
+    if ( (unsigned)tv->tv_usec > 999999 )
+    {
+        char tmp[TIMEBUF_SIZE];
+        ts_print(tv, tmp);
+        puts(tmp);
+        return;
+    }
+
+    reserve(TIMEBUF_SIZE);
+    memcpy(buf + pos, ts, ts_len - 6);
+    pos += ts_len;
+
+    unsigned usec = tv->tv_usec;
+    char* d = buf + pos;
+
+    for ( unsigned i = 0; i < 3; ++i, usec /= 100 )
+    {
+        unsigned j = (usec % 100) * 2;
+        *--d = dec_pairs[j + 1];
+        *--d = dec_pairs[j];
+    }
+}
+
 //-------------------------------------------------------------------------
 // field formatting functions
 //-------------------------------------------------------------------------
 
+// the label of each field, including the preceding comma, is built once
+// when the logger is configured
 struct Args
 {
     Packet* pkt;
     const char* msg;
     const Event& event;
-    bool comma;
+    const string* label;
 };
 
-static void print_label(const Args& a, const char* label)
+static void print_label(const Args& a)
 {
-    if ( a.comma )
-        TextLog_Print(json_log, ",");
-
-    TextLog_Print(json_log, " \"%s\" : ", label);
+    json_out->put(a.label->data(), a.label->size());
 }
 
 static bool ff_action(const Args& a)
 {
-    print_label(a, "action");
-    TextLog_Quote(json_log, a.pkt->active->get_action_string());
+    print_label(a);
+    json_out->quote(a.pkt->active->get_action_string());
     return true;
 }
 
@@ -94,8 +365,8 @@ static bool ff_class(const Args& a)
     if ( a.event.sig_info->class_type and !a.event.sig_info->class_type->text.empty() )
         cls = a.event.sig_info->class_type->text.c_str();
 
-    print_label(a, "class");
-    TextLog_Quote(json_log, cls);
+    print_label(a);
+    json_out->quote(cls);
     return true;
 }
 
@@ -111,21 +382,21 @@ static bool ff_b64_data(const Args& a)
     unsigned nin = 0;
     Base64Encoder b64;
 
-    print_label(a, "b64_data");
-    TextLog_Putc(json_log, '"');
+    print_label(a);
+    json_out->put('"');
 
     while ( nin < a.pkt->dsize )
     {
         unsigned kin = min(a.pkt->dsize-nin, block_size);
         unsigned kout = b64.encode(in+nin, kin, out);
-        TextLog_Write(json_log, out, kout);
+        json_out->put(out, kout);
         nin += kin;
     }
 
     if ( unsigned kout = b64.finish(out) )
-        TextLog_Write(json_log, out, kout);
+        json_out->put(out, kout);
 
-    TextLog_Putc(json_log, '"');
+    json_out->put('"');
     return true;
 }
 
@@ -133,8 +404,8 @@ static bool ff_client_bytes(const Args& a)
 {
     if (a.pkt->flow)
     {
-        print_label(a, "client_bytes");
-        TextLog_Print(json_log, "%" PRIu64, a.pkt->flow->flowstats.client_bytes);
+        print_label(a);
+        json_out->put_uint(a.pkt->flow->flowstats.client_bytes);
         return true;
     }
     return false;
@@ -144,8 +415,8 @@ static bool ff_client_pkts(const Args& a)
 {
     if (a.pkt->flow)
     {
-        print_label(a, "client_pkts");
-        TextLog_Print(json_log, "%" PRIu64, a.pkt->flow->flowstats.client_pkts);
+        print_label(a);
+        json_out->put_uint(a.pkt->flow->flowstats.client_pkts);
         return true;
     }
     return false;
@@ -162,8 +433,8 @@ static bool ff_dir(const Args& a)
     else
         dir = "UNK";
 
-    print_label(a, "dir");
-    TextLog_Quote(json_log, dir);
+    print_label(a);
+    json_out->quote(dir);
     return true;
 }
 
@@ -171,9 +442,10 @@ static bool ff_dst_addr(const Args& a)
 {
     if ( a.pkt->has_ip() or a.pkt->is_data() )
     {
-        SfIpString ip_str;
-        print_label(a, "dst_addr");
-        TextLog_Quote(json_log, a.pkt->ptrs.ip_api.get_dst()->ntop(ip_str));
+        print_label(a);
+        json_out->put('"');
+        json_out->put_ip(a.pkt->ptrs.ip_api.get_dst());
+        json_out->put('"');
         return true;
     }
     return false;
@@ -181,17 +453,20 @@ static bool ff_dst_addr(const Args& a)
 
 static bool ff_dst_ap(const Args& a)
 {
-    SfIpString addr = "";
     unsigned port = 0;
 
-    if ( a.pkt->has_ip() or a.pkt->is_data() )
-        a.pkt->ptrs.ip_api.get_dst()->ntop(addr);
-
     if ( a.pkt->proto_bits & (PROTO_BIT__TCP|PROTO_BIT__UDP) )
         port = a.pkt->ptrs.dp;
 
-    print_label(a, "dst_ap");
-    TextLog_Print(json_log, "\"%s:%u\"", addr, port);
+    print_label(a);
+    json_out->put('"');
+
+    if ( a.pkt->has_ip() or a.pkt->is_data() )
+        json_out->put_ip(a.pkt->ptrs.ip_api.get_dst());
+
+    json_out->put(':');
+    json_out->put_uint(port);
+    json_out->put('"');
     return true;
 }
 
@@ -199,8 +474,8 @@ static bool ff_dst_port(const Args& a)
 {
     if ( a.pkt->proto_bits & (PROTO_BIT__TCP|PROTO_BIT__UDP) )
     {
-        print_label(a, "dst_port");
-        TextLog_Print(json_log, "%u", a.pkt->ptrs.dp);
+        print_label(a);
+        json_out->put_uint(a.pkt->ptrs.dp);
         return true;
     }
     return false;
@@ -211,13 +486,12 @@ static bool ff_eth_dst(const Args& a)
     if ( !(a.pkt->proto_bits & PROTO_BIT__ETH) )
         return false;
 
-    print_label(a, "eth_dst");
+    print_label(a);
     const eth::EtherHdr* eh = layer::get_eth_layer(a.pkt);
 
-    TextLog_Print(json_log, "\"%02X:%02X:%02X:%02X:%02X:%02X\"", eh->ether_dst[0],
-        eh->ether_dst[1], eh->ether_dst[2], eh->ether_dst[3],
-        eh->ether_dst[4], eh->ether_dst[5]);
-
+    json_out->put('"');
+    json_out->put_mac(eh->ether_dst);
+    json_out->put('"');
     return true;
 }
 
@@ -226,8 +500,8 @@ static bool ff_eth_len(const Args& a)
     if ( !(a.pkt->proto_bits & PROTO_BIT__ETH) )
         return false;
 
-    print_label(a, "eth_len");
-    TextLog_Print(json_log, "%u", a.pkt->pkth->pktlen);
+    print_label(a);
+    json_out->put_uint(a.pkt->pkth->pktlen);
     return true;
 }
 
@@ -236,12 +510,12 @@ static bool ff_eth_src(const Args& a)
     if ( !(a.pkt->proto_bits & PROTO_BIT__ETH) )
         return false;
 
-    print_label(a, "eth_src");
+    print_label(a);
     const eth::EtherHdr* eh = layer::get_eth_layer(a.pkt);
 
-    TextLog_Print(json_log, "\"%02X:%02X:%02X:%02X:%02X:%02X\"", eh->ether_src[0],
-        eh->ether_src[1], eh->ether_src[2], eh->ether_src[3],
-        eh->ether_src[4], eh->ether_src[5]);
+    json_out->put('"');
+    json_out->put_mac(eh->ether_src);
+    json_out->put('"');
     return true;
 }
 
@@ -252,8 +526,10 @@ static bool ff_eth_type(const Args& a)
 
     const eth::EtherHdr* eh = layer::get_eth_layer(a.pkt);
 
-    print_label(a, "eth_type");
-    TextLog_Print(json_log, "\"0x%X\"", ntohs(eh->ether_type));
+    print_label(a);
+    json_out->put("\"0x", 3);
+    json_out->put_hex(ntohs(eh->ether_type));
+    json_out->put('"');
     return true;
 }
 
@@ -261,8 +537,8 @@ static bool ff_flowstart_time(const Args& a)
 {
     if (a.pkt->flow)
     {
-        print_label(a, "flowstart_time");
-        TextLog_Print(json_log, "%lu", a.pkt->flow->flowstats.start_time.tv_sec);
+        print_label(a);
+        json_out->put_uint((unsigned long)a.pkt->flow->flowstats.start_time.tv_sec);
         return true;
     }
     return false;
@@ -270,8 +546,8 @@ static bool ff_flowstart_time(const Args& a)
 
 static bool ff_gid(const Args& a)
 {
-    print_label(a, "gid");
-    TextLog_Print(json_log, "%u",  a.event.sig_info->gid);
+    print_label(a);
+    json_out->put_uint(a.event.sig_info->gid);
     return true;
 }
 
@@ -279,8 +555,8 @@ static bool ff_icmp_code(const Args& a)
 {
     if (a.pkt->ptrs.icmph )
     {
-        print_label(a, "icmp_code");
-        TextLog_Print(json_log, "%u", a.pkt->ptrs.icmph->code);
+        print_label(a);
+        json_out->put_uint(a.pkt->ptrs.icmph->code);
         return true;
     }
     return false;
@@ -290,8 +566,8 @@ static bool ff_icmp_id(const Args& a)
 {
     if (a.pkt->ptrs.icmph )
     {
-        print_label(a, "icmp_id");
-        TextLog_Print(json_log, "%u", ntohs(a.pkt->ptrs.icmph->s_icmp_id));
+        print_label(a);
+        json_out->put_uint(ntohs(a.pkt->ptrs.icmph->s_icmp_id));
         return true;
     }
     return false;
@@ -301,8 +577,8 @@ static bool ff_icmp_seq(const Args& a)
 {
     if (a.pkt->ptrs.icmph )
     {
-        print_label(a, "icmp_seq");
-        TextLog_Print(json_log, "%u", ntohs(a.pkt->ptrs.icmph->s_icmp_seq));
+        print_label(a);
+        json_out->put_uint(ntohs(a.pkt->ptrs.icmph->s_icmp_seq));
         return true;
     }
     return false;
@@ -312,8 +588,8 @@ static bool ff_icmp_type(const Args& a)
 {
     if (a.pkt->ptrs.icmph )
     {
-        print_label(a, "icmp_type");
-        TextLog_Print(json_log, "%u", a.pkt->ptrs.icmph->type);
+        print_label(a);
+        json_out->put_uint(a.pkt->ptrs.icmph->type);
         return true;
     }
     return false;
@@ -321,8 +597,8 @@ static bool ff_icmp_type(const Args& a)
 
 static bool ff_iface(const Args& a)
 {
-    print_label(a, "iface");
-    TextLog_Quote(json_log, SFDAQ::get_input_spec());
+    print_label(a);
+    json_out->quote(SFDAQ::get_input_spec());
     return true;
 }
 
@@ -330,8 +606,8 @@ static bool ff_ip_id(const Args& a)
 {
     if (a.pkt->has_ip())
     {
-        print_label(a, "ip_id");
-        TextLog_Print(json_log, "%u", a.pkt->ptrs.ip_api.id());
+        print_label(a);
+        json_out->put_uint(a.pkt->ptrs.ip_api.id());
         return true;
     }
     return false;
@@ -341,8 +617,8 @@ static bool ff_ip_len(const Args& a)
 {
     if (a.pkt->has_ip())
     {
-        print_label(a, "ip_len");
-        TextLog_Print(json_log, "%u", a.pkt->ptrs.ip_api.pay_len());
+        print_label(a);
+        json_out->put_uint(a.pkt->ptrs.ip_api.pay_len());
         return true;
     }
     return false;
@@ -350,8 +626,8 @@ static bool ff_ip_len(const Args& a)
 
 static bool ff_msg(const Args& a)
 {
-    print_label(a, "msg");
-    TextLog_Puts(json_log, a.msg);
+    print_label(a);
+    json_out->puts(a.msg);
     return true;
 }
 
@@ -368,72 +644,77 @@ static bool ff_mpls(const Args& a)
     else
         return false;
 
-    print_label(a, "mpls");
-    TextLog_Print(json_log, "%u", ntohl(mpls));
+    print_label(a);
+    json_out->put_uint(ntohl(mpls));
     return true;
 }
 
 static bool ff_pkt_gen(const Args& a)
 {
-    print_label(a, "pkt_gen");
-    TextLog_Quote(json_log, a.pkt->get_pseudo_type());
+    print_label(a);
+    json_out->quote(a.pkt->get_pseudo_type());
     return true;
 }
 
 static bool ff_pkt_len(const Args& a)
 {
-    print_label(a, "pkt_len");
+    print_label(a);
 
     if (a.pkt->has_ip())
-        TextLog_Print(json_log, "%u", a.pkt->ptrs.ip_api.dgram_len());
+        json_out->put_uint(a.pkt->ptrs.ip_api.dgram_len());
     else
-        TextLog_Print(json_log, "%u", a.pkt->dsize);
+        json_out->put_uint(a.pkt->dsize);
 
     return true;
 }
 
 static bool ff_pkt_num(const Args& a)
 {
-    print_label(a, "pkt_num");
-    TextLog_Print(json_log, STDu64, a.pkt->context->packet_number);
+    print_label(a);
+    json_out->put_uint(a.pkt->context->packet_number);
     return true;
 }
 
 static bool ff_priority(const Args& a)
 {
-    print_label(a, "priority");
-    TextLog_Print(json_log, "%u", a.event.sig_info->priority);
+    print_label(a);
+    json_out->put_uint(a.event.sig_info->priority);
     return true;
 }
 
 static bool ff_proto(const Args& a)
 {
-    print_label(a, "proto");
-    TextLog_Quote(json_log, a.pkt->get_type());
+    print_label(a);
+    json_out->quote(a.pkt->get_type());
     return true;
 }
 
 static bool ff_rev(const Args& a)
 {
-    print_label(a, "rev");
-    TextLog_Print(json_log, "%u",  a.event.sig_info->rev);
+    print_label(a);
+    json_out->put_uint(a.event.sig_info->rev);
     return true;
 }
 
 static bool ff_rule(const Args& a)
 {
-    print_label(a, "rule");
+    print_label(a);
 
-    TextLog_Print(json_log, "\"%u:%u:%u\"",
-        a.event.sig_info->gid, a.event.sig_info->sid, a.event.sig_info->rev);
+    json_out->put('"');
+    json_out->put_uint(a.event.sig_info->gid);
+    json_out->put(':');
+    json_out->put_uint(a.event.sig_info->sid);
+    json_out->put(':');
+    json_out->put_uint(a.event.sig_info->rev);
+    json_out->put('"');
 
     return true;
 }
 
 static bool ff_seconds(const Args& a)
 {
-    print_label(a, "seconds");
-    TextLog_Print(json_log, "%lu",  a.pkt->pkth->ts.tv_sec);
+    print_label(a);
+    json_out->put_uint((unsigned long)a.pkt->pkth->ts.tv_sec);
     return true;
 }
 
@@ -441,8 +722,8 @@ static bool ff_server_bytes(const Args& a)
 {
     if (a.pkt->flow)
     {
-        print_label(a, "server_bytes");
-        TextLog_Print(json_log, "%" PRIu64, a.pkt->flow->flowstats.server_bytes);
+        print_label(a);
+        json_out->put_uint(a.pkt->flow->flowstats.server_bytes);
         return true;
     }
     return false;
@@ -452,8 +733,8 @@ static bool ff_server_pkts(const Args& a)
 {
     if (a.pkt->flow)
     {
-        print_label(a, "server_pkts");
-        TextLog_Print(json_log, "%" PRIu64, a.pkt->flow->flowstats.server_pkts);
+        print_label(a);
+        json_out->put_uint(a.pkt->flow->flowstats.server_pkts);
         return true;
     }
     return false;
@@ -466,8 +747,8 @@ static bool ff_service(const Args& a)
     if ( a.pkt->flow and a.pkt->flow->service )
         svc = a.pkt->flow->service;
 
-    print_label(a, "service");
-    TextLog_Quote(json_log, svc);
+    print_label(a);
+    json_out->quote(svc);
     return true;
 }
 
@@ -476,8 +757,8 @@ static bool ff_sgt(const Args& a)
     if (a.pkt->proto_bits & PROTO_BIT__CISCO_META_DATA)
     {
         const cisco_meta_data::CiscoMetaDataHdr* cmdh = layer::get_cisco_meta_data_layer(a.pkt);
-        print_label(a, "sgt");
-        TextLog_Print(json_log, "%hu", cmdh->sgt_val());
+        print_label(a);
+        json_out->put_uint(cmdh->sgt_val());
         return true;
     }
     return false;
@@ -485,8 +766,8 @@ static bool ff_sgt(const Args& a)
 
 static bool ff_sid(const Args& a)
 {
-    print_label(a, "sid");
-    TextLog_Print(json_log, "%u",  a.event.sig_info->sid);
+    print_label(a);
+    json_out->put_uint(a.event.sig_info->sid);
     return true;
 }
 
@@ -494,9 +775,10 @@ static bool ff_src_addr(const Args& a)
 {
     if ( a.pkt->has_ip() or a.pkt->is_data() )
     {
-        SfIpString ip_str;
-        print_label(a, "src_addr");
-        TextLog_Quote(json_log, a.pkt->ptrs.ip_api.get_src()->ntop(ip_str));
+        print_label(a);
+        json_out->put('"');
+        json_out->put_ip(a.pkt->ptrs.ip_api.get_src());
+        json_out->put('"');
         return true;
     }
     return false;
@@ -504,17 +786,20 @@ static bool ff_src_addr(const Args& a)
 
 static bool ff_src_ap(const Args& a)
 {
-    SfIpString addr = "";
     unsigned port = 0;
 
-    if ( a.pkt->has_ip() or a.pkt->is_data() )
-        a.pkt->ptrs.ip_api.get_src()->ntop(addr);
-
     if ( a.pkt->proto_bits & (PROTO_BIT__TCP|PROTO_BIT__UDP) )
         port = a.pkt->ptrs.sp;
 
-    print_label(a, "src_ap");
-    TextLog_Print(json_log, "\"%s:%u\"", addr, port);
+    print_label(a);
+    json_out->put('"');
+
+    if ( a.pkt->has_ip() or a.pkt->is_data() )
+        json_out->put_ip(a.pkt->ptrs.ip_api.get_src());
+
+    json_out->put(':');
+    json_out->put_uint(port);
+    json_out->put('"');
     return true;
 }
 
@@ -522,8 +807,8 @@ static bool ff_src_port(const Args& a)
 {
     if ( a.pkt->proto_bits & (PROTO_BIT__TCP|PROTO_BIT__UDP) )
     {
-        print_label(a, "src_port");
-        TextLog_Print(json_log, "%u", a.pkt->ptrs.sp);
+        print_label(a);
+        json_out->put_uint(a.pkt->ptrs.sp);
         return true;
     }
     return false;
@@ -531,19 +816,21 @@ static bool ff_src_port(const Args& a)
 
 static bool ff_target(const Args& a)
 {
-    SfIpString addr = "";
+    const SfIp* addr;
 
     if ( a.event.sig_info->target == TARGET_SRC )
-        a.pkt->ptrs.ip_api.get_src()->ntop(addr);
+        addr = a.pkt->ptrs.ip_api.get_src();
 
     else if ( a.event.sig_info->target == TARGET_DST )
-        a.pkt->ptrs.ip_api.get_dst()->ntop(addr);
+        addr = a.pkt->ptrs.ip_api.get_dst();
 
     else
         return false;
 
-    print_label(a, "target");
-    TextLog_Quote(json_log, addr);
+    print_label(a);
+    json_out->put('"');
+    json_out->put_ip(addr);
+    json_out->put('"');
     return true;
 }
 
@@ -551,8 +838,8 @@ static bool ff_tcp_ack(const Args& a)
 {
     if (a.pkt->ptrs.tcph )
     {
-        print_label(a, "tcp_ack");
-        TextLog_Print(json_log, "%u", ntohl(a.pkt->ptrs.tcph->th_ack));
+        print_label(a);
+        json_out->put_uint(ntohl(a.pkt->ptrs.tcph->th_ack));
         return true;
     }
     return false;
@@ -565,8 +852,8 @@ static bool ff_tcp_flags(const Args& a)
         char tcpFlags[9];
         CreateTCPFlagString(a.pkt->ptrs.tcph, tcpFlags);
 
-        print_label(a, "tcp_flags");
-        TextLog_Quote(json_log, tcpFlags);
+        print_label(a);
+        json_out->quote(tcpFlags);
         return true;
     }
     return false;
@@ -576,8 +863,8 @@ static bool ff_tcp_len(const Args& a)
 {
     if (a.pkt->ptrs.tcph )
     {
-        print_label(a, "tcp_len");
-        TextLog_Print(json_log, "%u", (a.pkt->ptrs.tcph->off()));
+        print_label(a);
+        json_out->put_uint(a.pkt->ptrs.tcph->off());
         return true;
     }
     return false;
@@ -587,8 +874,8 @@ static bool ff_tcp_seq(const Args& a)
 {
     if (a.pkt->ptrs.tcph )
     {
-        print_label(a, "tcp_seq");
-        TextLog_Print(json_log, "%u", ntohl(a.pkt->ptrs.tcph->th_seq));
+        print_label(a);
+        json_out->put_uint(ntohl(a.pkt->ptrs.tcph->th_seq));
         return true;
     }
     return false;
@@ -598,8 +885,8 @@ static bool ff_tcp_win(const Args& a)
 {
     if (a.pkt->ptrs.tcph )
     {
-        print_label(a, "tcp_win");
-        TextLog_Print(json_log, "%u", ntohs(a.pkt->ptrs.tcph->th_win));
+        print_label(a);
+        json_out->put_uint(ntohs(a.pkt->ptrs.tcph->th_win));
         return true;
     }
     return false;
@@ -607,10 +894,10 @@ static bool ff_tcp_win(const Args& a)
 
 static bool ff_timestamp(const Args& a)
 {
-    print_label(a, "timestamp");
-    TextLog_Putc(json_log, '"');
-    LogTimeStamp(json_log, a.pkt);
-    TextLog_Putc(json_log, '"');
+    print_label(a);
+    json_out->put('"');
+    json_out->put_timestamp(a.pkt);
+    json_out->put('"');
     return true;
 }
 
@@ -618,8 +905,8 @@ static bool ff_tos(const Args& a)
 {
     if (a.pkt->has_ip())
     {
-        print_label(a, "tos");
-        TextLog_Print(json_log, "%u", a.pkt->ptrs.ip_api.tos());
+        print_label(a);
+        json_out->put_uint(a.pkt->ptrs.ip_api.tos());
         return true;
     }
     return false;
@@ -629,8 +916,8 @@ static bool ff_ttl(const Args& a)
 {
     if (a.pkt->has_ip())
     {
-        print_label(a, "ttl");
-        TextLog_Print(json_log, "%u",a.pkt->ptrs.ip_api.ttl());
+        print_label(a);
+        json_out->put_uint(a.pkt->ptrs.ip_api.ttl());
         return true;
     }
     return false;
@@ -640,8 +927,8 @@ static bool ff_udp_len(const Args& a)
 {
     if (a.pkt->ptrs.udph )
     {
-        print_label(a, "udp_len");
-        TextLog_Print(json_log, "%u", ntohs(a.pkt->ptrs.udph->uh_len));
+        print_label(a);
+        json_out->put_uint(ntohs(a.pkt->ptrs.udph->uh_len));
         return true;
     }
     return false;
@@ -649,8 +936,8 @@ static bool ff_udp_len(const Args& a)
 
 static bool ff_vlan(const Args& a)
 {
-    print_label(a, "vlan");
-    TextLog_Print(json_log, "%hu", a.pkt->get_flow_vlan_id());
+    print_label(a);
+    json_out->put_uint(a.pkt->get_flow_vlan_id());
     return true;
 }
 
@@ -660,6 +947,12 @@ static bool ff_vlan(const Args& a)
 
 typedef bool (*JsonFunc)(const Args&);
 
+struct JsonField
+{
+    JsonFunc func;
+    string label;
+};
+
 static const JsonFunc json_func[] =
 {
     ff_action, ff_class, ff_b64_data, ff_client_bytes, ff_client_pkts, ff_dir,
@@ -720,7 +1013,7 @@ public:
     bool file = false;
     size_t limit = 0;
     string sep;
-    vector<JsonFunc> fields;
+    vector<JsonField> fields;
 };
 
 bool JsonModule::set(const char*, Value& v, SnortConfig*)
@@ -738,7 +1031,7 @@ bool JsonModule::set(const char*, Value& v, SnortConfig*)
         {
             int i = Parameter::index(json_range, tok.c_str());
             if ( i >= 0 )
-                fields.emplace_back(json_func[i]);
+                fields.emplace_back(JsonField{ json_func[i], tok });
         }
     }
 
@@ -770,7 +1063,7 @@ bool JsonModule::begin(const char*, int, SnortConfig*)
         {
             int i = Parameter::index(json_range, tok.c_str());
             if ( i >= 0 )
-                fields.emplace_back(json_func[i]);
+                fields.emplace_back(JsonField{ json_func[i], tok });
         }
     }
     return true;
@@ -793,7 +1086,7 @@ public:
 public:
     string file;
     unsigned long limit;
-    vector<JsonFunc> fields;
+    vector<JsonField> fields;
     string sep;
 };
 
@@ -803,31 +1096,41 @@ JsonLogger::JsonLogger(JsonModule* m)
     limit = m->limit;
     sep = m->sep;
     fields = std::move(m->fields);
+
+    // every field but the first is preceded by a comma, even if the
+    // previous fields were not logged
+    for ( unsigned i = 0; i < fields.size(); ++i )
+        fields[i].label = (i ? ", \"" : " \"") + fields[i].label + "\" : ";
 }
 
 void JsonLogger::open()
 {
-    json_log = TextLog_Init(file.c_str(), LOG_BUFFER, limit);
+    json_out = new JsonOutput;
+    json_log = TextLog_Init(file.c_str(), LOG_BUFFER, limit, SnortConfig::get_conf()->log_queue);
 }
 
 void JsonLogger::close()
 {
     if ( json_log )
         TextLog_Term(json_log);
+
+    delete json_out;
+    json_out = nullptr;
 }
 
 void JsonLogger::alert(Packet* p, const char* msg, const Event& event)
 {
-    Args a = { p, msg, event, false };
-    TextLog_Putc(json_log, '{');
+    Args a = { p, msg, event, nullptr };
+    json_out->put('{');
 
-    for ( JsonFunc f : fields )
+    for ( const JsonField& f : fields )
     {
-        f(a);
-        a.comma = true;
+        a.label = &f.label;
+        f.func(a);
     }
 
-    TextLog_Print(json_log, " }\n");
+    json_out->put(" }\n", 3);
+    json_out->flush();
     TextLog_Flush(json_log);
 }
 
@@ -876,3 +1179,182 @@ const BaseApi* alert_json[] =
     nullptr
 };
 
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+static string format(void (*f)(JsonOutput&))
+{
+    JsonOutput out;
+    f(out);
+    return string(out.data(), out.size());
+}
+
+TEST_CASE("json uint", "[alert_json]")
+{
+    std::mt19937_64 rng(1);
+    vector<uint64_t> vals = { 0, UINT64_MAX, UINT32_MAX, (uint64_t)UINT32_MAX + 1 };
+
+    for ( uint64_t p = 1; p and p <= UINT64_MAX / 10; p *= 10 )
+    {
+        vals.emplace_back(p - 1);
+        vals.emplace_back(p);
+        vals.emplace_back(p + 1);
+    }
+
+    for ( unsigned i = 0; i < 10000; ++i )
+        vals.emplace_back(rng() >> (rng() % 64));
+
+    for ( auto v : vals )
+    {
+        JsonOutput out;
+        out.put_uint(v);
+
+        char s[32];
+        snprintf(s, sizeof(s), "%" PRIu64, v);
+        CHECK(string(out.data(), out.size()) == s);
+    }
+}
+
+TEST_CASE("json hex", "[alert_json]")
+{
+    for ( unsigned v : { 0u, 1u, 0xFu, 0x10u, 0x800u, 0x86DDu, 0xFFFFu, 0xFFFFFFFFu } )
+    {
+        JsonOutput out;
+        out.put_hex(v);
+
+        char s[16];
+        snprintf(s, sizeof(s), "%X", v);
+        CHECK(string(out.data(), out.size()) == s);
+    }
+}
+
+TEST_CASE("json mac", "[alert_json]")
+{
+    CHECK(format([](JsonOutput& out)
+    {
+        const uint8_t mac[] = { 0x00, 0x1b, 0xA0, 0xff, 0x09, 0x90 };
+        out.put_mac(mac);
+    }) == "00:1B:A0:FF:09:90");
+}
+
+TEST_CASE("json ip", "[alert_json]")
+{
+    std::mt19937 rng(1);
+    vector<string> addrs = { "0.0.0.0", "255.255.255.255", "10.0.0.1", "192.168.100.9",
+        "::", "::1", "2001:db8::8:800:200c:417a", "::ffff:1.2.3.4" };
+
+    for ( unsigned i = 0; i < 1000; ++i )
+    {
+        char s[16];
+        snprintf(s, sizeof(s), "%u.%u.%u.%u", (unsigned)(rng() % 256), (unsigned)(rng() % 256),
+            (unsigned)(rng() % 256), (unsigned)(rng() % 256));
+        addrs.emplace_back(s);
+    }
+
+    for ( const auto& s : addrs )
+    {
+        SfIp ip;
+        REQUIRE(ip.set(s.c_str()) == SFIP_SUCCESS);
+
+        SfIpString str;
+        ip.ntop(str);
+
+        JsonOutput out;
+        out.put_ip(&ip);
+        CHECK(string(out.data(), out.size()) == str);
+    }
+}
+
+TEST_CASE("json quote", "[alert_json]")
+{
+    CHECK(format([](JsonOutput& out) { out.quote(""); }) == "\"\"");
+    CHECK(format([](JsonOutput& out) { out.quote("abc"); }) == "\"abc\"");
+    CHECK(format([](JsonOutput& out) { out.quote("a\"b\\c\""); }) == "\"a\\\"b\\\\c\\\"\"");
+}
+
+#endif
+
+//-------------------------------------------------------------------------
+// benchmarks
+//-------------------------------------------------------------------------
+
+#ifdef BENCHMARK_TEST
+
+// the numeric and address parts of the default fields formatted as
+// TextLog_Print() does and as the precompiled fields do
+TEST_CASE("json alert record", "[alert_json]")
+{
+    SfIp src, dst;
+    src.set("192.168.1.123");
+    dst.set("10.20.30.40");
+
+    const string labels[] =
+    {
+        " \"pkt_num\" : ", ", \"pkt_len\" : ", ", \"src_ap\" : ",
+        ", \"dst_ap\" : ", ", \"rule\" : "
+    };
+
+    uint64_t pkt_num = 123456789;
+    unsigned pkt_len = 1514;
+
+    char buf[LOG_BUFFER];
+
+    BENCHMARK("printf fields")
+    {
+        unsigned pos = 0;
+        SfIpString s, d;
+
+        pos += snprintf(buf + pos, sizeof(buf) - pos, " \"%s\" : ", "pkt_num");
+        pos += snprintf(buf + pos, sizeof(buf) - pos, STDu64, ++pkt_num);
+        pos += snprintf(buf + pos, sizeof(buf) - pos, ",");
+        pos += snprintf(buf + pos, sizeof(buf) - pos, " \"%s\" : ", "pkt_len");
+        pos += snprintf(buf + pos, sizeof(buf) - pos, "%u", pkt_len);
+        pos += snprintf(buf + pos, sizeof(buf) - pos, ",");
+        pos += snprintf(buf + pos, sizeof(buf) - pos, " \"%s\" : ", "src_ap");
+        pos += snprintf(buf + pos, sizeof(buf) - pos, "\"%s:%u\"", src.ntop(s), 51234);
+        pos += snprintf(buf + pos, sizeof(buf) - pos, ",");
+        pos += snprintf(buf + pos, sizeof(buf) - pos, " \"%s\" : ", "dst_ap");
+        pos += snprintf(buf + pos, sizeof(buf) - pos, "\"%s:%u\"", dst.ntop(d), 443);
+        pos += snprintf(buf + pos, sizeof(buf) - pos, ",");
+        pos += snprintf(buf + pos, sizeof(buf) - pos, " \"%s\" : ", "rule");
+        pos += snprintf(buf + pos, sizeof(buf) - pos, "\"%u:%u:%u\"", 1, 2000001, 3);
+        return pos;
+    };
+
+    JsonOutput out;
+
+    BENCHMARK("precompiled fields")
+    {
+        out.reset();
+        out.put(labels[0].data(), labels[0].size());
+        out.put_uint(++pkt_num);
+        out.put(labels[1].data(), labels[1].size());
+        out.put_uint(pkt_len);
+        out.put(labels[2].data(), labels[2].size());
+        out.put('"');
+        out.put_ip(&src);
+        out.put(':');
+        out.put_uint(51234);
+        out.put('"');
+        out.put(labels[3].data(), labels[3].size());
+        out.put('"');
+        out.put_ip(&dst);
+        out.put(':');
+        out.put_uint(443);
+        out.put('"');
+        out.put(labels[4].data(), labels[4].size());
+        out.put('"');
+        out.put_uint(1);
+        out.put(':');
+        out.put_uint(2000001);
+        out.put(':');
+        out.put_uint(3);
+        out.put('"');
+        return out.size();
+    };
+}
+
+#endif
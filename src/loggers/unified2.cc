@@ -1025,7 +1025,7 @@ static LogApi u2_api
         mod_ctor,
         mod_dtor
     },
-    OUTPUT_TYPE_FLAG__LOG | OUTPUT_TYPE_FLAG__ALERT,
+    OUTPUT_TYPE_FLAG__LOG | OUTPUT_TYPE_FLAG__ALERT | OUTPUT_TYPE_FLAG__XTRA,
     u2_ctor,
     u2_dtor
 };
@@ -28,6 +28,7 @@
 
 #include <thread>
 
+#include "decompress/inflate_pool.h"
 #include "detection/context_switcher.h"
 #include "detection/detect.h"
 #include "detection/detection_engine.h"
@@ -587,7 +588,9 @@ void Analyzer::init_unprivileged()
 
     // init filters hash tables that depend on alerts
     sfthreshold_alloc(sc->threshold_config->memcap, sc->threshold_config->memcap);
-    SFRF_Alloc(sc->rate_filter_config->memcap);
+
+    if ( !sc->rate_filter_config->shared )
+        SFRF_Alloc(sc->rate_filter_config->memcap);
 }
 
 void Analyzer::reinit(const SnortConfig* sc)
@@ -646,6 +649,7 @@ void Analyzer::term()
     EventTrace_Term();
     CleanupTag();
     FileService::thread_term();
+    InflatePool::thread_term();
     PacketTracer::thread_term();
     PacketManager::thread_term();
 
@@ -811,6 +815,12 @@ DAQ_RecvStatus Analyzer::process_messages()
     // This conveniently handles servicing offloads in the no messages received case as well.
     DetectionEngine::onload();
 
+    {
+        unsigned num_pending;
+        const DAQ_Msg_h* pending = daq_instance->get_pending_messages(num_pending);
+        Stream::prefetch_flows(pending, num_pending, daq_instance->get_base_protocol());
+    }
+
     unsigned num_recv = 0;
     DAQ_Msg_h msg;
     while ((msg = daq_instance->next_message()) != nullptr)
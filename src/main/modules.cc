@@ -41,6 +41,7 @@
 #include "host_tracker/host_cache_module.h"
 #include "latency/latency_module.h"
 #include "log/messages.h"
+#include "log/text_log.h"
 #include "managers/module_manager.h"
 #include "managers/plugin_manager.h"
 #include "memory/memory_module.h"
@@ -190,6 +191,9 @@ static const Parameter search_engine_params[] =
     { "split_any_any", Parameter::PT_BOOL, nullptr, "true",
       "evaluate any-any rules separately to save memory" },
 
+    { "stream_search", Parameter::PT_BOOL, nullptr, "false",
+      "continue packet fast pattern searches across reassembled TCP PDUs if supported by the search method" },
+
     { "queue_limit", Parameter::PT_INT, "0:max32", "0",
       "maximum number of fast pattern matches to queue per packet (0 is unlimited)" },
 
@@ -303,6 +307,9 @@ bool SearchEngineModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("split_any_any") )
         fp->set_split_any_any(v.get_bool());
 
+    else if ( v.is("stream_search") )
+        fp->set_stream_search(v.get_bool());
+
     else if ( v.is("queue_limit") )
         fp->set_queue_limit(v.get_uint32());
 
@@ -620,6 +627,9 @@ static const Parameter alerts_params[] =
     { "detection_filter_memcap", Parameter::PT_INT, "0:max32", "1048576",
       "set available MB of memory for detection_filters" },
 
+    { "detection_filter_shared", Parameter::PT_BOOL, nullptr, "false",
+      "count detection_filter hits across all packet threads in one memcap sized table" },
+
     { "event_filter_memcap", Parameter::PT_INT, "0:max32", "1048576",
       "set available MB of memory for event_filters" },
 
@@ -632,6 +642,9 @@ static const Parameter alerts_params[] =
     { "rate_filter_memcap", Parameter::PT_INT, "0:max32", "1048576",
       "set available MB of memory for rate_filters" },
 
+    { "rate_filter_shared", Parameter::PT_BOOL, nullptr, "false",
+      "enforce rate_filter limits across all packet threads in one memcap sized table" },
+
     { "reference_net", Parameter::PT_STRING, nullptr, nullptr,
       "set the CIDR for homenet "
       "(for use with -l or -B, does NOT change $HOME_NET in IDS mode)" },
@@ -666,6 +679,9 @@ bool AlertsModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("detection_filter_memcap") )
         sc->detection_filter_config->memcap = v.get_uint32();
 
+    else if ( v.is("detection_filter_shared") )
+        sc->detection_filter_config->shared = v.get_bool();
+
     else if ( v.is("event_filter_memcap") )
         sc->threshold_config->memcap = v.get_uint32();
 
@@ -678,6 +694,9 @@ bool AlertsModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("rate_filter_memcap") )
         sc->rate_filter_config->memcap = v.get_uint32();
 
+    else if ( v.is("rate_filter_shared") )
+        sc->rate_filter_config->shared = v.get_bool();
+
     else if ( v.is("reference_net") )
         return ( sc->homenet.set(v.get_string()) == SFIP_SUCCESS );
 
@@ -725,6 +744,9 @@ static const Parameter output_params[] =
     { "logdir", Parameter::PT_STRING, nullptr, ".",
       "where to put log files (same as -l)" },
 
+    { "log_queue", Parameter::PT_INT, "0:65535", "0",
+      "formatted buffers per alert log queued for a writer thread; 0 writes on the packet thread" },
+
     { "show_year", Parameter::PT_BOOL, nullptr, "false",
       "include year in timestamp in the alert and log files (same as -y)" },
 
@@ -747,6 +769,14 @@ static const Parameter output_params[] =
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
+static const PegInfo output_pegs[] =
+{
+    { CountType::SUM, "queued_buffers", "log buffers queued for the writer thread" },
+    { CountType::SUM, "dropped_buffers", "log buffers dropped because the queue was full" },
+    { CountType::SUM, "dropped_bytes", "log bytes dropped because the queue was full" },
+    { CountType::END, nullptr, nullptr }
+};
+
 #define output_help \
     "configure general output parameters"
 
@@ -756,6 +786,12 @@ public:
     OutputModule() : Module("output", output_help, output_params) { }
     bool set(const char*, Value&, SnortConfig*) override;
 
+    const PegInfo* get_pegs() const override
+    { return output_pegs; }
+
+    PegCount* get_counts() const override
+    { return (PegCount*)&text_log_counts; }
+
     Usage get_usage() const override
     { return GLOBAL; }
 };
@@ -780,6 +816,9 @@ bool OutputModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("logdir") )
         sc->log_dir = v.get_string();
 
+    else if ( v.is("log_queue") )
+        sc->log_queue = v.get_uint32();
+
     else if ( v.is("max_data") )
         sc->event_trace_max = v.get_uint16();
 
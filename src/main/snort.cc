@@ -32,6 +32,7 @@
 #include "connectors/connectors.h"
 #include "detection/fp_config.h"
 #include "file_api/file_service.h"
+#include "filters/detection_filter.h"
 #include "filters/rate_filter.h"
 #include "filters/sfrf.h"
 #include "filters/sfthreshold.h"
@@ -215,6 +216,10 @@ void Snort::init(int argc, char** argv)
     /* Need to do this after dynamic detection stuff is initialized, too */
     IpsManager::global_init(sc);
 
+    // shared filter counts are used by all packet threads
+    RateFilter_SharedInit(sc->rate_filter_config);
+    detection_filter_shared_init(sc->detection_filter_config);
+
     sc->post_setup();
 
     const MpseApi* search_api = sc->fast_pattern_config->get_search_api();
@@ -327,6 +332,9 @@ void Snort::term()
     IpsManager::global_term(sc);
     HostAttributesManager::term();
 
+    RateFilter_SharedTerm();
+    detection_filter_shared_term();
+
 #ifdef PIGLET
     if ( !Piglet::piglet_mode() )
 #endif
@@ -506,6 +506,12 @@ bool SnortConfig::verify() const
     else if (sc->detection_filter_config->memcap != detection_filter_config->memcap)
         ReloadError("Changing alerts.detection_filter_memcap requires a restart.\n");
 
+    else if (sc->rate_filter_config->shared != rate_filter_config->shared)
+        ReloadError("Changing alerts.rate_filter_shared requires a restart.\n");
+
+    else if (sc->detection_filter_config->shared != detection_filter_config->shared)
+        ReloadError("Changing alerts.detection_filter_shared requires a restart.\n");
+
     else
         config_ok = true;
 
@@ -230,6 +230,7 @@ public:
     uint32_t output_flags = 0;
 #endif
     uint32_t tagged_packet_limit = 256;
+    uint32_t log_queue = 0;
     uint16_t event_trace_max = 0;
 
     std::string log_dir;
@@ -257,6 +258,7 @@ public:
 #ifdef HAVE_HYPERSCAN
     bool hyperscan_literals = false;
     bool pcre_to_regex = false;
+    std::string hyperscan_cache;
 #endif
 
     bool global_rule_state = false;
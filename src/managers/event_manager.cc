@@ -216,6 +216,16 @@ void EventManager::instantiate(
         instantiate(p, mod, sc);
 }
 
+bool EventManager::logs_xtra_data()
+{
+    for ( auto p : s_loggers.outputs )
+    {
+        if ( p->get_api()->flags & OUTPUT_TYPE_FLAG__XTRA )
+            return true;
+    }
+    return false;
+}
+
 //-------------------------------------------------------------------------
 // execution
 
@@ -30,6 +30,7 @@
 #define OUTPUT_TYPE_FLAG__NONE  0x0
 #define OUTPUT_TYPE_FLAG__ALERT 0x1
 #define OUTPUT_TYPE_FLAG__LOG   0x2
+#define OUTPUT_TYPE_FLAG__XTRA  0x4  // logs inspector extra data
 
 namespace snort
 {
@@ -81,6 +82,9 @@ public:
     static void call_alerters(OutputSet*, snort::Packet*, const char* message, const Event&);
     static void call_loggers(OutputSet*, snort::Packet*, const char* message, Event*);
 
+    // true if an instantiated logger writes the inspectors' extra data
+    SO_PUBLIC static bool logs_xtra_data();
+
     static void enable_alerts(bool b) { alert_enabled = b; }
     static void enable_logs(bool b) { log_enabled = b; }
 
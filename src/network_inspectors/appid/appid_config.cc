@@ -176,6 +176,7 @@ void OdpContext::initialize()
     sip_matchers.finalize_patterns(*this);
     ssl_matchers.finalize_patterns();
     dns_matchers.finalize_patterns();
+    host_port_cache.finalize();
 }
 
 void OdpContext::reload()
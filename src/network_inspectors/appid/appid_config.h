@@ -199,6 +199,11 @@ public:
         return AF_indicators;
     }
 
+    LuaDetectorImage& get_lua_detector_image()
+    {
+        return lua_detector_image;
+    }
+
     void add_port_service_id(IpProtocol, uint16_t, AppId);
     void add_protocol_service_id(IpProtocol, AppId);
     AppId get_port_service_id(IpProtocol, uint16_t);
@@ -218,6 +223,7 @@ private:
     PatternClientDetector* client_pattern_detector;
     PatternServiceDetector* service_pattern_detector;
     std::unordered_map<AppId, AFElement> AF_indicators;     // list of "indicator apps"
+    LuaDetectorImage lua_detector_image;
 
     std::array<AppId, APP_ID_PORT_ARRAY_SIZE> tcp_port_only = {}; // port-only TCP services
     std::array<AppId, APP_ID_PORT_ARRAY_SIZE> udp_port_only = {}; // port-only UDP services
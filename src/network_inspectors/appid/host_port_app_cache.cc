@@ -23,17 +23,93 @@
 #include "config.h"
 #endif
 
-#include <map>
-
 #include "host_port_app_cache.h"
+
+#include <cassert>
+
 #include "log/messages.h"
 #include "main/thread.h"
 #include "managers/inspector_manager.h"
 #include "appid_config.h"
 #include "appid_inspector.h"
 
+#ifdef UNIT_TEST
+#include <map>
+#include <random>
+
+#include "catch/snort_catch.h"
+#endif
+
 using namespace snort;
 
+static inline size_t hash_key(const HostPortKey& hk)
+{
+    const uint8_t* p = (const uint8_t*)&hk;
+    uint64_t h = 0x9E3779B97F4A7C15ull;
+    size_t i = 0;
+
+    for ( ; i + 8 <= sizeof(hk); i += 8 )
+    {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+
+    if ( i < sizeof(hk) )
+    {
+        uint64_t w = 0;
+        memcpy(&w, p + i, sizeof(hk) - i);
+        h = (h ^ w) * 0xC4CEB9FE1A85EC53ull;
+    }
+    return h ^ (h >> 29);
+}
+
+static inline bool same_key(const HostPortKey& a, const HostPortKey& b)
+{ return !memcmp(&a, &b, sizeof(a)); }
+
+void HostPortCache::Table::insert(const HostPortKey& hk, const HostPortVal& hv)
+{
+    for ( size_t i = hash_key(hk) & mask; ; i = (i + 1) & mask )
+    {
+        Slot& s = slots[i];
+
+        if ( !s.used )
+        {
+            s.key = hk;
+            s.val = hv;
+            s.used = true;
+            ++count;
+            return;
+        }
+        if ( same_key(s.key, hk) )
+        {
+            s.val = hv;
+            return;
+        }
+    }
+}
+
+HostPortVal* HostPortCache::find(const HostPortKey& hk)
+{
+    Table* t = table.load(std::memory_order_acquire);
+
+    if ( !t )
+        return nullptr;
+
+    // the table is at most half full so there is always an empty slot
+    for ( size_t i = hash_key(hk) & t->mask; ; i = (i + 1) & t->mask )
+    {
+        Slot& s = t->slots[i];
+
+        if ( !s.used )
+            return nullptr;
+
+        if ( same_key(s.key, hk) )
+            return &s.val;
+    }
+}
+
 HostPortVal* HostPortCache::find(const SfIp* ip, uint16_t port, IpProtocol protocol,
     const OdpContext& odp_ctxt)
 {
@@ -43,12 +119,7 @@ HostPortVal* HostPortCache::find(const SfIp* ip, uint16_t port, IpProtocol proto
     hk.port = (odp_ctxt.allow_port_wildcard_host_cache)? 0 : port;
     hk.proto = protocol;
 
-    std::map<HostPortKey, HostPortVal>::iterator it;
-    it = cache.find(hk);
-    if (it != cache.end())
-        return &it->second;
-    else
-        return nullptr;
+    return find(hk);
 }
 
 bool HostPortCache::add(const SfIp* ip, uint16_t port, IpProtocol proto, unsigned type, AppId
@@ -67,23 +138,210 @@ bool HostPortCache::add(const SfIp* ip, uint16_t port, IpProtocol proto, unsigne
     hv.appId = appId;
     hv.type = type;
 
-    cache[ hk ] = hv;
+    add(hk, hv);
 
     return true;
 }
 
+void HostPortCache::add(const HostPortKey& hk, const HostPortVal& hv)
+{
+    staged.emplace_back(hk, hv);
+}
+
+void HostPortCache::finalize()
+{
+    if ( staged.empty() )
+        return;
+
+    Table* old = table.load(std::memory_order_relaxed);
+    size_t n = (old ? old->count : 0) + staged.size();
+    size_t cap = 16;
+
+    while ( cap < 2 * n )
+        cap <<= 1;
+
+    Table* t = new Table(cap);
+
+    if ( old )
+    {
+        for ( const auto& s : old->slots )
+        {
+            if ( s.used )
+                t->insert(s.key, s.val);
+        }
+    }
+
+    // later adds of the same key replace earlier ones
+    for ( const auto& e : staged )
+        t->insert(e.first, e.second);
+
+    staged.clear();
+    staged.shrink_to_fit();
+
+    table.store(t, std::memory_order_release);
+
+    if ( old )
+        retired.emplace_back(old);
+}
+
+size_t HostPortCache::size() const
+{
+    const Table* t = table.load(std::memory_order_acquire);
+    return t ? t->count : 0;
+}
+
+static void dump_entry(const HostPortKey& hk, const HostPortVal& hv)
+{
+    char inet_buffer[INET6_ADDRSTRLEN];
+
+    inet_ntop(AF_INET6, &hk.ip, inet_buffer, sizeof(inet_buffer));
+    LogMessage("\tip=%s, \tport %d, \tip_proto %u, \ttype=%u, \tappId=%d\n",
+        inet_buffer, hk.port, (unsigned)hk.proto, hv.type, hv.appId);
+}
+
 void HostPortCache::dump()
 {
-    for ( auto& kv : cache )
+    if ( const Table* t = table.load(std::memory_order_acquire) )
+    {
+        for ( const auto& s : t->slots )
+        {
+            if ( s.used )
+                dump_entry(s.key, s.val);
+        }
+    }
+
+    for ( const auto& e : staged )
+        dump_entry(e.first, e.second);
+}
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+static HostPortKey make_key(uint32_t addr, uint16_t port, IpProtocol proto)
+{
+    HostPortKey hk;
+    addr = htonl(addr);
+    hk.ip.set(&addr, AF_INET);
+    hk.port = port;
+    hk.proto = proto;
+    return hk;
+}
+
+TEST_CASE("host port cache", "[appid]")
+{
+    HostPortCache hpc;
+    HostPortKey k1 = make_key(0x0a000001, 80, IpProtocol::TCP);
+    HostPortKey k2 = make_key(0x0a000001, 80, IpProtocol::UDP);
+    HostPortKey k3 = make_key(0x0a000002, 443, IpProtocol::TCP);
+
+    CHECK(!hpc.find(k1));
+
+    hpc.add(k1, { 1, 2 });
+    hpc.add(k2, { 3, 4 });
+
+    // nothing is visible until published
+    CHECK(!hpc.find(k1));
+    CHECK(hpc.size() == 0);
+
+    hpc.finalize();
+    CHECK(hpc.size() == 2);
+
+    HostPortVal* hv = hpc.find(k1);
+    REQUIRE(hv);
+    CHECK(hv->appId == 1);
+    CHECK(hv->type == 2);
+
+    hv = hpc.find(k2);
+    REQUIRE(hv);
+    CHECK(hv->appId == 3);
+    CHECK(!hpc.find(k3));
+
+    SECTION("republish")
+    {
+        hpc.add(k1, { 5, 6 });
+        hpc.add(k3, { 7, 8 });
+        hpc.finalize();
+        CHECK(hpc.size() == 3);
+
+        hv = hpc.find(k1);
+        REQUIRE(hv);
+        CHECK(hv->appId == 5);
+
+        hv = hpc.find(k2);
+        REQUIRE(hv);
+        CHECK(hv->appId == 3);
+
+        hv = hpc.find(k3);
+        REQUIRE(hv);
+        CHECK(hv->appId == 7);
+    }
+    SECTION("grow")
+    {
+        for ( uint32_t i = 0; i < 1000; ++i )
+            hpc.add(make_key(0xc0a80000 + i, 8080, IpProtocol::TCP), { (AppId)i, 0 });
+
+        hpc.finalize();
+        CHECK(hpc.size() == 1002);
+
+        for ( uint32_t i = 0; i < 1000; ++i )
+        {
+            hv = hpc.find(make_key(0xc0a80000 + i, 8080, IpProtocol::TCP));
+            REQUIRE(hv);
+            CHECK(hv->appId == (AppId)i);
+        }
+        CHECK(!hpc.find(make_key(0xc0a80000 + 1000, 8080, IpProtocol::TCP)));
+    }
+}
+
+#ifdef BENCHMARK_TEST
+
+TEST_CASE("host port cache lookups", "[appid]")
+{
+    const unsigned num_entries = 100000;
+    const unsigned num_lookups = 4096;
+
+    std::mt19937 gen(7);
+    std::vector<HostPortKey> keys;
+    std::map<HostPortKey, HostPortVal> map;
+    HostPortCache hpc;
+
+    for ( unsigned i = 0; i < num_entries; ++i )
     {
-        char inet_buffer[INET6_ADDRSTRLEN];
+        uint32_t r = gen();
+        HostPortKey hk = make_key(r, r >> 16, (r & 1) ? IpProtocol::TCP : IpProtocol::UDP);
+        HostPortVal hv = { (AppId)i, 0 };
 
-        HostPortKey hk = kv.first;
-        HostPortVal hv = kv.second;
+        map[hk] = hv;
+        hpc.add(hk, hv);
 
-        inet_ntop(AF_INET6, &hk.ip, inet_buffer, sizeof(inet_buffer));
-        LogMessage("\tip=%s, \tport %d, \tip_proto %u, \ttype=%u, \tappId=%d\n",
-            inet_buffer, hk.port, (unsigned)hk.proto, hv.type, hv.appId);
+        if ( i % (num_entries / num_lookups) == 0 )
+            keys.emplace_back(hk);
     }
+    hpc.finalize();
+
+    // half hits, half misses
+    for ( unsigned i = 0, n = keys.size(); i < n; ++i )
+        keys.emplace_back(make_key(gen(), i, IpProtocol::TCP));
+
+    BENCHMARK("map host port lookups")
+    {
+        int n = 0;
+        for ( const auto& hk : keys )
+            n += (map.find(hk) != map.end());
+        return n;
+    };
+
+    BENCHMARK("hash host port lookups")
+    {
+        int n = 0;
+        for ( const auto& hk : keys )
+            n += (hpc.find(hk) != nullptr);
+        return n;
+    };
 }
 
+#endif
+#endif
@@ -22,7 +22,10 @@
 #ifndef HOST_PORT_APP_CACHE_H
 #define HOST_PORT_APP_CACHE_H
 
+#include <atomic>
 #include <cstring>
+#include <utility>
+#include <vector>
 
 #include "application_ids.h"
 #include "protocols/protocol_ids.h"
@@ -60,20 +63,60 @@ struct HostPortVal
     unsigned type;
 };
 
+// HostPortCache is an open addressing hash table that is read without
+// locks.  Entries are staged by add() and published by finalize(), which
+// copies the current table and the staged entries into a new table and
+// swaps it in (read-copy-update).  Replaced tables are kept until the
+// cache is deleted with its OdpContext, when there are no more readers.
+// Entries are only added by the control thread while building an
+// OdpContext, so there is normally just one finalize.
+
 class HostPortCache
 {
 public:
-    HostPortVal* find(const snort::SfIp*, uint16_t port, IpProtocol, const OdpContext&);
-    bool add(const snort::SfIp*, uint16_t port, IpProtocol, unsigned type, AppId);
-    void dump();
+    HostPortCache() = default;
 
     ~HostPortCache()
     {
-        cache.clear();
+        for ( auto* t : retired )
+            delete t;
+
+        delete table.load();
     }
 
+    HostPortVal* find(const snort::SfIp*, uint16_t port, IpProtocol, const OdpContext&);
+    HostPortVal* find(const HostPortKey&);
+
+    bool add(const snort::SfIp*, uint16_t port, IpProtocol, unsigned type, AppId);
+    void add(const HostPortKey&, const HostPortVal&);
+
+    void finalize();
+    void dump();
+
+    size_t size() const;
+
 private:
-    std::map<HostPortKey, HostPortVal> cache;
+    struct Slot
+    {
+        HostPortKey key;
+        HostPortVal val;
+        bool used = false;
+    };
+
+    struct Table
+    {
+        Table(size_t n) : mask(n - 1), slots(n) { }
+
+        void insert(const HostPortKey&, const HostPortVal&);
+
+        size_t mask;
+        size_t count = 0;
+        std::vector<Slot> slots;
+    };
+
+    std::atomic<Table*> table { nullptr };
+    std::vector<Table*> retired;
+    std::vector<std::pair<HostPortKey, HostPortVal>> staged;
 };
 
 #endif
@@ -27,9 +27,11 @@
 
 #include <glob.h>
 #include <libgen.h>
+#include <sys/stat.h>
 
 #include <cassert>
 #include <fstream>
+#include <functional>
 
 #include "appid_config.h"
 #include "appid_inspector.h"
@@ -40,6 +42,13 @@
 #include "utils/sflsq.h"
 #include "log/messages.h"
 
+#ifdef UNIT_TEST
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "catch/snort_catch.h"
+#endif
+
 using namespace snort;
 using namespace std;
 
@@ -396,8 +405,83 @@ LuaObject* LuaDetectorManager::create_lua_detector(const char* detector_name,
     return nullptr;
 }
 
+static int dump_chunk(lua_State*, const void* p, size_t sz, void* ud)
+{
+    string* s = static_cast<string*>(ud);
+    s->append(static_cast<const char*>(p), sz);
+    return 0;
+}
+
+// returns false if the file can't be found
+static bool get_file_stamp(const char* file, uint64_t& size, int64_t& mtime)
+{
+    struct stat st;
+
+    if ( stat(file, &st) )
+        return false;
+
+    size = st.st_size;
+    mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+// saves the main chunk on top of the stack; the file is stamped before
+// it is compiled so any later change makes the chunk stale
+static bool save_detector_chunk(lua_State* L, LuaDetectorChunk& chunk)
+{
+    chunk.code.clear();
+
+    if ( lua_dump(L, dump_chunk, &chunk.code) )
+        return false;
+
+    chunk.code_hash = std::hash<string>()(chunk.code);
+    return true;
+}
+
+// pushes the main chunk from the image unless the file changed since it was
+// compiled or the code is damaged.  a missing file doesn't make it stale.
+static bool load_detector_chunk(lua_State* L, const LuaDetectorChunk& chunk)
+{
+    uint64_t size;
+    int64_t mtime;
+
+    if ( (!get_file_stamp(chunk.file.c_str(), size, mtime)
+        or (size == chunk.file_size and mtime == chunk.file_mtime))
+        and std::hash<string>()(chunk.code) == chunk.code_hash )
+    {
+        if ( !luaL_loadbuffer(L, chunk.code.data(), chunk.code.size(), chunk.file.c_str()) )
+            return true;
+
+        lua_pop(L, 1);
+    }
+    return !luaL_loadfile(L, chunk.file.c_str());
+}
+
+// runs the detector's main chunk, which must be on top of the stack, in its
+// own environment stored in the registry under the detector name
+static bool run_detector_chunk(lua_State* L, const char* detectorName)
+{
+    // create a new function environment and store it in the registry
+    lua_newtable(L); // create _ENV tables
+    lua_newtable(L); // create metatable
+    lua_getglobal(L, "_G"); // push the value of the global name
+    lua_setfield(L, -2, "__index"); // pop and get the global table
+    lua_setmetatable(L, -2); // pop and set global as the metatable
+    lua_pushvalue(L, -1); // push a copy of the element on the top
+    lua_setfield(L, LUA_REGISTRYINDEX, detectorName); // push to registry with unique name
+
+    // set the environment for the loaded script and execute it
+    lua_setfenv(L, -2);
+    return !lua_pcall(L, 0, 0, 0);
+}
+
 void LuaDetectorManager::load_detector(char* detector_filename, bool isCustom)
 {
+    LuaDetectorChunk chunk;
+
+    if (init(L))
+        get_file_stamp(detector_filename, chunk.file_size, chunk.file_mtime);
+
     if (luaL_loadfile(L, detector_filename))
     {
         if (init(L))
@@ -415,18 +499,26 @@ void LuaDetectorManager::load_detector(char* detector_filename, bool isCustom)
         (isCustom ? "custom" : "odp"), basename(detector_filename));
 #endif
 
-    // create a new function environment and store it in the registry
-    lua_newtable(L); // create _ENV tables
-    lua_newtable(L); // create metatable
-    lua_getglobal(L, "_G"); // push the value of the global name
-    lua_setfield(L, -2, "__index"); // pop and get the global table
-    lua_setmetatable(L, -2); // pop and set global as the metatable
-    lua_pushvalue(L, -1); // push a copy of the element on the top
-    lua_setfield(L, LUA_REGISTRYINDEX, detectorName); // push to registry with unique name
+    if (init(L))
+    {
+        chunk.name = detectorName;
+        chunk.file = detector_filename;
+        chunk.is_custom = isCustom;
+
+        if (!save_detector_chunk(L, chunk))
+            ErrorMessage("Error - appid: can not save Lua detector %s\n", detector_filename);
+        else
+            ctxt.get_odp_ctxt().get_lua_detector_image().emplace_back(std::move(chunk));
+    }
 
-    // set the environment for the loaded script and execute it
-    lua_setfenv(L, -2);
-    if (lua_pcall(L, 0, 0, 0))
+    run_detector(detectorName, detector_filename, isCustom);
+}
+
+// runs the detector's main chunk, which must be on top of the stack
+void LuaDetectorManager::run_detector(
+    const char* detectorName, const char* detector_filename, bool isCustom)
+{
+    if (!run_detector_chunk(L, detectorName))
     {
         ErrorMessage("Error - appid: can not set env of Lua detector %s : %s\n",
             detector_filename, lua_tostring(L, -1));
@@ -461,6 +553,24 @@ void LuaDetectorManager::load_lua_detectors(const char* path, bool isCustom)
             pattern, rval);
 }
 
+void LuaDetectorManager::load_lua_detectors(const LuaDetectorImage& image, bool isCustom)
+{
+    for (const auto& chunk : image)
+    {
+        if (chunk.is_custom != isCustom)
+            continue;
+
+        if (!load_detector_chunk(L, chunk))
+        {
+            ErrorMessage("Error - appid: can not load Lua detector %s, %s\n",
+                chunk.file.c_str(), lua_tostring(L, -1));
+            lua_pop(L, 1);
+            continue;
+        }
+        run_detector(chunk.name.c_str(), chunk.file.c_str(), isCustom);
+    }
+}
+
 void LuaDetectorManager::initialize_lua_detectors()
 {
     char path[PATH_MAX];
@@ -469,6 +579,19 @@ void LuaDetectorManager::initialize_lua_detectors()
     if ( !dir )
         return;
 
+    LuaDetectorImage& image = ctxt.get_odp_ctxt().get_lua_detector_image();
+
+    if ( !init(L) )
+    {
+        load_lua_detectors(image, false);
+        num_odp_detectors = allocated_objects.size();
+        load_lua_detectors(image, true);
+        return;
+    }
+
+    // rebuilt from the files by the control thread
+    image.clear();
+
     snprintf(path, sizeof(path), "%s/odp/lua", dir);
     load_lua_detectors(path, false);
     num_odp_detectors = allocated_objects.size();
@@ -531,3 +654,115 @@ void LuaDetectorManager::list_lua_detectors()
         (allocated_objects.size() - num_odp_detectors), lua_gc(L, LUA_GCCOUNT, 0));
 }
 
+
+#ifdef UNIT_TEST
+static const char* test_detector =
+    "DetectorPackageInfo = {\n"
+    "    name = 'test_client',\n"
+    "    proto = 6,\n"
+    "    client = { init = 'DetectorInit', clean = 'DetectorClean' },\n"
+    "}\n"
+    "function DetectorInit(detector) return 0 end\n";
+
+// the DetectorPackageInfo fields create_lua_detector() validates
+static string get_test_detector_info(lua_State* L, const char* detector_name)
+{
+    Lua::ManageStack mgr(L);
+    string log_name;
+    int proto;
+
+    lua_getfield(L, LUA_REGISTRYINDEX, detector_name);
+    lua_getfield(L, -1, "DetectorPackageInfo");
+
+    if ( !lua_istable(L, -1) or !get_lua_field(L, -1, "name", log_name)
+        or !get_lua_field(L, -1, "proto", proto) )
+        return "invalid";
+
+    lua_getfield(L, -1, "client");
+    const char* type = lua_istable(L, -1) ? "client" : "";
+    lua_pop(L, 1);
+
+    lua_getfield(L, -1, "server");
+    if ( lua_istable(L, -1) )
+        type = "server";
+
+    return log_name + " " + to_string(proto) + " " + type;
+}
+
+static string load_test_detector(const LuaDetectorChunk& chunk)
+{
+    Lua::State lua;
+
+    if ( !load_detector_chunk(lua, chunk) or !run_detector_chunk(lua, chunk.name.c_str()) )
+        return "not loaded";
+
+    return get_test_detector_info(lua, chunk.name.c_str());
+}
+
+TEST_CASE("lua detector image", "[appid]")
+{
+    char dir[] = "/tmp/lua_detector_XXXXXX";
+    REQUIRE(mkdtemp(dir));
+
+    string file = string(dir) + "/test_client.lua";
+    std::ofstream(file) << test_detector;
+
+    // build the image the way the control thread does
+    LuaDetectorChunk chunk;
+    chunk.name = "odp_test_client.lua";
+    chunk.file = file;
+    REQUIRE(get_file_stamp(file.c_str(), chunk.file_size, chunk.file_mtime));
+
+    string source_info;
+    {
+        Lua::State lua;
+        REQUIRE(!luaL_loadfile(lua, file.c_str()));
+        REQUIRE(save_detector_chunk(lua, chunk));
+        REQUIRE(run_detector_chunk(lua, chunk.name.c_str()));
+        source_info = get_test_detector_info(lua, chunk.name.c_str());
+    }
+    CHECK(source_info == "test_client 6 client");
+    CHECK(!chunk.code.empty());
+
+    SECTION("from image")
+    {
+        CHECK(load_test_detector(chunk) == source_info);
+
+        // the source isn't needed
+        unlink(file.c_str());
+        CHECK(load_test_detector(chunk) == source_info);
+    }
+    SECTION("stale image")
+    {
+        std::ofstream(file) << "DetectorPackageInfo = { name = 'changed', proto = 17, "
+            "server = { init = 'DetectorInit' } }\n";
+        CHECK(load_test_detector(chunk) == "changed 17 server");
+    }
+    SECTION("same size edit")
+    {
+        // only the modification time shows the file was rewritten
+        string edited = test_detector;
+        edited.replace(edited.find("test_client"), 11, "othr_client");
+        std::ofstream(file) << edited;
+
+        struct timespec times[2] = { { 0, UTIME_OMIT }, { 12345, 0 } };
+        REQUIRE(!utimensat(AT_FDCWD, file.c_str(), times, 0));
+        CHECK(load_test_detector(chunk) == "othr_client 6 client");
+    }
+    SECTION("corrupt image")
+    {
+        chunk.code[chunk.code.size() / 2] ^= 0x5a;
+        CHECK(load_test_detector(chunk) == source_info);
+
+        unlink(file.c_str());
+        CHECK(load_test_detector(chunk) == "not loaded");
+    }
+    SECTION("truncated image")
+    {
+        chunk.code.resize(chunk.code.size() / 2);
+        CHECK(load_test_detector(chunk) == source_info);
+    }
+    unlink(file.c_str());
+    rmdir(dir);
+}
+#endif
@@ -26,6 +26,7 @@
 #include <list>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <lua.hpp>
 #include <lua/lua.h>
@@ -41,6 +42,23 @@ class AppIdDetector;
 struct DetectorFlow;
 class LuaObject;
 
+// the control thread compiles each detector file once and saves the
+// bytecode in the odp context so the packet thread states are loaded from
+// memory instead of reading and parsing every file again.  a chunk whose
+// file changed or whose code is damaged is compiled from the file instead.
+struct LuaDetectorChunk
+{
+    std::string name;   // registry name
+    std::string file;
+    std::string code;   // lua_dump of the file's main chunk
+    size_t code_hash = 0;
+    uint64_t file_size = 0;  // when the file was compiled
+    int64_t file_mtime = 0;
+    bool is_custom = false;
+};
+
+typedef std::vector<LuaDetectorChunk> LuaDetectorImage;
+
 bool get_lua_field(lua_State* L, int table, const char* field, std::string& out);
 bool get_lua_field(lua_State* L, int table, const char* field, int& out);
 bool get_lua_field(lua_State* L, int table, const char* field, IpProtocol& out);
@@ -74,6 +92,8 @@ private:
     void list_lua_detectors();
     void load_detector(char* detectorName, bool isCustom);
     void load_lua_detectors(const char* path, bool isCustom);
+    void load_lua_detectors(const LuaDetectorImage&, bool isCustom);
+    void run_detector(const char* detector_name, const char* detector_filename, bool isCustom);
     LuaObject* create_lua_detector(const char* detector_name, bool is_custom,
         const char* detector_filename);
 
@@ -53,6 +53,7 @@ static const PegInfo bind_pegs[] =
     { CountType::SUM, "blocks", "block actions bound" },
     { CountType::SUM, "allows", "allow actions bound" },
     { CountType::SUM, "inspects", "inspect actions bound" },
+    { CountType::SUM, "checked_bindings", "candidate bindings checked after index lookup" },
     { CountType::END, nullptr, nullptr }
 };
 
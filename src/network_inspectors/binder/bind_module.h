@@ -37,6 +37,7 @@ struct BindStats
     PegCount new_standby_flows;
     PegCount no_match;
     PegCount verdicts[BindUse::BA_MAX];
+    PegCount checked_bindings;
 };
 
 extern THREAD_LOCAL BindStats bstats;
@@ -33,6 +33,7 @@
 
 #include "bind_module.h"
 #include "binding.h"
+#include "binding_index.h"
 
 using namespace snort;
 using namespace std;
@@ -484,6 +485,8 @@ private:
 private:
     vector<Binding> bindings;
     vector<Binding> policy_bindings;
+    BindingIndex index;
+    BindingIndex policy_index;
     Inspector* default_ssn_inspectors[to_utype(PktType::MAX)]{};
 };
 
@@ -565,6 +568,10 @@ bool Binder::configure(SnortConfig* sc)
     for (Binding& b : policy_bindings)
         b.configure(sc);
 
+    // Policy ids are resolved by configure so index after
+    index.build(bindings);
+    policy_index.build(policy_bindings);
+
     // Grab default session inspectors if they exist for this policy
     for (int proto = to_utype(PktType::NONE); proto < to_utype(PktType::MAX); proto++)
     {
@@ -631,6 +638,7 @@ void Binder::remove_inspector_binding(SnortConfig*, const char* name)
         if (!strcmp(key, name))
         {
             bindings.erase(it);
+            index.build(bindings);
             return;
         }
     }
@@ -736,12 +744,19 @@ void Binder::get_policy_bindings(Flow& flow, const char* service)
     // FIXIT-L This will select the first policy ID of each type that it finds and ignore the rest.
     //          It gets potentially hairy if people start specifying overlapping policy types in
     //          overlapping rules.
-    for (const Binding& b : policy_bindings)
+    BindingIndex::Cursor cursor;
+    policy_index.select(flow, service, cursor);
+
+    for (int i = cursor.next(); i >= 0; i = cursor.next())
     {
+        const Binding& b = policy_bindings[i];
+
         // Skip any rules that don't contain an ID for a policy type we haven't set yet.
         if ((!b.use.inspection_index || inspection_index) && (!b.use.ips_index || ips_index))
             continue;
 
+        bstats.checked_bindings++;
+
         if (!b.check_all(flow, service))
             continue;
 
@@ -767,8 +782,8 @@ void Binder::get_policy_bindings(Flow& flow, const char* service)
     }
 }
 
-// FIXIT-P this is a simple linear search until functionality is nailed
-// down.  performance should be the focus of the next iteration.
+// only the bindings selected by the index are checked, in order, so the
+// first match is the same as a linear search
 void Binder::get_bindings(Flow& flow, Stuff& stuff, const char* service)
 {
     // Evaluate policy ID bindings first
@@ -788,8 +803,14 @@ void Binder::get_bindings(Flow& flow, Stuff& stuff, const char* service)
     // Initialize the session inspector for both client and server to the default for this policy.
     stuff.client = stuff.server = default_ssn_inspectors[to_utype(flow.pkt_type)];
 
-    for (const Binding& b : bindings)
+    BindingIndex::Cursor cursor;
+    index.select(flow, service, cursor);
+
+    for (int i = cursor.next(); i >= 0; i = cursor.next())
     {
+        const Binding& b = bindings[i];
+        bstats.checked_bindings++;
+
         if (!b.check_all(flow, service))
             continue;
 
@@ -0,0 +1,469 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "binding_index.h"
+
+#include <cassert>
+#include <map>
+
+#include "flow/flow.h"
+#include "flow/flow_key.h"
+
+#ifdef UNIT_TEST
+#include <random>
+
+#include "catch/snort_catch.h"
+#endif
+
+using namespace snort;
+
+// vlan tags are 12 bits; anything else only matches bindings w/o vlans
+static const unsigned max_vlans = 4096;
+
+static inline void set_bit(std::vector<uint64_t>& row, unsigned i)
+{ row[i / 64] |= (uint64_t)1 << (i % 64); }
+
+static uint16_t add_row(
+    std::vector<uint64_t>& rows, std::map<std::vector<uint64_t>, uint16_t>& ids,
+    const std::vector<uint64_t>& row)
+{
+    auto it = ids.find(row);
+
+    if ( it != ids.end() )
+        return it->second;
+
+    uint16_t id = ids.size();
+    assert(id == ids.size());
+
+    ids[row] = id;
+    rows.insert(rows.end(), row.begin(), row.end());
+    return id;
+}
+
+// each key gets the bindings w/o the criteria plus those that pass the test
+template<typename Restricted, typename Test>
+void BindingIndex::build_table(
+    Table& t, unsigned num_keys, const std::vector<Binding>& bv,
+    Restricted restricted, Test test)
+{
+    std::vector<uint64_t> all(words, 0);
+    std::vector<unsigned> limited;
+
+    for ( unsigned i = 0; i < bv.size(); ++i )
+    {
+        if ( restricted(bv[i]) )
+            limited.emplace_back(i);
+        else
+            set_bit(all, i);
+    }
+
+    std::map<std::vector<uint64_t>, uint16_t> ids;
+    std::vector<uint64_t> row, last;
+    uint16_t last_id = 0;
+
+    t.index.resize(num_keys);
+    t.rows.clear();
+
+    for ( unsigned k = 0; k < num_keys; ++k )
+    {
+        row = all;
+
+        for ( auto i : limited )
+        {
+            if ( test(bv[i], k) )
+                set_bit(row, i);
+        }
+
+        // adjacent keys (port ranges) usually share a row
+        if ( k and row == last )
+        {
+            t.index[k] = last_id;
+            continue;
+        }
+        last_id = t.index[k] = add_row(t.rows, ids, row);
+        last.swap(row);
+    }
+}
+
+// row 0 is for keys no binding names
+template<typename Key, typename Restricted, typename Keys>
+void BindingIndex::build_map(
+    Table& t, std::unordered_map<Key, uint16_t>& map, const std::vector<Binding>& bv,
+    Restricted restricted, Keys keys, bool with_unrestricted)
+{
+    std::vector<uint64_t> none(words, 0);
+    std::map<Key, std::vector<uint64_t>> key_rows;
+
+    for ( unsigned i = 0; i < bv.size(); ++i )
+    {
+        if ( !restricted(bv[i]) )
+        {
+            if ( with_unrestricted )
+                set_bit(none, i);
+            continue;
+        }
+        for ( const auto& k : keys(bv[i]) )
+            key_rows[k];
+    }
+
+    for ( auto& kr : key_rows )
+        kr.second = none;
+
+    for ( unsigned i = 0; i < bv.size(); ++i )
+    {
+        if ( restricted(bv[i]) )
+        {
+            for ( const auto& k : keys(bv[i]) )
+                set_bit(key_rows[k], i);
+        }
+    }
+
+    std::map<std::vector<uint64_t>, uint16_t> ids;
+
+    t.index.clear();
+    t.rows.clear();
+    map.clear();
+
+    add_row(t.rows, ids, none);
+
+    for ( auto& kr : key_rows )
+        map[kr.first] = add_row(t.rows, ids, kr.second);
+}
+
+void BindingIndex::build(const std::vector<Binding>& bv)
+{
+    words = (bv.size() + 63) / 64;
+
+    if ( !words )
+        return;
+
+    build_table(protos, to_utype(PktType::MAX), bv,
+        [](const Binding& b)
+        { return b.when.has_criteria(BindWhen::BWC_PROTO); },
+        [](const Binding& b, unsigned k)
+        { return !k or (b.when.protos & (1 << (k - 1))); });
+
+    build_table(vlans, max_vlans + 1, bv,
+        [](const Binding& b)
+        { return b.when.has_criteria(BindWhen::BWC_VLANS); },
+        [](const Binding& b, unsigned k)
+        { return k < max_vlans and b.when.vlans.test(k); });
+
+    // ports only restrict tcp and udp flows but others fail check_all
+    build_table(client_ports, 65536, bv,
+        [](const Binding& b)
+        {
+            return (b.when.has_criteria(BindWhen::BWC_PORTS) and b.when.role == BindWhen::BR_CLIENT)
+                or b.when.has_criteria(BindWhen::BWC_SPLIT_PORTS);
+        },
+        [](const Binding& b, unsigned k)
+        { return b.when.src_ports.test(k); });
+
+    build_table(server_ports, 65536, bv,
+        [](const Binding& b)
+        {
+            return (b.when.has_criteria(BindWhen::BWC_PORTS) and b.when.role == BindWhen::BR_SERVER)
+                or b.when.has_criteria(BindWhen::BWC_SPLIT_PORTS);
+        },
+        [](const Binding& b, unsigned k)
+        {
+            if ( b.when.has_criteria(BindWhen::BWC_PORTS) and b.when.role == BindWhen::BR_SERVER
+                and !b.when.src_ports.test(k) )
+                return false;
+
+            return !b.when.has_criteria(BindWhen::BWC_SPLIT_PORTS) or b.when.dst_ports.test(k);
+        });
+
+    build_table(either_ports, 65536, bv,
+        [](const Binding& b)
+        { return b.when.has_criteria(BindWhen::BWC_PORTS) and b.when.role == BindWhen::BR_EITHER; },
+        [](const Binding& b, unsigned k)
+        { return b.when.src_ports.test(k); });
+
+    build_map(ips_ids, ips_id_map, bv,
+        [](const Binding& b)
+        { return b.when.has_criteria(BindWhen::BWC_IPS_ID); },
+        [](const Binding& b)
+        { return std::vector<PolicyId>{ b.when.ips_id }; });
+
+    build_map(addr_spaces, addr_space_map, bv,
+        [](const Binding& b)
+        { return b.when.has_criteria(BindWhen::BWC_ADDR_SPACES); },
+        [](const Binding& b) -> const std::unordered_set<uint16_t>&
+        { return b.when.addr_spaces; });
+
+    auto svc_restricted = [](const Binding& b)
+    { return b.when.has_criteria(BindWhen::BWC_SVC); };
+
+    auto svc_keys = [](const Binding& b)
+    { return std::vector<std::string>{ b.when.svc }; };
+
+    build_map(flow_svcs, flow_svc_map, bv, svc_restricted, svc_keys);
+
+    // explicit service lookups require a service criteria
+    build_map(lookup_svcs, lookup_svc_map, bv, svc_restricted, svc_keys, false);
+}
+
+void BindingIndex::select(const Flow& flow, const char* service, Cursor& c) const
+{
+    c.words = words;
+    c.word = 0;
+    c.bits = 0;
+    c.num_rows = 0;
+
+    if ( !words )
+        return;
+
+    unsigned vlan = flow.key->vlan_tag < max_vlans ? flow.key->vlan_tag : max_vlans;
+
+    c.rows[c.num_rows++] = protos.get(to_utype(flow.pkt_type), words);
+    c.rows[c.num_rows++] = vlans.get(vlan, words);
+    c.rows[c.num_rows++] = client_ports.get(flow.client_port, words);
+    c.rows[c.num_rows++] = server_ports.get(flow.server_port, words);
+
+    c.either[0] = either_ports.get(flow.client_port, words);
+    c.either[1] = either_ports.get(flow.server_port, words);
+
+    auto ips = ips_id_map.find(flow.ips_policy_id);
+    c.rows[c.num_rows++] = ips_ids.get_row(ips != ips_id_map.end() ? ips->second : 0, words);
+
+    auto as = addr_space_map.find(flow.key->addressSpaceId);
+    c.rows[c.num_rows++] = addr_spaces.get_row(as != addr_space_map.end() ? as->second : 0, words);
+
+    if ( service )
+    {
+        auto svc = lookup_svc_map.find(service);
+        c.rows[c.num_rows++] = lookup_svcs.get_row(svc != lookup_svc_map.end() ? svc->second : 0, words);
+    }
+    else if ( flow.service )
+    {
+        auto svc = flow_svc_map.find(flow.service);
+        c.rows[c.num_rows++] = flow_svcs.get_row(svc != flow_svc_map.end() ? svc->second : 0, words);
+    }
+    else
+        c.rows[c.num_rows++] = flow_svcs.get_row(0, words);
+
+    assert(c.num_rows <= Cursor::max_rows);
+}
+
+size_t BindingIndex::get_mem_used() const
+{
+    size_t n = 0;
+
+    for ( const Table* t : { &protos, &vlans, &client_ports, &server_ports, &either_ports,
+        &ips_ids, &addr_spaces, &flow_svcs, &lookup_svcs } )
+    {
+        n += t->index.size() * sizeof(t->index[0]);
+        n += t->rows.size() * sizeof(t->rows[0]);
+    }
+    return n;
+}
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+static const char* test_svcs[] = { "http", "smtp", "dns", "ssl" };
+
+// a mix of tenants (vlan, address space, policy) with port and service
+// specific bindings and a catch all per tenant
+static void make_bindings(std::vector<Binding>& bv, unsigned n, std::mt19937& gen)
+{
+    bv.resize(n);
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        BindWhen& w = bv[i].when;
+        unsigned r = gen();
+
+        if ( i % 5 )
+        {
+            w.vlans.set(i % 97);
+            w.add_criteria(BindWhen::BWC_VLANS);
+        }
+        if ( r & 0x1 )
+        {
+            w.protos = (r & 0x2) ? PROTO_BIT__TCP : PROTO_BIT__UDP;
+            w.add_criteria(BindWhen::BWC_PROTO);
+        }
+        switch ( (r >> 2) & 0x3 )
+        {
+        case 0:
+            break;
+        case 1:
+            w.src_ports.reset();
+            w.src_ports.set(80 + (r >> 8) % 8);
+            w.role = (BindWhen::Role)((r >> 4) % BindWhen::BR_MAX);
+            w.add_criteria(BindWhen::BWC_PORTS);
+            break;
+        default:
+            w.src_ports.reset();
+            w.dst_ports.reset();
+            w.src_ports.set(1024 + (r >> 8) % 4);
+            w.dst_ports.set(80 + (r >> 12) % 8);
+            w.add_criteria(BindWhen::BWC_SPLIT_PORTS);
+            break;
+        }
+        if ( r & 0x40 )
+        {
+            w.svc = test_svcs[(r >> 16) % 4];
+            w.add_criteria(BindWhen::BWC_SVC);
+        }
+        if ( r & 0x80 )
+        {
+            w.ips_id = (r >> 20) % 3;
+            w.add_criteria(BindWhen::BWC_IPS_ID);
+        }
+        if ( r & 0x100 )
+        {
+            w.addr_spaces.insert((r >> 24) % 3);
+            w.add_criteria(BindWhen::BWC_ADDR_SPACES);
+        }
+    }
+}
+
+static void make_flow(Flow& flow, FlowKey& key, std::mt19937& gen)
+{
+    unsigned r = gen();
+
+    memset(&key, 0, sizeof(key));
+    key.vlan_tag = r % 97;
+    key.addressSpaceId = (r >> 8) % 3;
+
+    flow.key = &key;
+    flow.pkt_type = (r & 0x10000) ? PktType::TCP : PktType::UDP;
+    flow.client_port = 1024 + (r >> 17) % 4;
+    flow.server_port = 80 + (r >> 19) % 8;
+    flow.ips_policy_id = (r >> 22) % 3;
+    flow.service = (r & 0x2000000) ? test_svcs[(r >> 26) % 4] : nullptr;
+}
+
+static int linear_match(const std::vector<Binding>& bv, const Flow& flow, const char* svc)
+{
+    for ( unsigned i = 0; i < bv.size(); ++i )
+        if ( bv[i].check_all(flow, svc) )
+            return i;
+
+    return -1;
+}
+
+static int index_match(
+    const BindingIndex& bi, const std::vector<Binding>& bv, const Flow& flow, const char* svc)
+{
+    BindingIndex::Cursor c;
+    bi.select(flow, svc, c);
+
+    for ( int i = c.next(); i >= 0; i = c.next() )
+        if ( bv[i].check_all(flow, svc) )
+            return i;
+
+    return -1;
+}
+
+TEST_CASE("binding index empty", "[binder]")
+{
+    std::vector<Binding> bv;
+    BindingIndex bi;
+    bi.build(bv);
+
+    Flow flow;
+    FlowKey key;
+    std::mt19937 gen(1);
+    make_flow(flow, key, gen);
+
+    BindingIndex::Cursor c;
+    bi.select(flow, nullptr, c);
+    CHECK(c.next() == -1);
+}
+
+TEST_CASE("binding index first match", "[binder]")
+{
+    std::mt19937 gen(7);
+    std::vector<Binding> bv;
+    make_bindings(bv, 300, gen);
+
+    BindingIndex bi;
+    bi.build(bv);
+
+    Flow flow;
+    FlowKey key;
+    unsigned matched = 0;
+
+    for ( unsigned i = 0; i < 5000; ++i )
+    {
+        make_flow(flow, key, gen);
+        const char* svc = (i % 4) ? nullptr : test_svcs[i % 3];
+
+        int expected = linear_match(bv, flow, svc);
+        CHECK(index_match(bi, bv, flow, svc) == expected);
+
+        if ( expected >= 0 )
+            ++matched;
+    }
+    // make sure the test isn't vacuous
+    CHECK(matched > 0);
+    CHECK(matched < 5000);
+}
+
+#ifdef BENCHMARK_TEST
+
+TEST_CASE("binding lookups", "[binder]")
+{
+    const unsigned num_flows = 1024;
+
+    std::mt19937 gen(3);
+    std::vector<Binding> bv;
+    make_bindings(bv, 1000, gen);
+
+    BindingIndex bi;
+    bi.build(bv);
+
+    std::vector<Flow> flows(num_flows);
+    std::vector<FlowKey> keys(num_flows);
+
+    for ( unsigned i = 0; i < num_flows; ++i )
+        make_flow(flows[i], keys[i], gen);
+
+    BENCHMARK("linear binding search")
+    {
+        int n = 0;
+        for ( auto& f : flows )
+            n += linear_match(bv, f, nullptr);
+        return n;
+    };
+
+    BENCHMARK("indexed binding search")
+    {
+        int n = 0;
+        for ( auto& f : flows )
+            n += index_match(bi, bv, f, nullptr);
+        return n;
+    };
+
+    WARN("binding index bytes: " << bi.get_mem_used());
+}
+
+#endif
+#endif
+
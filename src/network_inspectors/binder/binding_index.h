@@ -0,0 +1,130 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef BINDING_INDEX_H
+#define BINDING_INDEX_H
+
+// BindingIndex compiles a vector of Bindings into tables of binding
+// bitmaps keyed by protocol, vlan, client and server port, ips policy,
+// address space, and service.  A lookup ANDs the rows selected by the flow
+// so only bindings that can match are visited, in binding order.  Nets,
+// interfaces, and groups aren't indexed; the candidates are a superset of
+// the matches and must still pass Binding::check_all so the first match
+// is the same as with a linear search.
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "binding.h"
+
+class BindingIndex
+{
+public:
+    class Cursor
+    {
+    public:
+        // returns the next candidate index or -1 when done
+        int next();
+
+    private:
+        friend class BindingIndex;
+        static const unsigned max_rows = 8;
+
+        const uint64_t* rows[max_rows];
+        const uint64_t* either[2];
+
+        unsigned num_rows = 0;
+        unsigned words = 0;
+        unsigned word = 0;
+        unsigned base = 0;
+        uint64_t bits = 0;
+    };
+
+    void build(const std::vector<Binding>&);
+    void select(const snort::Flow&, const char* service, Cursor&) const;
+
+    size_t get_mem_used() const;
+
+private:
+    struct Table
+    {
+        std::vector<uint16_t> index;
+        std::vector<uint64_t> rows;
+
+        const uint64_t* get_row(uint16_t id, unsigned words) const
+        { return &rows[id * words]; }
+
+        const uint64_t* get(unsigned key, unsigned words) const
+        { return get_row(index[key], words); }
+    };
+
+    template<typename Restricted, typename Test>
+    void build_table(Table&, unsigned num_keys, const std::vector<Binding>&,
+        Restricted, Test);
+
+    template<typename Key, typename Restricted, typename Keys>
+    void build_map(Table&, std::unordered_map<Key, uint16_t>&, const std::vector<Binding>&,
+        Restricted, Keys, bool with_unrestricted = true);
+
+    unsigned words = 0;
+
+    Table protos;
+    Table vlans;
+    Table client_ports;
+    Table server_ports;
+    Table either_ports;
+
+    Table ips_ids;
+    std::unordered_map<PolicyId, uint16_t> ips_id_map;
+
+    Table addr_spaces;
+    std::unordered_map<uint16_t, uint16_t> addr_space_map;
+
+    Table flow_svcs;
+    std::unordered_map<std::string, uint16_t> flow_svc_map;
+
+    Table lookup_svcs;
+    std::unordered_map<std::string, uint16_t> lookup_svc_map;
+};
+
+inline int BindingIndex::Cursor::next()
+{
+    while ( !bits )
+    {
+        if ( word == words )
+            return -1;
+
+        uint64_t m = either[0][word] | either[1][word];
+
+        for ( unsigned i = 0; i < num_rows; ++i )
+            m &= rows[i][word];
+
+        bits = m;
+        base = 64 * word++;
+    }
+
+    unsigned bit = __builtin_ctzll(bits);
+    bits &= bits - 1;
+
+    return base + bit;
+}
+
+#endif
+
@@ -0,0 +1,391 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "columnar_formatter.h"
+
+#include <cstring>
+
+#include "log/messages.h"
+#include "utils/endian.h"
+
+using namespace snort;
+using namespace std;
+
+static const unsigned max_varint = 10;
+
+static inline unsigned encode_varint(uint64_t v, uint8_t* p)
+{
+    unsigned n = 0;
+
+    while ( v >= 0x80 )
+    {
+        p[n++] = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+// pegs may be reset between intervals so deltas are signed
+static inline uint64_t zigzag(uint64_t cur, uint64_t prev)
+{
+    int64_t d = (int64_t)(cur - prev);
+    return ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+}
+
+void ColumnarFormatter::put_varint(uint64_t v)
+{
+    uint8_t tmp[max_varint];
+    body.insert(body.end(), tmp, tmp + encode_varint(v, tmp));
+}
+
+// columns are written as the gap from the last changed column
+void ColumnarFormatter::put_column(unsigned col)
+{
+    put_varint(col - next_col);
+    next_col = col + 1;
+    changed++;
+}
+
+bool ColumnarFormatter::put_vector(unsigned col, const vector<PegCount>& cur)
+{
+    vector<PegCount>& last = last_vectors[col];
+
+    if ( cur == last )
+        return false;
+
+    unsigned n = 0;
+
+    for ( unsigned k = 0; k < cur.size(); k++ )
+    {
+        if ( cur[k] != (k < last.size() ? last[k] : 0) )
+            n++;
+    }
+    put_column(col);
+    put_varint(cur.size());
+    put_varint(n);
+
+    unsigned next = 0;
+
+    for ( unsigned k = 0; k < cur.size() and n; k++ )
+    {
+        PegCount prev = k < last.size() ? last[k] : 0;
+
+        if ( cur[k] == prev )
+            continue;
+
+        put_varint(k - next);
+        put_varint(zigzag(cur[k], prev));
+        next = k + 1;
+        n--;
+    }
+    last = cur;
+    return true;
+}
+
+void ColumnarFormatter::finalize_fields()
+{
+    unsigned cols = 0;
+
+    for ( unsigned i = 0; i < section_names.size(); i++ )
+    {
+        for ( unsigned j = 0; j < field_names[i].size(); j++, cols++ )
+        {
+            switch ( types[i][j] )
+            {
+            case FT_PEG_COUNT:
+                schema += "p ";
+                break;
+
+            case FT_STRING:
+                schema += "s ";
+                break;
+
+            case FT_IDX_PEG_COUNT:
+                schema += "v ";
+                break;
+            }
+            schema += section_names[i];
+            schema += " ";
+            schema += field_names[i][j];
+            schema += "\n";
+        }
+    }
+    last_pegs.resize(cols);
+    last_strings.resize(cols);
+    last_vectors.resize(cols);
+
+    section_names.clear();
+    field_names.clear();
+}
+
+void ColumnarFormatter::init_output(FILE* fh)
+{
+    uint32_t size = htonl(schema.length());
+
+    writable =
+        fwrite("PCOL", 4, 1, fh) == 1 and
+        fwrite(&size, sizeof(size), 1, fh) == 1 and
+        (schema.empty() or fwrite(schema.c_str(), schema.length(), 1, fh) == 1) and
+        !fflush(fh);
+
+    if ( !writable )
+        ErrorMessage("perf_monitor: can't write %s columnar header, "
+            "skipping this file\n", get_tracker_name().c_str());
+
+    // a new file starts from zero
+    for ( auto& pc : last_pegs )
+        pc = 0;
+
+    for ( auto& s : last_strings )
+        s.clear();
+
+    for ( auto& v : last_vectors )
+        v.clear();
+
+    last_time = 0;
+}
+
+void ColumnarFormatter::write(FILE* fh, time_t timestamp)
+{
+    if ( !writable )
+        return;
+
+    unsigned col = 0;
+
+    body.clear();
+    next_col = changed = 0;
+
+    for ( unsigned i = 0; i < values.size(); i++ )
+    {
+        for ( unsigned j = 0; j < values[i].size(); j++, col++ )
+        {
+            switch ( types[i][j] )
+            {
+            case FT_PEG_COUNT:
+            {
+                PegCount pc = *values[i][j].pc;
+
+                if ( pc != last_pegs[col] )
+                {
+                    put_column(col);
+                    put_varint(zigzag(pc, last_pegs[col]));
+                    last_pegs[col] = pc;
+                }
+                break;
+            }
+            case FT_STRING:
+            {
+                const char* s = values[i][j].s ? values[i][j].s : "";
+
+                if ( last_strings[col] != s )
+                {
+                    size_t len = strlen(s);
+                    put_column(col);
+                    put_varint(len);
+                    body.insert(body.end(), (const uint8_t*)s, (const uint8_t*)s + len);
+                    last_strings[col] = s;
+                }
+                break;
+            }
+            case FT_IDX_PEG_COUNT:
+                put_vector(col, *values[i][j].ipc);
+                break;
+            }
+        }
+    }
+
+    // record := length, time delta, changed columns, changes
+    uint8_t head[3 * max_varint];
+    unsigned n = encode_varint(zigzag((uint64_t)timestamp, (uint64_t)last_time), head + max_varint);
+    n += encode_varint(changed, head + max_varint + n);
+
+    unsigned len = encode_varint(n + body.size(), head);
+    memmove(head + len, head + max_varint, n);
+
+    writable =
+        fwrite(head, len + n, 1, fh) == 1 and
+        (body.empty() or fwrite(body.data(), body.size(), 1, fh) == 1) and
+        !fflush(fh);
+
+    if ( !writable )
+        ErrorMessage("perf_monitor: can't write %s columnar record, "
+            "skipping this file\n", get_tracker_name().c_str());
+
+    last_time = timestamp;
+}
+
+#ifdef CATCH_TEST_BUILD
+
+#include "catch/catch.hpp"
+
+static unsigned errors = 0;
+
+void snort::ErrorMessage(const char*, ...)
+{ errors++; }
+
+static string read_file(FILE* fh)
+{
+    auto size = ftell(fh);
+    string s(size, '\0');
+
+    rewind(fh);
+
+    if ( size )
+        REQUIRE(fread(&s[0], size, 1, fh) == 1);
+
+    return s;
+}
+
+TEST_CASE("columnar output", "[ColumnarFormatter]")
+{
+    PegCount one = 1, two = 0, three = 300;
+    char five[32] = "hi";
+    vector<PegCount> kvp;
+
+    const char schema[] =
+        "p name one\n"
+        "p name two\n"
+        "p other three\n"
+        "s other five\n"
+        "v other kvp\n";
+
+    FILE* fh = tmpfile();
+    ColumnarFormatter f("columnar_formatter");
+
+    f.register_section("name");
+    f.register_field("one", &one);
+    f.register_field("two", &two);
+    f.register_section("other");
+    f.register_field("three", &three);
+    f.register_field("five", five);
+    f.register_field("kvp", &kvp);
+    f.finalize_fields();
+    f.init_output(fh);
+
+    kvp.emplace_back(50);
+    kvp.emplace_back(0);
+    kvp.emplace_back(70);
+
+    f.write(fh, (time_t)1000);
+
+    // nothing changed
+    f.write(fh, (time_t)1001);
+
+    one = 0;
+    two = 2;
+    five[0] = '\0';
+    kvp[2] = 71;
+    f.write(fh, (time_t)1003);
+
+    string cooked("PCOL", 4);
+    cooked += string("\0\0\0", 3) + (char)(sizeof(schema) - 1);
+    cooked += schema;
+
+    const uint8_t records[] =
+    {
+        // 1000: one = +1, skip two, three = +300, five = "hi", kvp[0] = +50, kvp[2] = +70
+        20, 0xd0, 0x0f, 4,
+        0, 2,
+        1, 0xd8, 0x04,
+        0, 2, 'h', 'i',
+        0, 3, 2, 0, 100, 1, 140, 0x01,
+
+        // 1001: time only
+        2, 2, 0,
+
+        // 1003: one = -1, two = +2, five = "", kvp[2] = +1
+        13, 4, 4,
+        0, 1,
+        0, 4,
+        1, 0,
+        0, 3, 1, 2, 2,
+    };
+    cooked += string((const char*)records, sizeof(records));
+
+    CHECK(read_file(fh) == cooked);
+
+    // a new file starts over
+    FILE* fh2 = tmpfile();
+    f.init_output(fh2);
+    f.write(fh2, (time_t)1003);
+
+    const uint8_t restart[] =
+    {
+        16, 0xd6, 0x0f, 3,
+        1, 4,
+        0, 0xd8, 0x04,
+        1, 3, 2, 0, 100, 1, 0x8e, 0x01,
+    };
+    cooked.resize(8 + sizeof(schema) - 1);
+    cooked += string((const char*)restart, sizeof(restart));
+
+    CHECK(read_file(fh2) == cooked);
+
+    fclose(fh2);
+    fclose(fh);
+}
+
+TEST_CASE("columnar write errors", "[ColumnarFormatter]")
+{
+    PegCount one = 1;
+    ColumnarFormatter f("columnar_formatter");
+
+    f.register_section("name");
+    f.register_field("one", &one);
+    f.finalize_fields();
+
+    // no records follow a header that wasn't written
+    errors = 0;
+    FILE* bad = fopen("/dev/null", "r");
+    REQUIRE(bad);
+
+    f.init_output(bad);
+    CHECK(errors == 1);
+
+    FILE* fh = tmpfile();
+    f.write(fh, (time_t)1000);
+    CHECK(errors == 1);
+    CHECK(read_file(fh).empty());
+
+    // nor a record that wasn't
+    f.init_output(fh);
+    f.write(fh, (time_t)1000);
+    CHECK(errors == 1);
+
+    string good = read_file(fh);
+    fseek(fh, 0, SEEK_END);
+
+    f.write(bad, (time_t)1001);
+    CHECK(errors == 2);
+
+    one = 2;
+    f.write(fh, (time_t)1002);
+    CHECK(errors == 2);
+    CHECK(read_file(fh) == good);
+
+    fclose(fh);
+    fclose(bad);
+}
+
+#endif
+
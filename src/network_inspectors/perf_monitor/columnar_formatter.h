@@ -0,0 +1,70 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef COLUMNAR_FORMATTER_H
+#define COLUMNAR_FORMATTER_H
+
+// ColumnarFormatter writes a binary stream where each record only carries
+// the columns that changed since the previous record.  Peg counts are
+// written as zigzag varint deltas so a record for a mostly idle tracker is
+// a few bytes.  Since every record depends on the ones before it, files
+// can't be appended to and each new file starts from zero.  See
+// dev_notes.txt for the layout and tools/perfcol for a reader.
+
+#include <cstdint>
+
+#include "perf_formatter.h"
+
+class ColumnarFormatter : public PerfFormatter
+{
+public:
+    ColumnarFormatter(const std::string& tracker_name) : PerfFormatter(tracker_name) {}
+
+    const char* get_extension() override
+    { return ".pcol"; }
+
+    bool allow_append() override
+    { return false; }
+
+    void finalize_fields() override;
+    void init_output(FILE*) override;
+    void write(FILE*, time_t) override;
+
+private:
+    void put_varint(uint64_t);
+    void put_column(unsigned col);
+    bool put_vector(unsigned col, const std::vector<PegCount>&);
+
+    std::string schema;
+    std::vector<uint8_t> body;
+
+    // last value written for each column, indexed by column
+    std::vector<PegCount> last_pegs;
+    std::vector<std::string> last_strings;
+    std::vector<std::vector<PegCount>> last_vectors;
+
+    time_t last_time = 0;
+    unsigned next_col = 0;
+    unsigned changed = 0;
+
+    // records can't be read after a failed write so skip the rest of the file
+    bool writable = false;
+};
+
+#endif
+
@@ -47,6 +47,7 @@ enum class PerfFormat
     CSV,
     TEXT,
     JSON,
+    COLUMNAR,
     FBS,
     MOCK
 };
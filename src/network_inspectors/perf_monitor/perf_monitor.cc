@@ -146,6 +146,8 @@ static const char* to_string(const PerfFormat& pf)
         return "csv";
     case PerfFormat::JSON:
         return "json";
+    case PerfFormat::COLUMNAR:
+        return "columnar";
 #ifdef HAVE_FLATBUFFERS
     case PerfFormat::FBS:
         return "flatbuffers";
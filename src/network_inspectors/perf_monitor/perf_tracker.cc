@@ -37,6 +37,7 @@
 #include "fbs_formatter.h"
 #endif
 
+#include "columnar_formatter.h"
 #include "csv_formatter.h"
 #include "json_formatter.h"
 #include "text_formatter.h"
@@ -69,6 +70,7 @@ PerfTracker::PerfTracker(PerfConfig* config, const char* tracker_name)
         case PerfFormat::CSV: formatter = new CSVFormatter(tracker_name); break;
         case PerfFormat::TEXT: formatter = new TextFormatter(tracker_name); break;
         case PerfFormat::JSON: formatter = new JSONFormatter(tracker_name); break;
+        case PerfFormat::COLUMNAR: formatter = new ColumnarFormatter(tracker_name); break;
 #ifdef HAVE_FLATBUFFERS
         case PerfFormat::FBS: formatter = new FbsFormatter(tracker_name); break;
 #endif
@@ -385,6 +385,8 @@ static std::string to_string(const IPSET* list)
 static void portscan_config_show(const PortscanConfig* config)
 {
     ConfigLogger::log_value("memcap", static_cast<uint64_t>(config->memcap));
+    ConfigLogger::log_value("tracker",
+        config->tracker_type == PS_TRACKER_SKETCH ? "sketch" : "exact");
     ConfigLogger::log_value("protos", get_protos(config->detect_scans).c_str());
     ConfigLogger::log_value("scan_types", get_types(config->detect_scan_type).c_str());
 
@@ -420,7 +422,12 @@ PortScan::~PortScan()
 }
 
 void PortScan::tinit()
-{ ps_init_hash(config->memcap); }
+{
+    if ( config->tracker_type == PS_TRACKER_SKETCH )
+        ps_init_sketch(config);
+    else
+        ps_init_hash(config->memcap);
+}
 
 void PortScan::tterm()
 { ps_cleanup(); }
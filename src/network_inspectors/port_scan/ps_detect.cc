@@ -46,6 +46,16 @@
 
 #include "ps_inspect.h"
 #include "ps_pegs.h"
+#include "ps_sketch.h"
+
+#ifdef BENCHMARK_TEST
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "catch/snort_catch.h"
+#endif
 
 using namespace snort;
 
@@ -86,6 +96,7 @@ public:
 };
 
 static THREAD_LOCAL PortScanCache* portscan_hash = nullptr;
+static THREAD_LOCAL PortScanSketch* portscan_sketch = nullptr;
 extern THREAD_LOCAL PsPegStats spstats;
 
 PS_PKT::PS_PKT(Packet* p)
@@ -119,6 +130,12 @@ void ps_cleanup()
         delete portscan_hash;
         portscan_hash = nullptr;
     }
+
+    if ( portscan_sketch )
+    {
+        delete portscan_sketch;
+        portscan_sketch = nullptr;
+    }
 }
 
 unsigned ps_node_size()
@@ -126,6 +143,12 @@ unsigned ps_node_size()
 
 bool ps_init_hash(unsigned long memcap)
 {
+    if ( portscan_sketch )
+    {
+        delete portscan_sketch;
+        portscan_sketch = nullptr;
+    }
+
     if ( portscan_hash )
     {
         bool need_pruning = (memcap < portscan_hash->get_mem_used());
@@ -140,6 +163,24 @@ bool ps_init_hash(unsigned long memcap)
     return false;
 }
 
+void ps_init_sketch(const PortscanConfig* config)
+{
+    if ( portscan_hash )
+    {
+        delete portscan_hash;
+        portscan_hash = nullptr;
+    }
+
+    if ( portscan_sketch and !portscan_sketch->resize_needed(config) )
+    {
+        portscan_sketch->configure(config);
+        return;
+    }
+
+    delete portscan_sketch;
+    portscan_sketch = new PortScanSketch(config);
+}
+
 bool ps_prune_hash(unsigned work_limit)
 {
     if ( !portscan_hash )
@@ -155,6 +196,9 @@ void ps_reset()
 {
     if ( portscan_hash )
         portscan_hash->clear_hash();
+
+    if ( portscan_sketch )
+        portscan_sketch->clear();
 }
 
 //  Check scanner and scanned ips to see if we can filter them out.
@@ -290,10 +334,14 @@ bool PortScan::ps_filter_ignore(PS_PKT* ps_pkt)
 
 /*
 **  Get a tracker node by either finding one or starting a new one.  We may
-**  return null, in which case we wait `til the next packet.
+**  return null, in which case we wait `til the next packet.  The sketch
+**  tracker returns a scratch node and uses peer for the address range.
 */
-static PS_TRACKER* ps_tracker_get(PS_HASH_KEY* key)
+static PS_TRACKER* ps_tracker_get(PS_HASH_KEY* key, const SfIp* peer)
 {
+    if ( portscan_sketch )
+        return portscan_sketch->get(key, sizeof(*key), key->protocol, peer, packet_time());
+
     PS_TRACKER* ht = (PS_TRACKER*)portscan_hash->get_user_data((void*)key);
 
     if ( ht )
@@ -319,6 +367,7 @@ bool PortScan::ps_tracker_lookup(
     PS_PKT* ps_pkt, PS_TRACKER** scanner, PS_TRACKER** scanned)
 {
     PS_HASH_KEY key;
+    const SfIp* peer;
     Packet* p = (Packet*)ps_pkt->pkt;
 
     if (ps_get_proto(ps_pkt, &key.protocol) == -1)
@@ -340,14 +389,16 @@ bool PortScan::ps_tracker_lookup(
         {
             key.scanned = *p->ptrs.ip_api.get_src();
             key.group = p->get_ingress_group();
+            peer = p->ptrs.ip_api.get_dst();
         }
         else
         {
             key.scanned = *p->ptrs.ip_api.get_dst();
             key.group = p->get_egress_group();
+            peer = p->ptrs.ip_api.get_src();
         }
 
-        *scanned = ps_tracker_get(&key);
+        *scanned = ps_tracker_get(&key, peer);
     }
 
     //  Let's lookup the host that is scanning.
@@ -359,14 +410,16 @@ bool PortScan::ps_tracker_lookup(
         {
             key.scanner = *p->ptrs.ip_api.get_dst();
             key.group = p->get_egress_group();
+            peer = p->ptrs.ip_api.get_src();
         }
         else
         {
             key.scanner = *p->ptrs.ip_api.get_src();
             key.group = p->get_ingress_group();
+            peer = p->ptrs.ip_api.get_dst();
         }
 
-        *scanner = ps_tracker_get(&key);
+        *scanner = ps_tracker_get(&key, peer);
     }
 
     return *scanner or *scanned;
@@ -437,7 +490,7 @@ int PortScan::ps_get_proto(PS_PKT* ps_pkt, int* proto)
     return -1;
 }
 
-void PortScan::ps_proto_update_window(unsigned interval, PS_PROTO* proto, time_t pkt_time)
+static void ps_proto_update_window(unsigned interval, PS_PROTO* proto, time_t pkt_time)
 {
     if (pkt_time > proto->window)
     {
@@ -456,12 +509,18 @@ void PortScan::ps_proto_update_window(unsigned interval, PS_PROTO* proto, time_t
 **  @param unsigned short  port/ip_proto to track
 **  @param time_t   time the packet was received. update windows.
 */
-int PortScan::ps_proto_update(PS_PROTO* proto, int ps_cnt, int pri_cnt,
+static int ps_proto_update(PS_PROTO* proto, int ps_cnt, int pri_cnt,
     unsigned window, const SfIp* ip, unsigned short port, time_t pkt_time)
 {
     if (!proto)
         return 0;
 
+    if ( portscan_sketch )
+    {
+        portscan_sketch->update(proto, ps_cnt, pri_cnt, ip, port);
+        return 0;
+    }
+
     /*
     **  If the ps_cnt is negative, that means we are just taking off
     **  for valid connection, and we don't want to do anything else,
@@ -563,6 +622,10 @@ static int ps_update_open_ports(PS_PROTO* proto, unsigned short port)
 {
     int iCtr;
 
+    // the sketch tracker doesn't keep open ports
+    if ( portscan_sketch )
+        return 0;
+
     for (iCtr = 0; iCtr < proto->open_ports_cnt; iCtr++)
     {
         if (port == proto->open_ports[iCtr])
@@ -1161,6 +1224,9 @@ bool PortScan::ps_tracker_alert(
         if ( config->alert_all )
             scanner->proto.alerts = 0;
         scanner_proto = &scanner->proto;
+
+        if ( portscan_sketch )
+            portscan_sketch->estimate(scanner);
     }
 
     if ( scanned )
@@ -1168,6 +1234,9 @@ bool PortScan::ps_tracker_alert(
         if ( config->alert_all )
             scanned->proto.alerts = 0;
         scanned_proto = &scanned->proto;
+
+        if ( portscan_sketch )
+            portscan_sketch->estimate(scanned);
     }
 
     switch (ps_pkt->proto)
@@ -1192,6 +1261,15 @@ bool PortScan::ps_tracker_alert(
         return false;
     }
 
+    if ( portscan_sketch )
+    {
+        if ( scanner )
+            portscan_sketch->set_alerted(scanner);
+
+        if ( scanned )
+            portscan_sketch->set_alerted(scanned);
+    }
+
     return true;
 }
 
@@ -1260,3 +1338,249 @@ int PortScan::ps_detect(PS_PKT* ps_pkt)
     return 1;
 }
 
+
+//-------------------------------------------------------------------------
+// benchmarks
+//-------------------------------------------------------------------------
+
+#ifdef BENCHMARK_TEST
+
+// an internet facing sensor during a scan storm: many sources each send a
+// couple of probes to random hosts and get reset.  a few real scanners
+// start once the storm is underway.  the exact tracker with enough memory
+// for every host is the reference for the alerts that should be raised.
+// that includes some noise sources that happen to reach the sweep
+// thresholds so the planted scanners are also counted separately.
+
+static const unsigned bench_memcap = 4 << 20;
+static const unsigned bench_noise = 50000;
+static const unsigned bench_scanners = 20;
+static const unsigned bench_probes = 100;
+
+struct BenchProbe
+{
+    SfIp src;
+    SfIp dst;
+    uint16_t port;
+};
+
+// alerted hosts
+struct BenchResult
+{
+    std::set<uint32_t> portscans;
+    std::set<uint32_t> portsweeps;
+};
+
+static void set_ip(SfIp& ip, uint32_t a)
+{
+    a = htonl(a);
+    ip.set(&a, AF_INET);
+}
+
+static void make_bench_probes(std::vector<BenchProbe>& probes, BenchResult& planted)
+{
+    std::mt19937 rng(1);
+    BenchProbe bp;
+
+    for ( unsigned i = 0; i < bench_noise; ++i )
+    {
+        set_ip(bp.src, 0x0A000000 | (rng() % 25000));
+        set_ip(bp.dst, 0xC0A80000 | (rng() & 0xFFFF));
+        bp.port = 1 + rng() % 65535;
+        probes.emplace_back(bp);
+    }
+
+    // portscanners hit 100 ports on one host and
+    // portsweepers hit port 445 on 100 hosts
+    for ( unsigned i = 0; i < bench_scanners; ++i )
+    {
+        for ( unsigned j = 0; j < bench_probes; ++j )
+        {
+            set_ip(bp.src, 0xCB007100 | i);
+            set_ip(bp.dst, 0xAC100000 | i);
+            bp.port = 1 + j;
+            probes.emplace_back(bp);
+
+            set_ip(bp.src, 0xC6336400 | i);
+            set_ip(bp.dst, 0xAC110000 | (i << 8) | j);
+            bp.port = 445;
+            probes.emplace_back(bp);
+        }
+        planted.portscans.insert(probes[probes.size() - 2].dst.get_ip4_value());
+        planted.portsweeps.insert(probes.back().src.get_ip4_value());
+    }
+    std::shuffle(probes.begin() + bench_noise / 2, probes.end(), rng);
+}
+
+// this follows ps_detect() for a SYN without a session (rst = false) and
+// the RST from the scanned host (rst = true)
+static void bench_packet(const PortscanConfig& conf, const BenchProbe& bp, bool rst,
+    BenchResult& res)
+{
+    PS_HASH_KEY key;
+    memset(&key, 0, sizeof(key));
+    key.protocol = PS_PROTO_TCP;
+
+    key.scanned = bp.dst;
+    PS_TRACKER* scanned = ps_tracker_get(&key, &bp.src);
+
+    key.scanned.clear();
+    key.scanner = bp.src;
+    PS_TRACKER* scanner = ps_tracker_get(&key, &bp.dst);
+
+    for ( auto t : { scanner, scanned } )
+    {
+        if ( !t )
+            continue;
+
+        if ( t->proto.alerts )
+            t->proto.alerts = PS_ALERT_GENERATED;
+
+        if ( rst )
+        {
+            ps_proto_update(&t->proto, 0, 1, conf.tcp_window, nullptr, 0, 0);
+            t->priority_node = 1;
+        }
+        else
+        {
+            const SfIp* ip = (t == scanned) ? &bp.src : &bp.dst;
+            ps_proto_update(&t->proto, 1, 0, conf.tcp_window, ip, bp.port, packet_time());
+        }
+
+        if ( portscan_sketch )
+            portscan_sketch->estimate(t);
+    }
+
+    PS_PROTO* scanner_proto = scanner ? &scanner->proto : nullptr;
+    PS_PROTO* scanned_proto = scanned ? &scanned->proto : nullptr;
+
+    if ( !ps_alert_one_to_one(conf.tcp_ports, scanner_proto, scanned_proto) )
+        ps_alert_one_to_many(conf.tcp_sweep, scanner_proto, scanned_proto);
+
+    // sketch trackers are never null
+    if ( portscan_sketch )
+    {
+        portscan_sketch->set_alerted(scanner);
+        portscan_sketch->set_alerted(scanned);
+    }
+
+    if ( scanned and scanned->proto.alerts == PS_ALERT_ONE_TO_ONE )
+        res.portscans.insert(bp.dst.get_ip4_value());
+
+    if ( scanner and scanner->proto.alerts == PS_ALERT_PORTSWEEP )
+        res.portsweeps.insert(bp.src.get_ip4_value());
+}
+
+static void bench_run(const PortscanConfig& conf, const std::vector<BenchProbe>& probes,
+    BenchResult& res)
+{
+    for ( const auto& bp : probes )
+    {
+        bench_packet(conf, bp, false, res);
+        bench_packet(conf, bp, true, res);
+    }
+}
+
+static void bench_config(PortscanConfig& conf, int tracker, size_t memcap)
+{
+    conf.memcap = memcap;
+    conf.tracker_type = tracker;
+    conf.detect_scans = PS_PROTO_TCP;
+    conf.detect_scan_type = PS_TYPE_PORTSCAN | PS_TYPE_PORTSWEEP;
+    conf.tcp_window = 90;
+
+    // tcp_med_ports and tcp_med_sweep from snort_defaults.lua
+    conf.tcp_ports = { 200, 10, 60, 15 };
+    conf.tcp_sweep = { 30, 7, 7, 10 };
+
+    ps_cleanup();
+
+    if ( tracker == PS_TRACKER_SKETCH )
+        ps_init_sketch(&conf);
+    else
+        ps_init_hash(conf.memcap);
+}
+
+static unsigned count_common(const std::set<uint32_t>& a, const std::set<uint32_t>& b)
+{
+    std::vector<uint32_t> common;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(common));
+    return common.size();
+}
+
+TEST_CASE("port scan storm detection", "[port_scan]")
+{
+    std::vector<BenchProbe> probes;
+    BenchResult planted;
+    make_bench_probes(probes, planted);
+
+    PortscanConfig conf;
+    BenchResult ref;
+    bench_config(conf, PS_TRACKER_EXACT, 256 << 20);
+    bench_run(conf, probes, ref);
+
+    WARN("reference bytes: " << portscan_hash->get_mem_used() <<
+        ", portscans: " << ref.portscans.size() << ", portsweeps: " << ref.portsweeps.size());
+
+    CHECK(count_common(planted.portscans, ref.portscans) == bench_scanners);
+    CHECK(count_common(planted.portsweeps, ref.portsweeps) == bench_scanners);
+
+    for ( int tracker : { PS_TRACKER_EXACT, PS_TRACKER_SKETCH } )
+    {
+        PortscanConfig conf;
+        bench_config(conf, tracker, bench_memcap);
+
+        BenchResult res;
+        bench_run(conf, probes, res);
+
+        size_t mem = portscan_sketch ? portscan_sketch->get_mem_used() :
+            portscan_hash->get_mem_used();
+
+        unsigned found = count_common(planted.portscans, res.portscans) +
+            count_common(planted.portsweeps, res.portsweeps);
+
+        unsigned scans = count_common(ref.portscans, res.portscans);
+        unsigned sweeps = count_common(ref.portsweeps, res.portsweeps);
+        unsigned extra = res.portscans.size() - scans + res.portsweeps.size() - sweeps;
+
+        WARN((tracker == PS_TRACKER_SKETCH ? "sketch" : "exact") << " bytes: " << mem <<
+            ", scanners: " << found << "/" << 2 * bench_scanners <<
+            ", portscans: " << scans << "/" << ref.portscans.size() <<
+            ", portsweeps: " << sweeps << "/" << ref.portsweeps.size() <<
+            ", false alerts: " << extra);
+
+        if ( tracker == PS_TRACKER_SKETCH )
+        {
+            CHECK(mem <= bench_memcap);
+            CHECK(found == 2 * bench_scanners);
+            CHECK(extra <= ref.portsweeps.size() / 10);
+        }
+    }
+    ps_cleanup();
+}
+
+TEST_CASE("port scan tracker updates", "[port_scan]")
+{
+    std::vector<BenchProbe> probes;
+    BenchResult planted;
+    make_bench_probes(probes, planted);
+
+    PortscanConfig exact, sketch;
+    BenchResult res;
+
+    BENCHMARK("exact tracker")
+    {
+        bench_config(exact, PS_TRACKER_EXACT, bench_memcap);
+        bench_run(exact, probes, res);
+    };
+
+    BENCHMARK("sketch tracker")
+    {
+        bench_config(sketch, PS_TRACKER_SKETCH, bench_memcap);
+        bench_run(sketch, probes, res);
+    };
+
+    ps_cleanup();
+}
+
+#endif
@@ -64,6 +64,9 @@ struct Packet;
 
 #define PS_ALERT_GENERATED                 255
 
+#define PS_TRACKER_EXACT                   0
+#define PS_TRACKER_SKETCH                  1
+
 //-------------------------------------------------------------------------
 
 struct PS_ALERT_CONF
@@ -83,6 +86,7 @@ struct PortscanConfig
     int proto_cnt;
     int include_midstream;
     int print_tracker;
+    int tracker_type;
 
     bool alert_all;
     bool logfile;
@@ -165,6 +169,7 @@ void ps_reset();
 
 unsigned ps_node_size();
 bool ps_init_hash(unsigned long);
+void ps_init_sketch(const PortscanConfig*);
 bool ps_prune_hash(unsigned);
 int ps_detect(PS_PKT*);
 
@@ -63,6 +63,9 @@ static const Parameter ps_params[] =
     { "memcap", Parameter::PT_INT, "1024:maxSZ", "10485760",
       "maximum tracker memory in bytes" },
 
+    { "tracker", Parameter::PT_ENUM, "exact | sketch", "exact",
+      "track each host exactly with pruning at memcap or estimate counts in memcap sized sketches" },
+
     { "protos", Parameter::PT_MULTI, protos, "all",
       "choose the protocols to monitor" },
 
@@ -239,6 +242,9 @@ bool PortScanModule::set(const char* fqn, Value& v, SnortConfig*)
     if ( v.is("memcap") )
         config->memcap = v.get_size();
 
+    else if ( v.is("tracker") )
+        config->tracker_type = v.get_uint8();
+
     else if ( v.is("protos") )
     {
         unsigned u = v.get_uint32();
@@ -328,7 +334,9 @@ bool PortScanModule::set(const char* fqn, Value& v, SnortConfig*)
 
 bool PortScanModule::end(const char* fqn, int, SnortConfig* sc)
 {
-    if ( Snort::is_reloading() && strcmp(fqn, "port_scan") == 0 )
+    // the sketch is fixed size and rebuilt by tinit if memcap changes
+    if ( Snort::is_reloading() && strcmp(fqn, "port_scan") == 0 &&
+        config->tracker_type == PS_TRACKER_EXACT )
         sc->register_reload_resource_tuner(new PortScanReloadTuner(config->memcap));
     return true;
 }
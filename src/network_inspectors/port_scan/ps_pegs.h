@@ -30,6 +30,8 @@ static const PegInfo ps_module_pegs[] =
     { CountType::SUM, "trackers", "number of trackers allocated by port scan" },
     { CountType::SUM, "alloc_prunes", "number of trackers pruned on allocation of new tracking" },
     { CountType::SUM, "reload_prunes", "number of trackers pruned on reload due to reduced memcap" },
+    { CountType::SUM, "sketch_estimates", "number of distinct count estimates made by the sketch tracker" },
+    { CountType::SUM, "sketch_resets", "number of sketch tracker windows expired" },
     { CountType::END, nullptr, nullptr },
 };
 
@@ -39,6 +41,8 @@ struct PsPegStats
     PegCount trackers;
     PegCount alloc_prunes;
     PegCount reload_prunes;
+    PegCount sketch_estimates;
+    PegCount sketch_resets;
 };
 
 #endif
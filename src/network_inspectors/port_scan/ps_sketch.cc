@@ -0,0 +1,752 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "ps_sketch.h"
+
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#include "main/thread.h"
+#include "utils/util.h"
+
+#include "ps_pegs.h"
+
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
+using namespace snort;
+
+extern THREAD_LOCAL PsPegStats spstats;
+
+//-------------------------------------------------------------------------
+// hashing
+//-------------------------------------------------------------------------
+
+static inline uint64_t mix(uint64_t h)
+{
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+static uint64_t hash_bytes(const void* data, unsigned len, uint64_t seed)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    uint64_t h = mix(seed ^ len);
+
+    while ( len >= 8 )
+    {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        h = mix(h ^ w);
+        p += 8;
+        len -= 8;
+    }
+    if ( len )
+    {
+        uint64_t w = 0;
+        memcpy(&w, p, len);
+        h = mix(h ^ w);
+    }
+    return h;
+}
+
+// maps h onto [0, n) without a division
+static inline uint32_t reduce(uint32_t h, uint32_t n)
+{ return ((uint64_t)h * n) >> 32; }
+
+// the two halves of a key give independent hashes for double hashing
+static inline uint32_t probe(uint64_t key, unsigned i)
+{ return (uint32_t)key + i * ((uint32_t)(key >> 32) | 1); }
+
+//-------------------------------------------------------------------------
+// count-min sketch
+//-------------------------------------------------------------------------
+
+// counts saturate well above any threshold
+struct CountCell
+{
+    uint16_t conn;
+    uint16_t pri;
+    uint16_t low_p;
+    uint16_t high_p;
+};
+
+// each key updates one cell in each row and reads the smallest, so counts
+// are only ever too high.  port ranges read the same way are too wide.
+// rejects only go up so they use conservative update, which only raises
+// the cells that are below the new minimum.
+class CountSketch
+{
+public:
+    static const unsigned rows = 4;
+    static const unsigned max_width = 1 << 28;
+
+    static size_t mem_size(size_t width)
+    { return rows * width * sizeof(CountCell); }
+
+    void init(CountCell* mem, unsigned w)
+    { cells = mem; width = w; }
+
+    void clear()
+    { memset(cells, 0, mem_size(width)); }
+
+    void add_conn(uint64_t key, int n)
+    {
+        for ( unsigned r = 0; r < rows; ++r )
+        {
+            CountCell& c = cell(key, r);
+            c.conn = std::min(std::max((int)c.conn + n, 0), UINT16_MAX);
+        }
+    }
+
+    void add_pri(uint64_t key, unsigned n)
+    {
+        unsigned pri = UINT16_MAX;
+
+        for ( unsigned r = 0; r < rows; ++r )
+            pri = std::min(pri, (unsigned)cell(key, r).pri);
+
+        pri = std::min(pri + n, (unsigned)UINT16_MAX);
+
+        for ( unsigned r = 0; r < rows; ++r )
+        {
+            CountCell& c = cell(key, r);
+
+            if ( c.pri < pri )
+                c.pri = pri;
+        }
+    }
+
+    void add_port(uint64_t key, uint16_t port)
+    {
+        for ( unsigned r = 0; r < rows; ++r )
+        {
+            CountCell& c = cell(key, r);
+
+            if ( !c.low_p or port < c.low_p )
+                c.low_p = port;
+
+            if ( port > c.high_p )
+                c.high_p = port;
+        }
+    }
+
+    void get(uint64_t key, PS_PROTO& proto) const
+    {
+        uint16_t conn = UINT16_MAX, pri = UINT16_MAX;
+        uint16_t low = 0, high = UINT16_MAX;
+
+        for ( unsigned r = 0; r < rows; ++r )
+        {
+            const CountCell& c = cell(key, r);
+
+            conn = std::min(conn, c.conn);
+            pri = std::min(pri, c.pri);
+            low = std::max(low, c.low_p);
+            high = std::min(high, c.high_p);
+        }
+        proto.connection_count = conn;
+        proto.priority_count = pri;
+        proto.low_p = low;
+        proto.high_p = high;
+    }
+
+private:
+    CountCell& cell(uint64_t key, unsigned r) const
+    { return cells[r * width + reduce(probe(key, r), width)]; }
+
+private:
+    CountCell* cells;
+    unsigned width;
+};
+
+//-------------------------------------------------------------------------
+// virtual HyperLogLog
+//-------------------------------------------------------------------------
+
+// each key uses vregs registers picked from one shared array.  other keys
+// add the same noise to every register on average so the noise is
+// estimated from the whole array and subtracted.  ranks are capped so the
+// array total can be kept exactly in fixed point as registers change.
+class DistinctSketch
+{
+public:
+    static const unsigned vreg_bits = 7;
+    static const unsigned vregs = 1 << vreg_bits;
+    static const unsigned min_regs = 4 * vregs;
+    static const unsigned max_regs = 1 << 30;
+
+    void init(uint8_t* mem, unsigned n)
+    {
+        assert(n >= min_regs);
+        regs = mem;
+        size = n;
+        clear();
+    }
+
+    void clear()
+    {
+        memset(regs, 0, size);
+        total = (uint64_t)size << max_rank;
+        zeros = size;
+    }
+
+    void add(uint64_t key, uint64_t item)
+    {
+        uint64_t h = mix(key ^ item);
+        uint64_t w = h >> vreg_bits;
+        unsigned rank = w ? __builtin_ctzll(w) + 1 : max_rank;
+
+        if ( rank > max_rank )
+            rank = max_rank;
+
+        uint8_t& r = regs[reg(key, h & (vregs - 1))];
+
+        if ( rank <= r )
+            return;
+
+        if ( !r )
+            --zeros;
+
+        total -= (uint64_t)1 << (max_rank - r);
+        total += (uint64_t)1 << (max_rank - rank);
+        r = rank;
+    }
+
+    unsigned estimate(uint64_t key) const
+    {
+        double sum = 0;
+        unsigned empty = 0;
+
+        for ( unsigned i = 0; i < vregs; ++i )
+        {
+            uint8_t r = regs[reg(key, i)];
+            sum += 1.0 / ((uint64_t)1 << r);
+
+            if ( !r )
+                ++empty;
+        }
+        double s = vregs, m = size;
+        double est = cardinality(s, sum, empty);
+        double noise = cardinality(m, std::ldexp((double)total, -(int)max_rank), zeros);
+        double n = (m * s / (m - s)) * (est / s - noise / m);
+
+        return n > 0 ? (unsigned)(n + 0.5) : 0;
+    }
+
+private:
+    static const unsigned max_rank = 32;
+
+    static double cardinality(double m, double sum, unsigned empty)
+    {
+        double alpha = 0.7213 / (1.0 + 1.079 / m);
+        double est = alpha * m * m / sum;
+
+        // linear counting is better for small counts
+        if ( est <= 2.5 * m and empty )
+            est = m * std::log(m / empty);
+
+        return est;
+    }
+
+    unsigned reg(uint64_t key, unsigned i) const
+    { return reduce(probe(key, i), size); }
+
+private:
+    uint8_t* regs;
+    uint64_t total;
+    unsigned size;
+    unsigned zeros;
+};
+
+//-------------------------------------------------------------------------
+// banks
+//-------------------------------------------------------------------------
+
+// one bank per protocol.  everything is cleared when the window expires
+// instead of per tracker as the hash does.
+struct PortScanSketch::Bank
+{
+    CountSketch counts;
+    DistinctSketch ports;
+    DistinctSketch hosts;
+
+    uint64_t* alerted;
+    unsigned alert_bits;
+
+    uint8_t* mem;
+    size_t mem_size;
+
+    time_t expires = 0;
+    unsigned window = 0;
+
+    // distinct counts are not needed until one of these is reached
+    unsigned min_conn = UINT_MAX;
+    unsigned min_pri = UINT_MAX;
+
+    Bank(size_t budget);
+    ~Bank()
+    { snort_free(mem); }
+
+    void clear();
+
+    bool is_alerted(uint64_t key) const
+    { return (alerted[bit(key, 0) / 64] & bit_mask(key, 0)) and
+        (alerted[bit(key, 1) / 64] & bit_mask(key, 1)); }
+
+    void set_alerted(uint64_t key)
+    {
+        alerted[bit(key, 0) / 64] |= bit_mask(key, 0);
+        alerted[bit(key, 1) / 64] |= bit_mask(key, 1);
+    }
+
+    unsigned bit(uint64_t key, unsigned i) const
+    { return reduce(probe(mix(key), i), alert_bits); }
+
+    uint64_t bit_mask(uint64_t key, unsigned i) const
+    { return (uint64_t)1 << (bit(key, i) % 64); }
+};
+
+// 1/4 counts, 1/64 alert filter, and the rest split between ports and hosts
+PortScanSketch::Bank::Bank(size_t budget)
+{
+    size_t alert_words = std::min(std::max(budget / 512, (size_t)1), (size_t)1 << 20);
+    alert_bits = alert_words * 64;
+
+    size_t width = budget / 4 / CountSketch::mem_size(1);
+    width = std::min(std::max(width, (size_t)64), (size_t)CountSketch::max_width);
+
+    size_t left = budget - std::min(budget,
+        CountSketch::mem_size(width) + alert_words * sizeof(uint64_t));
+
+    size_t regs = std::max(left / 2, (size_t)DistinctSketch::min_regs);
+    regs = std::min(regs, (size_t)DistinctSketch::max_regs);
+
+    mem_size = alert_words * sizeof(uint64_t) + CountSketch::mem_size(width) + 2 * regs;
+    mem = (uint8_t*)snort_calloc(mem_size);
+
+    uint8_t* p = mem;
+    alerted = (uint64_t*)p;
+    p += alert_words * sizeof(uint64_t);
+
+    counts.init((CountCell*)p, width);
+    p += CountSketch::mem_size(width);
+
+    ports.init(p, regs);
+    hosts.init(p + regs, regs);
+}
+
+void PortScanSketch::Bank::clear()
+{
+    memset(alerted, 0, alert_bits / 8);
+    counts.clear();
+    ports.clear();
+    hosts.clear();
+    expires = 0;
+}
+
+//-------------------------------------------------------------------------
+// scratch trackers
+//-------------------------------------------------------------------------
+
+struct PortScanSketch::Entry
+{
+    PS_TRACKER tracker;
+    Bank* bank;
+    uint64_t key;
+};
+
+static unsigned bank_index(int proto)
+{
+    switch ( proto )
+    {
+    case PS_PROTO_TCP:  return 0;
+    case PS_PROTO_UDP:  return 1;
+    case PS_PROTO_ICMP: return 2;
+    case PS_PROTO_IP:   return 3;
+    }
+    return 4;
+}
+
+static void set_thresholds(
+    unsigned& min_conn, unsigned& min_pri, const PS_ALERT_CONF& conf, bool enabled)
+{
+    if ( !enabled )
+        return;
+
+    // the alert checks ignore scans when the threshold is zero
+    if ( conf.connection_count > 0 )
+        min_conn = std::min(min_conn, (unsigned)conf.connection_count);
+
+    min_pri = std::min(min_pri, (unsigned)std::max(conf.priority_count, (short)0));
+}
+
+//-------------------------------------------------------------------------
+// public methods
+//-------------------------------------------------------------------------
+
+PortScanSketch::PortScanSketch(const PortscanConfig* pc)
+{
+    memcap = pc->memcap;
+    protos = pc->detect_scans & PS_PROTO_ALL;
+
+    std::random_device rd;
+    seed = ((uint64_t)rd() << 32) | rd();
+
+    unsigned num = __builtin_popcount(protos);
+    size_t budget = num ? memcap / num : 0;
+
+    for ( int proto : { PS_PROTO_TCP, PS_PROTO_UDP, PS_PROTO_ICMP, PS_PROTO_IP } )
+    {
+        if ( !(protos & proto) )
+            continue;
+
+        Bank* b = new Bank(budget);
+        banks[bank_index(proto)] = b;
+        mem_used += b->mem_size;
+    }
+    scratch = new Entry[2];
+    configure(pc);
+}
+
+PortScanSketch::~PortScanSketch()
+{
+    for ( auto b : banks )
+        delete b;
+
+    delete[] scratch;
+}
+
+bool PortScanSketch::resize_needed(const PortscanConfig* pc) const
+{ return pc->memcap != memcap or (pc->detect_scans & PS_PROTO_ALL) != protos; }
+
+void PortScanSketch::configure(const PortscanConfig* pc)
+{
+    int types = pc->detect_scan_type;
+    bool ports = types & PS_TYPE_PORTSCAN;
+    bool decoy = types & PS_TYPE_DECOYSCAN;
+    bool sweep = types & PS_TYPE_PORTSWEEP;
+    bool dist = types & PS_TYPE_DISTPORTSCAN;
+
+    if ( Bank* b = get_bank(PS_PROTO_TCP) )
+    {
+        b->window = pc->tcp_window;
+        b->min_conn = b->min_pri = UINT_MAX;
+        set_thresholds(b->min_conn, b->min_pri, pc->tcp_ports, ports);
+        set_thresholds(b->min_conn, b->min_pri, pc->tcp_decoy, decoy);
+        set_thresholds(b->min_conn, b->min_pri, pc->tcp_sweep, sweep);
+        set_thresholds(b->min_conn, b->min_pri, pc->tcp_dist, dist);
+    }
+    if ( Bank* b = get_bank(PS_PROTO_UDP) )
+    {
+        b->window = pc->udp_window;
+        b->min_conn = b->min_pri = UINT_MAX;
+        set_thresholds(b->min_conn, b->min_pri, pc->udp_ports, ports);
+        set_thresholds(b->min_conn, b->min_pri, pc->udp_decoy, decoy);
+        set_thresholds(b->min_conn, b->min_pri, pc->udp_sweep, sweep);
+        set_thresholds(b->min_conn, b->min_pri, pc->udp_dist, dist);
+    }
+    if ( Bank* b = get_bank(PS_PROTO_IP) )
+    {
+        b->window = pc->ip_window;
+        b->min_conn = b->min_pri = UINT_MAX;
+        set_thresholds(b->min_conn, b->min_pri, pc->ip_proto, ports);
+        set_thresholds(b->min_conn, b->min_pri, pc->ip_decoy, decoy);
+        set_thresholds(b->min_conn, b->min_pri, pc->ip_sweep, sweep);
+        set_thresholds(b->min_conn, b->min_pri, pc->ip_dist, dist);
+    }
+    if ( Bank* b = get_bank(PS_PROTO_ICMP) )
+    {
+        b->window = pc->icmp_window;
+        b->min_conn = b->min_pri = UINT_MAX;
+        set_thresholds(b->min_conn, b->min_pri, pc->icmp_sweep, sweep);
+    }
+}
+
+void PortScanSketch::clear()
+{
+    for ( auto b : banks )
+    {
+        if ( b )
+            b->clear();
+    }
+}
+
+PS_TRACKER* PortScanSketch::get(
+    const void* key, unsigned len, int proto, const SfIp* peer, time_t now)
+{
+    Bank* b = get_bank(proto);
+
+    if ( !b )
+        return nullptr;
+
+    if ( now > b->expires )
+    {
+        if ( b->expires )
+        {
+            b->clear();
+            ++spstats.sketch_resets;
+        }
+        b->expires = now + b->window;
+    }
+
+    Entry& e = scratch[next];
+    next ^= 1;
+
+    memset(&e.tracker, 0, sizeof(e.tracker));
+    e.bank = b;
+    e.key = hash_bytes(key, len, seed);
+
+    PS_PROTO& p = e.tracker.proto;
+    p.window = b->expires;
+
+    if ( b->is_alerted(e.key) )
+        p.alerts = PS_ALERT_GENERATED;
+
+    if ( peer )
+        p.low_ip = p.high_ip = *peer;
+
+    return &e.tracker;
+}
+
+void PortScanSketch::update(
+    PS_PROTO* proto, int ps_cnt, int pri_cnt, const SfIp* ip, unsigned short port)
+{
+    Entry* e = get_entry(proto);
+    Bank* b = e->bank;
+
+    if ( ps_cnt < 0 )
+        b->counts.add_conn(e->key, ps_cnt);
+
+    else if ( pri_cnt )
+        b->counts.add_pri(e->key, pri_cnt);
+
+    else
+    {
+        b->counts.add_conn(e->key, ps_cnt);
+
+        // the hash tracker doesn't count an unset address or port 0 either
+        if ( ip->is_set() )
+            b->hosts.add(e->key, hash_bytes(ip->get_ip6_ptr(), 16, seed));
+
+        if ( port )
+        {
+            b->ports.add(e->key, mix(seed + port));
+            b->counts.add_port(e->key, port);
+        }
+    }
+}
+
+bool PortScanSketch::estimate(PS_TRACKER* t)
+{
+    Entry* e = get_entry(&t->proto);
+    Bank* b = e->bank;
+    PS_PROTO& p = t->proto;
+
+    b->counts.get(e->key, p);
+
+    if ( (unsigned)p.connection_count < b->min_conn and (unsigned)p.priority_count < b->min_pri )
+    {
+        p.u_ip_count = p.u_port_count = 0;
+        return false;
+    }
+
+    p.u_ip_count = b->hosts.estimate(e->key);
+    p.u_port_count = b->ports.estimate(e->key);
+    ++spstats.sketch_estimates;
+    return true;
+}
+
+void PortScanSketch::set_alerted(const PS_TRACKER* t)
+{
+    if ( !t->proto.alerts or t->proto.alerts == PS_ALERT_GENERATED )
+        return;
+
+    Entry* e = get_entry(&t->proto);
+    e->bank->set_alerted(e->key);
+}
+
+//-------------------------------------------------------------------------
+// private methods
+//-------------------------------------------------------------------------
+
+PortScanSketch::Bank* PortScanSketch::get_bank(int proto) const
+{
+    unsigned idx = bank_index(proto);
+    return idx < 4 ? banks[idx] : nullptr;
+}
+
+PortScanSketch::Entry* PortScanSketch::get_entry(const PS_PROTO* p)
+{
+    Entry* e = (p == &scratch[0].tracker.proto) ? scratch : scratch + 1;
+    assert(p == &e->tracker.proto);
+    return e;
+}
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+#include <vector>
+
+TEST_CASE("distinct sketch", "[port_scan]")
+{
+    std::vector<uint8_t> mem(1 << 16);
+    DistinctSketch ds;
+    ds.init(mem.data(), mem.size());
+
+    const uint64_t scanned = mix(1), quiet = mix(2);
+
+    for ( unsigned port = 1; port <= 100; ++port )
+    {
+        ds.add(scanned, mix(port));
+        ds.add(scanned, mix(port));
+    }
+    for ( unsigned port = 1; port <= 3; ++port )
+        ds.add(quiet, mix(port));
+
+    // other hosts add noise to all registers
+    for ( unsigned host = 0; host < 10000; ++host )
+    {
+        for ( unsigned port = 0; port < 3; ++port )
+            ds.add(mix(host + 100), mix(host * 3 + port));
+    }
+
+    unsigned n = ds.estimate(scanned);
+    CHECK(n >= 80);
+    CHECK(n <= 120);
+    CHECK(ds.estimate(quiet) < 15);
+    CHECK(ds.estimate(mix(3)) < 15);
+
+    ds.clear();
+    CHECK(ds.estimate(scanned) == 0);
+}
+
+TEST_CASE("count sketch", "[port_scan]")
+{
+    std::vector<CountCell> mem(CountSketch::rows * 1024);
+    CountSketch cs;
+    cs.init(mem.data(), 1024);
+    cs.clear();
+
+    const uint64_t key = mix(1);
+    PS_PROTO proto;
+
+    cs.add_conn(key, 1);
+    cs.add_conn(key, 1);
+    cs.add_conn(key, -1);
+    cs.add_pri(key, 3);
+    cs.add_port(key, 80);
+    cs.add_port(key, 22);
+    cs.add_port(key, 443);
+
+    cs.get(key, proto);
+    CHECK(proto.connection_count == 1);
+    CHECK(proto.priority_count == 3);
+    CHECK(proto.low_p == 22);
+    CHECK(proto.high_p == 443);
+
+    // counts don't go negative
+    cs.add_conn(key, -1);
+    cs.add_conn(key, -1);
+    cs.get(key, proto);
+    CHECK(proto.connection_count == 0);
+
+    cs.get(mix(2), proto);
+    CHECK(proto.priority_count == 0);
+    CHECK(proto.low_p == 0);
+}
+
+TEST_CASE("sketch tracker", "[port_scan]")
+{
+    PortscanConfig pc;
+    pc.memcap = 1 << 20;
+    pc.detect_scans = PS_PROTO_TCP;
+    pc.detect_scan_type = PS_TYPE_PORTSCAN;
+    pc.tcp_window = 60;
+    pc.tcp_ports = { 200, 10, 60, 15 };
+
+    PortScanSketch pss(&pc);
+    CHECK(pss.get_mem_used() <= pc.memcap);
+    CHECK(!pss.resize_needed(&pc));
+
+    SfIp scanner, scanned;
+    scanner.set("10.1.1.1");
+    scanned.set("10.9.9.9");
+
+    int key = 1;
+    CHECK(!pss.get(&key, sizeof(key), PS_PROTO_UDP, &scanner, 100));
+
+    for ( unsigned short port = 1; port <= 20; ++port )
+    {
+        PS_TRACKER* t = pss.get(&key, sizeof(key), PS_PROTO_TCP, &scanner, 100);
+        REQUIRE(t);
+        pss.update(&t->proto, 1, 0, &scanner, port);
+        pss.update(&t->proto, 0, 1, &scanner, 0);
+    }
+
+    PS_TRACKER* t = pss.get(&key, sizeof(key), PS_PROTO_TCP, &scanner, 100);
+    CHECK(t->proto.low_ip.equals(scanner));
+    CHECK(t->proto.alerts == 0);
+    CHECK(pss.estimate(t));
+    CHECK(t->proto.connection_count == 20);
+    CHECK(t->proto.priority_count == 20);
+    CHECK(t->proto.u_ip_count == 1);
+    CHECK(t->proto.u_port_count >= 14);
+    CHECK(t->proto.u_port_count <= 26);
+    CHECK(t->proto.low_p == 1);
+    CHECK(t->proto.high_p == 20);
+
+    t->proto.alerts = PS_ALERT_ONE_TO_ONE;
+    pss.set_alerted(t);
+
+    // a different key is not over threshold and not alerted
+    int other = 2;
+    PS_TRACKER* o = pss.get(&other, sizeof(other), PS_PROTO_TCP, &scanned, 101);
+    CHECK(o != t);
+    CHECK(!pss.estimate(o));
+    CHECK(o->proto.alerts == 0);
+
+    t = pss.get(&key, sizeof(key), PS_PROTO_TCP, &scanner, 160);
+    CHECK(t->proto.alerts == PS_ALERT_GENERATED);
+
+    // window expired
+    t = pss.get(&key, sizeof(key), PS_PROTO_TCP, &scanner, 161);
+    CHECK(t->proto.alerts == 0);
+    CHECK(!pss.estimate(t));
+    CHECK(t->proto.connection_count == 0);
+
+    pc.memcap *= 2;
+    CHECK(pss.resize_needed(&pc));
+}
+
+#endif
@@ -0,0 +1,87 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef PS_SKETCH_H
+#define PS_SKETCH_H
+
+// Fixed size alternative to the port scan tracker hash.  Connection and
+// reject counts are kept in count-min sketches and distinct port and
+// address counts in virtual HyperLogLogs that share one register array per
+// protocol, so memory does not depend on the number of hosts seen and
+// nothing is pruned.  The counts are estimates: count-min only overcounts
+// and the distinct counts get noisier as the registers fill up.
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+#include "ps_detect.h"
+
+class PortScanSketch
+{
+public:
+    PortScanSketch(const PortscanConfig*);
+    ~PortScanSketch();
+
+    // true if memcap or protocols changed so the banks must be rebuilt
+    bool resize_needed(const PortscanConfig*) const;
+
+    // updates windows and thresholds
+    void configure(const PortscanConfig*);
+
+    void clear();
+
+    size_t get_mem_used() const
+    { return mem_used; }
+
+    // returns a scratch tracker for the key that stays valid until the
+    // second following get().  peer is reported as the address range.
+    // returns nullptr if the protocol is not tracked.
+    PS_TRACKER* get(const void* key, unsigned len, int proto,
+        const snort::SfIp* peer, time_t now);
+
+    // same arguments as the hash tracker update but applied to the sketch
+    void update(PS_PROTO*, int ps_cnt, int pri_cnt, const snort::SfIp*, unsigned short port);
+
+    // fills in the tracker counts.  the distinct counts are only estimated
+    // if a count is high enough for an alert.  returns true if they were.
+    bool estimate(PS_TRACKER*);
+
+    // suppress further alerts for the tracker until the window expires
+    void set_alerted(const PS_TRACKER*);
+
+private:
+    struct Bank;
+    struct Entry;
+
+    Bank* get_bank(int proto) const;
+    Entry* get_entry(const PS_PROTO*);
+
+private:
+    Bank* banks[4] = { };
+    Entry* scratch;
+    unsigned next = 0;
+
+    uint64_t seed;
+    size_t memcap;
+    size_t mem_used = 0;
+    int protos;
+};
+
+#endif
+
@@ -73,6 +73,8 @@ struct ListFile
     std::set<unsigned int> intfs;
     uint8_t list_index;
     uint8_t list_type;
+    uint64_t file_size = 0;     // when loaded, to check a list image
+    int64_t file_mtime = 0;     // nanoseconds
 };
 
 typedef std::vector<ListFile*> ListFiles;
@@ -92,6 +94,10 @@ struct ReputationConfig
     table_flat_t* ip_list = nullptr;
     ListFiles list_files;
     std::string list_dir;
+    std::string list_image;
+    uint32_t segment_used = 0;
+    uint8_t* list_image_map = nullptr;
+    size_t list_image_size = 0;
 
     ~ReputationConfig();
 };
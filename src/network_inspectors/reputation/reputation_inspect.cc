@@ -29,6 +29,7 @@
 #include "detection/detection_engine.h"
 #include "events/event_queue.h"
 #include "log/messages.h"
+#include "main/snort_config.h"
 #include "network_inspectors/packet_tracer/packet_tracer.h"
 #include "packet_io/active.h"
 #include "profiler/profiler.h"
@@ -393,6 +394,20 @@ Reputation::Reputation(ReputationConfig* pc)
         read_manifest(MANIFEST_FILENAME, conf);
 
     add_block_allow_List(conf);
+
+    // -T loads the lists and writes the image instead of using it
+    bool test_mode = SnortConfig::get_conf()->test_mode();
+
+    if ( !conf->list_image.empty() and !test_mode )
+    {
+        if ( load_list_image(conf) )
+        {
+            reputationstats.memory_allocated = sfrt_flat_usage(conf->ip_list);
+            return;
+        }
+        ParseWarning(WARN_CONF, "reputation: can't use list image; loading lists.");
+    }
+
     estimate_num_entries(conf);
     if (conf->num_entries <= 0)
     {
@@ -403,12 +418,16 @@ Reputation::Reputation(ReputationConfig* pc)
 
     ip_list_init(conf->num_entries + 1, conf);
     reputationstats.memory_allocated = sfrt_flat_usage(conf->ip_list);
+
+    if ( !conf->list_image.empty() and test_mode )
+        save_list_image(conf);
 }
 
 void Reputation::show(const SnortConfig*) const
 {
     ConfigLogger::log_value("blocklist", config.blocklist_path.c_str());
     ConfigLogger::log_value("list_dir", config.list_dir.c_str());
+    ConfigLogger::log_value("list_image", config.list_image.c_str());
     ConfigLogger::log_value("memcap", config.memcap);
     ConfigLogger::log_value("nested_ip", to_string(config.nested_ip));
     ConfigLogger::log_value("priority", to_string(config.priority));
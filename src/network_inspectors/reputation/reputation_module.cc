@@ -60,6 +60,9 @@ static const Parameter s_params[] =
     { "list_dir", Parameter::PT_STRING, nullptr, nullptr,
       "directory for IP lists and manifest file" },
 
+    { "list_image", Parameter::PT_STRING, nullptr, nullptr,
+      "prebuilt IP list image to map instead of loading the lists; written with -T" },
+
     { "memcap", Parameter::PT_INT, "1:4095", "500",
       "maximum total MB of memory allocated" },
 
@@ -135,6 +138,9 @@ bool ReputationModule::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("list_dir") )
         conf->list_dir = v.get_string();
 
+    else if ( v.is("list_image") )
+        conf->list_image = v.get_string();
+
     else if ( v.is("memcap") )
         conf->memcap = v.get_uint32();
 
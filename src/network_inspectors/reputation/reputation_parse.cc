@@ -23,10 +23,17 @@
 
 #include "reputation_parse.h"
 
+#include <fcntl.h>
 #include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <cassert>
+#include <cinttypes>
 #include <climits>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <limits>
 
@@ -36,6 +43,10 @@
 #include "utils/util.h"
 #include "utils/util_cstring.h"
 
+#ifdef UNIT_TEST
+#include "catch/snort_catch.h"
+#endif
+
 using namespace snort;
 using namespace std;
 
@@ -68,6 +79,36 @@ static char monitor_info[] = "monitorlist";
 
 #define MAX_MSGS_TO_PRINT      20
 
+// the segment starts on a page boundary in the image file
+#define LIST_IMAGE_MAGIC        "SNRPIMG"
+#define LIST_IMAGE_VERSION      2
+#define LIST_IMAGE_ALIGN        4096
+
+struct ListImageHeader
+{
+    char magic[8];
+    uint32_t version;         // also fails if the byte order differs
+    uint32_t header_size;
+    uint32_t table_size;      // sizeof(table_flat_t)
+    uint32_t num_lists;       // ListImageRecords follow the header
+    uint32_t memcap;          // config used to load the lists
+    uint32_t priority;
+    uint32_t allow_action;
+    uint32_t unused;
+    uint64_t segment_offset;
+    uint64_t segment_size;
+};
+
+struct ListImageRecord
+{
+    uint64_t file_size;       // list file when it was loaded
+    int64_t file_mtime;
+    uint32_t file_type;
+    uint32_t list_id;
+    uint32_t name_len;        // name follows, padded to 8 bytes
+    uint32_t unused;
+};
+
 unsigned long total_duplicates;
 unsigned long total_invalids;
 
@@ -75,11 +116,21 @@ int totalNumEntries = 0;
 
 static void load_list_file(ListFile*, ReputationConfig* config);
 
+// the size and modification time stand in for the contents of a list file
+static void get_file_stamp(const struct stat& st, uint64_t& size, int64_t& mtime)
+{
+    size = st.st_size;
+    mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+}
+
 ReputationConfig::~ReputationConfig()
 {
     if (reputation_segment != nullptr)
         snort_free(reputation_segment);
 
+    if (list_image_map != nullptr)
+        munmap(list_image_map, list_image_size);
+
     for (auto& file : list_files)
     {
         delete file;
@@ -111,6 +162,25 @@ static uint32_t estimate_size(uint32_t num_entries, uint32_t memcap)
     return (uint32_t)size;
 }
 
+static void set_list_types(ReputationConfig* config)
+{
+    for (size_t i = 0; i < config->list_files.size(); i++)
+    {
+        config->list_files[i]->list_index = (uint8_t)i + 1;
+        if (config->list_files[i]->file_type == ALLOW_LIST)
+        {
+            if (config->allow_action == DO_NOT_BLOCK)
+                config->list_files[i]->list_type = TRUSTED_DO_NOT_BLOCK;
+            else
+                config->list_files[i]->list_type = TRUSTED;
+        }
+        else if (config->list_files[i]->file_type == BLOCK_LIST)
+            config->list_files[i]->list_type = BLOCKED;
+        else if (config->list_files[i]->file_type == MONITOR_LIST)
+            config->list_files[i]->list_type = MONITORED;
+    }
+}
+
 void ip_list_init(uint32_t max_entries, ReputationConfig* config)
 {
     if ( !config->ip_list )
@@ -134,23 +204,12 @@ void ip_list_init(uint32_t max_entries, ReputationConfig* config)
         }
 
         total_duplicates = 0;
-        for (size_t i = 0; i < config->list_files.size(); i++)
-        {
-            config->list_files[i]->list_index = (uint8_t)i + 1;
-            if (config->list_files[i]->file_type == ALLOW_LIST)
-            {
-                if (config->allow_action == DO_NOT_BLOCK)
-                    config->list_files[i]->list_type = TRUSTED_DO_NOT_BLOCK;
-                else
-                    config->list_files[i]->list_type = TRUSTED;
-            }
-            else if (config->list_files[i]->file_type == BLOCK_LIST)
-                config->list_files[i]->list_type = BLOCKED;
-            else if (config->list_files[i]->file_type == MONITOR_LIST)
-                config->list_files[i]->list_type = MONITORED;
+        set_list_types(config);
 
-            load_list_file(config->list_files[i], config);
-        }
+        for (auto& file : config->list_files)
+            load_list_file(file, config);
+
+        config->segment_used = mem_size - segment_unusedmem();
     }
 }
 
@@ -586,11 +645,18 @@ static void load_list_file(ListFile* list_info, ReputationConfig* config)
     unsigned int fail_count = 0;   /*number of invalid entries in this file*/
     unsigned int num_loaded_before = 0;     /*number of valid entries loaded */
 
+    update_path_to_file(full_path_filename, PATH_MAX, list_info->file_name.c_str());
+
+    // stamped before reading so a later change always fails the image check,
+    // even for lists that aren't loaded
+    struct stat st;
+
+    if ( !stat(full_path_filename, &st) )
+        get_file_stamp(st, list_info->file_size, list_info->file_mtime);
+
     if (config->memcap_reached)
         return;
 
-    update_path_to_file(full_path_filename, PATH_MAX, list_info->file_name.c_str());
-
     list_type_name = get_list_type_name(list_info);
 
     if (!list_type_name)
@@ -959,3 +1025,432 @@ int read_manifest(const char* manifest_file, ReputationConfig* config)
     return 0;
 }
 
+// everything sfrt_flat_dir8x_lookup and get_reputation follow from the table
+// must be checked because the lookups trust the image completely
+struct ListImageCheck
+{
+    const uint8_t* base;      // start of the segment
+    uint64_t size;            // of the segment
+    uint64_t entries_left;    // bounds the walk if a bad image shares sub tables
+    uint32_t max_size;        // of the data table
+    size_t num_lists;
+};
+
+template<typename T>
+static const T* image_at(const ListImageCheck& ic, uint64_t off, uint64_t num = 1)
+{
+    if ( off > ic.size or num > (ic.size - off) / sizeof(T) )
+        return nullptr;
+
+    return (const T*)(ic.base + off);
+}
+
+// the dimensions of DIR_8x16 as allocated by sfrt_flat_new
+static const int ip4_dims[] = { 16, 8, 4, 4 };
+static const int ip6_dims[] = { 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8 };
+
+static bool check_sub_table(ListImageCheck& ic, MEM_OFFSET off, const int* dims, int depth,
+    int num_dims)
+{
+    const dir_sub_table_flat_t* sub = image_at<dir_sub_table_flat_t>(ic, off);
+
+    if ( !sub or sub->width != dims[depth] or sub->num_entries != (1 << sub->width)
+        or (uint64_t)sub->num_entries > ic.entries_left )
+        return false;
+
+    ic.entries_left -= sub->num_entries;
+    const DIR_Entry* entries = image_at<DIR_Entry>(ic, sub->entries, sub->num_entries);
+
+    if ( !entries )
+        return false;
+
+    for ( int i = 0; i < sub->num_entries; i++ )
+    {
+        // same test as the lookup: a zero value or a length is a data index
+        if ( !entries[i].value or entries[i].length )
+        {
+            if ( entries[i].value >= ic.max_size )
+                return false;
+        }
+        else if ( depth + 1 >= num_dims
+            or !check_sub_table(ic, entries[i].value, dims, depth + 1, num_dims) )
+            return false;
+    }
+    return true;
+}
+
+static bool check_dir_table(ListImageCheck& ic, TABLE_PTR off, const int* dims, int num_dims)
+{
+    const dir_table_flat_t* rt = image_at<dir_table_flat_t>(ic, off);
+
+    if ( !off or !rt or rt->dim_size != num_dims
+        or memcmp(rt->dimensions, dims, num_dims * sizeof(*dims)) )
+        return false;
+
+    return check_sub_table(ic, rt->sub_table, dims, 0, num_dims);
+}
+
+static bool check_rep_info(const ListImageCheck& ic, MEM_OFFSET off)
+{
+    while ( const IPrepInfo* info = image_at<IPrepInfo>(ic, off) )
+    {
+        for ( int i = 0; i < NUM_INDEX_PER_ENTRY; i++ )
+        {
+            int list_index = info->list_indexes[i];
+
+            if ( list_index < 0 or (size_t)list_index > ic.num_lists )
+                return false;
+        }
+        if ( !info->next )
+            return true;
+
+        // segment memory is only ever appended so a chain always moves forward,
+        // which also rules out loops
+        if ( info->next <= off )
+            return false;
+
+        off = info->next;
+    }
+    return false;
+}
+
+static bool check_list_table(const uint8_t* segment, uint64_t size, size_t num_lists)
+{
+    const table_flat_t* table = (const table_flat_t*)segment;
+
+    if ( table->table_flat_type != DIR_8x16 or table->ip_type != IPv6
+        or table->allocated > size or !table->num_ent or table->num_ent > table->max_size )
+        return false;
+
+    ListImageCheck ic { segment, size, size / sizeof(DIR_Entry), table->max_size, num_lists };
+    const INFO* data = image_at<INFO>(ic, table->data, table->max_size);
+
+    if ( !data )
+        return false;
+
+    for ( uint32_t i = 0; i < table->max_size; i++ )
+    {
+        if ( data[i] and !check_rep_info(ic, data[i]) )
+            return false;
+    }
+
+    return check_dir_table(ic, table->rt, ip4_dims, (int)(sizeof(ip4_dims) / sizeof(*ip4_dims)))
+        and check_dir_table(ic, table->rt6, ip6_dims, (int)(sizeof(ip6_dims) / sizeof(*ip6_dims)));
+}
+
+static const char* check_list_image(const uint8_t* image, size_t size, const ReputationConfig* config)
+{
+    const ListImageHeader* hdr = (const ListImageHeader*)image;
+
+    if ( memcmp(hdr->magic, LIST_IMAGE_MAGIC, sizeof(hdr->magic)) )
+        return "not a list image";
+
+    if ( hdr->version != LIST_IMAGE_VERSION or hdr->header_size != sizeof(*hdr)
+        or hdr->table_size != sizeof(table_flat_t) )
+        return "unsupported version";
+
+    if ( hdr->segment_offset % LIST_IMAGE_ALIGN or hdr->segment_offset > size
+        or hdr->segment_size > size - hdr->segment_offset
+        or hdr->segment_size < sizeof(table_flat_t) )
+        return "truncated";
+
+    if ( hdr->memcap != config->memcap or hdr->priority != (uint32_t)config->priority
+        or hdr->allow_action != (uint32_t)config->allow_action )
+        return "config changed";
+
+    if ( hdr->num_lists != config->list_files.size() )
+        return "lists changed";
+
+    // the segment only has list indexes so the lists must be in the same order
+    size_t off = sizeof(*hdr);
+
+    for (auto& file : config->list_files)
+    {
+        if ( off + sizeof(ListImageRecord) > hdr->segment_offset )
+            return "truncated";
+
+        const ListImageRecord* rec = (const ListImageRecord*)(image + off);
+        off += sizeof(*rec);
+
+        if ( rec->name_len > hdr->segment_offset - off )
+            return "truncated";
+
+        if ( rec->file_type != (uint32_t)file->file_type or rec->list_id != file->list_id
+            or file->file_name.compare(0, string::npos, (const char*)image + off, rec->name_len) )
+            return "lists changed";
+
+        // a missing list has no stamp and no entries
+        char full_path_filename[PATH_MAX+1];
+        update_path_to_file(full_path_filename, PATH_MAX, file->file_name.c_str());
+
+        struct stat st;
+        uint64_t file_size = 0;
+        int64_t file_mtime = 0;
+
+        if ( !stat(full_path_filename, &st) )
+            get_file_stamp(st, file_size, file_mtime);
+
+        if ( rec->file_size != file_size or rec->file_mtime != file_mtime )
+            return "list file changed";
+
+        off += (rec->name_len + 7) & ~7;
+    }
+
+    if ( !check_list_table(image + hdr->segment_offset, hdr->segment_size, hdr->num_lists) )
+        return "bad table";
+
+    return nullptr;
+}
+
+bool load_list_image(ReputationConfig* config)
+{
+    char full_path_filename[PATH_MAX+1];
+    update_path_to_file(full_path_filename, PATH_MAX, config->list_image.c_str());
+
+    int fd = open(full_path_filename, O_RDONLY);
+
+    if ( fd < 0 )
+    {
+        ErrorMessage("Unable to open list image %s, Error: %s\n", full_path_filename,
+            get_error(errno));
+        return false;
+    }
+
+    struct stat st;
+    void* map = MAP_FAILED;
+
+    if ( !fstat(fd, &st) and (size_t)st.st_size >= sizeof(ListImageHeader) )
+        map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if ( map == MAP_FAILED )
+    {
+        ErrorMessage("Unable to map list image %s\n", full_path_filename);
+        return false;
+    }
+
+    const uint8_t* image = (const uint8_t*)map;
+
+    if ( const char* err = check_list_image(image, st.st_size, config) )
+    {
+        ErrorMessage("Invalid list image %s: %s\n", full_path_filename, err);
+        munmap(map, st.st_size);
+        return false;
+    }
+
+    const ListImageHeader* hdr = (const ListImageHeader*)image;
+
+    config->list_image_map = (uint8_t*)map;
+    config->list_image_size = st.st_size;
+    config->ip_list = (table_flat_t*)(config->list_image_map + hdr->segment_offset);
+    set_list_types(config);
+
+    LogMessage("    Reputation entries mapped: %u (from image %s)\n",
+        sfrt_flat_num_entries(config->ip_list), full_path_filename);
+
+    return true;
+}
+
+bool save_list_image(const ReputationConfig* config)
+{
+    if ( !config->ip_list or !config->reputation_segment )
+        return false;
+
+    std::string lists;
+
+    for (auto& file : config->list_files)
+    {
+        ListImageRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.file_size = file->file_size;
+        rec.file_mtime = file->file_mtime;
+        rec.file_type = file->file_type;
+        rec.list_id = file->list_id;
+        rec.name_len = file->file_name.size();
+
+        lists.append((const char*)&rec, sizeof(rec));
+        lists.append(file->file_name);
+        lists.resize((lists.size() + 7) & ~7, '\0');
+    }
+
+    ListImageHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, LIST_IMAGE_MAGIC, sizeof(hdr.magic));
+    hdr.version = LIST_IMAGE_VERSION;
+    hdr.header_size = sizeof(hdr);
+    hdr.table_size = sizeof(table_flat_t);
+    hdr.num_lists = config->list_files.size();
+    hdr.memcap = config->memcap;
+    hdr.priority = config->priority;
+    hdr.allow_action = config->allow_action;
+    hdr.segment_offset = (sizeof(hdr) + lists.size() + LIST_IMAGE_ALIGN - 1) &
+        ~(uint64_t)(LIST_IMAGE_ALIGN - 1);
+    hdr.segment_size = config->segment_used;
+
+    std::string pad(hdr.segment_offset - sizeof(hdr) - lists.size(), '\0');
+
+    char full_path_filename[PATH_MAX+1];
+    update_path_to_file(full_path_filename, PATH_MAX, config->list_image.c_str());
+
+    // write a temporary file and rename it so a running snort never sees a
+    // partial image and keeps its mapping of the old one
+    std::string tmp_filename = std::string(full_path_filename) + ".tmp";
+    FILE* fp = fopen(tmp_filename.c_str(), "wb");
+
+    if ( !fp )
+    {
+        ErrorMessage("Unable to create list image %s, Error: %s\n", tmp_filename.c_str(),
+            get_error(errno));
+        return false;
+    }
+
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1
+        and fwrite(lists.data(), 1, lists.size(), fp) == lists.size()
+        and fwrite(pad.data(), 1, pad.size(), fp) == pad.size()
+        and fwrite(config->reputation_segment, 1, hdr.segment_size, fp) == hdr.segment_size
+        and !fflush(fp) and !fsync(fileno(fp));
+
+    ok = !fclose(fp) and ok;
+
+    if ( ok and !rename(tmp_filename.c_str(), full_path_filename) )
+    {
+        LogMessage("    Reputation list image written: %" PRIu64 " bytes (to image %s)\n",
+            hdr.segment_offset + hdr.segment_size, full_path_filename);
+        return true;
+    }
+
+    ErrorMessage("Unable to write list image %s, Error: %s\n", full_path_filename,
+        get_error(errno));
+    unlink(tmp_filename.c_str());
+    return false;
+}
+
+#ifdef UNIT_TEST
+
+static void set_test_lists(ReputationConfig& conf, const string& dir)
+{
+    ListFile* file = new ListFile;
+    file->file_name = dir + "/block.list";
+    file->file_type = BLOCK_LIST;
+    file->list_id = 7;
+    file->all_intfs_enabled = true;
+    conf.list_files.emplace_back(file);
+    conf.list_image = dir + "/lists.img";
+}
+
+static const IPrepInfo* test_lookup(const ReputationConfig& conf, const char* addr)
+{
+    SfIp ip;
+    ip.set(addr);
+    return (const IPrepInfo*)sfrt_flat_dir8x_lookup(&ip, conf.ip_list);
+}
+
+// patch one 32 bit word of the segment in the image file
+static void corrupt_image(const string& path, uint64_t seg_off, uint32_t val)
+{
+    ListImageHeader hdr;
+    FILE* fp = fopen(path.c_str(), "r+b");
+    REQUIRE(fp);
+    REQUIRE(fread(&hdr, sizeof(hdr), 1, fp) == 1);
+    REQUIRE(!fseek(fp, hdr.segment_offset + seg_off, SEEK_SET));
+    REQUIRE(fwrite(&val, sizeof(val), 1, fp) == 1);
+    fclose(fp);
+}
+
+TEST_CASE("list image save, load, and lookup", "[reputation]")
+{
+    char dir[] = "/tmp/rep_image_XXXXXX";
+    REQUIRE(mkdtemp(dir));
+
+    std::ofstream(string(dir) + "/block.list") << "10.1.2.3\n192.168.0.0/16\n2001:db8::/32\n";
+
+    ReputationConfig saved;
+    set_test_lists(saved, dir);
+    ip_list_init(8, &saved);
+    REQUIRE(saved.ip_list);
+    REQUIRE(save_list_image(&saved));
+
+    // the image must not depend on the segment set up for the last list load
+    segment_meminit(nullptr, 0);
+
+    ReputationConfig loaded;
+    set_test_lists(loaded, dir);
+    REQUIRE(load_list_image(&loaded));
+
+    CHECK(sfrt_flat_num_entries(loaded.ip_list) == 3);
+    CHECK(sfrt_flat_usage(loaded.ip_list) == sfrt_flat_usage(saved.ip_list));
+
+    const IPrepInfo* info = test_lookup(loaded, "10.1.2.3");
+    REQUIRE(info);
+    CHECK(info->list_indexes[0] == 1);
+    CHECK(loaded.list_files[0]->list_type == BLOCKED);
+
+    CHECK(test_lookup(loaded, "192.168.40.1"));
+    CHECK(test_lookup(loaded, "2001:db8::1"));
+    CHECK(!test_lookup(loaded, "10.1.2.4"));
+    CHECK(!test_lookup(loaded, "2001:db9::1"));
+
+    string image = loaded.list_image;
+    uint64_t info_off = (const uint8_t*)info - (const uint8_t*)loaded.ip_list;
+    uint64_t rt6_off = loaded.ip_list->rt6 + offsetof(dir_table_flat_t, sub_table);
+
+    SECTION("bad list index")
+    {
+        corrupt_image(image, info_off + offsetof(IPrepInfo, list_indexes), 2);
+        ReputationConfig bad;
+        set_test_lists(bad, dir);
+        CHECK(!load_list_image(&bad));
+    }
+    SECTION("bad sub table")
+    {
+        corrupt_image(image, rt6_off, 0xfffffff0);
+        ReputationConfig bad;
+        set_test_lists(bad, dir);
+        CHECK(!load_list_image(&bad));
+    }
+    SECTION("edited list")
+    {
+        std::ofstream(string(dir) + "/block.list", std::ios::app) << "10.9.9.9\n";
+        ReputationConfig bad;
+        set_test_lists(bad, dir);
+        CHECK(!load_list_image(&bad));
+
+        // the lists are loaded instead
+        ip_list_init(8, &bad);
+        REQUIRE(bad.ip_list);
+        CHECK(test_lookup(bad, "10.9.9.9"));
+    }
+    SECTION("touched list")
+    {
+        // same size and contents, only the modification time differs
+        struct timespec times[2] = { { 0, UTIME_OMIT }, { 12345, 0 } };
+        REQUIRE(!utimensat(AT_FDCWD, (string(dir) + "/block.list").c_str(), times, 0));
+        ReputationConfig bad;
+        set_test_lists(bad, dir);
+        CHECK(!load_list_image(&bad));
+    }
+    SECTION("changed config")
+    {
+        ReputationConfig bad;
+        set_test_lists(bad, dir);
+        bad.memcap = saved.memcap + 1;
+        CHECK(!load_list_image(&bad));
+
+        bad.memcap = saved.memcap;
+        bad.priority = BLOCKED;
+        CHECK(!load_list_image(&bad));
+
+        bad.priority = saved.priority;
+        bad.allow_action = TRUST;
+        CHECK(!load_list_image(&bad));
+
+        bad.allow_action = saved.allow_action;
+        CHECK(load_list_image(&bad));
+    }
+    unlink(image.c_str());
+    unlink((string(dir) + "/block.list").c_str());
+    rmdir(dir);
+}
+
+#endif
@@ -29,4 +29,10 @@ void estimate_num_entries(ReputationConfig* config);
 int read_manifest(const char* filename, ReputationConfig* config);
 void add_block_allow_List(ReputationConfig* config);
 
+// the list image is the loaded segment written to a file so it can be
+// mapped read only by every reputation instance instead of loading the
+// lists again.  load fails if the image doesn't match the configured lists.
+bool load_list_image(ReputationConfig* config);
+bool save_list_image(const ReputationConfig* config);
+
 #endif
@@ -25,11 +25,13 @@
 #include <hs_compile.h>
 #include <hs_runtime.h>
 
+#include <atomic>
 #include <cassert>
 #include <cstring>
 
 #include "framework/module.h"
 #include "framework/mpse.h"
+#include "helpers/hyper_db_cache.h"
 #include "helpers/scratch_allocator.h"
 #include "log/messages.h"
 #include "main/snort_config.h"
@@ -114,11 +116,36 @@ struct ScanContext
     void* match_ctx;
     int nfound = 0;
 
+    // stream mode only
+    unsigned long long base = 0;
+    uint64_t* seen = nullptr;
+
     ScanContext(HyperscanMpse* m, MpseMatch cb, void* ctx)
     { mpse = m; match_cb = cb; match_ctx = ctx; }
 
 };
 
+// the owner id rather than the mpse pointer ties a stream to its database
+// since a reloaded mpse may be allocated at the address of a deleted one
+
+class HyperscanStream : public MpseStream
+{
+public:
+    HyperscanStream(hs_stream_t* s, uint64_t id, size_t n)
+    { stream = s; owner = id; size = n; }
+
+    ~HyperscanStream() override
+    { hs_close_stream(stream, nullptr, nullptr, nullptr); }
+
+    size_t size_of() const override
+    { return sizeof(*this) + size; }
+
+    hs_stream_t* stream;
+    uint64_t owner;
+    size_t size;
+    unsigned long long offset = 0;
+};
+
 //-------------------------------------------------------------------------
 // mpse
 //-------------------------------------------------------------------------
@@ -130,13 +157,14 @@ public:
         : Mpse("hyperscan")
     {
         agent = a;
+        owner_id = ++next_id;
         ++instances;
     }
 
     ~HyperscanMpse() override
     {
-        if ( hs_db )
-            hs_free_database(hs_db);
+        HyperDbCache::release(hs_db);
+        HyperDbCache::release(hs_stream_db);
 
         if ( agent )
             user_dtor();
@@ -156,6 +184,14 @@ public:
 
     int _search(const uint8_t*, int, MpseMatch, void*, int*) override;
 
+    void set_stream_mode() override
+    { stream_mode = true; }
+
+    MpseStream* open_stream() override;
+    bool reset_stream(MpseStream*) override;
+
+    int _search_stream(MpseStream*, const uint8_t*, int, MpseMatch, void*) override;
+
     int get_pattern_count() const override
     { return pvector.size(); }
 
@@ -165,22 +201,37 @@ public:
         unsigned id, unsigned long long from, unsigned long long to,
         unsigned flags, void*);
 
+    static int stream_match(
+        unsigned id, unsigned long long from, unsigned long long to,
+        unsigned flags, void*);
+
 private:
     void user_ctor(SnortConfig*);
     void user_dtor();
 
+    int compile(SnortConfig*, const std::vector<const char*>&, std::vector<unsigned>&,
+        const std::vector<unsigned>&, unsigned mode, hs_database_t**);
+
     const MpseAgent* agent;
     PatternVector pvector;
 
     hs_database_t* hs_db = nullptr;
+    hs_database_t* hs_stream_db = nullptr;
+    size_t stream_size = 0;
+
+    uint64_t owner_id;
+    bool stream_mode = false;
+
+    static std::atomic<uint64_t> next_id;
 
 public:
-    static uint64_t instances;
-    static uint64_t patterns;
+    static std::atomic<uint64_t> instances;
+    static std::atomic<uint64_t> patterns;
 };
 
-uint64_t HyperscanMpse::instances = 0;
-uint64_t HyperscanMpse::patterns = 0;
+std::atomic<uint64_t> HyperscanMpse::next_id(0);
+std::atomic<uint64_t> HyperscanMpse::instances(0);
+std::atomic<uint64_t> HyperscanMpse::patterns(0);
 
 // other mpse have direct access to their fsm match states and populate
 // user list and tree with each pattern that leads to the same match state.
@@ -218,6 +269,31 @@ void HyperscanMpse::user_dtor()
     }
 }
 
+int HyperscanMpse::compile(
+    SnortConfig* sc, const std::vector<const char*>& pats, std::vector<unsigned>& flags,
+    const std::vector<unsigned>& ids, unsigned mode, hs_database_t** db)
+{
+    hs_compile_error_t* errptr = nullptr;
+
+    if ( HyperDbCache::acquire_multi(sc->hyperscan_cache.c_str(), &pats[0], &flags[0], &ids[0],
+            pvector.size(), mode, db, &errptr) or !*db )
+    {
+        ParseError("can't compile hyperscan pattern database: %s (%d) - '%s'",
+            errptr->message, errptr->expression,
+            errptr->expression >= 0 ? pats[errptr->expression] : "");
+        hs_free_compile_error(errptr);
+        return -2;
+    }
+
+    if ( hs_error_t err = hs_alloc_scratch(*db, &s_scratch[get_instance_id()]) )
+    {
+        ParseError("can't allocate search scratch space (%d)", err);
+        return -3;
+    }
+
+    return 0;
+}
+
 int HyperscanMpse::prep_patterns(SnortConfig* sc)
 {
     if ( pvector.empty() )
@@ -229,7 +305,6 @@ int HyperscanMpse::prep_patterns(SnortConfig* sc)
         return -1;
     }
 
-    hs_compile_error_t* errptr = nullptr;
     std::vector<const char*> pats;
     std::vector<unsigned> flags;
     std::vector<unsigned> ids;
@@ -243,20 +318,20 @@ int HyperscanMpse::prep_patterns(SnortConfig* sc)
         ids.emplace_back(id++);
     }
 
-    if ( hs_compile_multi(&pats[0], &flags[0], &ids[0], pvector.size(), HS_MODE_BLOCK,
-            nullptr, &hs_db, &errptr) or !hs_db )
-    {
-        ParseError("can't compile hyperscan pattern database: %s (%d) - '%s'",
-            errptr->message, errptr->expression,
-            errptr->expression >= 0 ? pats[errptr->expression] : "");
-        hs_free_compile_error(errptr);
-        return -2;
-    }
+    if ( int ret = compile(sc, pats, flags, ids, HS_MODE_BLOCK, &hs_db) )
+        return ret;
 
-    if ( hs_error_t err = hs_alloc_scratch(hs_db, &s_scratch[get_instance_id()]) )
+    if ( stream_mode )
     {
-        ParseError("can't allocate search scratch space (%d)", err);
-        return -3;
+        // single match would apply to the life of the stream instead of
+        // each buffer so we filter repeats in stream_match instead
+        for ( auto& f : flags )
+            f &= ~HS_FLAG_SINGLEMATCH;
+
+        if ( int ret = compile(sc, pats, flags, ids, HS_MODE_STREAM, &hs_stream_db) )
+            return ret;
+
+        hs_stream_size(hs_stream_db, &stream_size);
     }
 
     if ( agent )
@@ -272,6 +347,12 @@ void HyperscanMpse::reuse_search()
 
     if ( hs_error_t err = hs_alloc_scratch(hs_db, &s_scratch[get_instance_id()]) )
         ErrorMessage("can't allocate search scratch space (%d)", err);
+
+    if ( !hs_stream_db )
+        return;
+
+    if ( hs_error_t err = hs_alloc_scratch(hs_stream_db, &s_scratch[get_instance_id()]) )
+        ErrorMessage("can't allocate stream search scratch space (%d)", err);
 }
 
 int HyperscanMpse::match(unsigned id, unsigned long long to, MpseMatch match_cb, void* match_ctx)
@@ -290,6 +371,24 @@ int HyperscanMpse::match(
     return  scan->mpse->match(id, to, scan->match_cb, scan->match_ctx);
 }
 
+int HyperscanMpse::stream_match(
+    unsigned id, unsigned long long /*from*/, unsigned long long to,
+    unsigned /*flags*/, void* pv)
+{
+    ScanContext* scan = (ScanContext*)pv;
+    uint64_t bit = (uint64_t)1 << (id % 64);
+
+    if ( scan->seen[id / 64] & bit )
+        return 0;
+
+    scan->seen[id / 64] |= bit;
+    scan->nfound++;
+
+    // matches ending in an earlier buffer were already reported
+    assert(to > scan->base);
+    return  scan->mpse->match(id, to - scan->base, scan->match_cb, scan->match_ctx);
+}
+
 int HyperscanMpse::_search(
     const uint8_t* buf, int n, MpseMatch mf, void* pv, int* current_state)
 {
@@ -307,6 +406,79 @@ int HyperscanMpse::_search(
     return scan.nfound;
 }
 
+MpseStream* HyperscanMpse::open_stream()
+{
+    if ( !hs_stream_db )
+        return nullptr;
+
+    hs_stream_t* stream = nullptr;
+
+    if ( hs_open_stream(hs_stream_db, 0, &stream) != HS_SUCCESS )
+        return nullptr;
+
+    return new HyperscanStream(stream, owner_id, stream_size);
+}
+
+bool HyperscanMpse::reset_stream(MpseStream* ms)
+{
+    HyperscanStream* hss = (HyperscanStream*)ms;
+
+    if ( hss->owner != owner_id )
+        return false;
+
+    if ( hs_reset_stream(hss->stream, 0, nullptr, nullptr, nullptr) != HS_SUCCESS )
+        return false;
+
+    hss->offset = 0;
+    return true;
+}
+
+int HyperscanMpse::_search_stream(
+    MpseStream* ms, const uint8_t* buf, int n, MpseMatch mf, void* pv)
+{
+    HyperscanStream* hss = (HyperscanStream*)ms;
+
+    if ( hss->owner != owner_id )
+        return -1;
+
+    ScanContext scan(this, mf, pv);
+    scan.base = hss->offset;
+
+    // one match per pattern per buffer like block mode single match
+    const unsigned words = (pvector.size() + 63) / 64;
+    const unsigned max_local = 128;
+
+    uint64_t local[max_local];
+    std::vector<uint64_t> heap;
+
+    if ( words <= max_local )
+    {
+        memset(local, 0, words * sizeof(uint64_t));
+        scan.seen = local;
+    }
+    else
+    {
+        heap.resize(words, 0);
+        scan.seen = heap.data();
+    }
+
+    hs_scratch_t* ss =
+        (hs_scratch_t*)SnortConfig::get_conf()->state[get_instance_id()][scratch_index];
+
+    assert(ss);
+
+    if ( hs_scan_stream(hss->stream, (const char*)buf, n, 0, ss,
+        HyperscanMpse::stream_match, &scan) != HS_SUCCESS )
+    {
+        // the stream is dead after an error so start over
+        reset_stream(hss);
+        return scan.nfound;
+    }
+
+    hss->offset += n;
+    return scan.nfound;
+}
+
 static bool scratch_setup(SnortConfig* sc)
 {
     // find the largest scratch and clone for all slots
@@ -404,12 +576,17 @@ static void hs_init()
 {
     HyperscanMpse::instances = 0;
     HyperscanMpse::patterns = 0;
+    HyperDbCache::reset_stats();
 }
 
 static void hs_print()
 {
     LogCount("instances", HyperscanMpse::instances);
     LogCount("patterns", HyperscanMpse::patterns);
+    LogCount("db cache hits", HyperDbCache::get_hits());
+    LogCount("db cache misses", HyperDbCache::get_misses());
+    LogCount("db cache errors", HyperDbCache::get_errors());
+    LogCount("db shares", HyperDbCache::get_shares());
 }
 
 static const MpseApi hs_api =
@@ -426,7 +603,7 @@ static const MpseApi hs_api =
         mod_ctor,
         mod_dtor
     },
-    MPSE_REGEX | MPSE_MTBLD,
+    MPSE_REGEX | MPSE_MTBLD | MPSE_STREAM,
     nullptr,  // activate
     nullptr,  // setup
     nullptr,  // start
@@ -23,11 +23,15 @@
 #endif
 
 #include <string.h>
+#include <unistd.h>
+
+#include <string>
 
 #include "framework/base_api.h"
 #include "framework/counts.h"
 #include "framework/mpse.h"
 #include "framework/mpse_batch.h"
+#include "helpers/hyper_db_cache.h"
 #include "main/snort_config.h"
 #include "utils/stats.h"
 
@@ -59,6 +63,12 @@ int Mpse::search_all(
     return _search(T, n, match, context, current_state);
 }
 
+int Mpse::search_stream(
+    MpseStream* ms, const unsigned char* T, int n, MpseMatch match, void* context)
+{
+    return _search_stream(ms, T, n, match, context);
+}
+
 void Mpse::search(MpseBatch& batch, MpseType mpse_type)
 {
     _search(batch, mpse_type);
@@ -149,10 +159,11 @@ void show_stats(PegCount*, const PegInfo*, const IndexVec&, const char*, FILE*)
 extern const BaseApi* se_hyperscan;
 
 static unsigned hits = 0;
+static int last_index = 0;
 
 static int match(
-    void* /*user*/, void* /*tree*/, int /*index*/, void* /*context*/, void* /*list*/)
-{ ++hits; return 0; }
+    void* /*user*/, void* /*tree*/, int index, void* /*context*/, void* /*list*/)
+{ ++hits; last_index = index; return 0; }
 
 static void* s_user = (void*)"user";
 static void* s_tree = (void*)"tree";
@@ -201,7 +212,7 @@ TEST(mpse_hs_base, base)
 TEST(mpse_hs_base, mpse)
 {
     const MpseApi* mpse_api = (const MpseApi*)se_hyperscan;
-    CHECK(mpse_api->flags == (MPSE_REGEX | MPSE_MTBLD));
+    CHECK(mpse_api->flags == (MPSE_REGEX | MPSE_MTBLD | MPSE_STREAM));
 
     CHECK(mpse_api->ctor);
     CHECK(mpse_api->dtor);
@@ -425,6 +436,263 @@ TEST(mpse_hs_multi, single)
     CHECK(hits == 1);
 }
 
+//-------------------------------------------------------------------------
+// stream mode tests
+//-------------------------------------------------------------------------
+
+TEST_GROUP(mpse_hs_stream)
+{
+    Module* mod = nullptr;
+    Mpse* hs = nullptr;
+    bool do_cleanup = false;
+    const MpseApi* mpse_api = (const MpseApi*)se_hyperscan;
+
+    void setup() override
+    {
+        CHECK(se_hyperscan);
+        mod = mpse_api->base.mod_ctor();
+        hs = mpse_api->ctor(snort_conf, nullptr, &s_agent);
+        CHECK(hs);
+        hits = 0;
+        last_index = 0;
+        parse_errors = 0;
+    }
+    void teardown() override
+    {
+        mpse_api->dtor(hs);
+        if ( do_cleanup )
+            scratcher->cleanup(snort_conf);
+        mpse_api->base.mod_dtor(mod);
+    }
+};
+
+TEST(mpse_hs_stream, block_only)
+{
+    Mpse::PatternDescriptor desc;
+
+    CHECK(hs->add_pattern((const uint8_t*)"foo", 3, desc, s_user) == 0);
+    CHECK(hs->prep_patterns(snort_conf) == 0);
+
+    do_cleanup = scratcher->setup(snort_conf);
+    CHECK(!hs->open_stream());
+}
+
+TEST(mpse_hs_stream, span)
+{
+    Mpse::PatternDescriptor desc;
+
+    CHECK(hs->add_pattern((const uint8_t*)"foobar", 6, desc, s_user) == 0);
+    hs->set_stream_mode();
+    CHECK(hs->prep_patterns(snort_conf) == 0);
+
+    do_cleanup = scratcher->setup(snort_conf);
+
+    MpseStream* ms = hs->open_stream();
+    CHECK(ms);
+    CHECK(ms->size_of() > 0);
+
+    CHECK(hs->search_stream(ms, (const uint8_t*)"xxfoo", 5, match, nullptr) == 0);
+    CHECK(hs->search_stream(ms, (const uint8_t*)"barxx", 5, match, nullptr) == 1);
+    CHECK(hits == 1);
+
+    // index is relative to the current buffer
+    CHECK(last_index == 3);
+
+    // block mode search is unaffected
+    int state = 0;
+    CHECK(hs->search((const uint8_t*)"barxx", 5, match, nullptr, &state) == 0);
+
+    // a reset stream forgets the prior buffer
+    CHECK(hs->search_stream(ms, (const uint8_t*)"xxfoo", 5, match, nullptr) == 0);
+    CHECK(hs->reset_stream(ms));
+    CHECK(hs->search_stream(ms, (const uint8_t*)"barxx", 5, match, nullptr) == 0);
+    CHECK(hits == 1);
+
+    delete ms;
+}
+
+TEST(mpse_hs_stream, repeats)
+{
+    Mpse::PatternDescriptor desc;
+
+    CHECK(hs->add_pattern((const uint8_t*)"foo", 3, desc, s_user) == 0);
+    CHECK(hs->add_pattern((const uint8_t*)"bar", 3, desc, s_user) == 0);
+    hs->set_stream_mode();
+    CHECK(hs->prep_patterns(snort_conf) == 0);
+
+    do_cleanup = scratcher->setup(snort_conf);
+
+    MpseStream* ms = hs->open_stream();
+    CHECK(ms);
+
+    // one match per pattern per buffer, for every buffer in the stream
+    CHECK(hs->search_stream(ms, (const uint8_t*)"foo foo bar", 11, match, nullptr) == 2);
+    CHECK(hs->search_stream(ms, (const uint8_t*)"foo", 3, match, nullptr) == 1);
+    CHECK(hits == 3);
+
+    delete ms;
+}
+
+TEST(mpse_hs_stream, owner)
+{
+    Mpse::PatternDescriptor desc;
+    Mpse* hs2 = mpse_api->ctor(snort_conf, nullptr, &s_agent);
+
+    CHECK(hs->add_pattern((const uint8_t*)"foo", 3, desc, s_user) == 0);
+    CHECK(hs2->add_pattern((const uint8_t*)"foo", 3, desc, s_user) == 0);
+    hs->set_stream_mode();
+    hs2->set_stream_mode();
+    CHECK(hs->prep_patterns(snort_conf) == 0);
+    CHECK(hs2->prep_patterns(snort_conf) == 0);
+
+    do_cleanup = scratcher->setup(snort_conf);
+
+    MpseStream* ms = hs->open_stream();
+    CHECK(ms);
+
+    CHECK(hs2->search_stream(ms, (const uint8_t*)"foo", 3, match, nullptr) == -1);
+    CHECK(!hs2->reset_stream(ms));
+    CHECK(hits == 0);
+
+    mpse_api->dtor(hs2);
+    delete ms;
+}
+
+//-------------------------------------------------------------------------
+// database cache tests
+//-------------------------------------------------------------------------
+
+TEST_GROUP(mpse_hs_cache)
+{
+    Module* mod = nullptr;
+    bool do_cleanup = false;
+    const MpseApi* mpse_api = (const MpseApi*)se_hyperscan;
+    char dir[32];
+
+    void setup() override
+    {
+        CHECK(se_hyperscan);
+        mod = mpse_api->base.mod_ctor();
+
+        strcpy(dir, "/tmp/hs_cache_XXXXXX");
+        CHECK(mkdtemp(dir));
+        snort_conf->hyperscan_cache = dir;
+
+        HyperDbCache::reset_stats();
+        hits = 0;
+        parse_errors = 0;
+    }
+    void teardown() override
+    {
+        if ( do_cleanup )
+            scratcher->cleanup(snort_conf);
+        mpse_api->base.mod_dtor(mod);
+
+        std::string cmd = "rm -rf ";
+        cmd += dir;
+        CHECK(!system(cmd.c_str()));
+        snort_conf->hyperscan_cache.clear();
+    }
+
+    Mpse* make_mpse(const char* pat)
+    {
+        Mpse* hs = mpse_api->ctor(snort_conf, nullptr, &s_agent);
+        Mpse::PatternDescriptor desc;
+        CHECK(hs->add_pattern((const uint8_t*)pat, strlen(pat), desc, s_user) == 0);
+        CHECK(hs->prep_patterns(snort_conf) == 0);
+        return hs;
+    }
+};
+
+TEST(mpse_hs_cache, reuse)
+{
+    Mpse* hs1 = make_mpse("foo");
+    CHECK(HyperDbCache::get_misses() == 1);
+    CHECK(HyperDbCache::get_hits() == 0);
+
+    // loaded from the directory once the in memory copy is gone
+    mpse_api->dtor(hs1);
+    Mpse* hs2 = make_mpse("foo");
+    CHECK(HyperDbCache::get_misses() == 1);
+    CHECK(HyperDbCache::get_hits() == 1);
+    CHECK(HyperDbCache::get_shares() == 0);
+
+    Mpse* hs3 = make_mpse("bar");
+    CHECK(HyperDbCache::get_misses() == 2);
+    CHECK(HyperDbCache::get_errors() == 0);
+
+    do_cleanup = scratcher->setup(snort_conf);
+
+    // the loaded database matches like the compiled one
+    int state = 0;
+    CHECK(hs2->search((const uint8_t*)"xfoox", 5, match, nullptr, &state) == 1);
+    CHECK(hs3->search((const uint8_t*)"xfoox", 5, match, nullptr, &state) == 0);
+    CHECK(hits == 1);
+
+    mpse_api->dtor(hs2);
+    mpse_api->dtor(hs3);
+}
+
+TEST(mpse_hs_cache, damaged)
+{
+    Mpse* hs1 = make_mpse("foo");
+    CHECK(HyperDbCache::get_misses() == 1);
+
+    // truncate the saved database
+    std::string cmd = "for f in ";
+    cmd += dir;
+    cmd += "/*.hsdb; do echo junk > $f; done";
+    CHECK(!system(cmd.c_str()));
+
+    mpse_api->dtor(hs1);
+    Mpse* hs2 = make_mpse("foo");
+    CHECK(HyperDbCache::get_hits() == 0);
+    CHECK(HyperDbCache::get_misses() == 2);
+    CHECK(HyperDbCache::get_errors() == 1);
+
+    // and it was rewritten
+    mpse_api->dtor(hs2);
+    Mpse* hs3 = make_mpse("foo");
+    CHECK(HyperDbCache::get_hits() == 1);
+
+    do_cleanup = scratcher->setup(snort_conf);
+
+    int state = 0;
+    CHECK(hs3->search((const uint8_t*)"foo", 3, match, nullptr, &state) == 1);
+    CHECK(parse_errors == 0);
+
+    mpse_api->dtor(hs3);
+}
+
+TEST(mpse_hs_cache, shared)
+{
+    // sharing doesn't need a directory
+    snort_conf->hyperscan_cache.clear();
+
+    Mpse* hs1 = make_mpse("foo");
+    Mpse* hs2 = make_mpse("foo");
+    Mpse* hs3 = make_mpse("bar");
+    CHECK(HyperDbCache::get_shares() == 1);
+    CHECK(HyperDbCache::get_misses() == 0);
+
+    // a new one gets it from the survivor
+    mpse_api->dtor(hs1);
+    Mpse* hs4 = make_mpse("foo");
+    CHECK(HyperDbCache::get_shares() == 2);
+
+    do_cleanup = scratcher->setup(snort_conf);
+
+    int state = 0;
+    CHECK(hs2->search((const uint8_t*)"xfoox", 5, match, nullptr, &state) == 1);
+    CHECK(hs3->search((const uint8_t*)"xfoox", 5, match, nullptr, &state) == 0);
+    CHECK(hs4->search((const uint8_t*)"xfoox", 5, match, nullptr, &state) == 1);
+    CHECK(hits == 2);
+
+    mpse_api->dtor(hs2);
+    mpse_api->dtor(hs3);
+    mpse_api->dtor(hs4);
+}
+
 //-------------------------------------------------------------------------
 // main
 //-------------------------------------------------------------------------
@@ -24,19 +24,26 @@
 #include "http2_hpack_dynamic_table.h"
 #include "http2_module.h"
 
+#include <cassert>
+#include <new>
 #include <string.h>
 
 #include "http2_hpack_table.h"
 
 using namespace Http2Enums;
 
+// Entries don't own their buffers so a slot is reused by constructing a new entry in place
+static void set_entry(HpackTableEntry& entry, const uint8_t* name, uint32_t name_len,
+    uint32_t value_len)
+{
+    entry.~HpackTableEntry();
+    new (&entry) HpackTableEntry(name_len, name, value_len, name + name_len);
+}
+
 HpackDynamicTable::~HpackDynamicTable()
 {
-    for (std::vector<HpackTableEntry*>::iterator it = circular_buf.begin();
-        it != circular_buf.end(); ++it)
-    {
-        delete *it;
-    }
+    delete[] circular_buf;
+    delete[] data;
 }
 
 bool HpackDynamicTable::add_entry(const Field& name, const Field& value)
@@ -45,7 +52,10 @@ bool HpackDynamicTable::add_entry(const Field& name, const Field& value)
     if (num_entries >= ARRAY_CAPACITY)
         return false;
 
-    const uint32_t new_entry_size = name.length() + value.length() + RFC_ENTRY_OVERHEAD;
+    const uint8_t* const name_start = name.start();
+    const uint32_t name_len = name.length();
+    const uint32_t value_len = value.length();
+    const uint32_t new_entry_size = name_len + value_len + RFC_ENTRY_OVERHEAD;
 
     // As per the RFC, attempting to add an entry that is larger than the max size of the table is
     // not an error, it causes the table to be cleared
@@ -55,16 +65,26 @@ bool HpackDynamicTable::add_entry(const Field& name, const Field& value)
         return true;
     }
 
-    // Create new entry. This is done before pruning because the entry referenced by the new name
-    // may be pruned.
-    HpackTableEntry* new_entry = new HpackTableEntry(name, value);
-
-    // If add entry would exceed max table size, evict old entries
+    // If add entry would exceed max table size, evict old entries. The new name may reference an
+    // evicted entry. Its bytes stay where they are until they are overwritten below.
     prune_to_size(max_size - new_entry_size);
 
+    if (num_entries == array_capacity)
+        grow_array();
+
+    uint8_t* old_data;
+    uint8_t* const entry_data = reserve(name_len + value_len, old_data);
+
+    // The value is always a literal but the name may overlap the space just reserved
+    memmove(entry_data, name_start, name_len);
+    memcpy(entry_data + name_len, value.start(), value_len);
+    delete[] old_data;
+
+    data_end = entry_data - data + name_len + value_len;
+
     // Add new entry to the front of the table (newest entry = lowest index)
-    start = (start + ARRAY_CAPACITY - 1) % ARRAY_CAPACITY;
-    circular_buf[start] = new_entry;
+    start = (start - 1) & (array_capacity - 1);
+    set_entry(circular_buf[start], entry_data, name_len, value_len);
 
     num_entries++;
     if (num_entries > Http2Module::get_peg_counts(PEG_MAX_TABLE_ENTRIES))
@@ -81,8 +101,96 @@ const HpackTableEntry* HpackDynamicTable::get_entry(uint32_t virtual_index) cons
     if (dyn_index + 1 > num_entries)
         return nullptr;
 
-    const uint32_t arr_index = (start + dyn_index) % ARRAY_CAPACITY;
-    return circular_buf[arr_index];
+    const uint32_t arr_index = (start + dyn_index) & (array_capacity - 1);
+    return &circular_buf[arr_index];
+}
+
+void HpackDynamicTable::grow_array()
+{
+    const uint32_t new_capacity = array_capacity ? array_capacity * 2 : MIN_ARRAY_CAPACITY;
+    assert(new_capacity <= ARRAY_CAPACITY);
+
+    HpackTableEntry* new_buf = new HpackTableEntry[new_capacity];
+
+    for (uint32_t i = 0; i < num_entries; i++)
+    {
+        const HpackTableEntry& entry = circular_buf[(start + i) & (array_capacity - 1)];
+        set_entry(new_buf[i], entry.name.start(), entry.name.length(), entry.value.length());
+    }
+
+    delete[] circular_buf;
+    circular_buf = new_buf;
+    array_capacity = new_capacity;
+    start = 0;
+}
+
+/* Returns space for length bytes that does not overlap any entry in the table. Entries occupy
+ * the buffer from the oldest entry up to data_end, wrapping around the end of the buffer at most
+ * once. When the buffer has wrapped data_end is strictly less than the start of the oldest entry,
+ * so data_end == oldest only when the table holds no bytes.
+ *
+ * If there isn't room the entries are moved to a larger buffer. The old buffer is returned in
+ * old_data so the caller can copy a name that references it before freeing it.
+ */
+uint8_t* HpackDynamicTable::reserve(uint32_t length, uint8_t*& old_data)
+{
+    old_data = nullptr;
+
+    if (num_entries == 0)
+    {
+        data_end = 0;
+
+        if (data and length <= data_capacity)
+            return data;
+    }
+    else
+    {
+        const uint32_t last_index = (start + num_entries - 1) & (array_capacity - 1);
+        const uint32_t oldest = circular_buf[last_index].name.start() - data;
+
+        if (data_end >= oldest)
+        {
+            if (data_end + length <= data_capacity)
+                return data + data_end;
+
+            if (length < oldest)
+                return data;
+        }
+        else if (data_end + length < oldest)
+            return data + data_end;
+    }
+
+    // Twice the max size always has room once the table is pruned so the growth stops there
+    const uint32_t used = rfc_table_size - num_entries * RFC_ENTRY_OVERHEAD;
+    uint64_t new_capacity = data_capacity ? 2 * (uint64_t)data_capacity : MIN_DATA_CAPACITY;
+
+    if (new_capacity > 2 * (uint64_t)max_size)
+        new_capacity = 2 * (uint64_t)max_size;
+
+    if (new_capacity < used + length)
+        new_capacity = used + length;
+
+    uint8_t* new_data = new uint8_t[new_capacity];
+    uint32_t offset = 0;
+
+    // Copy oldest to newest so the new buffer starts out unwrapped
+    for (uint32_t i = num_entries; i > 0; i--)
+    {
+        HpackTableEntry& entry = circular_buf[(start + i - 1) & (array_capacity - 1)];
+        const uint32_t name_len = entry.name.length();
+        const uint32_t value_len = entry.value.length();
+
+        memcpy(new_data + offset, entry.name.start(), name_len + value_len);
+        set_entry(entry, new_data + offset, name_len, value_len);
+        offset += name_len + value_len;
+    }
+
+    old_data = data;
+    data = new_data;
+    data_capacity = (uint32_t)new_capacity;
+    data_end = offset;
+
+    return data + offset;
 }
 
 /* This is called when adding a new entry and when receiving a dynamic table size update.
@@ -95,12 +203,10 @@ void HpackDynamicTable::prune_to_size(uint32_t new_max_size)
 {
     while (rfc_table_size > new_max_size)
     {
-        const uint32_t last_index = (start + num_entries - 1 + ARRAY_CAPACITY) % ARRAY_CAPACITY;
+        const uint32_t last_index = (start + num_entries - 1) & (array_capacity - 1);
         num_entries--;
-        rfc_table_size -= circular_buf[last_index]->name.length() +
-            circular_buf[last_index]->value.length() + RFC_ENTRY_OVERHEAD;
-        delete circular_buf[last_index];
-        circular_buf[last_index] = nullptr;
+        rfc_table_size -= circular_buf[last_index].name.length() +
+            circular_buf[last_index].value.length() + RFC_ENTRY_OVERHEAD;
     }
 }
 
@@ -25,15 +25,12 @@
 
 #include "http2_enum.h"
 
-#include <vector>
-
 struct HpackTableEntry;
 
 class HpackDynamicTable
 {
 public:
-    // FIXIT-P This array can be optimized to start smaller and grow on demand
-    HpackDynamicTable() : circular_buf(ARRAY_CAPACITY, nullptr) {}
+    HpackDynamicTable() = default;
     ~HpackDynamicTable();
     const HpackTableEntry* get_entry(uint32_t index) const;
     bool add_entry(const Field& name, const Field& value);
@@ -45,13 +42,27 @@ private:
 
     const static uint32_t DEFAULT_MAX_SIZE = 4096;
     const static uint32_t ARRAY_CAPACITY = 512;
+    const static uint32_t MIN_ARRAY_CAPACITY = 16;
+    const static uint32_t MIN_DATA_CAPACITY = 1024;
     uint32_t max_size = DEFAULT_MAX_SIZE;
 
+    // Entries are kept in a circular array with the newest entry at start. The array starts small
+    // and doubles on demand up to ARRAY_CAPACITY, which must be a power of 2.
     uint32_t start = 0;
     uint32_t num_entries = 0;
     uint32_t rfc_table_size = 0;
-    std::vector<HpackTableEntry*> circular_buf;
+    uint32_t array_capacity = 0;
+    HpackTableEntry* circular_buf = nullptr;
+
+    // The name and value of each entry are stored back to back in a circular byte buffer in the
+    // order they were added. An entry is never split across the end of the buffer. The buffer
+    // grows when the new entry does not fit in the space left by evicted entries.
+    uint8_t* data = nullptr;
+    uint32_t data_capacity = 0;
+    uint32_t data_end = 0;
 
+    uint8_t* reserve(uint32_t length, uint8_t*& old_data);
+    void grow_array();
     void prune_to_size(uint32_t new_max_size);
 };
 #endif
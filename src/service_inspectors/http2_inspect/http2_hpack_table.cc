@@ -27,22 +27,19 @@
 
 #include <string.h>
 
+#ifdef BENCHMARK_TEST
+#include <string>
+#include <vector>
+
+#include "catch/snort_catch.h"
+#include "http2_huffman_decode.h"
+#endif
+
 #define MAKE_TABLE_ENTRY(name, value) \
     HpackTableEntry(strlen(name), (const uint8_t*)name, strlen(value), (const uint8_t*)value)
 
 using namespace Http2Enums;
 
-HpackTableEntry::HpackTableEntry(const Field& copy_name, const Field& copy_value)
-{
-    uint8_t* new_name = new uint8_t[copy_name.length()];
-    uint8_t* new_value = new uint8_t[copy_value.length()];
-    memcpy(new_name, copy_name.start(), copy_name.length());
-    memcpy(new_value, copy_value.start(), copy_value.length());
-
-    name.set(copy_name.length(), new_name, true);
-    value.set(copy_value.length(), new_value, true);
-}
-
 const HpackTableEntry HpackIndexTable::static_table[STATIC_MAX_INDEX + 1] =
 {
     MAKE_TABLE_ENTRY("", ""),
@@ -147,3 +144,156 @@ bool HpackIndexTable::hpack_table_size_update(uint32_t new_size)
     else
         return false;
 }
+
+#ifdef BENCHMARK_TEST
+
+// Header lists of the requests and responses seen on one connection when a browser loads a page.
+// Everything is sent as literals with incremental indexing and Huffman encoded strings as most
+// encoders do the first time a header is seen.
+static const char* const request_headers[][2] =
+{
+    { ":method", "GET" }, { ":scheme", "https" }, { ":authority", "www.example.com" },
+    { ":path", "/" },
+    { "user-agent", "Mozilla/5.0 (X11; Linux x86_64; rv:80.0) Gecko/20100101 Firefox/80.0" },
+    { "accept", "text/html,application/xhtml+xml,application/xml;q=0.9,image/webp,*/*;q=0.8" },
+    { "accept-language", "en-US,en;q=0.5" }, { "accept-encoding", "gzip, deflate, br" },
+    { "cookie", "session=3b8d5f6e7a9c0b1d2e3f4a5b6c7d8e9f; theme=dark; lang=en" },
+    { "upgrade-insecure-requests", "1" }, { "cache-control", "max-age=0" },
+    { ":method", "GET" }, { ":path", "/static/css/site.min.css?v=20200917" },
+    { "referer", "https://www.example.com/" }, { "accept", "text/css,*/*;q=0.1" },
+    { ":method", "POST" }, { ":path", "/api/v2/events" },
+    { "content-type", "application/json; charset=utf-8" }, { "content-length", "187" },
+    { "x-requested-with", "XMLHttpRequest" }, { "origin", "https://www.example.com" },
+};
+
+static const char* const response_headers[][2] =
+{
+    { ":status", "200" }, { "date", "Thu, 17 Sep 2020 20:13:21 GMT" },
+    { "content-type", "text/html; charset=utf-8" }, { "content-encoding", "br" },
+    { "cache-control", "private, max-age=0" }, { "vary", "Accept-Encoding" },
+    { "set-cookie", "session=3b8d5f6e7a9c0b1d2e3f4a5b6c7d8e9f; Path=/; Secure; HttpOnly" },
+    { "strict-transport-security", "max-age=31536000; includeSubDomains" },
+    { "server", "nginx" }, { ":status", "304" },
+    { "etag", "\"5f63c0a1-1b2f\"" }, { "last-modified", "Thu, 17 Sep 2020 19:58:09 GMT" },
+};
+
+static void huffman_encode(const char* s, std::vector<uint8_t>& out)
+{
+    std::vector<uint8_t> encoded;
+    uint64_t bits = 0;
+    unsigned num_bits = 0;
+
+    for ( ; *s; ++s )
+    {
+        const HuffmanCode& hc = huffman_code[(uint8_t)*s];
+        bits = (bits << hc.len) | hc.code;
+        num_bits += hc.len;
+
+        while ( num_bits >= 8 )
+        {
+            num_bits -= 8;
+            encoded.emplace_back(bits >> num_bits);
+        }
+    }
+    if ( num_bits )
+        encoded.emplace_back((bits << (8 - num_bits)) | (0xff >> num_bits));
+
+    REQUIRE(encoded.size() < 0x7f);
+    out.emplace_back(0x80 | encoded.size());
+    out.insert(out.end(), encoded.begin(), encoded.end());
+}
+
+template <size_t N>
+static void encode_block(const char* const (&headers)[N][2], std::vector<uint8_t>& block)
+{
+    for ( size_t i = 0; i < N; ++i )
+    {
+        block.emplace_back(0x40);
+        huffman_encode(headers[i][0], block);
+        huffman_encode(headers[i][1], block);
+    }
+}
+
+// Decodes a block of literals with indexing and returns the number of lines. The table is
+// optional so the string decoding can be measured by itself.
+static unsigned decode_block(const Http2HpackStringDecode& decode, HpackIndexTable* table,
+    const std::vector<uint8_t>& block, uint8_t* out, uint32_t out_len)
+{
+    Http2EventGen events;
+    Http2Infractions infractions;
+    uint32_t offset = 0;
+    unsigned lines = 0;
+
+    while ( offset < block.size() )
+    {
+        uint32_t consumed, name_len, value_len;
+        offset++;
+
+        if ( !decode.translate(block.data() + offset, block.size() - offset, consumed, out,
+            out_len, name_len, &events, &infractions, false) )
+            break;
+        offset += consumed;
+
+        if ( !decode.translate(block.data() + offset, block.size() - offset, consumed,
+            out + name_len, out_len - name_len, value_len, &events, &infractions, false) )
+            break;
+        offset += consumed;
+
+        Field name(name_len, out);
+        Field value(value_len, out + name_len);
+
+        if ( table and (!table->add_index(name, value) or
+            !table->lookup(HpackIndexTable::STATIC_MAX_INDEX + 1)) )
+            break;
+
+        lines++;
+    }
+    return lines;
+}
+
+TEST_CASE("hpack header blocks", "[http2_hpack]")
+{
+    std::vector<uint8_t> request, response;
+    encode_block(request_headers, request);
+    encode_block(response_headers, response);
+
+    const Http2HpackStringDecode decode;
+    uint8_t out[1024];
+
+    const unsigned num_lines =
+        sizeof(request_headers) / sizeof(request_headers[0]) +
+        sizeof(response_headers) / sizeof(response_headers[0]);
+
+    {
+        HpackIndexTable table(nullptr, HttpCommon::SRC_CLIENT);
+        CHECK(decode_block(decode, &table, request, out, sizeof(out)) +
+            decode_block(decode, &table, response, out, sizeof(out)) == num_lines);
+    }
+
+    BENCHMARK("hpack string decode")
+    {
+        unsigned n = 0;
+
+        for ( unsigned i = 0; i < 16; ++i )
+        {
+            n += decode_block(decode, nullptr, request, out, sizeof(out));
+            n += decode_block(decode, nullptr, response, out, sizeof(out));
+        }
+        return n;
+    };
+
+    BENCHMARK("hpack decode and index")
+    {
+        HpackIndexTable table(nullptr, HttpCommon::SRC_CLIENT);
+        unsigned n = 0;
+
+        for ( unsigned i = 0; i < 16; ++i )
+        {
+            n += decode_block(decode, &table, request, out, sizeof(out));
+            n += decode_block(decode, &table, response, out, sizeof(out));
+        }
+        return n;
+    };
+}
+
+#endif
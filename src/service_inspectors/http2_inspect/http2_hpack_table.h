@@ -29,10 +29,10 @@ class Http2FlowData;
 
 struct HpackTableEntry
 {
+    HpackTableEntry() = default;
     HpackTableEntry(uint32_t name_len, const uint8_t* _name, uint32_t value_len,
         const uint8_t* _value) : name { static_cast<int32_t>(name_len), _name },
         value { static_cast<int32_t>(value_len), _value } { }
-    HpackTableEntry(const Field& copy_name, const Field& copy_value);
     Field name;
     Field value;
 };
@@ -0,0 +1,75 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef HTTP2_HUFFMAN_DECODE_H
+#define HTTP2_HUFFMAN_DECODE_H
+
+// Huffman decoding of HPACK string literals. The code from RFC 7541 appendix B is turned into a
+// state machine at startup. A state is an internal node of the code tree and each transition
+// consumes a whole input byte, which completes at most two symbols because the shortest code is
+// 5 bits long. Decoding takes one table lookup per input byte no matter where the symbol
+// boundaries fall.
+
+#include "main/snort_types.h"
+
+struct HuffmanCode
+{
+    uint32_t code;
+    uint8_t len;
+};
+
+static const unsigned HUFFMAN_EOS = 256;
+static const unsigned HUFFMAN_NUM_STATES = 256;
+
+extern const HuffmanCode huffman_code[HUFFMAN_EOS + 1];
+
+// The low bits of the flags are the number of symbols completed by the transition
+enum HuffmanFlags
+{
+    HUFFMAN_COUNT = 0x3,
+    HUFFMAN_FAIL = 0x4
+};
+
+// What it means for the input to end in a given state
+enum HuffmanEnd
+{
+    HUFFMAN_END_OK,             // on a symbol boundary or in up to 7 bits of EOS prefix
+    HUFFMAN_END_BAD_PADDING,    // fewer than 8 leftover bits that are not all 1s
+    HUFFMAN_END_INCOMPLETE      // 8 or more leftover bits
+};
+
+struct HuffmanTransition
+{
+    uint8_t state;
+    uint8_t flags;
+    uint8_t symbol[2];
+};
+
+class HuffmanDecodeTable
+{
+public:
+    HuffmanDecodeTable();
+
+    HuffmanTransition next[HUFFMAN_NUM_STATES][256];
+    uint8_t end[HUFFMAN_NUM_STATES];
+};
+
+extern const HuffmanDecodeTable huffman_decode;
+
+#endif
+
@@ -23,7 +23,7 @@
 #endif
 
 #include "../http2_enum.h"
-#include "../http2_huffman_state_machine.h"
+#include "../http2_huffman_decode.h"
 #include "../http2_hpack_string_decode.h"
 #include "../../http_inspect/http_common.h"
 #include "../../http_inspect/http_enum.h"
@@ -631,6 +631,22 @@ TEST(http2_hpack_string_decode_success, huffman_decoding_tail_lookup_unsucessful
 //
 // The following tests should trigger infractions/events
 //
+TEST(http2_hpack_string_decode_success, huffman_decoding_long_code_before_end)
+{
+    // a 7 bit code ends in the last byte after a 13 bit code - decodes to ctG(a
+    uint8_t buf[5] = {0x84, 0x22, 0x71, 0x7F, 0x43};
+    // decode
+    uint32_t bytes_processed = 0, bytes_written = 0;
+    uint8_t res[6];
+    bool success = decode->translate(buf, 5, bytes_processed, res, 6, bytes_written, &events, &inf,
+        false);
+    // check results
+    CHECK(success == true);
+    CHECK(bytes_processed == 5);
+    CHECK(bytes_written == 5);
+    CHECK(memcmp(res, "ctG(a", 5) == 0);
+}
+
 TEST_GROUP(http2_hpack_string_decode_infractions)
 {
 };
@@ -765,6 +781,27 @@ TEST(http2_hpack_string_decode_infractions, huffman_1_byte_bad_padding)
     CHECK(local_inf.get_raw() == (1<<INF_HUFFMAN_BAD_PADDING));
 }
 
+TEST(http2_hpack_string_decode_infractions, huffman_2_bytes_bad_padding)
+{
+    // prepare decode object
+    Http2EventGen local_events;
+    Http2Infractions local_inf;
+    Http2HpackStringDecode local_decode;
+    // prepare buf to decode - i* followed by 101
+    uint8_t buf[3] = { 0x82, 0x37, 0xCD };
+    // decode
+    uint32_t bytes_processed = 0, bytes_written = 0;
+    uint8_t res[3];
+    bool success = local_decode.translate(buf, 3, bytes_processed, res, 3, bytes_written,
+        &local_events, &local_inf, false);
+    // check results
+    CHECK(success == false);
+    CHECK(bytes_processed == 3);
+    CHECK(bytes_written == 2);
+    CHECK(local_inf.get_raw() == (1<<INF_HUFFMAN_BAD_PADDING));
+    CHECK(memcmp(res, "i*", 2) == 0);
+}
+
 TEST(http2_hpack_string_decode_infractions, huffman_1_byte_incomplete_FF)
 {
     // prepare decode object
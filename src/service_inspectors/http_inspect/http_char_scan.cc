@@ -0,0 +1,155 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "http_char_scan.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+struct ScanSet
+{
+    const uint8_t* chars;
+    unsigned num_chars;
+    bool eightbit;
+    bool space_ctl;
+
+    bool match(uint8_t c) const
+    {
+        if ((eightbit && (c & 0x80)) || (space_ctl && (c <= ' ')))
+            return true;
+        for (unsigned i = 0; i < num_chars; i++)
+        {
+            if (c == chars[i])
+                return true;
+        }
+        return false;
+    }
+};
+}
+
+static const uint8_t uri_chars[] = { '%', '+', '\\', '/', '.' };
+
+static const ScanSet uri_special { uri_chars, sizeof(uri_chars), true, false };
+static const ScanSet percent_or_eightbit { uri_chars, 1, true, false };
+static const ScanSet space_or_ctl { nullptr, 0, false, true };
+
+// Each block is compared against every character in the set. A byte at or below <SP> is one that
+// saturating subtraction of <SP> reduces to zero. The high bit needs no compare because movemask
+// extracts it directly.
+static inline int32_t scan(const uint8_t* buf, int32_t k, const int32_t length,
+    const ScanSet& set)
+{
+#ifdef __AVX2__
+    const __m256i zero32 = _mm256_setzero_si256();
+    const __m256i space32 = _mm256_set1_epi8(' ');
+
+    for (; k + 32 <= length; k += 32)
+    {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(buf + k));
+        __m256i hit = set.eightbit ? v : zero32;
+
+        for (unsigned i = 0; i < set.num_chars; i++)
+            hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(set.chars[i])));
+
+        if (set.space_ctl)
+            hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(_mm256_subs_epu8(v, space32), zero32));
+
+        const uint32_t mask = _mm256_movemask_epi8(hit);
+
+        if (mask)
+            return k + __builtin_ctz(mask);
+    }
+#endif
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i space = _mm_set1_epi8(' ');
+
+    for (; k + 16 <= length; k += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(buf + k));
+        __m128i hit = set.eightbit ? v : zero;
+
+        for (unsigned i = 0; i < set.num_chars; i++)
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8(set.chars[i])));
+
+        if (set.space_ctl)
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(_mm_subs_epu8(v, space), zero));
+
+        const uint32_t mask = _mm_movemask_epi8(hit);
+
+        if (mask)
+            return k + __builtin_ctz(mask);
+    }
+#endif
+
+    for (; k < length; k++)
+    {
+        if (set.match(buf[k]))
+            return k;
+    }
+    return length;
+}
+
+int32_t HttpCharScan::find_uri_special(const uint8_t* buf, int32_t start, int32_t length)
+{
+    return scan(buf, start, length, uri_special);
+}
+
+int32_t HttpCharScan::find_percent_or_eightbit(const uint8_t* buf, int32_t start, int32_t length)
+{
+    return scan(buf, start, length, percent_or_eightbit);
+}
+
+int32_t HttpCharScan::find_space_or_ctl(const uint8_t* buf, int32_t start, int32_t length)
+{
+    return scan(buf, start, length, space_or_ctl);
+}
+
+void HttpCharScan::to_lower(const uint8_t* in, int32_t length, uint8_t* out)
+{
+    int32_t k = 0;
+
+#ifdef __SSE2__
+    const __m128i before_a = _mm_set1_epi8('A' - 1);
+    const __m128i after_z = _mm_set1_epi8('Z' + 1);
+    const __m128i to_a = _mm_set1_epi8('a' - 'A');
+
+    for (; k + 16 <= length; k += 16)
+    {
+        // bytes above 0x7F are negative and fail the first signed compare
+        const __m128i v = _mm_loadu_si128((const __m128i*)(in + k));
+        const __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, before_a),
+            _mm_cmplt_epi8(v, after_z));
+        _mm_storeu_si128((__m128i*)(out + k), _mm_add_epi8(v, _mm_and_si128(upper, to_a)));
+    }
+#endif
+
+    for (; k < length; k++)
+        out[k] = ((in[k] < 'A') || (in[k] > 'Z')) ? in[k] : in[k] - ('A' - 'a');
+}
+
@@ -0,0 +1,48 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef HTTP_CHAR_SCAN_H
+#define HTTP_CHAR_SCAN_H
+
+// Vector searches for the bytes the URI and header normalizers must look at individually. Each
+// find function returns the offset of the first such byte at or after start, or length if there
+// is none. The sets are supersets of what the callers handle specially so any run of bytes that
+// is skipped is one the byte at a time code would have copied through unchanged. The SSE2 and
+// AVX2 versions are used when the compiler targets them and produce the same results as the
+// scalar loops.
+
+#include <cstdint>
+
+namespace HttpCharScan
+{
+// % + \ / . and any byte with the high bit set. These are the only characters the uri_char
+// table can classify as something other than CHAR_NORMAL.
+int32_t find_uri_special(const uint8_t* buf, int32_t start, int32_t length);
+
+// % and any byte with the high bit set
+int32_t find_percent_or_eightbit(const uint8_t* buf, int32_t start, int32_t length);
+
+// <SP> and all control characters up to and including <SP>
+int32_t find_space_or_ctl(const uint8_t* buf, int32_t start, int32_t length);
+
+// Copy length bytes from in to out converting A-Z to a-z
+void to_lower(const uint8_t* in, int32_t length, uint8_t* out);
+}
+
+#endif
+
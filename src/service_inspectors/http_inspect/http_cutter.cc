@@ -23,6 +23,9 @@
 
 #include "http_cutter.h"
 
+#include "decompress/inflate_pool.h"
+#include "decompress/stream_decomp.h"
+
 #include "http_common.h"
 #include "http_enum.h"
 #include "http_module.h"
@@ -278,25 +281,29 @@ ScanResult HttpHeaderCutter::cut(const uint8_t* buffer, uint32_t length,
     return SCAN_NOT_FOUND;
 }
 
-HttpBodyCutter::HttpBodyCutter(AcceleratedBlocking accelerated_blocking_, CompressId compression_)
-    : accelerated_blocking(accelerated_blocking_), compression(compression_)
+HttpBodyCutter::HttpBodyCutter(AcceleratedBlocking accelerated_blocking_, CompressId compression_,
+    uint32_t unzip_memcap) : accelerated_blocking(accelerated_blocking_), compression(compression_)
 {
     if (accelerated_blocking != AB_NONE)
     {
         if ((compression == CMP_GZIP) || (compression == CMP_DEFLATE))
         {
-            compress_stream = new z_stream;
-            compress_stream->zalloc = Z_NULL;
-            compress_stream->zfree = Z_NULL;
-            compress_stream->next_in = Z_NULL;
-            compress_stream->avail_in = 0;
             const int window_bits = (compression == CMP_GZIP) ? GZIP_WINDOW_BITS : DEFLATE_WINDOW_BITS;
-            if (inflateInit2(compress_stream, window_bits) != Z_OK)
+            compress_stream = InflatePool::acquire(window_bits);
+            if (compress_stream == nullptr)
+            {
+                assert(false);
+                compression = CMP_NONE;
+            }
+        }
+        else if ((compression == CMP_BROTLI) || (compression == CMP_ZSTD))
+        {
+            stream_decomp = StreamDecomp::create((compression == CMP_BROTLI) ?
+                StreamDecomp::SD_BROTLI : StreamDecomp::SD_ZSTD, unzip_memcap);
+            if (stream_decomp == nullptr)
             {
                 assert(false);
                 compression = CMP_NONE;
-                delete compress_stream;
-                compress_stream = nullptr;
             }
         }
 
@@ -324,11 +331,8 @@ HttpBodyCutter::HttpBodyCutter(AcceleratedBlocking accelerated_blocking_, Compre
 
 HttpBodyCutter::~HttpBodyCutter()
 {
-    if (compress_stream != nullptr)
-    {
-        inflateEnd(compress_stream);
-        delete compress_stream;
-    }
+    InflatePool::release(compress_stream);
+    delete stream_decomp;
 }
 
 ScanResult HttpBodyClCutter::cut(const uint8_t* buffer, uint32_t length, HttpInfractions*,
@@ -923,6 +927,33 @@ bool HttpBodyCutter::dangerous(const uint8_t* data, uint32_t length)
         input_buf = decomp_output;
         input_length = decomp_buffer_size - compress_stream->avail_out;
     }
+    else if ((compression == CMP_BROTLI) || (compression == CMP_ZSTD))
+    {
+        if (decompress_failed)
+            return true;
+
+        const uint32_t decomp_buffer_size = MAX_OCTETS;
+        decomp_output = new uint8_t[decomp_buffer_size];
+
+        const uint8_t* next_in = data;
+        uint32_t avail_in = length;
+        uint8_t* next_out = decomp_output;
+        uint32_t avail_out = decomp_buffer_size;
+
+        const StreamDecomp::Status status =
+            stream_decomp->decompress(next_in, avail_in, next_out, avail_out);
+
+        if (((status != StreamDecomp::SD_OK) && (status != StreamDecomp::SD_END)) ||
+            (avail_in > 0))
+        {
+            decompress_failed = true;
+            delete[] decomp_output;
+            return true;
+        }
+
+        input_buf = decomp_output;
+        input_length = decomp_buffer_size - avail_out;
+    }
 
     std::unique_ptr<uint8_t[]> uniq(decomp_output);
 
@@ -28,6 +28,8 @@
 #include "http_enum.h"
 #include "http_event.h"
 
+class StreamDecomp;
+
 //-------------------------------------------------------------------------
 // HttpCutter class and subclasses
 //-------------------------------------------------------------------------
@@ -103,7 +105,7 @@ class HttpBodyCutter : public HttpCutter
 {
 public:
     HttpBodyCutter(HttpEnums::AcceleratedBlocking accelerated_blocking_,
-        HttpEnums::CompressId compression_);
+        HttpEnums::CompressId compression_, uint32_t unzip_memcap);
     ~HttpBodyCutter() override;
     void soft_reset() override { octets_seen = 0; packet_detained = false; }
     void detain_ended() { packet_detained = false; }
@@ -121,6 +123,7 @@ private:
     bool detention_required = false;
     HttpEnums::CompressId compression;
     z_stream* compress_stream = nullptr;
+    StreamDecomp* stream_decomp = nullptr;
     bool decompress_failed = false;
     snort::LiteralSearch* finder = nullptr;
     snort::LiteralSearch::Handle* handle = nullptr;
@@ -134,8 +137,8 @@ class HttpBodyClCutter : public HttpBodyCutter
 public:
     HttpBodyClCutter(int64_t expected_length,
         HttpEnums::AcceleratedBlocking accelerated_blocking,
-        HttpEnums::CompressId compression) :
-        HttpBodyCutter(accelerated_blocking, compression), remaining(expected_length)
+        HttpEnums::CompressId compression, uint32_t unzip_memcap) :
+        HttpBodyCutter(accelerated_blocking, compression, unzip_memcap), remaining(expected_length)
         { assert(remaining > 0); }
     HttpEnums::ScanResult cut(const uint8_t*, uint32_t length, HttpInfractions*, HttpEventGen*,
         uint32_t flow_target, bool stretch, HttpEnums::H2BodyState) override;
@@ -148,8 +151,8 @@ class HttpBodyOldCutter : public HttpBodyCutter
 {
 public:
     HttpBodyOldCutter(HttpEnums::AcceleratedBlocking accelerated_blocking,
-        HttpEnums::CompressId compression) :
-        HttpBodyCutter(accelerated_blocking, compression)
+        HttpEnums::CompressId compression, uint32_t unzip_memcap) :
+        HttpBodyCutter(accelerated_blocking, compression, unzip_memcap)
         {}
     HttpEnums::ScanResult cut(const uint8_t*, uint32_t, HttpInfractions*, HttpEventGen*,
         uint32_t flow_target, bool stretch, HttpEnums::H2BodyState) override;
@@ -159,8 +162,8 @@ class HttpBodyChunkCutter : public HttpBodyCutter
 {
 public:
     HttpBodyChunkCutter(HttpEnums::AcceleratedBlocking accelerated_blocking,
-        HttpEnums::CompressId compression) :
-        HttpBodyCutter(accelerated_blocking, compression)
+        HttpEnums::CompressId compression, uint32_t unzip_memcap) :
+        HttpBodyCutter(accelerated_blocking, compression, unzip_memcap)
         {}
     HttpEnums::ScanResult cut(const uint8_t* buffer, uint32_t length,
         HttpInfractions* infractions, HttpEventGen* events, uint32_t flow_target, bool stretch,
@@ -184,8 +187,9 @@ class HttpBodyH2Cutter : public HttpBodyCutter
 public:
     HttpBodyH2Cutter(int64_t expected_length,
         HttpEnums::AcceleratedBlocking accelerated_blocking,
-        HttpEnums::CompressId compression) :
-        HttpBodyCutter(accelerated_blocking, compression), expected_body_length(expected_length)
+        HttpEnums::CompressId compression, uint32_t unzip_memcap) :
+        HttpBodyCutter(accelerated_blocking, compression, unzip_memcap),
+        expected_body_length(expected_length)
         {}
     HttpEnums::ScanResult cut(const uint8_t* buffer, uint32_t length, HttpInfractions*,
         HttpEventGen*, uint32_t flow_target, bool stretch, HttpEnums::H2BodyState state) override;
@@ -24,6 +24,8 @@
 #include "http_flow_data.h"
 
 #include "decompress/file_decomp.h"
+#include "decompress/inflate_pool.h"
+#include "decompress/stream_decomp.h"
 
 #include "http_cutter.h"
 #include "http_common.h"
@@ -90,11 +92,8 @@ HttpFlowData::~HttpFlowData()
         update_deallocations(partial_detect_length[k]);
         HttpTransaction::delete_transaction(transaction[k], nullptr);
         delete cutter[k];
-        if (compress_stream[k] != nullptr)
-        {
-            inflateEnd(compress_stream[k]);
-            delete compress_stream[k];
-        }
+        InflatePool::release(compress_stream[k]);
+        delete stream_decomp[k];
         if (mime_state[k] != nullptr)
         {
             delete mime_state[k];
@@ -136,12 +135,10 @@ void HttpFlowData::half_reset(SourceId source_id)
     detection_status[source_id] = DET_REACTIVATING;
 
     compression[source_id] = CMP_NONE;
-    if (compress_stream[source_id] != nullptr)
-    {
-        inflateEnd(compress_stream[source_id]);
-        delete compress_stream[source_id];
-        compress_stream[source_id] = nullptr;
-    }
+    InflatePool::release(compress_stream[source_id]);
+    compress_stream[source_id] = nullptr;
+    delete stream_decomp[source_id];
+    stream_decomp[source_id] = nullptr;
     if (mime_state[source_id] != nullptr)
     {
         delete mime_state[source_id];
@@ -179,12 +176,10 @@ void HttpFlowData::trailer_prep(SourceId source_id)
 {
     type_expected[source_id] = SEC_TRAILER;
     compression[source_id] = CMP_NONE;
-    if (compress_stream[source_id] != nullptr)
-    {
-        inflateEnd(compress_stream[source_id]);
-        delete compress_stream[source_id];
-        compress_stream[source_id] = nullptr;
-    }
+    InflatePool::release(compress_stream[source_id]);
+    compress_stream[source_id] = nullptr;
+    delete stream_decomp[source_id];
+    stream_decomp[source_id] = nullptr;
     detection_status[source_id] = DET_REACTIVATING;
 }
 
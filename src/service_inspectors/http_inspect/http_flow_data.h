@@ -38,6 +38,7 @@ class HttpJsNorm;
 class HttpMsgSection;
 class HttpCutter;
 class HttpQueryParser;
+class StreamDecomp;
 
 class HttpFlowData : public snort::FlowData
 {
@@ -137,6 +138,7 @@ private:
     uint64_t last_request_was_connect = false;
     // length of the data from Content-Length field
     z_stream* compress_stream[2] = { nullptr, nullptr };
+    StreamDecomp* stream_decomp[2] = { nullptr, nullptr };
     uint64_t zero_nine_expected = 0;
     int64_t data_length[2] = { HttpCommon::STAT_NOT_PRESENT, HttpCommon::STAT_NOT_PRESENT };
     uint32_t section_size_target[2] = { 0, 0 };
@@ -21,6 +21,7 @@
 #include "config.h"
 #endif
 
+#include "http_char_scan.h"
 #include "http_common.h"
 #include "http_enum.h"
 #include "http_header_normalizer.h"
@@ -50,7 +51,15 @@ static int32_t derive_header_content(const uint8_t* value, int32_t length, uint8
             }
             beginning = false;
             last_white = false;
-            buffer[out_length++] = value[k];
+
+            // Copy the rest of this run of non-white space. White space is always at or below
+            // <SP> so nothing else stops the scan for long.
+            int32_t end = HttpCharScan::find_space_or_ctl(value, k+1, length);
+            while ((end < length) && !is_sp_tab_cr_lf[value[end]])
+                end = HttpCharScan::find_space_or_ctl(value, end+1, length);
+            memcpy(buffer + out_length, value + k, end - k);
+            out_length += end - k;
+            k = end - 1;
         }
         else if (!last_white)
         {
@@ -24,11 +24,17 @@
 #include "http_inspect.h"
 
 #include <cassert>
+#include <cstring>
 #include <iomanip>
 #include <sstream>
 
 #include "detection/detection_engine.h"
 #include "detection/detection_util.h"
+#include "detection/signature.h"
+#include "detection/treenodes.h"
+#include "hash/ghash.h"
+#include "main/snort_config.h"
+#include "managers/event_manager.h"
 #include "service_inspectors/http2_inspect/http2_dummy_packet.h"
 #include "service_inspectors/http2_inspect/http2_flow_data.h"
 #include "log/unified2.h"
@@ -49,6 +55,7 @@
 #include "http_msg_status.h"
 #include "http_msg_trailer.h"
 #include "http_test_manager.h"
+#include "ips_http.h"
 
 using namespace snort;
 using namespace HttpCommon;
@@ -100,7 +107,7 @@ static std::string GetXFFHeaders(const StrCode *header_list)
     return hdr_list;
 }
 
-HttpInspect::HttpInspect(const HttpParaList* params_) :
+HttpInspect::HttpInspect(HttpParaList* params_) :
     params(params_),
     xtra_trueip_id(Stream::reg_xtra_data_cb(get_xtra_trueip)),
     xtra_uri_id(Stream::reg_xtra_data_cb(get_xtra_uri)),
@@ -126,11 +133,55 @@ HttpInspect::HttpInspect(const HttpParaList* params_) :
 #endif
 }
 
-bool HttpInspect::configure(SnortConfig* )
+// Find which HTTP buffers and JavaScript events the rules enabled in any policy can see
+static void find_buffer_use(SnortConfig* sc, HttpParaList::BufferUse& use)
+{
+    use.http.reset();
+    use.file_data = false;
+    use.js_events = false;
+
+    for (GHashNode* node = sc->otn_map->find_first(); node != nullptr;
+        node = sc->otn_map->find_next())
+    {
+        const OptTreeNode* const otn = (OptTreeNode*)node->data;
+
+        if (otn->sigInfo.builtin || !otn->enabled_somewhere())
+            continue;
+
+        for (const OptFpList* ofl = otn->opt_func; ofl != nullptr; ofl = ofl->next)
+        {
+            const IpsOption* const opt = ofl->ips_opt;
+
+            if ((opt == nullptr) || (opt->get_type() != RULE_OPTION_TYPE_BUFFER_SET))
+                continue;
+
+            if (strcmp(opt->get_name(), "file_data") == 0)
+                use.file_data = true;
+
+            // All of the http_* buffer options are HttpIpsOptions
+            else if (strncmp(opt->get_name(), "http_", 5) == 0)
+                use.http[((const HttpIpsOption*)opt)->get_buffer_type()] = true;
+        }
+    }
+
+    for (const auto sid : { EVENT_JS_OBFUSCATION_EXCD, EVENT_JS_EXCESS_WS, EVENT_MIXED_ENCODINGS })
+    {
+        const OptTreeNode* const otn = OtnLookup(sc->otn_map, HTTP_GID, sid);
+        if ((otn != nullptr) && otn->enabled_somewhere())
+            use.js_events = true;
+    }
+}
+
+bool HttpInspect::configure(SnortConfig* sc)
 {
     if (params->js_norm_param.normalize_javascript)
         params->js_norm_param.js_norm->configure();
 
+    HttpParaList::BufferUse& use = params->buffer_use;
+    find_buffer_use(sc, use);
+    use.js_xtra_data = EventManager::logs_xtra_data();
+    use.set_processing(params->request_depth, params->response_depth);
+
     return true;
 }
 
@@ -145,6 +196,7 @@ void HttpInspect::show(const SnortConfig*) const
     ConfigLogger::log_limit("request_depth", params->request_depth, -1LL);
     ConfigLogger::log_limit("response_depth", params->response_depth, -1LL);
     ConfigLogger::log_flag("unzip", params->unzip);
+    ConfigLogger::log_value("unzip_memcap", params->unzip_memcap);
     ConfigLogger::log_flag("normalize_utf", params->normalize_utf);
     ConfigLogger::log_flag("decompress_pdf", params->decompress_pdf);
     ConfigLogger::log_flag("decompress_swf", params->decompress_swf);
@@ -379,7 +431,8 @@ int HttpInspect::get_xtra_jsnorm(Flow* flow, uint8_t** buf, uint32_t* len, uint3
 
     if ((current_section == nullptr) ||
         (current_section->get_source_id() != SRC_SERVER) ||
-        !current_section->get_params()->js_norm_param.normalize_javascript)
+        !current_section->get_params()->js_norm_param.normalize_javascript ||
+        !current_section->get_params()->buffer_use.js_norm)
         return 0;
 
     HttpMsgBody* const body = current_section->get_body();
@@ -40,7 +40,7 @@ class HttpApi;
 class HttpInspect : public snort::Inspector
 {
 public:
-    HttpInspect(const HttpParaList* params_);
+    HttpInspect(HttpParaList* params_);
     ~HttpInspect() override { delete params; }
 
     bool get_buf(snort::InspectionBuffer::Type ibt, snort::Packet* p,
@@ -83,7 +83,7 @@ private:
     static HttpFlowData* http_get_flow_data(const snort::Flow* flow);
     static void http_set_flow_data(snort::Flow* flow, HttpFlowData* flow_data);
 
-    const HttpParaList* const params;
+    HttpParaList* const params;
 
     // Registrations for "extra data"
     const uint32_t xtra_trueip_id;
@@ -23,6 +23,7 @@
 
 #include "http_module.h"
 
+#include "decompress/inflate_pool.h"
 #include "helpers/literal_search.h"
 #include "log/messages.h"
 
@@ -74,7 +75,10 @@ const Parameter HttpModule::http_params[] =
       "maximum response message body bytes to examine (-1 no limit)" },
 
     { "unzip", Parameter::PT_BOOL, nullptr, "true",
-      "decompress gzip and deflate message bodies" },
+      "decompress gzip, deflate, brotli, and zstd message bodies" },
+
+    { "unzip_memcap", Parameter::PT_INT, "65536:max32", "8388608",
+      "maximum memory used to decode each brotli or zstd message body" },
 
     { "normalize_utf", Parameter::PT_BOOL, nullptr, "true",
       "normalize charset utf encodings in response bodies" },
@@ -171,6 +175,14 @@ THREAD_LOCAL ProfileStats HttpModule::http_profile;
 ProfileStats* HttpModule::get_profile() const
 { return &http_profile; }
 
+void HttpModule::sum_stats(bool accumulate_now_stats)
+{
+    // the inflate pool is shared with file decompression but its counts are
+    // reported here since http_inspect is its main user
+    InflatePool::get_counts(peg_counts[PEG_INFLATE_HITS], peg_counts[PEG_INFLATE_MISSES]);
+    Module::sum_stats(accumulate_now_stats);
+}
+
 THREAD_LOCAL PegCount HttpModule::peg_counts[PEG_COUNT_MAX] = { };
 
 bool HttpModule::begin(const char*, int, SnortConfig*)
@@ -194,6 +206,10 @@ bool HttpModule::set(const char*, Value& val, SnortConfig*)
     {
         params->unzip = val.get_bool();
     }
+    else if (val.is("unzip_memcap"))
+    {
+        params->unzip_memcap = val.get_uint32();
+    }
     else if (val.is("normalize_utf"))
     {
         params->normalize_utf = val.get_bool();
@@ -427,6 +443,17 @@ HttpParaList::JsNormParam::~JsNormParam()
     delete js_norm;
 }
 
+void HttpParaList::BufferUse::set_processing(int64_t request_depth, int64_t response_depth)
+{
+    const bool detect_data_seen = file_data || http[HTTP_BUFFER_CLIENT_BODY];
+    accumulate_detect_data[HttpCommon::SRC_CLIENT] = detect_data_seen || (request_depth != -1);
+
+    // The JavaScript extra data is the response detection data
+    accumulate_detect_data[HttpCommon::SRC_SERVER] = detect_data_seen || js_xtra_data ||
+        (response_depth != -1);
+    js_norm = accumulate_detect_data[HttpCommon::SRC_SERVER] || js_events;
+}
+
 // Characters that should not be percent-encoded
 // 0-9, a-z, A-Z, tilde, period, underscore, and minus
 // Initializer string for std::bitset is in reverse order. The first character is element 255
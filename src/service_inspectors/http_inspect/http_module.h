@@ -41,6 +41,7 @@ public:
     int64_t response_depth = -1;
 
     bool unzip = true;
+    uint32_t unzip_memcap = 8388608;
     bool normalize_utf = true;
     bool decompress_pdf = false;
     bool decompress_swf = false;
@@ -97,6 +98,28 @@ public:
     // any custom headers mapped with the their respective Header IDs.
     StrCode header_list[HttpEnums::HEAD__MAX_VALUE + HttpEnums::MAX_CUSTOM_HEADERS + 1] = {};
 
+    // Which products of message processing the loaded rules can see. Filled in by
+    // HttpInspect::configure(). Until then everything is considered used.
+    struct BufferUse
+    {
+    public:
+        BufferUse() { http.set(); }
+
+        std::bitset<HttpEnums::HTTP_BUFFER_MAX> http;  // http_* rule options
+        bool file_data = true;      // file_data rule option
+        bool js_events = true;      // builtin rules for JavaScript normalization events
+        bool js_xtra_data = true;   // a logger writes the normalized JavaScript extra data
+
+        // Body detection data that no rule or logger can see is only assembled across partial
+        // inspections when its length counts against a depth. JavaScript normalization is
+        // skipped under the same conditions when none of its events are enabled.
+        bool accumulate_detect_data[2] = { true, true };
+        bool js_norm = true;
+
+        void set_processing(int64_t request_depth, int64_t response_depth);
+    };
+    BufferUse buffer_use;
+
 #ifdef REG_TEST
     int64_t print_amount = 1200;
 
@@ -118,7 +141,7 @@ public:
     bool set(const char*, snort::Value&, snort::SnortConfig*) override;
     unsigned get_gid() const override { return HttpEnums::HTTP_GID; }
     const snort::RuleMap* get_rules() const override { return http_events; }
-    const HttpParaList* get_once_params()
+    HttpParaList* get_once_params()
     {
         HttpParaList* ret_val = params;
         params = nullptr;
@@ -127,6 +150,7 @@ public:
 
     const PegInfo* get_pegs() const override { return peg_names; }
     PegCount* get_counts() const override { return peg_counts; }
+    void sum_stats(bool) override;
     static void increment_peg_counts(HttpEnums::PEG_COUNT counter)
         { peg_counts[counter]++; }
     static void increment_peg_counts(HttpEnums::PEG_COUNT counter, uint64_t value)
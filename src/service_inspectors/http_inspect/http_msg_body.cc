@@ -73,40 +73,50 @@ void HttpMsgBody::analyze()
 
         uint32_t& partial_detect_length = session_data->partial_detect_length[source_id];
         uint8_t*& partial_detect_buffer = session_data->partial_detect_buffer[source_id];
-        const int32_t total_length = partial_detect_length + js_norm_body.length();
-        const int32_t detect_length =
-            (total_length <= session_data->detect_depth_remaining[source_id]) ?
-            total_length : session_data->detect_depth_remaining[source_id];
 
-        if (partial_detect_length > 0)
+        if (!params->buffer_use.accumulate_detect_data[source_id] && (partial_detect_length == 0))
         {
-            uint8_t* const detect_buffer = new uint8_t[total_length];
-            memcpy(detect_buffer, partial_detect_buffer, partial_detect_length);
-            memcpy(detect_buffer + partial_detect_length, js_norm_body.start(),
-                js_norm_body.length());
-            detect_data.set(detect_length, detect_buffer, true);
+            // No rule can see the detection data and the depth is unlimited so there is no
+            // reason to carry it from one partial inspection to the next
+            detect_data.set(js_norm_body);
         }
         else
         {
-            detect_data.set(detect_length, js_norm_body.start());
-        }
+            const int32_t total_length = partial_detect_length + js_norm_body.length();
+            const int32_t detect_length =
+                (total_length <= session_data->detect_depth_remaining[source_id]) ?
+                total_length : session_data->detect_depth_remaining[source_id];
 
-        delete[] partial_detect_buffer;
-        session_data->update_deallocations(partial_detect_length);
+            if (partial_detect_length > 0)
+            {
+                uint8_t* const detect_buffer = new uint8_t[total_length];
+                memcpy(detect_buffer, partial_detect_buffer, partial_detect_length);
+                memcpy(detect_buffer + partial_detect_length, js_norm_body.start(),
+                    js_norm_body.length());
+                detect_data.set(detect_length, detect_buffer, true);
+            }
+            else
+            {
+                detect_data.set(detect_length, js_norm_body.start());
+            }
 
-        if (!session_data->partial_flush[source_id])
-        {
-            session_data->detect_depth_remaining[source_id] -= detect_length;
-            partial_detect_buffer = nullptr;
-            partial_detect_length = 0;
-        }
-        else
-        {
-            uint8_t* const save_partial = new uint8_t[detect_data.length()];
-            memcpy(save_partial, detect_data.start(), detect_data.length());
-            partial_detect_buffer = save_partial;
-            partial_detect_length = detect_data.length();
-            session_data->update_allocations(partial_detect_length);
+            delete[] partial_detect_buffer;
+            session_data->update_deallocations(partial_detect_length);
+
+            if (!session_data->partial_flush[source_id])
+            {
+                session_data->detect_depth_remaining[source_id] -= detect_length;
+                partial_detect_buffer = nullptr;
+                partial_detect_length = 0;
+            }
+            else
+            {
+                uint8_t* const save_partial = new uint8_t[detect_data.length()];
+                memcpy(save_partial, detect_data.start(), detect_data.length());
+                partial_detect_buffer = save_partial;
+                partial_detect_length = detect_data.length();
+                session_data->update_allocations(partial_detect_length);
+            }
         }
 
         set_file_data(const_cast<uint8_t*>(detect_data.start()),
@@ -232,7 +242,8 @@ void HttpMsgBody::fd_event_callback(void* context, int event)
 
 void HttpMsgBody::do_js_normalization(const Field& input, Field& output)
 {
-    if (!params->js_norm_param.normalize_javascript || source_id == SRC_CLIENT)
+    if (!params->js_norm_param.normalize_javascript || source_id == SRC_CLIENT ||
+        !params->buffer_use.js_norm)
     {
         output.set(input);
         return;
@@ -26,6 +26,8 @@
 #include <cassert>
 
 #include "decompress/file_decomp.h"
+#include "decompress/inflate_pool.h"
+#include "decompress/stream_decomp.h"
 #include "file_api/file_flows.h"
 #include "file_api/file_service.h"
 #include "hash/hash_key_operations.h"
@@ -511,6 +513,16 @@ void HttpMsgHeader::setup_encoding_decompression()
             add_infraction(INF_UNKNOWN_ENCODING);
             create_event(EVENT_UNKNOWN_ENCODING);
             break;
+        case CONTENTCODE_BR:
+        case CONTENTCODE_ZSTD:
+            // Supported only when built with the library
+            if (StreamDecomp::is_supported((content_code == CONTENTCODE_BR) ?
+                StreamDecomp::SD_BROTLI : StreamDecomp::SD_ZSTD))
+            {
+                compression = (content_code == CONTENTCODE_BR) ? CMP_BROTLI : CMP_ZSTD;
+                break;
+            }
+            // fallthrough
         default:
             // The ones we know by name but don't support
             add_infraction(INF_UNSUPPORTED_ENCODING);
@@ -522,18 +534,27 @@ void HttpMsgHeader::setup_encoding_decompression()
     if (compression == CMP_NONE)
         return;
 
-    session_data->compress_stream[source_id] = new z_stream;
-    session_data->compress_stream[source_id]->zalloc = Z_NULL;
-    session_data->compress_stream[source_id]->zfree = Z_NULL;
-    session_data->compress_stream[source_id]->next_in = Z_NULL;
-    session_data->compress_stream[source_id]->avail_in = 0;
+    if ((compression == CMP_BROTLI) || (compression == CMP_ZSTD))
+    {
+        const bool brotli = (compression == CMP_BROTLI);
+        session_data->stream_decomp[source_id] = StreamDecomp::create(
+            brotli ? StreamDecomp::SD_BROTLI : StreamDecomp::SD_ZSTD, params->unzip_memcap);
+        if (session_data->stream_decomp[source_id] == nullptr)
+        {
+            assert(false);
+            session_data->compression[source_id] = CMP_NONE;
+            return;
+        }
+        HttpModule::increment_peg_counts(brotli ? PEG_BROTLI_BODIES : PEG_ZSTD_BODIES);
+        return;
+    }
+
     const int window_bits = (compression == CMP_GZIP) ? GZIP_WINDOW_BITS : DEFLATE_WINDOW_BITS;
-    if (inflateInit2(session_data->compress_stream[source_id], window_bits) != Z_OK)
+    session_data->compress_stream[source_id] = InflatePool::acquire(window_bits);
+    if (session_data->compress_stream[source_id] == nullptr)
     {
         assert(false);
         session_data->compression[source_id] = CMP_NONE;
-        delete session_data->compress_stream[source_id];
-        session_data->compress_stream[source_id] = nullptr;
     }
 }
 
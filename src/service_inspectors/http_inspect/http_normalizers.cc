@@ -21,6 +21,7 @@
 #include "config.h"
 #endif
 
+#include "http_char_scan.h"
 #include "http_common.h"
 #include "http_normalizers.h"
 
@@ -36,12 +37,7 @@ using namespace HttpEnums;
 int32_t norm_to_lower(const uint8_t* in_buf, int32_t in_length, uint8_t* out_buf,
     HttpInfractions*, HttpEventGen*)
 {
-    for (int32_t k=0; k < in_length; k++)
-    {
-        // FIXIT-P tolower() might perform better but must be sure <locale> cannot be pulled in
-        out_buf[k] = ((in_buf[k] < 'A') || (in_buf[k] > 'Z')) ? in_buf[k] : in_buf[k] - ('A' -
-            'a');
-    }
+    HttpCharScan::to_lower(in_buf, in_length, out_buf);
     return in_length;
 }
 
@@ -53,7 +49,15 @@ int32_t norm_remove_lws(const uint8_t* in_buf, int32_t in_length, uint8_t* out_b
     for (int32_t k = 0; k < in_length; k++)
     {
         if (!is_sp_tab[in_buf[k]])
-            out_buf[length++] = in_buf[k];
+        {
+            // Space and tab are at or below <SP> so everything the scan skips is copied
+            int32_t end = HttpCharScan::find_space_or_ctl(in_buf, k+1, in_length);
+            while ((end < in_length) && !is_sp_tab[in_buf[end]])
+                end = HttpCharScan::find_space_or_ctl(in_buf, end+1, in_length);
+            memcpy(out_buf + length, in_buf + k, end - k);
+            length += end - k;
+            k = end - 1;
+        }
     }
     return length;
 }
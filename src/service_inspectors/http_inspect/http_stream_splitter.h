@@ -61,7 +61,8 @@ private:
         unsigned length) const;
     static void decompress_copy(uint8_t* buffer, uint32_t& offset, const uint8_t* data,
         uint32_t length, HttpEnums::CompressId& compression, z_stream*& compress_stream,
-        bool at_start, HttpInfractions* infractions, HttpEventGen* events);
+        StreamDecomp*& stream_decomp, bool at_start, HttpInfractions* infractions,
+        HttpEventGen* events);
     static void detain_packet(snort::Packet* pkt);
 
     HttpInspect* const my_inspector;
@@ -21,6 +21,8 @@
 #include "config.h"
 #endif
 
+#include "decompress/inflate_pool.h"
+#include "decompress/stream_decomp.h"
 #include "protocols/packet.h"
 
 #include "http_inspect.h"
@@ -100,7 +102,8 @@ void HttpStreamSplitter::chunk_spray(HttpFlowData* session_data, uint8_t* buffer
                 (session_data->section_offset[source_id] == 0);
             decompress_copy(buffer, session_data->section_offset[source_id], data+k, skip_amount,
                 session_data->compression[source_id], session_data->compress_stream[source_id],
-                at_start, session_data->get_infractions(source_id),
+                session_data->stream_decomp[source_id], at_start,
+                session_data->get_infractions(source_id),
                 session_data->events[source_id]);
             if ((expected -= skip_amount) == 0)
                 curr_state = CHUNK_DCRLF1;
@@ -130,7 +133,8 @@ void HttpStreamSplitter::chunk_spray(HttpFlowData* session_data, uint8_t* buffer
                 (session_data->section_offset[source_id] == 0);
             decompress_copy(buffer, session_data->section_offset[source_id], data+k, skip_amount,
                 session_data->compression[source_id], session_data->compress_stream[source_id],
-                at_start, session_data->get_infractions(source_id),
+                session_data->stream_decomp[source_id], at_start,
+                session_data->get_infractions(source_id),
                 session_data->events[source_id]);
             k += skip_amount-1;
             break;
@@ -141,7 +145,8 @@ void HttpStreamSplitter::chunk_spray(HttpFlowData* session_data, uint8_t* buffer
 
 void HttpStreamSplitter::decompress_copy(uint8_t* buffer, uint32_t& offset, const uint8_t* data,
     uint32_t length, HttpEnums::CompressId& compression, z_stream*& compress_stream,
-    bool at_start, HttpInfractions* infractions, HttpEventGen* events)
+    StreamDecomp*& stream_decomp, bool at_start, HttpInfractions* infractions,
+    HttpEventGen* events)
 {
     if ((compression == CMP_GZIP) || (compression == CMP_DEFLATE))
     {
@@ -176,8 +181,7 @@ void HttpStreamSplitter::decompress_copy(uint8_t* buffer, uint32_t& offset, cons
                     events->create_event(EVENT_GZIP_OVERRUN);
                 }
                 compression = CMP_NONE;
-                inflateEnd(compress_stream);
-                delete compress_stream;
+                InflatePool::release(compress_stream);
                 compress_stream = nullptr;
             }
             return;
@@ -194,8 +198,8 @@ void HttpStreamSplitter::decompress_copy(uint8_t* buffer, uint32_t& offset, cons
             inflate(compress_stream, Z_SYNC_FLUSH);
 
             // Start over at the beginning
-            decompress_copy(buffer, offset, data, length, compression, compress_stream, false,
-                infractions, events);
+            decompress_copy(buffer, offset, data, length, compression, compress_stream,
+                stream_decomp, false, infractions, events);
             return;
         }
         else
@@ -203,12 +207,59 @@ void HttpStreamSplitter::decompress_copy(uint8_t* buffer, uint32_t& offset, cons
             *infractions += INF_GZIP_FAILURE;
             events->create_event(EVENT_GZIP_FAILURE);
             compression = CMP_NONE;
-            inflateEnd(compress_stream);
-            delete compress_stream;
+            InflatePool::release(compress_stream);
             compress_stream = nullptr;
             // Since we failed to uncompress the data, fall through
         }
     }
+    else if ((compression == CMP_BROTLI) || (compression == CMP_ZSTD))
+    {
+        const uint8_t* next_in = data;
+        uint32_t avail_in = length;
+        uint8_t* next_out = buffer + offset;
+        uint32_t avail_out = MAX_OCTETS - offset;
+        const StreamDecomp::Status status =
+            stream_decomp->decompress(next_in, avail_in, next_out, avail_out);
+
+        if ((status == StreamDecomp::SD_OK) || (status == StreamDecomp::SD_END))
+        {
+            offset = MAX_OCTETS - avail_out;
+            if (avail_in > 0)
+            {
+                // Same two ways not to consume all the input as gzip
+                if (status == StreamDecomp::SD_END)
+                {
+                    *infractions += INF_GZIP_EARLY_END;
+                    events->create_event(EVENT_GZIP_EARLY_END);
+                    const uint32_t num_copy = (avail_in <= avail_out) ? avail_in : avail_out;
+                    memcpy(buffer + offset, next_in, num_copy);
+                    offset += num_copy;
+                }
+                else
+                {
+                    assert(avail_out == 0);
+                    *infractions += INF_GZIP_OVERRUN;
+                    events->create_event(EVENT_GZIP_OVERRUN);
+                }
+                compression = CMP_NONE;
+                delete stream_decomp;
+                stream_decomp = nullptr;
+            }
+            return;
+        }
+        else
+        {
+            // A window larger than unzip_memcap is counted separately from corrupt data
+            if (status == StreamDecomp::SD_MEMCAP)
+                HttpModule::increment_peg_counts(PEG_DECODE_MEMCAP);
+            *infractions += INF_GZIP_FAILURE;
+            events->create_event(EVENT_GZIP_FAILURE);
+            compression = CMP_NONE;
+            delete stream_decomp;
+            stream_decomp = nullptr;
+            // Since we failed to decode the data, fall through
+        }
+    }
 
     // The following precaution is necessary because mixed compressed and uncompressed data can
     // cause the buffer to overrun even though we are not decompressing right now
@@ -400,7 +451,7 @@ const StreamBuffer HttpStreamSplitter::reassemble(Flow* flow, unsigned total,
              (session_data->section_offset[source_id] == 0);
         decompress_copy(buffer, session_data->section_offset[source_id], data, len,
             session_data->compression[source_id], session_data->compress_stream[source_id],
-            at_start, session_data->get_infractions(source_id),
+            session_data->stream_decomp[source_id], at_start, session_data->get_infractions(source_id),
             session_data->events[source_id]);
     }
     else
@@ -160,6 +160,7 @@ const StrCode HttpMsgHeadShared::content_code_list[] =
     { CONTENTCODE_SDCH,          "sdch" },
     { CONTENTCODE_XPRESS,        "xpress" },
     { CONTENTCODE_XZ,            "xz" },
+    { CONTENTCODE_ZSTD,          "zstd" },
     { 0,                         nullptr }
 };
 
@@ -444,6 +445,12 @@ const PegInfo HttpModule::peg_names[PEG_COUNT_MAX+1] =
     { CountType::SUM, "pipelined_flows", "total HTTP connections containing pipelined requests" },
     { CountType::SUM, "pipelined_requests", "total requests placed in a pipeline" },
     { CountType::SUM, "total_bytes", "total HTTP data bytes inspected" },
+    { CountType::SUM, "inflate_pool_hits", "inflate streams reused from the per thread pool" },
+    { CountType::SUM, "inflate_pool_misses", "inflate streams created for the per thread pool" },
+    { CountType::SUM, "brotli_bodies", "message bodies decoded from brotli" },
+    { CountType::SUM, "zstd_bodies", "message bodies decoded from zstd" },
+    { CountType::SUM, "decode_memcap_exceeded",
+        "brotli or zstd bodies not decoded because of unzip_memcap" },
     { CountType::END, nullptr, nullptr }
 };
 
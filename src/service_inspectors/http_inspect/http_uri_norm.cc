@@ -23,8 +23,10 @@
 
 #include "http_uri_norm.h"
 
+#include <cstring>
 #include <sstream>
 
+#include "http_char_scan.h"
 #include "http_enum.h"
 #include "log/messages.h"
 
@@ -72,10 +74,13 @@ bool UriNormalizer::need_norm(const Field& uri_component, bool do_path,
 bool UriNormalizer::need_norm_no_path(const Field& uri_component,
     const HttpParaList::UriParam& uri_param)
 {
-    for (int32_t k = 0; k < uri_component.length(); k++)
+    const int32_t length = uri_component.length();
+    const uint8_t* const buf = uri_component.start();
+    for (int32_t k = HttpCharScan::find_uri_special(buf, 0, length); k < length;
+        k = HttpCharScan::find_uri_special(buf, k+1, length))
     {
-        if ((uri_param.uri_char[uri_component.start()[k]] == CHAR_PERCENT) ||
-            (uri_param.uri_char[uri_component.start()[k]] == CHAR_SUBSTIT))
+        if ((uri_param.uri_char[buf[k]] == CHAR_PERCENT) ||
+            (uri_param.uri_char[buf[k]] == CHAR_SUBSTIT))
             return true;
     }
     return false;
@@ -86,7 +91,9 @@ bool UriNormalizer::need_norm_path(const Field& uri_component,
 {
     const int32_t length = uri_component.length();
     const uint8_t* const buf = uri_component.start();
-    for (int32_t k = 0; k < length; k++)
+    // Characters the scan skips over are always CHAR_NORMAL
+    for (int32_t k = HttpCharScan::find_uri_special(buf, 0, length); k < length;
+        k = HttpCharScan::find_uri_special(buf, k+1, length))
     {
         switch (uri_param.uri_char[buf[k]])
         {
@@ -146,6 +153,15 @@ int32_t UriNormalizer::norm_percent_processing(const Field& input, uint8_t* out_
     int32_t length = 0;
     for (int32_t k = 0; k < input.length(); k++)
     {
+        // Everything other than percent and eight-bit characters is copied through so runs of
+        // them are moved in bulk
+        const int32_t next = HttpCharScan::find_percent_or_eightbit(input.start(), k,
+            input.length());
+        memmove(out_buf + length, input.start() + k, next - k);
+        length += next - k;
+        if ((k = next) == input.length())
+            break;
+
         switch (uri_param.uri_char[input.start()[k]])
         {
         case CHAR_EIGHTBIT:
@@ -290,7 +306,14 @@ int32_t UriNormalizer::norm_double_decode(const Field& input, uint8_t* out_buf,
     for (int32_t k = 0; k < input.length(); k++)
     {
         if (input.start()[k] != '%')
-            out_buf[length++] = input.start()[k];
+        {
+            const uint8_t* const percent = (const uint8_t*)memchr(input.start() + k, '%',
+                input.length() - k);
+            const int32_t next = (percent != nullptr) ? percent - input.start() : input.length();
+            memmove(out_buf + length, input.start() + k, next - k);
+            length += next - k;
+            k = next - 1;
+        }
         else
         {
             if (is_percent_encoding(input, k))
@@ -359,24 +382,20 @@ void UriNormalizer::norm_substitute(uint8_t* buf, int32_t length,
 {
     if (uri_param.backslash_to_slash)
     {
-        for (int32_t k = 0; k < length; k++)
+        uint8_t* end = buf + length;
+        for (uint8_t* p = buf; (p = (uint8_t*)memchr(p, '\\', end - p)) != nullptr; p++)
         {
-            if (buf[k] == '\\')
-            {
-                buf[k] = '/';
-                *infractions += INF_BACKSLASH_IN_URI;
-                events->create_event(EVENT_BACKSLASH_IN_URI);
-            }
+            *p = '/';
+            *infractions += INF_BACKSLASH_IN_URI;
+            events->create_event(EVENT_BACKSLASH_IN_URI);
         }
     }
     if (uri_param.plus_to_space)
     {
-        for (int32_t k = 0; k < length; k++)
+        uint8_t* end = buf + length;
+        for (uint8_t* p = buf; (p = (uint8_t*)memchr(p, '+', end - p)) != nullptr; p++)
         {
-            if (buf[k] == '+')
-            {
-                buf[k] = ' ';
-            }
+            *p = ' ';
         }
     }
 }
@@ -398,7 +417,16 @@ int32_t UriNormalizer::norm_path_clean(uint8_t* buf, const int32_t in_length,
         // Pass through all non-slash characters and also the leading slash
         if (((k < in_length) && (buf[k] != '/')) || (k == 0))
         {
-            buf[length++] = buf[k];
+            int32_t end = k + 1;
+            if (end < in_length)
+            {
+                const uint8_t* const slash = (const uint8_t*)memchr(buf + end, '/',
+                    in_length - end);
+                end = (slash != nullptr) ? slash - buf : in_length;
+            }
+            memmove(buf + length, buf + k, end - k);
+            length += end - k;
+            k = end - 1;
         }
         // Ignore this slash if it directly follows another slash
         else if ((k < in_length) && (length >= 1) && (buf[length-1] == '/'))
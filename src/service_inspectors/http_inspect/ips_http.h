@@ -103,6 +103,8 @@ public:
     uint32_t hash() const override;
     bool operator==(const snort::IpsOption& ips) const override;
     bool retry(Cursor&, const Cursor&) override;
+    HttpEnums::HTTP_BUFFER get_buffer_type() const
+        { return (HttpEnums::HTTP_BUFFER)buffer_info.type; }
     static IpsOption* opt_ctor(snort::Module* m, OptTreeNode*)
         { return new HttpIpsOption((HttpCursorModule*)m); }
     static void opt_dtor(snort::IpsOption* p) { delete p; }
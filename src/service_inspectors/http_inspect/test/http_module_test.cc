@@ -23,9 +23,11 @@
 #include "config.h"
 #endif
 
+#include "decompress/inflate_pool.h"
 #include "helpers/literal_search.h"
 #include "log/messages.h"
 
+#include "service_inspectors/http_inspect/http_common.h"
 #include "service_inspectors/http_inspect/http_js_norm.h"
 #include "service_inspectors/http_inspect/http_module.h"
 #include "service_inspectors/http_inspect/http_str_to_code.h"
@@ -36,6 +38,7 @@
 #include <CppUTestExt/MockSupport.h>
 
 using namespace snort;
+using namespace HttpCommon;
 using namespace HttpEnums;
 
 namespace snort
@@ -56,6 +59,7 @@ LiteralSearch* LiteralSearch::instantiate(LiteralSearch::Handle*, const uint8_t*
 }
 
 void show_stats(PegCount*, const PegInfo*, unsigned, const char*) { }
+void InflatePool::get_counts(PegCount&, PegCount&) { }
 void show_stats(PegCount*, const PegInfo*, const IndexVec&, const char*, FILE*) { }
 
 int32_t str_to_code(const char*, const StrCode []) { return 0; }
@@ -122,6 +126,109 @@ TEST(http_peg_count_test, zero_out)
     CHECK(counts[PEG_INSPECT] == 1);
 }
 
+TEST_GROUP(http_buffer_use_test)
+{
+    HttpParaList::BufferUse use;
+
+    // What find_buffer_use() and EventManager report for a rule set and logger configuration
+    void set_rules(bool file_data, bool client_body, bool other_http, bool js_events,
+        bool js_xtra_data)
+    {
+        use.http.reset();
+        use.http[HTTP_BUFFER_CLIENT_BODY] = client_body;
+        use.http[HTTP_BUFFER_URI] = other_http;
+        use.http[HTTP_BUFFER_HEADER] = other_http;
+        use.file_data = file_data;
+        use.js_events = js_events;
+        use.js_xtra_data = js_xtra_data;
+    }
+};
+
+TEST(http_buffer_use_test, defaults)
+{
+    CHECK(use.http.all());
+    CHECK(use.file_data);
+    CHECK(use.js_events);
+    CHECK(use.js_xtra_data);
+    CHECK(use.accumulate_detect_data[SRC_CLIENT]);
+    CHECK(use.accumulate_detect_data[SRC_SERVER]);
+    CHECK(use.js_norm);
+}
+
+TEST(http_buffer_use_test, file_data_rules)
+{
+    set_rules(true, false, true, false, false);
+    use.set_processing(-1, -1);
+    CHECK(use.accumulate_detect_data[SRC_CLIENT]);
+    CHECK(use.accumulate_detect_data[SRC_SERVER]);
+    CHECK(use.js_norm);
+}
+
+TEST(http_buffer_use_test, client_body_rules)
+{
+    set_rules(false, true, false, false, false);
+    use.set_processing(-1, -1);
+    CHECK(use.accumulate_detect_data[SRC_CLIENT]);
+    CHECK(use.accumulate_detect_data[SRC_SERVER]);
+    CHECK(use.js_norm);
+}
+
+TEST(http_buffer_use_test, header_rules)
+{
+    set_rules(false, false, true, false, false);
+    use.set_processing(-1, -1);
+    CHECK(!use.accumulate_detect_data[SRC_CLIENT]);
+    CHECK(!use.accumulate_detect_data[SRC_SERVER]);
+    CHECK(!use.js_norm);
+}
+
+TEST(http_buffer_use_test, header_rules_with_jsnorm_logging)
+{
+    set_rules(false, false, true, false, true);
+    use.set_processing(-1, -1);
+    CHECK(!use.accumulate_detect_data[SRC_CLIENT]);
+    CHECK(use.accumulate_detect_data[SRC_SERVER]);
+    CHECK(use.js_norm);
+}
+
+TEST(http_buffer_use_test, header_rules_with_depth)
+{
+    set_rules(false, false, true, false, false);
+    use.set_processing(1000, -1);
+    CHECK(use.accumulate_detect_data[SRC_CLIENT]);
+    CHECK(!use.accumulate_detect_data[SRC_SERVER]);
+    CHECK(!use.js_norm);
+
+    use.set_processing(-1, 1000);
+    CHECK(!use.accumulate_detect_data[SRC_CLIENT]);
+    CHECK(use.accumulate_detect_data[SRC_SERVER]);
+    CHECK(use.js_norm);
+}
+
+// Whenever a rule, event, or logger can see the detection data or the normalized JavaScript it
+// is produced exactly as it was before any work was skipped
+TEST(http_buffer_use_test, nothing_seen_is_skipped)
+{
+    for (unsigned k = 0; k < 128; k++)
+    {
+        const bool file_data = k & 1;
+        const bool client_body = k & 2;
+        const bool js_events = k & 8;
+        const bool js_xtra_data = k & 16;
+        const int64_t request_depth = (k & 32) ? 1000 : -1;
+        const int64_t response_depth = (k & 64) ? 1000 : -1;
+
+        set_rules(file_data, client_body, k & 4, js_events, js_xtra_data);
+        use.set_processing(request_depth, response_depth);
+
+        const bool detect_seen = file_data || client_body;
+        CHECK(use.accumulate_detect_data[SRC_CLIENT] == (detect_seen || (request_depth != -1)));
+        CHECK(use.accumulate_detect_data[SRC_SERVER] ==
+            (detect_seen || js_xtra_data || (response_depth != -1)));
+        CHECK(use.js_norm == (use.accumulate_detect_data[SRC_SERVER] || js_events));
+    }
+}
+
 int main(int argc, char** argv)
 {
     return CommandLineTestRunner::RunAllTests(argc, argv);
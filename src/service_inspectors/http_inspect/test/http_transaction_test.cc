@@ -23,6 +23,7 @@
 #include "config.h"
 #endif
 
+#include "decompress/inflate_pool.h"
 #include "service_inspectors/http_inspect/http_common.h"
 #include "service_inspectors/http_inspect/http_enum.h"
 #include "service_inspectors/http_inspect/http_flow_data.h"
@@ -51,6 +52,7 @@ void FlowData::update_deallocations(size_t) {}
 }
 
 THREAD_LOCAL PegCount HttpModule::peg_counts[PEG_COUNT_MAX] = { };
+void InflatePool::release(z_stream*) { }
 
 class HttpUnitTestSetup
 {
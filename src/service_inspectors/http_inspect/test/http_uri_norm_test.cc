@@ -23,17 +23,24 @@
 #include "config.h"
 #endif
 
+#include "decompress/inflate_pool.h"
 #include "helpers/literal_search.h"
 #include "log/messages.h"
 
+#include "service_inspectors/http_inspect/http_char_scan.h"
+#include "service_inspectors/http_inspect/http_header_normalizer.h"
 #include "service_inspectors/http_inspect/http_js_norm.h"
+#include "service_inspectors/http_inspect/http_normalizers.h"
 #include "service_inspectors/http_inspect/http_uri_norm.h"
 
+#include <random>
+
 #include <CppUTest/CommandLineTestRunner.h>
 #include <CppUTest/TestHarness.h>
 #include <CppUTestExt/MockSupport.h>
 
 using namespace snort;
+using namespace HttpEnums;
 
 namespace snort
 {
@@ -51,6 +58,7 @@ LiteralSearch* LiteralSearch::instantiate(LiteralSearch::Handle*, const uint8_t*
 }
 
 void show_stats(PegCount*, const PegInfo*, unsigned, const char*) { }
+void InflatePool::get_counts(PegCount&, PegCount&) { }
 void show_stats(PegCount*, const PegInfo*, const IndexVec&, const char*, FILE*) { }
 
 HttpJsNorm::HttpJsNorm(int, const HttpParaList::UriParam& uri_param_) :
@@ -156,6 +164,549 @@ TEST(http_double_decode_test, u_encode_all)
     CHECK(memcmp(result.start(), "/uri/to/normalize", 17) == 0);
 }
 
+// Differential tests for the vector scans. The reference functions are the byte at a time
+// normalizers the scans replaced. Random inputs rich in escape and path characters must produce
+// the same output, infractions, and events under every combination of URI options.
+
+namespace reference
+{
+static bool is_percent_encoding(const uint8_t* buf, int32_t length, int32_t k)
+{
+    return (k+2 < length) && (HttpEnums::as_hex[buf[k+1]] != -1) &&
+        (HttpEnums::as_hex[buf[k+2]] != -1);
+}
+
+static uint8_t extract_percent_encoding(const uint8_t* buf, int32_t k)
+{
+    return HttpEnums::as_hex[buf[k+1]] << 4 | HttpEnums::as_hex[buf[k+2]];
+}
+
+static bool is_u_encoding(const uint8_t* buf, int32_t length, int32_t k)
+{
+    return (k+5 < length) && ((buf[k+1] == 'u') || (buf[k+1] == 'U')) &&
+        (HttpEnums::as_hex[buf[k+2]] != -1) && (HttpEnums::as_hex[buf[k+3]] != -1) &&
+        (HttpEnums::as_hex[buf[k+4]] != -1) && (HttpEnums::as_hex[buf[k+5]] != -1);
+}
+
+static uint16_t extract_u_encoding(const uint8_t* buf, int32_t k)
+{
+    return (HttpEnums::as_hex[buf[k+2]] << 12) | (HttpEnums::as_hex[buf[k+3]] << 8) |
+        (HttpEnums::as_hex[buf[k+4]] << 4) | HttpEnums::as_hex[buf[k+5]];
+}
+
+static uint8_t reduce_to_eight_bits(uint16_t value, const HttpParaList::UriParam& uri_param,
+    HttpInfractions* infractions, HttpEventGen* events)
+{
+    if (value <= 0xFF)
+        return value;
+    if (!uri_param.iis_unicode)
+        return 0xFF;
+    if (uri_param.unicode_map[value] != 0xFF)
+    {
+        *infractions += INF_CODE_POINT_IN_URI;
+        events->create_event(EVENT_CODE_POINT_IN_URI);
+    }
+    return uri_param.unicode_map[value];
+}
+
+static void detect_bad_char(const uint8_t* buf, int32_t length,
+    const HttpParaList::UriParam& uri_param, HttpInfractions* infractions, HttpEventGen* events)
+{
+    if (uri_param.bad_characters.count() == 0)
+        return;
+    for (int32_t k = 0; k < length; k++)
+    {
+        if (uri_param.bad_characters[buf[k]])
+        {
+            *infractions += INF_URI_BAD_CHAR;
+            events->create_event(EVENT_NON_RFC_CHAR);
+            return;
+        }
+    }
+}
+
+static bool need_norm(const uint8_t* buf, int32_t length, bool do_path,
+    const HttpParaList::UriParam& uri_param, HttpInfractions* infractions, HttpEventGen* events)
+{
+    for (int32_t k = 0; k < length; k++)
+    {
+        switch (uri_param.uri_char[buf[k]])
+        {
+        case CHAR_NORMAL:
+        case CHAR_EIGHTBIT:
+            continue;
+        case CHAR_PERCENT:
+        case CHAR_SUBSTIT:
+            return true;
+        case CHAR_PATH:
+            if (!do_path || !uri_param.simplify_path)
+                continue;
+            if (buf[k] == '/')
+            {
+                if ((k == 0) || (buf[k-1] != '/'))
+                    continue;
+                return true;
+            }
+            if (((k == 0) || (uri_param.uri_char[buf[k-1]] != CHAR_PATH)) &&
+                ((k == length-1) || (uri_param.uri_char[buf[k+1]] != CHAR_PATH)))
+                continue;
+            return true;
+        }
+    }
+    detect_bad_char(buf, length, uri_param, infractions, events);
+    return false;
+}
+
+static int32_t percent_processing(const uint8_t* in, int32_t in_length, uint8_t* out_buf,
+    const HttpParaList::UriParam& uri_param, bool& utf8_needed,
+    std::vector<bool>& percent_encoded, bool& double_decoding_needed,
+    HttpInfractions* infractions, HttpEventGen* events)
+{
+    int32_t length = 0;
+    for (int32_t k = 0; k < in_length; k++)
+    {
+        switch (uri_param.uri_char[in[k]])
+        {
+        case CHAR_EIGHTBIT:
+            if (uri_param.utf8_bare_byte &&
+               (((in[k] & 0xE0) == 0xC0) || ((in[k] & 0xF0) == 0xE0)))
+                utf8_needed = true;
+            // Fall through
+        case CHAR_NORMAL:
+        case CHAR_PATH:
+        case CHAR_SUBSTIT:
+            out_buf[length++] = in[k];
+            break;
+        case CHAR_PERCENT:
+            if (is_percent_encoding(in, in_length, k))
+            {
+                const uint8_t hex_val = extract_percent_encoding(in, k);
+                percent_encoded[length] = true;
+                if (((hex_val & 0xE0) == 0xC0) || ((hex_val & 0xF0) == 0xE0))
+                    utf8_needed = true;
+                if (hex_val == '%')
+                    double_decoding_needed = true;
+                out_buf[length++] = hex_val;
+                k += 2;
+            }
+            else if ((k+1 < in_length) && (in[k+1] == '%'))
+            {
+                double_decoding_needed = true;
+                out_buf[length++] = '%';
+                k += 1;
+            }
+            else if (uri_param.percent_u && is_u_encoding(in, in_length, k))
+            {
+                *infractions += INF_URI_U_ENCODE;
+                events->create_event(EVENT_U_ENCODE);
+                percent_encoded[length] = true;
+                const uint8_t byte_val = reduce_to_eight_bits(extract_u_encoding(in, k),
+                    uri_param, infractions, events);
+                if (((byte_val & 0xE0) == 0xC0) || ((byte_val & 0xF0) == 0xE0))
+                    utf8_needed = true;
+                if (byte_val == '%')
+                    double_decoding_needed = true;
+                out_buf[length++] = byte_val;
+                k += 5;
+            }
+            else
+            {
+                *infractions += INF_URI_UNKNOWN_PERCENT;
+                events->create_event(EVENT_UNKNOWN_PERCENT);
+                double_decoding_needed = true;
+                out_buf[length++] = '%';
+            }
+            if (uri_param.unreserved_char[out_buf[length-1]])
+            {
+                *infractions += INF_URI_PERCENT_UNRESERVED;
+                events->create_event(EVENT_ASCII);
+            }
+            break;
+        }
+    }
+    return length;
+}
+
+static int32_t utf8_processing(uint8_t* buf, int32_t in_length,
+    const HttpParaList::UriParam& uri_param, const std::vector<bool>& pe,
+    bool& double_decoding_needed, HttpInfractions* infractions, HttpEventGen* events)
+{
+    const bool bare = uri_param.utf8_bare_byte;
+    int32_t length = 0;
+    for (int32_t k=0; k < in_length; k++)
+    {
+        uint16_t utf8_val;
+        int32_t extra;
+        if (!pe[k] && !bare)
+        {
+            buf[length++] = buf[k];
+            continue;
+        }
+        if (((buf[k] & 0xE0) == 0xC0) && (k+1 < in_length) && (pe[k+1] || bare) &&
+            ((buf[k+1] & 0xC0) == 0x80))
+        {
+            *infractions += INF_URI_PERCENT_UTF8_2B;
+            events->create_event(EVENT_UTF_8);
+            if (!pe[k] || !pe[k+1])
+            {
+                *infractions += INF_BARE_BYTE;
+                events->create_event(EVENT_BARE_BYTE);
+            }
+            utf8_val = ((buf[k] & 0x1F) << 6) + (buf[k+1] & 0x3F);
+            extra = 1;
+        }
+        else if (((buf[k] & 0xF0) == 0xE0) && (k+2 < in_length) && (pe[k+1] || bare) &&
+            ((buf[k+1] & 0xC0) == 0x80) && (pe[k+2] || bare) && ((buf[k+2] & 0xC0) == 0x80))
+        {
+            *infractions += INF_URI_PERCENT_UTF8_3B;
+            events->create_event(EVENT_UTF_8);
+            if (!pe[k] || !pe[k+1] || !pe[k+2])
+            {
+                *infractions += INF_BARE_BYTE;
+                events->create_event(EVENT_BARE_BYTE);
+            }
+            utf8_val = ((buf[k] & 0x0F) << 12) + ((buf[k+1] & 0x3F) << 6) + (buf[k+2] & 0x3F);
+            extra = 2;
+        }
+        else
+        {
+            buf[length++] = buf[k];
+            continue;
+        }
+        const uint8_t val8 = reduce_to_eight_bits(utf8_val, uri_param, infractions, events);
+        if (val8 == '%')
+            double_decoding_needed = true;
+        buf[length++] = val8;
+        k += extra;
+    }
+    return length;
+}
+
+static int32_t double_decode(uint8_t* buf, int32_t in_length,
+    const HttpParaList::UriParam& uri_param, HttpInfractions* infractions, HttpEventGen* events)
+{
+    int32_t length = 0;
+    for (int32_t k = 0; k < in_length; k++)
+    {
+        if (buf[k] != '%')
+            buf[length++] = buf[k];
+        else if (is_percent_encoding(buf, in_length, k))
+        {
+            *infractions += INF_URI_DOUBLE_DECODE;
+            events->create_event(EVENT_DOUBLE_DECODE);
+            buf[length++] = extract_percent_encoding(buf, k);
+            k += 2;
+        }
+        else if (uri_param.percent_u && is_u_encoding(buf, in_length, k))
+        {
+            *infractions += INF_URI_DOUBLE_DECODE;
+            events->create_event(EVENT_DOUBLE_DECODE);
+            *infractions += INF_URI_U_ENCODE;
+            events->create_event(EVENT_U_ENCODE);
+            buf[length++] = reduce_to_eight_bits(extract_u_encoding(buf, k), uri_param,
+                infractions, events);
+            k += 5;
+        }
+        else
+            buf[length++] = '%';
+    }
+    return length;
+}
+
+static int32_t path_clean(uint8_t* buf, const int32_t in_length, HttpInfractions* infractions,
+    HttpEventGen* events)
+{
+    int32_t length = 0;
+    for (int32_t k = 0; k <= in_length; k++)
+    {
+        if (((k < in_length) && (buf[k] != '/')) || (k == 0))
+            buf[length++] = buf[k];
+        else if ((k < in_length) && (length >= 1) && (buf[length-1] == '/'))
+        {
+            *infractions += INF_URI_MULTISLASH;
+            events->create_event(EVENT_MULTI_SLASH);
+        }
+        else if ((length >= 2) && (buf[length-1] == '.') && (buf[length-2] == '/'))
+        {
+            *infractions += INF_URI_SLASH_DOT;
+            events->create_event(EVENT_SELF_DIR_TRAV);
+            length -= 1;
+        }
+        else if ((length >= 3) && (buf[length-1] == '.') && (buf[length-2] == '.') &&
+            (buf[length-3] == '/'))
+        {
+            *infractions += INF_URI_SLASH_DOT_DOT;
+            events->create_event(EVENT_DIR_TRAV);
+            if ( (length == 3) ||
+                ((length >= 6) && (buf[length-4] == '.') && (buf[length-5] == '.') &&
+                (buf[length-6] == '/')))
+            {
+                *infractions += INF_URI_ROOT_TRAV;
+                events->create_event(EVENT_WEBROOT_DIR);
+                buf[length++] = '/';
+            }
+            else
+            {
+                for (length -= 3; buf[length-1] != '/'; length--);
+            }
+        }
+        else if (k < in_length)
+            buf[length++] = '/';
+    }
+    return length;
+}
+
+static int32_t normalize(const uint8_t* in, int32_t in_length, bool do_path, uint8_t* buf,
+    const HttpParaList::UriParam& uri_param, HttpInfractions* infractions, HttpEventGen* events)
+{
+    bool utf8_needed = false;
+    bool double_decoding_needed = false;
+    std::vector<bool> percent_encoded(in_length, false);
+    int32_t length = percent_processing(in, in_length, buf, uri_param, utf8_needed,
+        percent_encoded, double_decoding_needed, infractions, events);
+    if (uri_param.utf8 && utf8_needed)
+        length = utf8_processing(buf, length, uri_param, percent_encoded,
+            double_decoding_needed, infractions, events);
+    if (uri_param.iis_double_decode && double_decoding_needed)
+        length = double_decode(buf, length, uri_param, infractions, events);
+
+    detect_bad_char(buf, length, uri_param, infractions, events);
+
+    for (int32_t k = 0; k < length; k++)
+    {
+        if (uri_param.backslash_to_slash && (buf[k] == '\\'))
+        {
+            buf[k] = '/';
+            *infractions += INF_BACKSLASH_IN_URI;
+            events->create_event(EVENT_BACKSLASH_IN_URI);
+        }
+        else if (uri_param.plus_to_space && (buf[k] == '+'))
+            buf[k] = ' ';
+    }
+
+    if (do_path && uri_param.simplify_path)
+        length = path_clean(buf, length, infractions, events);
+    return length;
+}
+
+static int32_t derive_header_content(const uint8_t* value, int32_t length, uint8_t* buffer,
+    HttpInfractions* infractions, HttpEventGen* events)
+{
+    int32_t out_length = 0;
+    bool beginning = true;
+    bool last_white = true;
+    for (int32_t k=0; k < length; k++)
+    {
+        if (!is_sp_tab_cr_lf[value[k]])
+        {
+            if (last_white && !beginning)
+            {
+                *infractions += INF_BAD_HEADER_WHITESPACE;
+                events->create_event(EVENT_BAD_HEADER_WHITESPACE);
+            }
+            beginning = false;
+            last_white = false;
+            buffer[out_length++] = value[k];
+        }
+        else if (!last_white)
+        {
+            last_white = true;
+            buffer[out_length++] = ' ';
+        }
+    }
+    if ((out_length > 0) && (buffer[out_length - 1] == ' '))
+        out_length--;
+    return out_length;
+}
+}
+
+// Mostly characters that mean something to a normalizer with an occasional arbitrary byte
+static void random_input(std::mt19937& rng, uint8_t* buf, int32_t length)
+{
+    static const char alphabet[] = "%%%%uU0123456789aAbcdefFxyz///...\\\\++  \t\r\n,"
+        "\xC0\xC1\xE0\xE1\x80\x81\xA5\xBF\xFF";
+    std::uniform_int_distribution<unsigned> pick(0, sizeof(alphabet) + 7);
+    std::uniform_int_distribution<unsigned> any(0, 255);
+
+    for (int32_t k = 0; k < length; k++)
+    {
+        const unsigned n = pick(rng);
+        buf[k] = (n < sizeof(alphabet) - 1) ? alphabet[n] : any(rng);
+    }
+}
+
+static void set_options(HttpParaList::UriParam& uri_param, unsigned opt)
+{
+    uri_param.percent_u = opt & 0x001;
+    uri_param.utf8 = opt & 0x002;
+    uri_param.utf8_bare_byte = opt & 0x004;
+    uri_param.iis_unicode = opt & 0x008;
+    uri_param.iis_double_decode = opt & 0x010;
+    uri_param.backslash_to_slash = opt & 0x020;
+    uri_param.plus_to_space = opt & 0x040;
+    uri_param.simplify_path = opt & 0x080;
+    uri_param.bad_characters.reset();
+    if (opt & 0x100)
+    {
+        uri_param.bad_characters[0xFF] = true;
+        uri_param.bad_characters['\t'] = true;
+    }
+
+    // as HttpModule::set() does
+    uri_param.uri_char[(uint8_t)'\\'] = uri_param.backslash_to_slash ? CHAR_SUBSTIT : CHAR_NORMAL;
+    uri_param.uri_char[(uint8_t)'+'] = uri_param.plus_to_space ? CHAR_SUBSTIT : CHAR_NORMAL;
+    uri_param.uri_char[(uint8_t)'/'] = uri_param.simplify_path ? CHAR_PATH : CHAR_NORMAL;
+    uri_param.uri_char[(uint8_t)'.'] = uri_param.simplify_path ? CHAR_PATH : CHAR_NORMAL;
+}
+
+static bool same(const HttpInfractions& inf1, const HttpEventGen& ev1,
+    const HttpInfractions& inf2, const HttpEventGen& ev2)
+{
+    return (inf1.get_raw() == inf2.get_raw()) && (inf1.get_raw2() == inf2.get_raw2()) &&
+        (ev1.get_raw() == ev2.get_raw()) && (ev1.get_raw2() == ev2.get_raw2()) &&
+        (ev1.get_raw3() == ev2.get_raw3());
+}
+
+TEST_GROUP(http_char_scan_differential)
+{
+    std::mt19937 rng { 0x5eed };
+};
+
+TEST(http_char_scan_differential, scans)
+{
+    uint8_t in[300];
+    uint8_t out[300];
+    uint8_t expected[300];
+
+    for (unsigned n = 0; n < 2000; n++)
+    {
+        const int32_t length = rng() % sizeof(in);
+        random_input(rng, in, length);
+
+        for (int32_t start = 0; start <= length; start++)
+        {
+            int32_t k;
+            for (k = start; (k < length) && (in[k] != '%') && (in[k] != '+') && (in[k] != '\\')
+                && (in[k] != '/') && (in[k] != '.') && (in[k] < 0x80); k++);
+            CHECK(HttpCharScan::find_uri_special(in, start, length) == k);
+
+            for (k = start; (k < length) && (in[k] != '%') && (in[k] < 0x80); k++);
+            CHECK(HttpCharScan::find_percent_or_eightbit(in, start, length) == k);
+
+            for (k = start; (k < length) && (in[k] > ' '); k++);
+            CHECK(HttpCharScan::find_space_or_ctl(in, start, length) == k);
+        }
+
+        for (int32_t k = 0; k < length; k++)
+            expected[k] = ((in[k] < 'A') || (in[k] > 'Z')) ? in[k] : in[k] - ('A' - 'a');
+        HttpCharScan::to_lower(in, length, out);
+        CHECK(memcmp(out, expected, length) == 0);
+    }
+}
+
+TEST(http_char_scan_differential, uri)
+{
+    HttpParaList::UriParam uri_param;
+    uri_param.unicode_map = new uint8_t[65536];
+    UriNormalizer::load_default_unicode_map(uri_param.unicode_map);
+
+    for (unsigned opt = 0; opt < 0x200; opt++)
+    {
+        set_options(uri_param, opt);
+
+        for (unsigned n = 0; n < 100; n++)
+        {
+            const int32_t length = 1 + rng() % 250;
+            const bool do_path = rng() & 1;
+            uint8_t* const in = new uint8_t[length];
+            random_input(rng, in, length);
+            if (do_path)
+                in[0] = '/';
+
+            HttpInfractions inf1, inf2;
+            HttpEventGen ev1, ev2;
+            const Field input(length, in);
+
+            const bool need = UriNormalizer::need_norm(input, do_path, uri_param, &inf1, &ev1);
+            CHECK(need == reference::need_norm(in, length, do_path, uri_param, &inf2, &ev2));
+
+            uint8_t* const buf1 = new uint8_t[length + UriNormalizer::URI_NORM_EXPANSION];
+            uint8_t* const buf2 = new uint8_t[length + UriNormalizer::URI_NORM_EXPANSION];
+            Field result;
+            UriNormalizer::normalize(input, result, do_path, buf1, uri_param, &inf1, &ev1);
+            const int32_t ref_length = reference::normalize(in, length, do_path, buf2,
+                uri_param, &inf2, &ev2);
+
+            CHECK(result.length() == ref_length);
+            CHECK(memcmp(buf1, buf2, ref_length) == 0);
+            CHECK(same(inf1, ev1, inf2, ev2));
+
+            delete[] buf1;
+            delete[] buf2;
+            delete[] in;
+        }
+    }
+}
+
+TEST(http_char_scan_differential, header)
+{
+    static const HeaderNormalizer norm(EVENT__NONE, INF__NONE, true, norm_to_lower,
+        norm_remove_lws, nullptr);
+    const HeaderId ids[] = { HEAD_ALLOW, HEAD__OTHER, HEAD_ALLOW, HEAD_ALLOW };
+    const int num_headers = sizeof(ids) / sizeof(ids[0]);
+
+    for (unsigned n = 0; n < 5000; n++)
+    {
+        uint8_t* in[num_headers];
+        Field values[num_headers];
+        int32_t total = num_headers;
+
+        for (int j = 0; j < num_headers; j++)
+        {
+            const int32_t length = rng() % 120;
+            in[j] = new uint8_t[length + 1];
+            random_input(rng, in[j], length);
+            values[j].set(length, in[j]);
+            total += length;
+        }
+
+        HttpInfractions inf1, inf2;
+        HttpEventGen ev1, ev2;
+        Field result;
+        norm.normalize(HEAD_ALLOW, 3, &inf1, &ev1, ids, values, num_headers, result);
+
+        uint8_t* const derived = new uint8_t[total];
+        int32_t length = 0;
+        int matches = 0;
+        for (int j = 0; j < num_headers; j++)
+        {
+            if (ids[j] != HEAD_ALLOW)
+                continue;
+            if (matches++ > 0)
+                derived[length++] = ',';
+            length += reference::derive_header_content(values[j].start(), values[j].length(),
+                derived + length, &inf2, &ev2);
+        }
+        uint8_t* const expected = new uint8_t[total];
+        int32_t expected_length = 0;
+        for (int32_t k = 0; k < length; k++)
+        {
+            if ((derived[k] != ' ') && (derived[k] != '\t'))
+                expected[expected_length++] = ((derived[k] < 'A') || (derived[k] > 'Z')) ?
+                    derived[k] : derived[k] - ('A' - 'a');
+        }
+
+        CHECK(result.length() == expected_length);
+        CHECK(memcmp(result.start(), expected, expected_length) == 0);
+        CHECK(same(inf1, ev1, inf2, ev2));
+
+        delete[] expected;
+        delete[] derived;
+        for (int j = 0; j < num_headers; j++)
+            delete[] in[j];
+    }
+}
+
 int main(int argc, char** argv)
 {
     return CommandLineTestRunner::RunAllTests(argc, argv);
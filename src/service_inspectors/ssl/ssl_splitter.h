@@ -57,6 +57,11 @@ public:
         return true;
     }
 
+    bool can_gather() override
+    {
+        return true;
+    }
+
 private:
     SslPafStates paf_state;
     uint16_t remain_len;
@@ -95,6 +95,7 @@ public:
         uint32_t flags, uint32_t* fp) override;
 
     bool is_paf() override { return true; }
+    bool can_gather() override { return true; }
 
 private:
     void count_scan(const Flow* f)
@@ -387,11 +387,15 @@ uint32_t sfrt_flat_usage(table_flat_t* table)
         return 0;
     }
 
-    usage = table->allocated + sfrt_dir_flat_usage(table->rt);
+    /* The table is always the first allocation in its segment so it is also
+     * the base, which holds for a mapped list image too (unlike the global
+     * segment base). */
+    const uint8_t* base = (const uint8_t*)table;
+    usage = table->allocated + sfrt_dir_flat_usage(table->rt, base);
 
     if (table->rt6)
     {
-        usage += sfrt_dir_flat_usage(table->rt6);
+        usage += sfrt_dir_flat_usage(table->rt6, base);
     }
 
     return usage;
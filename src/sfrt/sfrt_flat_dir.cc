@@ -595,16 +595,14 @@ tuple_flat_t sfrt_dir_flat_lookup(const uint32_t* addr, int numAddrDwords, TABLE
     return _dir_sub_flat_lookup(&iplu, root->sub_table);
 }
 
-uint32_t sfrt_dir_flat_usage(TABLE_PTR table_ptr)
+uint32_t sfrt_dir_flat_usage(TABLE_PTR table_ptr, const uint8_t* base)
 {
-    dir_table_flat_t* table;
-    uint8_t* base;
+    const dir_table_flat_t* table;
     if (!table_ptr)
     {
         return 0;
     }
-    base = (uint8_t*)segment_basePtr();
-    table = (dir_table_flat_t*)(&base[table_ptr]);
-    return ((dir_table_flat_t*)(table))->allocated;
+    table = (const dir_table_flat_t*)(&base[table_ptr]);
+    return table->allocated;
 }
 
@@ -73,7 +73,8 @@ void sfrt_dir_flat_free(TABLE_PTR);
 tuple_flat_t sfrt_dir_flat_lookup(const uint32_t* addr, int numAddrDwords, TABLE_PTR table);
 int sfrt_dir_flat_insert(const uint32_t* addr, int numAddrDwords, int len, word data_index,
                     int behavior, TABLE_PTR, updateEntryInfoFunc updateEntry, INFO *data);
-uint32_t sfrt_dir_flat_usage(TABLE_PTR);
+// base is the start of the segment holding the table
+uint32_t sfrt_dir_flat_usage(TABLE_PTR, const uint8_t* base);
 
 #endif /* SFRT_FLAT_DIR_H */
 
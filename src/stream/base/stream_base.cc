@@ -76,6 +76,7 @@ const PegInfo base_pegs[] =
     { CountType::SUM, "reload_allowed_deletes", "number of allowed flows deleted by config reloads" },
     { CountType::SUM, "reload_blocked_deletes", "number of blocked flows deleted by config reloads" },
     { CountType::SUM, "reload_offloaded_deletes", "number of offloaded flows deleted by config reloads" },
+    { CountType::SUM, "prefetched_flows", "flow lookups prefetched ahead of decoding" },
     { CountType::END, nullptr, nullptr }
 };
 
@@ -98,6 +99,7 @@ void base_prep()
     stream_base_stats.reload_allowed_flow_deletes = flow_con->get_deletes(FlowDeleteState::ALLOWED);
     stream_base_stats.reload_offloaded_flow_deletes= flow_con->get_deletes(FlowDeleteState::OFFLOADED);
     stream_base_stats.reload_blocked_flow_deletes= flow_con->get_deletes(FlowDeleteState::BLOCKED);
+    stream_base_stats.prefetched_flows = flow_con->get_prefetches();
     ExpectCache* exp_cache = flow_con->get_exp_cache();
 
     if ( exp_cache )
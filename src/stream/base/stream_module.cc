@@ -38,6 +38,9 @@ using namespace std;
 
 THREAD_LOCAL const Trace* stream_trace = nullptr;
 
+// the flow caches are built with the startup config and can't change type
+static FlowTableType flow_table_type = FlowTableType::ZHASH;
+
 //-------------------------------------------------------------------------
 // stream module
 //-------------------------------------------------------------------------
@@ -81,6 +84,12 @@ static const Parameter s_params[] =
     { "pruning_timeout", Parameter::PT_INT, "1:max32", "30",
                     "minimum inactive time before being eligible for pruning" },
 
+    { "flow_table", Parameter::PT_ENUM, "zhash | flat", "zhash",
+      "flow cache storage; flat is open addressing with a separate LRU index (requires restart)" },
+
+    { "flow_prefetch", Parameter::PT_BOOL, nullptr, "false",
+      "prefetch flows for each DAQ message batch before decoding it" },
+
     { "held_packet_timeout", Parameter::PT_INT, "1:max32", "1000",
       "timeout in milliseconds for held packets" },
 
@@ -173,6 +182,16 @@ bool StreamModule::set(const char* fqn, Value& v, SnortConfig* c)
         config.flow_cache_cfg.pruning_timeout = v.get_uint32();
         return true;
     }
+    else if ( v.is("flow_table") )
+    {
+        config.flow_cache_cfg.table_type = (FlowTableType)v.get_uint8();
+        return true;
+    }
+    else if ( v.is("flow_prefetch") )
+    {
+        config.flow_cache_cfg.prefetch = v.get_bool();
+        return true;
+    }
     else if ( v.is("held_packet_timeout") )
     {
         config.held_packet_timeout = v.get_uint32();
@@ -213,6 +232,8 @@ bool StreamModule::end(const char* fqn, int, SnortConfig* sc)
 
         sc->register_reload_resource_tuner(new HPQReloadTuner(config.held_packet_timeout));
     }
+    else if ( strcmp(fqn, MOD_NAME) == 0 )
+        flow_table_type = config.flow_cache_cfg.table_type;
 
     return true;
 }
@@ -241,12 +262,25 @@ bool StreamReloadResourceManager::initialize(const StreamModuleConfig& config_)
         return false;
     }
 #endif
+    if ( config_.flow_cache_cfg.table_type != flow_table_type )
+    {
+        ReloadError("Changing stream.flow_table requires a restart.\n");
+        return false;
+    }
     config = config_;
     return true;
 }
 
 bool StreamReloadResourceManager::tinit()
 {
+    // prefetch applies from the next batch so it needs no tuning
+    if ( config.flow_cache_cfg.prefetch != flow_con->get_flow_cache_config().prefetch )
+    {
+        FlowCacheConfig cfg = flow_con->get_flow_cache_config();
+        cfg.prefetch = config.flow_cache_cfg.prefetch;
+        flow_con->set_flow_cache_config(cfg);
+    }
+
     int max_flows_change =
         config.flow_cache_cfg.max_flows - flow_con->get_flow_cache_config().max_flows;
 
@@ -334,6 +368,9 @@ void StreamModuleConfig::show() const
 {
     ConfigLogger::log_value("max_flows", flow_cache_cfg.max_flows);
     ConfigLogger::log_value("pruning_timeout", flow_cache_cfg.pruning_timeout);
+    ConfigLogger::log_value("flow_table",
+        flow_cache_cfg.table_type == FlowTableType::FLAT ? "flat" : "zhash");
+    ConfigLogger::log_flag("flow_prefetch", flow_cache_cfg.prefetch);
 
     for (int i = to_utype(PktType::IP); i < to_utype(PktType::MAX); ++i)
     {
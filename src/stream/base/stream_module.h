@@ -67,6 +67,7 @@ struct BaseStats
      PegCount reload_allowed_flow_deletes;
      PegCount reload_blocked_flow_deletes;
      PegCount reload_offloaded_flow_deletes;
+     PegCount prefetched_flows;
 };
 
 extern const PegInfo base_pegs[];
@@ -403,6 +403,12 @@ void Stream::handle_timeouts(bool idle)
     TcpStreamTracker::release_held_packets(cur_time, max_remove);
 }
 
+void Stream::prefetch_flows(const DAQ_Msg_h* msgs, unsigned num_msgs, int dlt)
+{
+    if ( flow_con )
+        flow_con->prefetch_flows(msgs, num_msgs, dlt);
+}
+
 void Stream::prune_flows()
 {
     if ( flow_con )
@@ -80,6 +80,10 @@ public:
     static void prune_flows();
     static bool expected_flow(Flow*, Packet*);
 
+    // Warms the flow cache for a batch of raw DAQ messages ahead of decoding
+    // when stream.flow_prefetch is enabled.
+    static void prefetch_flows(const DAQ_Msg_h*, unsigned num_msgs, int dlt);
+
     // Looks in the flow cache for flow session with specified key and returns
     // pointer to flow session object if found, otherwise null.
     static Flow* get_flow(const FlowKey*);
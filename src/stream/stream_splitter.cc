@@ -60,6 +60,27 @@ const StreamBuffer StreamSplitter::reassemble(
     return { nullptr, 0 };
 }
 
+const StreamBuffer StreamSplitter::gather(
+    Flow*, const StreamBuffer* segs, unsigned num, unsigned total)
+{
+    if ( num == 1 )
+        return segs[0];
+
+    unsigned max;
+    uint8_t* pdu_buf = DetectionEngine::get_next_buffer(max);
+    unsigned offset = 0;
+
+    assert(total < max);
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        memcpy(pdu_buf + offset, segs[i].data, segs[i].length);
+        offset += segs[i].length;
+    }
+    assert(offset == total);
+    return { pdu_buf, total };
+}
+
 //--------------------------------------------------------------------------
 // atom splitter
 //--------------------------------------------------------------------------
@@ -79,6 +79,21 @@ public:
         unsigned& copied       // actual data copied (1 <= copied <= len)
         );
 
+    // splitters that only inspect the data can opt in to gather() in place
+    // of reassemble().  gather() is then given whole, gap free pdus as a
+    // scatter-gather view of the queued segments.  the default returns the
+    // data by reference when the pdu is in a single segment and otherwise
+    // copies it to the pdu buffer.  referenced data is only valid until the
+    // pdu has been inspected.
+    virtual bool can_gather() { return false; }
+
+    virtual const StreamBuffer gather(
+        Flow*,
+        const StreamBuffer* segs,  // segment views in stream order
+        unsigned num,              // number of segments
+        unsigned total             // sum of segment lengths
+        );
+
     virtual bool is_paf() { return false; }
     virtual unsigned max(Flow* = nullptr);
     virtual unsigned adjust_to_fit(unsigned len) { return len; }
@@ -116,6 +131,8 @@ public:
     unsigned adjust_to_fit(unsigned len) override;
     void update() override;
 
+    bool can_gather() override { return true; }
+
 private:
     void reset();
 
@@ -134,6 +151,7 @@ public:
     LogSplitter(bool);
 
     Status scan(Packet*, const uint8_t*, uint32_t, uint32_t, uint32_t*) override;
+    bool can_gather() override { return true; }
 };
 
 //-------------------------------------------------------------------------
@@ -145,6 +163,7 @@ public:
     StopAndWaitSplitter(bool b) : StreamSplitter(b) { }
 
     Status scan(Packet*, const uint8_t*, uint32_t, uint32_t, uint32_t*) override;
+    bool can_gather() override { return true; }
 
 private:
     bool saw_data()
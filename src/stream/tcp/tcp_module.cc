@@ -108,6 +108,11 @@ const PegInfo tcp_pegs[] =
     { CountType::SUM, "partial_flush_bytes", "partial flush total bytes" },
     { CountType::SUM, "inspector_fallbacks", "count of fallbacks from assigned service inspector" },
     { CountType::SUM, "partial_fallbacks", "count of fallbacks from assigned service stream splitter" },
+    { CountType::SUM, "seg_pool_hits", "segments allocated from a free slab node" },
+    { CountType::SUM, "seg_pool_misses", "segments that required a new slab or direct allocation" },
+    { CountType::SUM, "pdu_bytes_copied", "reassembled bytes copied to the pdu buffer" },
+    { CountType::SUM, "pdu_bytes_referenced",
+        "reassembled bytes passed to inspection by reference to the segment" },
     { CountType::END, nullptr, nullptr }
 };
 
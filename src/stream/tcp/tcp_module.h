@@ -109,6 +109,10 @@ struct TcpStats
     PegCount partial_flush_bytes;
     PegCount inspector_fallbacks;
     PegCount partial_fallbacks;
+    PegCount seg_pool_hits;
+    PegCount seg_pool_misses;
+    PegCount pdu_bytes_copied;
+    PegCount pdu_bytes_referenced;
 };
 
 extern THREAD_LOCAL struct TcpStats tcpStats;
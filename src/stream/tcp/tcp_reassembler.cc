@@ -26,6 +26,7 @@
 #include "tcp_reassembler.h"
 
 #include "detection/detection_engine.h"
+#include "detection/fp_stream.h"
 #include "log/log.h"
 #include "main/analyzer.h"
 #include "memory/memory_cap.h"
@@ -366,8 +367,84 @@ void TcpReassembler::show_rebuilt_packet(const TcpReassemblerState& trs, Packet*
     }
 }
 
+// pdus spanning more segments than this are reassembled the usual way
+static constexpr unsigned max_gather_segs = 64;
+
+// gather a whole, gap free pdu for splitters that can take a view of the
+// segments; returns 0 if the pdu doesn't qualify.  a pdu that will be
+// offloaded or suspended is copied since the segments may be purged
+// before it is inspected.
+int TcpReassembler::gather_data_segments(TcpReassemblerState& trs, uint32_t flush_len, Packet* pdu)
+{
+    StreamSplitter* ss = trs.tracker->get_splitter();
+    Flow* flow = trs.sos.session->flow;
+
+    if ( !ss->can_gather() or flow->is_suspended() or
+        flush_len >= pdu->context->conf->offload_limit )
+        return 0;
+
+    StreamBuffer segs[max_gather_segs];
+    unsigned num = 0;
+    uint32_t remaining_bytes = flush_len;
+    TcpSegmentNode* tsn = trs.sos.seglist.cur_rseg;
+
+    while ( remaining_bytes )
+    {
+        if ( num == max_gather_segs )
+            return 0;
+
+        unsigned len = ( tsn->c_len <= remaining_bytes ) ? tsn->c_len : remaining_bytes;
+        segs[num++] = { tsn->payload(), len };
+        remaining_bytes -= len;
+
+        if ( remaining_bytes and !next_no_gap(*tsn) )
+            return 0;
+
+        tsn = tsn->next;
+    }
+
+    const StreamBuffer sb = ss->gather(flow, segs, num, flush_len);
+    pdu->data = sb.data;
+    pdu->dsize = sb.length;
+
+    if ( sb.data == segs[0].data )
+        tcpStats.pdu_bytes_referenced += flush_len;
+    else
+        tcpStats.pdu_bytes_copied += flush_len;
+
+    uint32_t to_seq = trs.sos.seglist.cur_rseg->c_seq + flush_len;
+
+    for ( unsigned i = 0; i < num; ++i )
+    {
+        tsn = trs.sos.seglist.cur_rseg;
+        tsn->c_seq += segs[i].length;
+        tsn->c_len -= segs[i].length;
+        tsn->offset += segs[i].length;
+
+        if ( !tsn->c_len )
+        {
+            trs.flush_count++;
+            update_next(trs, *tsn);
+        }
+    }
+
+    // see flush_data_segments()
+    if ( tsn->is_packet_missing(to_seq) )
+    {
+        if ( !trs.tracker->is_fin_seq_set() or
+            SEQ_LEQ(to_seq, trs.tracker->get_fin_final_seq()) )
+        {
+            trs.tracker->set_tf_flags(TF_MISSING_PKT);
+        }
+    }
+    return flush_len;
+}
+
 int TcpReassembler::flush_data_segments(TcpReassemblerState& trs, uint32_t flush_len, Packet* pdu)
 {
+    if ( int flushed = gather_data_segments(trs, flush_len, pdu) )
+        return flushed;
+
     uint32_t flags = PKT_PDU_HEAD;
     uint32_t to_seq = trs.sos.seglist.cur_rseg->c_seq + flush_len;
     uint32_t remaining_bytes = flush_len;
@@ -396,6 +473,7 @@ int TcpReassembler::flush_data_segments(TcpReassemblerState& trs, uint32_t flush
         }
 
         total_flushed += bytes_copied;
+        tcpStats.pdu_bytes_copied += bytes_copied;
         tsn->c_seq += bytes_copied;
         tsn->c_len -= bytes_copied;
         tsn->offset += bytes_copied;
@@ -511,6 +589,10 @@ int TcpReassembler::flush_to_seq(
     assert( trs.sos.seglist_base_seq == tsn->c_seq);
 
     Packet* pdu = initialize_pdu(trs, p, pkt_flags, tsn->tv);
+
+    // pdus have no tcp header so stream searches get the seq from here
+    FpStreamData::set_pdu_seq(pdu, tsn->c_seq);
+
     int32_t flushed_bytes = flush_data_segments(trs, bytes, pdu);
     assert( flushed_bytes );
 
@@ -568,6 +650,8 @@ int TcpReassembler::do_zero_byte_flush(TcpReassemblerState& trs, Packet* p, uint
      if ( sb.data )
      {
         Packet* pdu = initialize_pdu(trs, p, pkt_flags, p->pkth->ts);
+        FpStreamData::clear_pdu_seq(pdu);
+
         /* setup the pseudopacket payload */
         pdu->data = sb.data;
         pdu->dsize = sb.length;
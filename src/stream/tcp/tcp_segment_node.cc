@@ -25,6 +25,9 @@
 
 #include "tcp_segment_node.h"
 
+#include <cstdlib>
+#include <new>
+
 #include "main/thread.h"
 #include "memory/memory_cap.h"
 #include "utils/util.h"
@@ -32,64 +35,321 @@
 #include "segment_overlap_editor.h"
 #include "tcp_module.h"
 
-#define USE_RESERVE
-#ifdef USE_RESERVE
-static THREAD_LOCAL TcpSegmentNode* reserved = nullptr;
-static THREAD_LOCAL unsigned reserve_sz = 0;
+#ifdef UNIT_TEST
+#include <vector>
 
-static constexpr unsigned num_res = 4096;
-static constexpr unsigned res_min = 1024;
-static constexpr unsigned res_max = 1460;
+#include "catch/snort_catch.h"
 #endif
 
-void TcpSegmentNode::setup()
+//-------------------------------------------------------------------------
+// per thread slab allocator
+//
+// segments are carved from 64K slabs aligned on their size so the slab
+// header can be found from any node.  each size class keeps a doubly linked
+// free list (using the node prev / next) so that the nodes of a slab can be
+// unlinked when the slab becomes empty and is given back.  an empty slab is
+// only released when the class has at least another slab's worth of free
+// nodes to avoid thrashing at the boundary.  segments larger than the
+// largest class are allocated directly.
+//
+// each slab points to its pool so a segment always goes back where it came
+// from.  when the thread is done with the pool (clear) while flows still
+// hold segments, the pool is orphaned and deleted when the last of them is
+// released.  tcp.mem_in_use counts the payload bytes of live segments; the
+// slabs are charged to the memcap.
+//-------------------------------------------------------------------------
+
+namespace
 {
-#ifdef USE_RESERVE
-    reserved = nullptr;
-    reserve_sz = 0;
-#endif
+class SegmentPool;
+
+struct SegmentSlab
+{
+    SegmentPool* pool;
+    SegmentSlab* prev;
+    SegmentSlab* next;
+    unsigned size_class;
+    unsigned in_use;
+};
+
+struct SegmentClass
+{
+    TcpSegmentNode* free_list;
+    unsigned num_free;
+    unsigned per_slab;
+    unsigned node_size;
+    uint16_t cap;
+};
+
+static constexpr size_t slab_size = 64 * 1024;
+static constexpr size_t slab_hdr_size = (sizeof(SegmentSlab) + 63) & ~(size_t)63;
+
+static constexpr uint16_t class_caps[] =
+{ 128, 256, 512, 1024, 1536, 2048, 4096, 9216, 16384 };
+
+static constexpr unsigned num_classes = sizeof(class_caps) / sizeof(class_caps[0]);
+static constexpr uint16_t max_class_cap = class_caps[num_classes - 1];
+
+class SegmentPool
+{
+public:
+    SegmentPool();
+    ~SegmentPool();
+
+    TcpSegmentNode* get(uint16_t len);
+    static void put(TcpSegmentNode*);
+
+    void orphan();
+
+private:
+    static unsigned get_class(uint16_t len);
+    static SegmentSlab* get_slab(TcpSegmentNode* tsn)
+    { return (SegmentSlab*)((uintptr_t)tsn & ~(uintptr_t)(slab_size - 1)); }
+
+    void link(SegmentClass&, TcpSegmentNode*);
+    void unlink(SegmentClass&, TcpSegmentNode*);
+
+    void add_slab(unsigned size_class);
+    void release_slab(SegmentSlab*);
+    void release(TcpSegmentNode*);
+
+    SegmentClass classes[num_classes];
+    SegmentSlab* slabs = nullptr;
+    unsigned live = 0;
+    bool orphaned = false;
+};
 }
 
-void TcpSegmentNode::clear()
+SegmentPool::SegmentPool()
 {
-#ifdef USE_RESERVE
-    while ( reserved )
+    for ( unsigned i = 0; i < num_classes; ++i )
     {
-        TcpSegmentNode* tsn = reserved;
-        reserved = reserved->next;
-        memory::MemoryCap::update_deallocations(sizeof(*tsn) + tsn->size);
-        tcpStats.mem_in_use -= tsn->size;
-        snort_free(tsn);
+        SegmentClass& sc = classes[i];
+        sc.free_list = nullptr;
+        sc.num_free = 0;
+        sc.cap = class_caps[i];
+        sc.node_size = (sizeof(TcpSegmentNode) + sc.cap + 7) & ~7u;
+        sc.per_slab = (slab_size - slab_hdr_size) / sc.node_size;
     }
-    reserve_sz = 0;
-#endif
 }
 
-//-------------------------------------------------------------------------
-// TcpSegment stuff
-//-------------------------------------------------------------------------
+SegmentPool::~SegmentPool()
+{
+    while ( slabs )
+    {
+        SegmentSlab* slab = slabs;
+        slabs = slab->next;
 
-TcpSegmentNode* TcpSegmentNode::create(
-    const struct timeval& tv, const uint8_t* payload, uint16_t len)
+        memory::MemoryCap::update_deallocations(slab_size);
+        free(slab);
+    }
+}
+
+unsigned SegmentPool::get_class(uint16_t len)
 {
-    TcpSegmentNode* tsn;
+    unsigned i = 0;
+
+    while ( class_caps[i] < len )
+        ++i;
+
+    return i;
+}
+
+void SegmentPool::link(SegmentClass& sc, TcpSegmentNode* tsn)
+{
+    tsn->prev = nullptr;
+    tsn->next = sc.free_list;
 
-#ifdef USE_RESERVE
-    if ( reserved and len > res_min and len <= res_max )
+    if ( sc.free_list )
+        sc.free_list->prev = tsn;
+
+    sc.free_list = tsn;
+    sc.num_free++;
+}
+
+void SegmentPool::unlink(SegmentClass& sc, TcpSegmentNode* tsn)
+{
+    if ( tsn->prev )
+        tsn->prev->next = tsn->next;
+    else
+        sc.free_list = tsn->next;
+
+    if ( tsn->next )
+        tsn->next->prev = tsn->prev;
+
+    sc.num_free--;
+}
+
+void SegmentPool::add_slab(unsigned size_class)
+{
+    void* p = nullptr;
+
+    if ( posix_memalign(&p, slab_size, slab_size) )
+        throw std::bad_alloc();
+
+    memory::MemoryCap::update_allocations(slab_size);
+
+    SegmentSlab* slab = (SegmentSlab*)p;
+    slab->pool = this;
+    slab->size_class = size_class;
+    slab->in_use = 0;
+
+    slab->prev = nullptr;
+    slab->next = slabs;
+
+    if ( slabs )
+        slabs->prev = slab;
+
+    slabs = slab;
+
+    SegmentClass& sc = classes[size_class];
+    uint8_t* node = (uint8_t*)p + slab_hdr_size;
+
+    for ( unsigned i = 0; i < sc.per_slab; ++i, node += sc.node_size )
     {
-        tsn = reserved;
-        reserved = tsn->next;
-        --reserve_sz;
+        link(sc, (TcpSegmentNode*)node);
     }
+}
+
+void SegmentPool::release_slab(SegmentSlab* slab)
+{
+    SegmentClass& sc = classes[slab->size_class];
+    uint8_t* node = (uint8_t*)slab + slab_hdr_size;
+
+    for ( unsigned i = 0; i < sc.per_slab; ++i, node += sc.node_size )
+        unlink(sc, (TcpSegmentNode*)node);
+
+    if ( slab->prev )
+        slab->prev->next = slab->next;
     else
-#endif
+        slabs = slab->next;
+
+    if ( slab->next )
+        slab->next->prev = slab->prev;
+
+    memory::MemoryCap::update_deallocations(slab_size);
+    free(slab);
+}
+
+TcpSegmentNode* SegmentPool::get(uint16_t len)
+{
+    TcpSegmentNode* tsn;
+    tcpStats.mem_in_use += len;
+
+    if ( len > max_class_cap )
     {
         size_t size = sizeof(*tsn) + len;
         memory::MemoryCap::update_allocations(size);
+        tcpStats.seg_pool_misses++;
+
         tsn = (TcpSegmentNode*)snort_alloc(size);
         tsn->size = len;
-        tcpStats.mem_in_use += len;
+        return tsn;
     }
+
+    unsigned size_class = get_class(len);
+    SegmentClass& sc = classes[size_class];
+
+    if ( sc.free_list )
+        tcpStats.seg_pool_hits++;
+
+    else
+    {
+        tcpStats.seg_pool_misses++;
+        add_slab(size_class);
+    }
+
+    tsn = sc.free_list;
+    unlink(sc, tsn);
+    get_slab(tsn)->in_use++;
+    live++;
+
+    tsn->size = len;
+    return tsn;
+}
+
+void SegmentPool::put(TcpSegmentNode* tsn)
+{
+    tcpStats.mem_in_use -= tsn->size;
+
+    if ( tsn->size > max_class_cap )
+    {
+        memory::MemoryCap::update_deallocations(sizeof(*tsn) + tsn->size);
+        snort_free(tsn);
+        return;
+    }
+    get_slab(tsn)->pool->release(tsn);
+}
+
+void SegmentPool::release(TcpSegmentNode* tsn)
+{
+    SegmentSlab* slab = get_slab(tsn);
+    SegmentClass& sc = classes[slab->size_class];
+
+    link(sc, tsn);
+    live--;
+
+    // an orphaned pool won't allocate again so its empty slabs are given back
+    if ( !--slab->in_use and (orphaned or sc.num_free >= 2 * sc.per_slab) )
+        release_slab(slab);
+
+    if ( orphaned and !live )
+        delete this;
+}
+
+void SegmentPool::orphan()
+{
+    if ( !live )
+    {
+        delete this;
+        return;
+    }
+    orphaned = true;
+
+    SegmentSlab* slab = slabs;
+
+    while ( slab )
+    {
+        SegmentSlab* next = slab->next;
+
+        if ( !slab->in_use )
+            release_slab(slab);
+
+        slab = next;
+    }
+}
+
+static THREAD_LOCAL SegmentPool* seg_pool = nullptr;
+
+void TcpSegmentNode::setup()
+{
+    if ( !seg_pool )
+        seg_pool = new SegmentPool;
+}
+
+// flows that outlive the pool (stream_tcp removed on reload, dirty_pig)
+// still release their segments to it
+void TcpSegmentNode::clear()
+{
+    if ( seg_pool )
+    {
+        seg_pool->orphan();
+        seg_pool = nullptr;
+    }
+}
+
+//-------------------------------------------------------------------------
+// TcpSegment stuff
+//-------------------------------------------------------------------------
+
+TcpSegmentNode* TcpSegmentNode::create(
+    const struct timeval& tv, const uint8_t* payload, uint16_t len)
+{
+    if ( !seg_pool )
+        setup();
+
+    TcpSegmentNode* tsn = seg_pool->get(len);
+
     tsn->tv = tv;
     tsn->i_len = tsn->c_len = len;
     memcpy(tsn->data, payload, len);
@@ -114,20 +374,7 @@ TcpSegmentNode* TcpSegmentNode::init(TcpSegmentNode& tns)
 
 void TcpSegmentNode::term()
 {
-#ifdef USE_RESERVE
-    if ( size == res_max and reserve_sz < num_res )
-    {
-        next = reserved;
-        reserved = this;
-        reserve_sz++;
-    }
-    else
-#endif
-    {
-        memory::MemoryCap::update_deallocations(sizeof(*this) + size);
-        tcpStats.mem_in_use -= size;
-        snort_free(this);
-    }
+    SegmentPool::put(this);
     tcpStats.segs_released++;
 }
 
@@ -155,3 +402,107 @@ bool TcpSegmentNode::is_retransmit(const uint8_t* rdata, uint16_t rsize,
 
     return false;
 }
+
+#ifdef UNIT_TEST
+TEST_CASE("segment pool", "[tcp_segment_node]")
+{
+    TcpSegmentNode::clear();
+    tcpStats.seg_pool_hits = tcpStats.seg_pool_misses = tcpStats.mem_in_use = 0;
+
+    // source segment for TcpSegmentNode::init()
+    std::vector<uint8_t> raw(sizeof(TcpSegmentNode) + 65535);
+    TcpSegmentNode* src = (TcpSegmentNode*)raw.data();
+    src->tv = { 0, 0 };
+    src->offset = 0;
+
+    for ( unsigned i = 0; i < 65535; ++i )
+        src->data[i] = (uint8_t)i;
+
+    auto create = [src](uint16_t len)
+    {
+        src->c_len = len;
+        return TcpSegmentNode::init(*src);
+    };
+
+    SECTION("sizes")
+    {
+        const uint16_t lens[] = { 1, 128, 129, 1460, 1537, 9000, 16384, 16385, 65535 };
+        std::vector<TcpSegmentNode*> segs;
+
+        for ( auto len : lens )
+        {
+            TcpSegmentNode* tsn = create(len);
+            CHECK(tsn->size >= len);
+            CHECK(!memcmp(tsn->payload(), src->data, len));
+            segs.emplace_back(tsn);
+        }
+        CHECK(tcpStats.seg_pool_hits == 1);
+        CHECK(tcpStats.seg_pool_misses == 8);
+
+        for ( auto tsn : segs )
+            tsn->term();
+
+        // only payload bytes are counted
+        CHECK(tcpStats.mem_in_use == 0);
+
+        TcpSegmentNode* tsn = create(1460);
+        CHECK(tcpStats.mem_in_use == 1460);
+        CHECK(tcpStats.seg_pool_hits == 2);
+        tsn->term();
+    }
+    SECTION("release")
+    {
+        std::vector<TcpSegmentNode*> segs;
+        unsigned per_slab = (slab_size - slab_hdr_size) / ((sizeof(TcpSegmentNode) + 1024 + 7) & ~7u);
+        unsigned n = 4 * per_slab;
+
+        for ( unsigned i = 0; i < n; ++i )
+            segs.emplace_back(create(1000));
+
+        CHECK(tcpStats.mem_in_use == n * 1000);
+
+        for ( auto tsn : segs )
+            tsn->term();
+
+        CHECK(tcpStats.mem_in_use == 0);
+        segs.clear();
+
+        // at least one slab's worth of spares is kept but not all
+        tcpStats.seg_pool_misses = 0;
+
+        for ( unsigned i = 0; i < per_slab; ++i )
+            segs.emplace_back(create(1000));
+
+        CHECK(tcpStats.seg_pool_misses == 0);
+
+        for ( unsigned i = per_slab; i < n; ++i )
+            segs.emplace_back(create(1000));
+
+        CHECK(tcpStats.seg_pool_misses > 0);
+
+        for ( auto tsn : segs )
+            tsn->term();
+    }
+    SECTION("orphaned pool")
+    {
+        // like flows that still hold segments when stream_tcp is removed
+        std::vector<TcpSegmentNode*> segs;
+
+        for ( uint16_t len : { 100, 1460, 1460, 9000, 20000 } )
+            segs.emplace_back(create(len));
+
+        TcpSegmentNode::clear();
+
+        TcpSegmentNode* tsn = create(1460);
+        CHECK(!memcmp(tsn->payload(), src->data, 1460));
+
+        for ( auto old : segs )
+            old->term();
+
+        CHECK(tcpStats.mem_in_use == 1460);
+        tsn->term();
+    }
+    TcpSegmentNode::clear();
+    CHECK(tcpStats.mem_in_use == 0);
+}
+#endif
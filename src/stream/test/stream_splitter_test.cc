@@ -51,8 +51,13 @@ Packet::~Packet() { }
 struct Packet* DetectionEngine::get_current_packet()
 { return nullptr; }
 
-uint8_t* DetectionEngine::get_next_buffer(unsigned int&)
-{ return nullptr; }
+static uint8_t pdu_buf[1024];
+
+uint8_t* DetectionEngine::get_next_buffer(unsigned int& max)
+{
+    max = sizeof(pdu_buf);
+    return pdu_buf;
+}
 
 StreamSplitter* Stream::get_splitter(Flow*, bool)
 { return next_splitter; }
@@ -165,6 +170,46 @@ TEST(other_splitter, stop_and_wait)
     CHECK(flushed == 2);
 }
 
+//--------------------------------------------------------------------------
+// gather tests
+//--------------------------------------------------------------------------
+
+TEST_GROUP(gather) { };
+
+TEST(gather, opt_in)
+{
+    AtomSplitter as(true);
+    LogSplitter ls(true);
+    StopAndWaitSplitter ws(true);
+
+    CHECK(as.can_gather());
+    CHECK(ls.can_gather());
+    CHECK(ws.can_gather());
+}
+
+TEST(gather, reference)
+{
+    LogSplitter s(true);
+    const uint8_t data[] = "abcdef";
+    StreamBuffer seg = { data, 6 };
+
+    const StreamBuffer sb = s.gather(nullptr, &seg, 1, 6);
+    CHECK(sb.data == data);
+    CHECK(sb.length == 6);
+}
+
+TEST(gather, copy)
+{
+    LogSplitter s(true);
+    const uint8_t data[] = "abcdef";
+    StreamBuffer segs[3] = { { data + 4, 2 }, { data, 3 }, { data + 3, 1 } };
+
+    const StreamBuffer sb = s.gather(nullptr, segs, 3, 6);
+    CHECK(sb.data == pdu_buf);
+    CHECK(sb.length == 6);
+    CHECK(!memcmp(sb.data, "efabcd", 6));
+}
+
 //-------------------------------------------------------------------------
 // main
 //-------------------------------------------------------------------------
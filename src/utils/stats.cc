@@ -207,6 +207,8 @@ const PegInfo pc_names[] =
     { CountType::SUM, "pcre_match_limit", "total number of times pcre hit the match limit" },
     { CountType::SUM, "pcre_recursion_limit", "total number of times pcre hit the recursion limit" },
     { CountType::SUM, "pcre_error", "total number of times pcre returns error" },
+    { CountType::SUM, "stream_searches", "fast pattern searches continued from the previous PDU" },
+    { CountType::SUM, "stream_resets", "fast pattern search streams restarted due to a gap" },
     { CountType::END, nullptr, nullptr }
 };
 
@@ -69,6 +69,8 @@ struct PacketCount
     PegCount pcre_match_limit;
     PegCount pcre_recursion_limit;
     PegCount pcre_error;
+    PegCount stream_searches;
+    PegCount stream_resets;
 };
 
 struct ProcessCount
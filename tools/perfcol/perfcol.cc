@@ -0,0 +1,518 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+//  This program expands the columnar files written by perf_monitor with
+//  format = columnar back into the csv or json that the csv and json
+//  formatters would have written for the same samples.
+
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define OPT_INFILE     0x1
+#define OPT_BEFORE     0x2
+#define OPT_AFTER      0x4
+#define OPT_TAIL       0x8
+#define OPT_JSON       0x10
+
+// sanity limits for corrupt files
+#define MAX_SCHEMA     (16 * 1024 * 1024)
+#define MAX_RECORD     (64 * 1024 * 1024)
+#define MAX_VECTOR     (1024 * 1024)
+
+using namespace std;
+
+struct Column
+{
+    char type;
+    string section;
+    string field;
+};
+
+string in_file;
+uint64_t b_stamp = 0, a_stamp = 0;
+uint8_t opt_flags = 0;
+bool done = false;
+FILE* file;
+
+static vector<Column> columns;
+static vector<uint64_t> pegs;
+static vector<string> strings;
+static vector<vector<uint64_t>> vectors;
+
+static void help()
+{
+    cout << "Columnar perf_monitor reader for Snort 3\n\n"
+         << "Records are output as csv or as a json array\n\n"
+         << "Usage: perfcol -i file [-j] [-b time] [-a time] [-t]\n"
+         << "-i: columnar records file from Snort (required)\n"
+         << "-j: output json instead of csv\n"
+         << "-b: Output all records before or equal to this timestamp\n"
+         << "-a: Output all records after or equal to this timestamp\n"
+         << "-t: Tail mode for reading live files\n";
+}
+
+static void error(const string& e)
+{
+    if( done )
+        return;
+
+    cout.flush();
+    cerr << "perfcol: " << e << "\n";
+    if( file )
+        fclose(file);
+    exit(-1);
+}
+
+static bool tail_read(void* buf, size_t size)
+{
+    bool tail = opt_flags & OPT_TAIL;
+
+    if( ferror(file) || (feof(file) && !tail) )
+        return false;
+
+    size_t to_read = size;
+    do {
+        if( tail )
+            clearerr(file);
+
+        to_read -= fread((char*)buf + (size - to_read), 1, to_read, file);
+
+        if( to_read && tail && !done )
+            usleep(100000);
+
+    } while( to_read && tail && !done );
+
+    if( tail )
+        clearerr(file);
+
+    return !to_read;
+}
+
+static void sigint_handler(int)
+{ done = true; }
+
+static bool handle_options(int argc, char* argv[])
+{
+    int opt;
+    while( (opt = getopt(argc, argv, "i:b:a:jt")) != -1 )
+    {
+        switch(opt)
+        {
+            case 'i':
+                in_file = optarg;
+                opt_flags |= OPT_INFILE;
+                break;
+
+            case 'b':
+                b_stamp = strtoull(optarg, nullptr, 10);
+                opt_flags |= OPT_BEFORE;
+                break;
+
+            case 'a':
+                a_stamp = strtoull(optarg, nullptr, 10);
+                opt_flags |= OPT_AFTER;
+                break;
+
+            case 'j':
+                opt_flags |= OPT_JSON;
+                break;
+
+            case 't':
+                opt_flags |= OPT_TAIL;
+                break;
+
+            default:
+                help();
+                return false;
+        }
+    }
+    return true;
+}
+
+static void load_schema()
+{
+    char magic[4];
+    uint32_t size;
+
+    if( !tail_read(magic, sizeof(magic)) || string(magic, sizeof(magic)) != "PCOL" )
+        error("Unknown file magic");
+
+    if( !tail_read(&size, sizeof(size)) )
+        error("Unable to read schema size");
+
+    size = ntohl(size);
+
+    if( size > MAX_SCHEMA )
+        error("Schema is too large");
+
+    string schema(size, '\0');
+
+    if( size && !tail_read(&schema[0], size) )
+        error("Unable to read schema");
+
+    istringstream ss(schema);
+    Column c;
+    string type;
+
+    while( ss >> type >> c.section >> c.field )
+    {
+        if( type != "p" && type != "s" && type != "v" )
+            error("Unknown column type " + type);
+
+        c.type = type[0];
+        columns.emplace_back(c);
+    }
+
+    pegs.resize(columns.size());
+    strings.resize(columns.size());
+    vectors.resize(columns.size());
+}
+
+class Record
+{
+public:
+    Record(const vector<uint8_t>& buf) : p(buf.data()), end(buf.data() + buf.size()) { }
+
+    uint64_t varint()
+    {
+        uint64_t v = 0;
+
+        for( unsigned shift = 0; shift < 64; shift += 7 )
+        {
+            if( p == end )
+                error("Record is truncated");
+
+            uint8_t b = *p++;
+            v |= (uint64_t)(b & 0x7f) << shift;
+
+            if( !(b & 0x80) )
+                return v;
+        }
+        error("Bad varint");
+        return 0;
+    }
+
+    // apply a signed delta to the previous value
+    uint64_t delta(uint64_t prev)
+    {
+        uint64_t v = varint();
+        return prev + ((v >> 1) ^ (~(v & 1) + 1));
+    }
+
+    string bytes(uint64_t len)
+    {
+        if( (uint64_t)(end - p) < len )
+            error("Record is truncated");
+
+        string s((const char*)p, len);
+        p += len;
+        return s;
+    }
+
+    bool empty()
+    { return p == end; }
+
+private:
+    const uint8_t* p;
+    const uint8_t* end;
+};
+
+// returns false at the end of the file
+static bool read_record(vector<uint8_t>& buf)
+{
+    uint64_t len = 0;
+
+    for( unsigned shift = 0; ; shift += 7 )
+    {
+        uint8_t b;
+
+        if( !tail_read(&b, 1) )
+        {
+            if( shift )
+                error("Record is truncated");
+            return false;
+        }
+
+        if( shift > 63 )
+            error("Bad record length");
+
+        len |= (uint64_t)(b & 0x7f) << shift;
+
+        if( !(b & 0x80) )
+            break;
+    }
+
+    if( len > MAX_RECORD )
+        error("Record is too large");
+
+    buf.resize(len);
+
+    if( len && !tail_read(buf.data(), len) )
+        error("Record is truncated");
+
+    return true;
+}
+
+static void apply(Record& r, uint64_t& timestamp)
+{
+    timestamp = r.delta(timestamp);
+
+    uint64_t changed = r.varint();
+    uint64_t col = 0;
+
+    while( changed-- )
+    {
+        col += r.varint();
+
+        if( col >= columns.size() )
+            error("Column is out of range");
+
+        switch( columns[col].type )
+        {
+            case 'p':
+                pegs[col] = r.delta(pegs[col]);
+                break;
+
+            case 's':
+                strings[col] = r.bytes(r.varint());
+                break;
+
+            case 'v':
+            {
+                auto& v = vectors[col];
+                uint64_t size = r.varint();
+                uint64_t n = r.varint();
+                uint64_t k = 0;
+
+                if( size > MAX_VECTOR )
+                    error("Vector is too large");
+
+                v.resize(size);
+
+                while( n-- )
+                {
+                    k += r.varint();
+
+                    if( k >= size )
+                        error("Vector index is out of range");
+
+                    v[k] = r.delta(v[k]);
+                    k++;
+                }
+                break;
+            }
+        }
+        col++;
+    }
+
+    if( !r.empty() )
+        error("Record has trailing data");
+}
+
+static void csv_header()
+{
+    cout << "#timestamp";
+
+    for( auto& c : columns )
+        cout << "," << c.section << "." << c.field;
+
+    cout << "\n";
+}
+
+static void csv_record(uint64_t timestamp)
+{
+    cout << timestamp;
+
+    for( unsigned i = 0; i < columns.size(); i++ )
+    {
+        switch( columns[i].type )
+        {
+            case 'p':
+                cout << "," << pegs[i];
+                break;
+
+            case 's':
+                cout << "," << strings[i];
+                break;
+
+            case 'v':
+            {
+                uint64_t size = 0;
+                ostringstream ss;
+
+                for( auto pc : vectors[i] )
+                {
+                    if( pc )
+                    {
+                        ss << "," << pc;
+                        size++;
+                    }
+                }
+                cout << "," << size << ss.str();
+                break;
+            }
+        }
+    }
+    cout << "\n";
+}
+
+static void json_record(uint64_t timestamp, bool first)
+{
+    if( !first )
+        cout << ",";
+
+    cout << "{\"timestamp\":" << timestamp;
+
+    const string* section = nullptr;
+    bool head = false;
+
+    for( unsigned i = 0; i < columns.size(); i++ )
+    {
+        if( !section || *section != columns[i].section )
+        {
+            if( head )
+                cout << "}";
+
+            section = &columns[i].section;
+            head = false;
+        }
+
+        switch( columns[i].type )
+        {
+            case 'p':
+            case 's':
+                if( columns[i].type == 'p' ? !pegs[i] : strings[i].empty() )
+                    continue;
+
+                cout << (head ? "," : ",\"" + *section + "\":{");
+                head = true;
+
+                cout << "\"" << columns[i].field << "\":";
+
+                if( columns[i].type == 'p' )
+                    cout << pegs[i];
+                else
+                    cout << "\"" << strings[i] << "\"";
+                break;
+
+            case 'v':
+            {
+                bool vec_head = false;
+                auto& v = vectors[i];
+
+                for( unsigned k = 0; k < v.size(); k++ )
+                {
+                    if( !v[k] )
+                        continue;
+
+                    if( !vec_head )
+                    {
+                        cout << (head ? "," : ",\"" + *section + "\":{");
+                        head = true;
+
+                        cout << "\"" << columns[i].field << "\":{";
+                        vec_head = true;
+                    }
+                    else
+                        cout << ",";
+
+                    cout << "\"" << k << "\":" << v[k];
+                }
+                if( vec_head )
+                    cout << "}";
+
+                break;
+            }
+        }
+    }
+    if( head )
+        cout << "}";
+
+    cout << "}";
+}
+
+int main(int argc, char* argv[])
+{
+    signal(SIGINT, sigint_handler);
+
+    if( !handle_options(argc, argv) )
+        return 1;
+
+    if( !(opt_flags & OPT_INFILE) )
+    {
+        help();
+        return 1;
+    }
+
+    file = fopen(in_file.c_str(), "rb");
+    if( !file )
+        error("Unable to open file");
+
+    load_schema();
+
+    bool json = opt_flags & OPT_JSON;
+
+    if( json )
+        cout << "[";
+    else
+        csv_header();
+
+    vector<uint8_t> buf;
+    uint64_t timestamp = 0;
+    bool first = true;
+
+    // every record is applied since each one is relative to the last
+    while( !done && read_record(buf) )
+    {
+        Record r(buf);
+        apply(r, timestamp);
+
+        if( (opt_flags & OPT_BEFORE) && timestamp > b_stamp )
+            break;
+
+        if( (opt_flags & OPT_AFTER) && timestamp < a_stamp )
+            continue;
+
+        if( json )
+            json_record(timestamp, first);
+        else
+            csv_record(timestamp);
+
+        first = false;
+
+        if( opt_flags & OPT_TAIL )
+            cout.flush();
+    }
+
+    if( json )
+        cout << "]\n";
+
+    fclose(file);
+    return 0;
+}
+
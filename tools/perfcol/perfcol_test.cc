@@ -0,0 +1,205 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2020-2020 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// perfcol_test.cc writes the same samples with the columnar, csv, and json
+// formatters and checks that perfcol turns the columnar file back into the
+// other two.  PERFCOL is the path of the perfcol built with this test.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "catch/catch.hpp"
+
+#include "network_inspectors/perf_monitor/columnar_formatter.h"
+#include "network_inspectors/perf_monitor/csv_formatter.h"
+#include "network_inspectors/perf_monitor/json_formatter.h"
+
+using namespace std;
+
+static string read_file(FILE* fh)
+{
+    fflush(fh);
+    fseek(fh, 0, SEEK_END);
+
+    auto size = ftell(fh);
+    string s(size, '\0');
+
+    rewind(fh);
+
+    if ( size )
+        REQUIRE(fread(&s[0], size, 1, fh) == 1);
+
+    return s;
+}
+
+static string perfcol(const string& args)
+{
+    string cmd = string(PERFCOL) + " " + args;
+    FILE* pipe = popen(cmd.c_str(), "r");
+    REQUIRE(pipe);
+
+    string out;
+    char buf[1024];
+    size_t n;
+
+    while ( (n = fread(buf, 1, sizeof(buf), pipe)) > 0 )
+        out.append(buf, n);
+
+    CHECK(pclose(pipe) == 0);
+    return out;
+}
+
+// keeps only the header and the records from after to before
+static string csv_range(const string& csv, time_t after, time_t before)
+{
+    string out;
+    size_t pos = 0;
+
+    while ( pos < csv.size() )
+    {
+        size_t end = csv.find('\n', pos) + 1;
+
+        if ( csv[pos] == '#' )
+            out += csv.substr(pos, end - pos);
+
+        else
+        {
+            time_t t = strtoll(csv.c_str() + pos, nullptr, 10);
+
+            if ( t >= after and t <= before )
+                out += csv.substr(pos, end - pos);
+        }
+        pos = end;
+    }
+    return out;
+}
+
+TEST_CASE("perfcol round trip", "[perfcol]")
+{
+    PegCount one = 0, two = 0, three = 0, four = 0;
+    char five[32] = "";
+    vector<PegCount> kvp;
+
+    ColumnarFormatter col("perfcol");
+    CSVFormatter csv("perfcol");
+    JSONFormatter json("perfcol");
+    vector<PerfFormatter*> formatters { &col, &csv, &json };
+
+    for ( auto f : formatters )
+    {
+        f->register_section("name");
+        f->register_field("one", &one);
+        f->register_field("two", &two);
+        f->register_section("other");
+        f->register_field("three", &three);
+        f->register_field("five", five);
+        f->register_field("kvp", &kvp);
+        f->register_section("empty");
+        f->register_section("last");
+        f->register_field("four", &four);
+        f->finalize_fields();
+    }
+
+    char col_name[] = "/tmp/perfcol_test_XXXXXX";
+    int fd = mkstemp(col_name);
+    REQUIRE(fd >= 0);
+
+    FILE* col_fh = fdopen(fd, "w+");
+    FILE* csv_fh = tmpfile();
+    FILE* json_fh = tmpfile();
+    REQUIRE(col_fh);
+    REQUIRE(csv_fh);
+    REQUIRE(json_fh);
+
+    vector<FILE*> files { col_fh, csv_fh, json_fh };
+
+    for ( unsigned i = 0; i < formatters.size(); i++ )
+        formatters[i]->init_output(files[i]);
+
+    auto sample = [&](time_t t)
+    {
+        for ( unsigned i = 0; i < formatters.size(); i++ )
+            formatters[i]->write(files[i], t);
+    };
+
+    // all zero
+    sample(1000);
+
+    one = 1;
+    three = 300;
+    strcpy(five, "hi");
+    kvp = { 50, 0, 70 };
+    sample(1001);
+
+    // nothing changed
+    sample(1002);
+
+    // pegs are reset, strings emptied, vector entries zeroed
+    one = 0;
+    two = 2;
+    five[0] = '\0';
+    kvp[0] = 0;
+    kvp[2] = 71;
+    sample(1005);
+
+    // the largest peg and a vector that grows
+    three = UINT64_MAX;
+    four = 1ULL << 40;
+    strcpy(five, "a longer string");
+    kvp.resize(1000);
+    kvp[999] = 9;
+    sample(1006);
+
+    // and shrinks
+    three = 5;
+    kvp.resize(2);
+    sample(1010);
+
+    kvp.clear();
+    four = 0;
+    sample(1011);
+
+    // the clock may be set back
+    one = 7;
+    sample(900);
+
+    json.finalize_output(json_fh);
+
+    string csv_out = read_file(csv_fh);
+    string json_out = read_file(json_fh);
+    fclose(col_fh);
+
+    CHECK(perfcol(string("-i ") + col_name) == csv_out);
+    CHECK(perfcol(string("-j -i ") + col_name) == json_out);
+
+    // records outside the range are still applied
+    CHECK(perfcol(string("-a 1005 -b 1006 -i ") + col_name) == csv_range(csv_out, 1005, 1006));
+
+    fclose(csv_fh);
+    fclose(json_fh);
+    unlink(col_name);
+}